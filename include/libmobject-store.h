@@ -46,6 +46,10 @@ enum {
    */
   LIBMOBJECT_OPERATION_FULL_FORCE		= 128,
   LIBMOBJECT_OPERATION_IGNORE_REDIRECT	= 256,
+  /* writes complete once the data is stored and logged by the server,
+     and become safe later, when the server has persisted them together
+     with other writes; only honored on pools without replication */
+  LIBMOBJECT_OPERATION_DEFER_PERSIST     = 512,
 };
 /** @} */
 
@@ -140,6 +144,15 @@ typedef struct mobject_store_completion* mobject_store_completion_t;
 
 #define MOBJECT_COMPLETION_NULL ((mobject_store_completion_t)0)
 
+/**
+ * @typedef mobject_store_completion_queue_t
+ * Collects the completions created with
+ * mobject_store_aio_create_queued_completion() as their operation
+ * completes, so that many in-flight operations can be reaped with
+ * a single call to mobject_store_completion_queue_reap().
+ */
+typedef struct mobject_store_completion_queue* mobject_store_completion_queue_t;
+
 /*****************************************
  * mobject store setup/teardown routines *
  *****************************************/
@@ -178,6 +191,107 @@ int mobject_store_connect(mobject_store_t cluster);
  */
 void mobject_store_shutdown(mobject_store_t cluster);
 
+/**
+ * Sets how large reads and writes are split. An operation made of a
+ * single read or a single write of at least 2*chunk_size bytes is sent
+ * as up to max_requests concurrent requests over disjoint ranges of
+ * the object, which lets the server process them on several execution
+ * streams. A split write is not atomic. Splitting is disabled by
+ * default, and can also be set with the MOBJECT_SPLIT_SIZE and
+ * MOBJECT_SPLIT_REQUESTS environment variables.
+ *
+ * @param[in] cluster       handle to mobject cluster
+ * @param[in] chunk_size    granularity of the ranges, 0 to disable splitting
+ * @param[in] max_requests  maximum number of requests per operation
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_store_set_split(
+    mobject_store_t cluster,
+    size_t chunk_size,
+    unsigned max_requests);
+
+/**
+ * Sets how long each attempt of an operation waits for a response, 0
+ * (the default) meaning forever, and how many times a read that timed
+ * out is sent again, waiting backoff_ms milliseconds before the first
+ * retry and doubling this delay for each following one. Writes are only
+ * retried if retry_writes is set, since a write that timed out may have
+ * been applied. These can also be set with the MOBJECT_TIMEOUT,
+ * MOBJECT_RETRIES, MOBJECT_RETRY_BACKOFF and MOBJECT_RETRY_WRITES
+ * environment variables.
+ *
+ * @param[in] cluster       handle to a connected mobject cluster
+ * @param[in] timeout_ms    timeout of each attempt, in milliseconds
+ * @param[in] max_retries   number of times an operation is sent again
+ * @param[in] backoff_ms    delay before the first retry, in milliseconds
+ * @param[in] retry_writes  whether writes are retried too
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_store_set_timeout(
+    mobject_store_t cluster,
+    double timeout_ms,
+    unsigned max_retries,
+    double backoff_ms,
+    int retry_writes);
+
+/**
+ * Enables hedged reads on replicated pools: if the replica a read was
+ * sent to has not answered after the given percentile of the latencies
+ * of recent reads (and at least min_delay_ms), the read is also sent to
+ * another replica, and whichever request is answered last is cancelled.
+ * Hedging is disabled by default, and can also be set with the
+ * MOBJECT_HEDGE_PERCENTILE and MOBJECT_HEDGE_MIN_DELAY environment
+ * variables. Range-split reads are not hedged.
+ *
+ * @param[in] cluster       handle to a connected mobject cluster
+ * @param[in] percentile    percentile of the read latencies, 0 to disable hedging
+ * @param[in] min_delay_ms  smallest delay before hedging, in milliseconds
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_store_set_hedging(
+    mobject_store_t cluster,
+    double percentile,
+    double min_delay_ms);
+
+/**
+ * Returns the number of timeouts, retries and hedged reads of the
+ * operations issued through the cluster handle.
+ *
+ * @param[in] cluster   handle to a connected mobject cluster
+ * @param[out] stats    resulting counters
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_store_get_client_stats(
+    mobject_store_t cluster,
+    mobject_client_stats_t *stats);
+
+/**
+ * Allocates a buffer in memory that is registered for RDMA once and for
+ * all. Reads and writes whose buffers come from mobject_store_alloc_buffer
+ * skip the registration of their memory. The regions buffers are taken
+ * from can be sized with the MOBJECT_BUFFER_REGION_SIZE environment
+ * variable, and backed by huge pages by setting MOBJECT_BUFFER_HUGE_PAGES
+ * to 1.
+ *
+ * @param[in] cluster   handle to a connected mobject cluster
+ * @param[in] len       size of the buffer
+ * @returns the buffer, or NULL on failure
+ */
+char *mobject_store_alloc_buffer(
+    mobject_store_t cluster,
+    size_t len);
+
+/**
+ * Frees a buffer allocated with mobject_store_alloc_buffer.
+ * Must be called before mobject_store_shutdown.
+ *
+ * @param[in] cluster   handle to mobject cluster
+ * @param[in] buf       buffer to free
+ */
+void mobject_store_free_buffer(
+    mobject_store_t cluster,
+    char *buf);
+
 /**********************************************
  * mobject store pool setup/teardown routines *
  **********************************************/
@@ -275,6 +389,19 @@ void mobject_store_write_op_write(mobject_store_write_op_t write_op,
                                   size_t len,
                                   uint64_t offset);
 
+/**
+ * Write the concatenation of iovcnt buffers to offset, without
+ * copying them into a contiguous buffer first.
+ * @param write_op operation to add this action to
+ * @param iov buffers to write
+ * @param iovcnt number of buffers in iov
+ * @param offset offset to write to
+ */
+void mobject_store_write_op_writev(mobject_store_write_op_t write_op,
+                                   const struct iovec *iov,
+                                   int iovcnt,
+                                   uint64_t offset);
+
 /**
  * Write whole object, atomically replacing it.
  * @param write_op operation to add this action to
@@ -358,6 +485,42 @@ void mobject_store_write_op_omap_rm_keys(mobject_store_write_op_t write_op,
                                          char const* const* keys,
                                          size_t keys_len);
 
+/**
+ * Register the buffers of a write operation now rather than each time
+ * it is sent. A prepared write operation keeps its registration and
+ * can be sent any number of times, to any object of the ioctx, with
+ * mobject_store_write_op_update() changing the offsets and lengths of
+ * its actions in between. No action can be added to it anymore.
+ * This is not supported on erasure-coded pools.
+ *
+ * @param write_op operation to prepare
+ * @param io the ioctx the operation will be sent to
+ * @returns 0 on success, -1 on failure
+ */
+int mobject_store_write_op_prepare(mobject_store_write_op_t write_op,
+                                   mobject_store_ioctx_t io);
+
+/**
+ * Change the offset and the length of an action of a write operation
+ * before sending it again. The action is designated by its position
+ * (starting at 0) in the order the actions were added. For write,
+ * write_full and append actions, the length can't exceed the one the
+ * action had when the operation was prepared; for writesame, it is the
+ * total written length. The offset is ignored by write_full and append
+ * actions, the length by truncate actions. The operation must not be
+ * in progress.
+ *
+ * @param write_op operation to modify
+ * @param index position of the action in the operation
+ * @param offset new offset of the action in the object
+ * @param len new length of the action
+ * @returns 0 on success, -1 if the action can't be modified this way
+ */
+int mobject_store_write_op_update(mobject_store_write_op_t write_op,
+                                  unsigned index,
+                                  uint64_t offset,
+                                  size_t len);
+
 /**
  * Perform a write operation synchronously
  * @param write_op operation to perform
@@ -388,6 +551,30 @@ int mobject_store_aio_write_op_operate(mobject_store_write_op_t write_op,
                                        time_t *mtime,
                                        int flags);
 
+/**
+ * Perform a batch of write operations on objects of the same ioctx.
+ * The operations are grouped by server and each group is sent in a
+ * single RPC exposing the data of all its operations through a single
+ * bulk handle, which is much cheaper than one RPC per object when
+ * writing many small objects. Each operation is applied atomically,
+ * but the batch as a whole is not. Operations on replicated or
+ * erasure-coded pools are sent one by one.
+ *
+ * @param write_ops operations to perform, which must not have been sent before
+ * @param io the ioctx that the objects are in
+ * @param oids the object ids, one per operation
+ * @param count number of operations
+ * @param rvals if not NULL, where to store the return value of each operation
+ * @param flags flags to apply to the entire batch (LIBMOBJECT_OPERATION_*)
+ * @returns 0 if all the operations succeeded, -1 otherwise
+ */
+int mobject_store_write_op_operate_batch(mobject_store_write_op_t *write_ops,
+                                         mobject_store_ioctx_t io,
+                                         const char * const *oids,
+                                         size_t count,
+                                         int *rvals,
+                                         int flags);
+
 /**
  * Create a new mobject_store_read_op_t write operation. This will store all
  * actions to be performed atomically. You must call
@@ -437,6 +624,24 @@ void mobject_store_read_op_read(mobject_store_read_op_t read_op,
                                 size_t *bytes_read,
                                 int *prval);
 
+/**
+ * Read bytes from offset into iovcnt buffers, filled one after
+ * the other. bytes_read is the total over all the buffers.
+ *
+ * @param read_op operation to add this action to
+ * @param offset offset to read from
+ * @param iov where to put the data
+ * @param iovcnt number of buffers in iov
+ * @param bytes_read where to store the number of bytes read by this action
+ * @param prval where to store the return value of this action
+ */
+void mobject_store_read_op_readv(mobject_store_read_op_t read_op,
+                                 uint64_t offset,
+                                 const struct iovec *iov,
+                                 int iovcnt,
+                                 size_t *bytes_read,
+                                 int *prval);
+
 /**
  * Start iterating over keys on an object.
  *
@@ -491,6 +696,39 @@ void mobject_store_read_op_omap_get_vals_by_keys(mobject_store_read_op_t read_op
                                                  mobject_store_omap_iter_t *iter,
                                                  int *prval);
 
+/**
+ * Register the buffers of a read operation now rather than each time
+ * it is sent. A prepared read operation keeps its registration and
+ * can be sent any number of times, to any object of the ioctx, with
+ * mobject_store_read_op_update() changing the offsets and lengths of
+ * its reads in between. No action can be added to it anymore.
+ * This is not supported on erasure-coded pools.
+ *
+ * @param read_op operation to prepare
+ * @param io the ioctx the operation will be sent to
+ * @returns 0 on success, -1 on failure
+ */
+int mobject_store_read_op_prepare(mobject_store_read_op_t read_op,
+                                  mobject_store_ioctx_t io);
+
+/**
+ * Change the offset and the length of a read action of a read operation
+ * before sending it again. The action is designated by its position
+ * (starting at 0) in the order the actions were added. The length can't
+ * exceed the one the read had when the operation was prepared. The
+ * operation must not be in progress.
+ *
+ * @param read_op operation to modify
+ * @param index position of the action in the operation
+ * @param offset new offset of the read in the object
+ * @param len new length of the read
+ * @returns 0 on success, -1 if the action can't be modified this way
+ */
+int mobject_store_read_op_update(mobject_store_read_op_t read_op,
+                                 unsigned index,
+                                 uint64_t offset,
+                                 size_t len);
+
 /**
  * Perform a read operation synchronously
  * @param read_op operation to perform
@@ -517,6 +755,30 @@ int mobject_store_aio_read_op_operate(mobject_store_read_op_t read_op,
                                       const char *oid,
                                       int flags);
 
+/**
+ * Perform a batch of read operations on objects of the same ioctx.
+ * The operations are grouped by server and each group is sent in a
+ * single RPC, the buffers of all its operations being exposed through
+ * a single bulk handle and the responses coming back in a single RPC
+ * response. This is much cheaper than one RPC per object when reading
+ * or stat-ing many small objects. Operations on erasure-coded pools
+ * are sent one by one.
+ *
+ * @param read_ops operations to perform, which must not have been sent before
+ * @param io the ioctx that the objects are in
+ * @param oids the object ids, one per operation
+ * @param count number of operations
+ * @param rvals if not NULL, where to store the return value of each operation
+ * @param flags flags to apply to the entire batch (LIBMOBJECT_OPERATION_*)
+ * @returns 0 if all the operations succeeded, -1 otherwise
+ */
+int mobject_store_read_op_operate_batch(mobject_store_read_op_t *read_ops,
+                                        mobject_store_ioctx_t io,
+                                        const char * const *oids,
+                                        size_t count,
+                                        int *rvals,
+                                        int flags);
+
 /**
  * Get the next omap key/value pair on the object
  *
@@ -563,7 +825,10 @@ typedef void (*mobject_store_callback_t)(mobject_store_completion_t cb, void *ar
  * acked and committed, respectively. The callbacks are called in
  * order of receipt, so the safe callback may be triggered before the
  * complete callback, and vice versa. This is affected by journalling
- * on the OSDs.
+ * on the OSDs. If any callback is given, the callbacks are called
+ * from the client's progress execution stream as soon as the
+ * response arrives, without the application having to wait on the
+ * completion. Callbacks must not block on other completions.
  *
  * @note Read operations only get a complete callback.
  * @note BUG: this should check for ENOMEM instead of throwing an exception
@@ -581,6 +846,24 @@ int mobject_store_aio_create_completion(void *cb_arg,
                                 mobject_store_callback_t cb_safe,
                                 mobject_store_completion_t *pc);
 
+/**
+ * Constructs a completion that is pushed to the completion queue q
+ * once its operation has completed, after its callbacks (if any)
+ * have been called.
+ *
+ * @param q the completion queue
+ * @param cb_arg application-defined data passed to the callback functions
+ * @param cb_complete the function to be called when the operation is complete
+ * @param cb_safe the function to be called when the operation is safe
+ * @param pc where to store the completion
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_store_aio_create_queued_completion(mobject_store_completion_queue_t q,
+                                void *cb_arg,
+                                mobject_store_callback_t cb_complete,
+                                mobject_store_callback_t cb_safe,
+                                mobject_store_completion_t *pc);
+
 /**
  * Block until an operation completes
  *
@@ -593,6 +876,19 @@ int mobject_store_aio_create_completion(void *cb_arg,
  */
 int mobject_store_aio_wait_for_complete(mobject_store_completion_t c);
 
+/**
+ * Block until an operation is safe
+ *
+ * This means it is on stable storage on all replicas. Writes made
+ * with LIBMOBJECT_OPERATION_DEFER_PERSIST are safe some time after
+ * they complete, other operations are safe when they complete.
+ *
+ * @param c operation to wait for
+ * @returns 0 on success, negative error code if the server could
+ * not tell whether the operation is safe
+ */
+int mobject_store_aio_wait_for_safe(mobject_store_completion_t c);
+
 /**
  * Has an asynchronous operation completed?
  *
@@ -604,6 +900,17 @@ int mobject_store_aio_wait_for_complete(mobject_store_completion_t c);
  */
 int mobject_store_aio_is_complete(mobject_store_completion_t c);
 
+/**
+ * Is an asynchronous operation safe?
+ *
+ * For deferred writes on completions without callbacks or queue,
+ * this only becomes true through mobject_store_aio_wait_for_safe.
+ *
+ * @param c async operation to inspect
+ * @returns whether c is safe
+ */
+int mobject_store_aio_is_safe(mobject_store_completion_t c);
+
 /**
  * Get the return value of an asychronous operation
  *
@@ -617,6 +924,15 @@ int mobject_store_aio_is_complete(mobject_store_completion_t c);
  */
 int mobject_store_aio_get_return_value(mobject_store_completion_t c);
 
+/**
+ * Get the application-defined data a completion was created with,
+ * e.g. to find out which operation a reaped completion belongs to.
+ *
+ * @param c async operation to inspect
+ * @returns the cb_arg given when creating the completion
+ */
+void *mobject_store_aio_get_arg(mobject_store_completion_t c);
+
 /**
  * Release a completion
  *
@@ -627,6 +943,39 @@ int mobject_store_aio_get_return_value(mobject_store_completion_t c);
  */
 void mobject_store_aio_release(mobject_store_completion_t c);
 
+/**
+ * Create a completion queue.
+ *
+ * @param q where to store the queue
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_store_completion_queue_create(mobject_store_completion_queue_t *q);
+
+/**
+ * Destroy a completion queue. Completions still using the
+ * queue must have been reaped and released first.
+ *
+ * @param q queue to destroy
+ */
+void mobject_store_completion_queue_destroy(mobject_store_completion_queue_t q);
+
+/**
+ * Reap the completions of a queue whose operation has completed, in
+ * the order in which they completed, blocking until at least min of
+ * them are available. The reaped completions must still be released
+ * with mobject_store_aio_release().
+ *
+ * @param q the completion queue
+ * @param completions where to store the completions
+ * @param max maximum number of completions to reap
+ * @param min minimum number of completions to wait for (0 to only poll)
+ * @returns number of completions stored in completions
+ */
+int mobject_store_completion_queue_reap(mobject_store_completion_queue_t q,
+                                        mobject_store_completion_t *completions,
+                                        unsigned max,
+                                        unsigned min);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,198 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#ifndef __MOBJECT_STRIPER
+#define __MOBJECT_STRIPER
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libmobject-store.h>
+
+// derived from: https://github.com/ceph/ceph/blob/master/src/include/radosstriper/libradosstriper.h
+
+/**
+ * @typedef mobject_striper_t
+ *
+ * A handle for interacting with striped objects in a mobject store
+ * I/O context. A striped object is cut in stripe units distributed
+ * round-robin over stripe_count sub-objects (an "object set"); once
+ * these sub-objects reach object_size bytes, the next stripe units go
+ * to a new object set. Sub-objects are named <soid>.<16 hex digits>
+ * and are placed independently, so that I/O on a large object is
+ * spread over the servers. The layout and the size of the striped
+ * object are kept in the omap of its first sub-object.
+ *
+ * Operations on the same striped object are not atomic with respect
+ * to each other: concurrent writers that extend an object must be
+ * serialized by the application.
+ */
+typedef struct mobject_striper *mobject_striper_t;
+
+#define MOBJECT_STRIPER_NULL ((mobject_striper_t)0)
+
+/* default layout of new striped objects */
+#define MOBJECT_STRIPER_DEFAULT_STRIPE_UNIT  (1024*1024)
+#define MOBJECT_STRIPER_DEFAULT_STRIPE_COUNT 8
+#define MOBJECT_STRIPER_DEFAULT_OBJECT_SIZE  (4*1024*1024)
+
+/**
+ * Creates a striper for an I/O context.
+ *
+ * @param ioctx the I/O context the striped objects are in
+ * @param striper where to store the striper
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_striper_create(mobject_store_ioctx_t ioctx,
+                           mobject_striper_t *striper);
+
+/**
+ * Destroys a striper.
+ *
+ * @param striper the striper to destroy
+ */
+void mobject_striper_destroy(mobject_striper_t striper);
+
+/**
+ * Sets the stripe unit used for the striped objects created by
+ * this striper. Existing objects keep the layout they were created with.
+ * The object size must remain a multiple of the stripe unit.
+ *
+ * @param striper the targeted striper
+ * @param stripe_unit the stripe unit, in bytes
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_striper_set_object_layout_stripe_unit(mobject_striper_t striper,
+                                                  unsigned int stripe_unit);
+
+/**
+ * Sets the number of sub-objects a stripe is spread over for the
+ * striped objects created by this striper.
+ *
+ * @param striper the targeted striper
+ * @param stripe_count the stripe count
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_striper_set_object_layout_stripe_count(mobject_striper_t striper,
+                                                   unsigned int stripe_count);
+
+/**
+ * Sets the maximum size of the sub-objects of the striped objects
+ * created by this striper. It must be a multiple of the stripe unit.
+ *
+ * @param striper the targeted striper
+ * @param object_size the size of the sub-objects, in bytes
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_striper_set_object_layout_object_size(mobject_striper_t striper,
+                                                  unsigned int object_size);
+
+/**
+ * Writes len bytes from buf into a striped object at offset off,
+ * creating the object if needed. The sub-objects are written in parallel.
+ *
+ * @param striper the striper in which the write will occur
+ * @param soid the name of the striped object
+ * @param buf data to write
+ * @param len length of the data, in bytes
+ * @param off byte offset in the object to begin writing at
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_striper_write(mobject_striper_t striper,
+                          const char *soid,
+                          const char *buf,
+                          size_t len,
+                          uint64_t off);
+
+/**
+ * Replaces the content of a striped object with len bytes from buf.
+ *
+ * @param striper the striper in which the write will occur
+ * @param soid the name of the striped object
+ * @param buf data to write
+ * @param len length of the data, in bytes
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_striper_write_full(mobject_striper_t striper,
+                               const char *soid,
+                               const char *buf,
+                               size_t len);
+
+/**
+ * Appends len bytes from buf to a striped object.
+ *
+ * @param striper the striper in which the write will occur
+ * @param soid the name of the striped object
+ * @param buf data to append
+ * @param len length of the data, in bytes
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_striper_append(mobject_striper_t striper,
+                           const char *soid,
+                           const char *buf,
+                           size_t len);
+
+/**
+ * Reads up to len bytes of a striped object from offset off into buf.
+ * The sub-objects are read in parallel. Ranges that were never written
+ * read as zeros.
+ *
+ * @param striper the striper in which the read will occur
+ * @param soid the name of the striped object
+ * @param buf where to store the data
+ * @param len the number of bytes to read
+ * @param off the offset to start reading from in the object
+ * @returns number of bytes read on success, negative error code on failure
+ */
+int mobject_striper_read(mobject_striper_t striper,
+                         const char *soid,
+                         char *buf,
+                         size_t len,
+                         uint64_t off);
+
+/**
+ * Gets the size and the modification time of a striped object.
+ *
+ * @param striper the striper in which the stat will occur
+ * @param soid the name of the striped object
+ * @param psize where to store the object size
+ * @param pmtime where to store the modification time
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_striper_stat(mobject_striper_t striper,
+                         const char *soid,
+                         uint64_t *psize,
+                         time_t *pmtime);
+
+/**
+ * Resizes a striped object, removing or truncating
+ * the sub-objects beyond the new size.
+ *
+ * @param striper the striper in which the truncation will occur
+ * @param soid the name of the striped object
+ * @param size the new size of the object
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_striper_trunc(mobject_striper_t striper,
+                          const char *soid,
+                          uint64_t size);
+
+/**
+ * Removes a striped object and all its sub-objects.
+ *
+ * @param striper the striper in which the removal will occur
+ * @param soid the name of the striped object
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_striper_remove(mobject_striper_t striper,
+                           const char *soid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
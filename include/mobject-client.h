@@ -8,6 +8,7 @@
 #define __MOBJECT_CLIENT_H
 
 #include <stdint.h>
+#include <sys/uio.h>
 #include <margo.h>
 
 #ifdef __cplusplus
@@ -91,6 +92,110 @@ extern "C" {
 
     int mobject_shutdown(mobject_client_t client, hg_addr_t addr);
 
+    /**
+     * Sets how the buffers returned by mobject_client_alloc_buffer are
+     * obtained: they are carved out of regions of region_size bytes
+     * (0 for the default of 64 MiB), backed by huge pages if huge_pages
+     * is set and the system has some available. Must be called before
+     * any buffer is allocated.
+     *
+     * @param client Mobject client
+     * @param region_size size of the regions
+     * @param huge_pages whether to back the regions with huge pages
+     *
+     * @return 0 on success, -1 on failure
+     */
+    int mobject_client_set_buffer_pool(
+            mobject_client_t client,
+            size_t region_size,
+            int huge_pages);
+
+    /**
+     * Allocates a buffer from memory that is already registered for
+     * RDMA. Operations whose buffers all come from the same region of
+     * the pool are sent without registering memory. The buffer must be
+     * freed with mobject_client_free_buffer before the client is finalized.
+     *
+     * @param client Mobject client
+     * @param size size of the buffer
+     *
+     * @return the buffer, aligned on 64 bytes, or NULL on failure
+     */
+    void* mobject_client_alloc_buffer(mobject_client_t client, size_t size);
+
+    /**
+     * Frees a buffer allocated with mobject_client_alloc_buffer.
+     *
+     * @param client Mobject client
+     * @param buffer buffer to free
+     */
+    void mobject_client_free_buffer(mobject_client_t client, void* buffer);
+
+    /**
+     * Sets how long each attempt of an operation waits for a response
+     * before failing with HG_TIMEOUT (0, the default, waits forever).
+     * A read, or a write if retry_writes is set, that times out is sent
+     * again up to max_retries times, waiting backoff_ms milliseconds
+     * before the first retry and twice as long before each following
+     * one. Writes are not retried by default since one that timed out
+     * may have been applied, which matters for appends and omap updates.
+     * Batches are subject to the timeout but never retried.
+     *
+     * @param client Mobject client
+     * @param timeout_ms timeout of each attempt, in milliseconds
+     * @param max_retries number of times an operation is sent again
+     * @param backoff_ms delay before the first retry, in milliseconds
+     * @param retry_writes whether writes are retried
+     *
+     * @return 0 on success, -1 on failure
+     */
+    int mobject_client_set_timeout(
+            mobject_client_t client,
+            double timeout_ms,
+            unsigned max_retries,
+            double backoff_ms,
+            int retry_writes);
+
+    /**
+     * Sets when reads on replicated pools are hedged: a read whose first
+     * replica has not answered after the given percentile of the
+     * latencies of the recent reads (and at least min_delay_ms) is also
+     * sent to a second replica. The first successful response is used
+     * and the other request is cancelled. Hedging is disabled when
+     * percentile is 0, the default.
+     *
+     * @param client Mobject client
+     * @param percentile percentile of the read latencies, in ]0,100]
+     * @param min_delay_ms smallest delay before hedging, in milliseconds
+     *
+     * @return 0 on success, -1 on failure
+     */
+    int mobject_client_set_hedging(
+            mobject_client_t client,
+            double percentile,
+            double min_delay_ms);
+
+    typedef struct mobject_client_stats {
+        uint64_t timeouts;   // attempts that timed out
+        uint64_t retries;    // operations sent again after a timeout
+        uint64_t hedges;     // reads sent to a second replica
+        uint64_t hedge_wins; // hedged reads answered first by the second replica
+        uint64_t cancelled;  // requests cancelled because the other replica answered
+    } mobject_client_stats_t;
+
+    /**
+     * Returns the counters of timeouts, retries and hedged
+     * reads since the client was created.
+     *
+     * @param client Mobject client
+     * @param stats resulting counters
+     *
+     * @return 0 on success, -1 on failure
+     */
+    int mobject_client_get_stats(
+            mobject_client_t client,
+            mobject_client_stats_t* stats);
+
     /**
      * Create a new mobject_store_write_op_t write operation.
      * This will store all actions to be performed atomically.
@@ -133,6 +238,21 @@ extern "C" {
             uint64_t offset,
             size_t len);
 
+    /**
+     * Write the concatenation of iovcnt buffers to offset. The buffers
+     * are sent without being copied, and land in the object as a
+     * single contiguous range.
+     * @param write_op operation to add this action to
+     * @param iov buffers to write
+     * @param iovcnt number of buffers in iov
+     * @param offset offset to write to
+     */
+    void mobject_write_op_writev(
+            mobject_store_write_op_t write_op,
+            const struct iovec *iov,
+            int iovcnt,
+            uint64_t offset);
+
     /**
      * Write whole object, atomically replacing it.
      * @param write_op operation to add this action to
@@ -224,6 +344,42 @@ extern "C" {
             char const* const* keys,
             size_t keys_len);
 
+    /**
+     * Register the buffers of a write operation with the client now,
+     * rather than when it is first sent. A prepared write operation can
+     * be sent any number of times, to any object, without registering
+     * its buffers again, but no action can be added to it anymore.
+     *
+     * @param client the client the operation will be sent with
+     * @param write_op operation to prepare
+     * @returns 0 on success, -1 on failure
+     */
+    int mobject_write_op_prepare(
+            mobject_client_t client,
+            mobject_store_write_op_t write_op);
+
+    /**
+     * Change the offset and the length of an action of a write operation
+     * before sending it again. The action is designated by its position
+     * (starting at 0) in the order the actions were added. For write,
+     * write_full and append actions, the length must not exceed the
+     * length the action had when the operation was prepared. The offset
+     * is ignored by write_full and append actions, the length by truncate
+     * actions, and the length is the total written length for writesame.
+     * The operation must not be modified while it is being processed.
+     *
+     * @param write_op operation to modify
+     * @param index position of the action in the operation
+     * @param offset new offset of the action in the object
+     * @param len new length of the action
+     * @returns 0 on success, -1 if the action can't be modified this way
+     */
+    int mobject_write_op_update(
+            mobject_store_write_op_t write_op,
+            unsigned index,
+            uint64_t offset,
+            size_t len);
+
     /**
      * Perform a write operation synchronously
      * @param write_op operation to perform
@@ -240,6 +396,17 @@ extern "C" {
             time_t *mtime,
             int flags);
 
+    /**
+     * Waits until a write made with LIBMOBJECT_OPERATION_DEFER_PERSIST
+     * has been persisted by the provider that acknowledged it.
+     * @param handle provider handle
+     * @param safe_seq ticket returned by the provider for the write
+     * @return 0 on success, -1 on failure
+     */
+    int mobject_write_op_wait_safe(
+            mobject_provider_handle_t handle,
+            uint64_t safe_seq);
+
     /**
      * Perform a write operation asynchronously
      * @param write_op operation to perform
@@ -258,6 +425,28 @@ extern "C" {
             int flags,
             mobject_request_t* req);
 
+    /**
+     * Perform a batch of write operations asynchronously, in a single RPC.
+     * All the objects must be in the same pool and managed by the provider.
+     * The data of all the write operations is exposed through a single
+     * bulk handle. The write operations must not have been sent before;
+     * once the request is waited on or discarded, they can be sent again.
+     * @param write_ops operations to perform
+     * @param count number of operations
+     * @param pool_name the name of the pool in which to write
+     * @param oids the object ids, one per operation
+     * @param flags flags to apply to the entire batch (LIBMOBJECT_OPERATION_*)
+     * @param req resulting request
+     */
+    int mobject_aio_write_op_operate_batch(
+            mobject_provider_handle_t handle,
+            mobject_store_write_op_t* write_ops,
+            size_t count,
+            const char* pool_name,
+            const char* const* oids,
+            int flags,
+            mobject_request_t* req);
+
     /**
      * Create a new mobject_store_read_op_t write operation. This will store all
      * actions to be performed atomically. You must call
@@ -308,6 +497,26 @@ extern "C" {
             size_t *bytes_read,
             int *prval);
 
+    /**
+     * Read the range of the object starting at offset into iovcnt
+     * buffers, filling them one after the other. bytes_read is the
+     * total number of bytes read into the buffers.
+     *
+     * @param read_op operation to add this action to
+     * @param iov where to put the data
+     * @param iovcnt number of buffers in iov
+     * @param offset offset to read from
+     * @param bytes_read where to store the number of bytes read by this action
+     * @param prval where to store the return value of this action
+     */
+    void mobject_read_op_readv(
+            mobject_store_read_op_t read_op,
+            const struct iovec *iov,
+            int iovcnt,
+            uint64_t offset,
+            size_t *bytes_read,
+            int *prval);
+
     /**
      * Start iterating over keys on an object.
      *
@@ -365,6 +574,40 @@ extern "C" {
             mobject_store_omap_iter_t *iter,
             int *prval);
 
+    /**
+     * Register the buffers of a read operation with the client now,
+     * rather than when it is first sent. A prepared read operation can
+     * be sent any number of times, to any object, without registering
+     * its buffers again, but no action can be added to it anymore.
+     *
+     * @param client the client the operation will be sent with
+     * @param read_op operation to prepare
+     * @returns 0 on success, -1 on failure
+     */
+    int mobject_read_op_prepare(
+            mobject_client_t client,
+            mobject_store_read_op_t read_op);
+
+    /**
+     * Change the offset and the length of a read action of a read
+     * operation before sending it again. The action is designated by its
+     * position (starting at 0) in the order the actions were added. The
+     * length must not exceed the length the action had when the operation
+     * was prepared. The operation must not be modified while it is being
+     * processed.
+     *
+     * @param read_op operation to modify
+     * @param index position of the action in the operation
+     * @param offset new offset of the read in the object
+     * @param len new length of the read
+     * @returns 0 on success, -1 if the action can't be modified this way
+     */
+    int mobject_read_op_update(
+            mobject_store_read_op_t read_op,
+            unsigned index,
+            uint64_t offset,
+            size_t len);
+
 
     /**
      * Perform a read operation synchronously
@@ -396,6 +639,29 @@ extern "C" {
             int flags,
             mobject_request_t* req);
 
+    /**
+     * Perform a batch of read operations asynchronously, in a single RPC.
+     * All the objects must be in the same pool and managed by the provider.
+     * The buffers of all the read operations are exposed through a single
+     * bulk handle and the responses come back in a single RPC response.
+     * The read operations must not have been sent before; once the
+     * request is waited on or discarded, they can be sent again.
+     * @param read_ops operations to perform
+     * @param count number of operations
+     * @param pool_name the pool that the objects are in
+     * @param oids the object ids, one per operation
+     * @param flags flags to apply to the entire batch (LIBMOBJECT_OPERATION_*)
+     * @param req resulting request
+     */
+    int mobject_aio_read_op_operate_batch(
+            mobject_provider_handle_t handle,
+            mobject_store_read_op_t* read_ops,
+            size_t count,
+            const char *pool_name,
+            const char* const* oids,
+            int flags,
+            mobject_request_t* req);
+
     int mobject_aio_wait(mobject_request_t req, int* ret);
 
     int mobject_aio_test(mobject_request_t req, int* flag);
@@ -20,6 +20,8 @@ extern "C" {
 
 #define MOBJECT_SERVER_GROUP_NAME "mobject-store-servers"
 #define MOBJECT_ABT_POOL_DEFAULT ABT_POOL_NULL
+/* operations moving at least this many bytes run in the bulk pool */
+#define MOBJECT_BULK_THRESHOLD_DEFAULT (256*1024)
 
 typedef struct mobject_server_context* mobject_provider_t;
 
@@ -47,6 +49,66 @@ int mobject_provider_register(
         const char *cluster_file,
         mobject_provider_t* provider);
 
+/**
+ * Configures the migration of objects performed when servers join
+ * or leave the group.
+ *
+ * @param[in] provider       mobject provider
+ * @param[in] max_bandwidth  maximum migration bandwidth in bytes/sec (0 for unlimited)
+ * @param[in] batch_size     maximum amount of data sent per migration message
+ *                           (0 for the default of 16 MiB)
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_provider_set_rebalancing(
+        mobject_provider_t provider,
+        size_t max_bandwidth,
+        size_t batch_size);
+
+/**
+ * Gives the provider a separate Argobots pool for bulk operations,
+ * i.e. reads and writes moving at least threshold bytes of data, and
+ * object migrations. Their RPCs are still received in the pool of the
+ * provider, but their execution is handed to a ULT of the bulk pool, so
+ * that metadata and small operations are not queued behind large
+ * transfers. The xstreams serving each pool, and the priority given to
+ * the provider's pool, are up to the caller.
+ *
+ * @param[in] provider   mobject provider
+ * @param[in] bulk_pool  pool for bulk operations (ABT_POOL_NULL to run
+ *                       every operation in the pool of the provider)
+ * @param[in] threshold  bytes of data from which an operation is a bulk one
+ *                       (0 for the default of 256 KiB)
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_provider_set_bulk_pool(
+        mobject_provider_t provider,
+        ABT_pool bulk_pool,
+        size_t threshold);
+
+struct symbiomon_provider;
+
+/**
+ * Publishes the metrics of the provider through a SYMBIOMON provider:
+ * for each type of action (write, read, stat, omap_set, remove...) the
+ * number executed, their average latency and a histogram of their
+ * latencies, the bytes written and read by clients, the number and time
+ * of the calls to sdskv and bake, and the hit ratio of the oid cache.
+ * The metrics are in the "mobject" namespace, tagged "provider:<id>",
+ * and updated every MOBJECT_METRICS_INTERVAL milliseconds (1000 by
+ * default). The counters are kept whether they are published or not,
+ * and are also printed by the mobject_server_stat RPC.
+ *
+ * @param[in] provider         mobject provider
+ * @param[in] metric_provider  SYMBIOMON provider to create the metrics in
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int mobject_provider_set_symbiomon(
+        mobject_provider_t provider,
+        struct symbiomon_provider* metric_provider);
+
 /**
  * Helper function that sets up the appropriate databases
  * in a given SDSKV provider. 
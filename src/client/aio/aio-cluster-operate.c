@@ -10,6 +10,10 @@
 #include "mobject-store-config.h"
 #include "libmobject-store.h"
 #include "src/client/cluster.h"
+#include "src/client/mobject-client-impl.h"
+#include "src/client/erasure.h"
+#include "src/client/split.h"
+#include "src/client/hedge.h"
 #include "src/client/aio/completion.h"
 #include "src/util/log.h"
 
@@ -21,21 +25,44 @@ int mobject_store_aio_write_op_operate(
         time_t *mtime,
         int flags)
 {   
-    hg_return_t ret;
+    int r;
+    unsigned k, m;
 
-    // XXX pick other servers using ch-placement
-    ssg_member_id_t svr_id = ssg_get_group_member_id_from_rank(io->cluster->gid, 0);
-    hg_addr_t svr_addr = ssg_get_group_member_addr(io->cluster->gid, svr_id);
+    /* erasure-coded objects are written chunk by chunk, the
+       operation completes before the completion is returned */
+    if(mobject_erasure_profile(io->cluster->erasure_spec, io->pool_name, &k, &m)) {
+        completion->request   = MOBJECT_REQUEST_NULL;
+        completion->ret_value = mobject_erasure_write_op_operate(io->cluster,
+                write_op, io->pool_name, oid, k, m);
+        return mobject_completion_start(completion, io->cluster->mid);
+    }
+
+    mobject_provider_handle_t mph = mobject_store_locate_object(io->cluster, oid);
+    if(mph == MOBJECT_PROVIDER_HANDLE_NULL) return -1;
 
-    mobject_provider_handle_t mph;
-    mobject_provider_handle_create(io->cluster->mobject_clt, svr_addr, 1, &mph);
     mobject_request_t req;
-    mobject_aio_write_op_operate(mph, write_op, io->pool_name, oid, mtime, flags, &req);
-    mobject_provider_handle_release(mph);
+    if(mobject_split_write_op_count(write_op, io->cluster->split_size,
+                io->cluster->split_requests) > 1)
+        r = mobject_split_aio_write_op_operate(mph, write_op, io->pool_name, oid, mtime, flags,
+                io->cluster->split_size, io->cluster->split_requests, &req);
+    else
+        r = mobject_aio_write_op_operate(mph, write_op, io->pool_name, oid, mtime, flags, &req);
+    if(r != 0) {
+        mobject_provider_handle_release(mph);
+        return r;
+    }
 
+    /* the request holds its own reference to the handle, the completion
+       keeps this one to find out when a deferred write is safe */
     completion->request = req;
+    if(flags & LIBMOBJECT_OPERATION_DEFER_PERSIST) {
+        completion->mph = mph;
+        req->safe_seq   = &completion->safe_seq;
+    } else {
+        mobject_provider_handle_release(mph);
+    }
 
-    return 0;
+    return mobject_completion_start(completion, io->cluster->mid);
 }
 
 int mobject_store_aio_read_op_operate(mobject_store_read_op_t read_op,
@@ -44,19 +71,39 @@ int mobject_store_aio_read_op_operate(mobject_store_read_op_t read_op,
         const char *oid,
         int flags)
 {   
-    hg_return_t ret;
+    int r;
+    unsigned k, m;
+
+    if(mobject_erasure_profile(io->cluster->erasure_spec, io->pool_name, &k, &m)) {
+        completion->request   = MOBJECT_REQUEST_NULL;
+        completion->ret_value = mobject_erasure_read_op_operate(io->cluster,
+                read_op, io->pool_name, oid, k, m);
+        return mobject_completion_start(completion, io->cluster->mid);
+    }
 
-    // XXX pick other servers using ch-placement
-    ssg_member_id_t svr_id = ssg_get_group_member_id_from_rank(io->cluster->gid, 0);
-    hg_addr_t svr_addr = ssg_get_group_member_addr(io->cluster->gid, svr_id);
+    mobject_provider_handle_t mph = mobject_store_locate_replica(io->cluster,
+            io->pool_name, oid, flags);
+    if(mph == MOBJECT_PROVIDER_HANDLE_NULL) return -1;
 
-    mobject_provider_handle_t mph;
-    mobject_provider_handle_create(io->cluster->mobject_clt, svr_addr, 1, &mph);
     mobject_request_t req;
-    mobject_aio_read_op_operate(mph, read_op, io->pool_name, oid, flags, &req);
+    mobject_provider_handle_t hedge_mph;
+    if(mobject_split_read_op_count(read_op, io->cluster->split_size,
+                io->cluster->split_requests) > 1)
+        r = mobject_split_aio_read_op_operate(mph, read_op, io->pool_name, oid, flags,
+                io->cluster->split_size, io->cluster->split_requests, &req);
+    else if((hedge_mph = mobject_store_locate_hedge_replica(io->cluster,
+                    io->pool_name, oid, mph)) != MOBJECT_PROVIDER_HANDLE_NULL) {
+        r = mobject_hedged_aio_read_op_operate(mph, hedge_mph, read_op, io->pool_name,
+                oid, flags, &req);
+        mobject_provider_handle_release(hedge_mph);
+    }
+    else
+        r = mobject_aio_read_op_operate(mph, read_op, io->pool_name, oid, flags, &req);
+    /* the requests hold their own references to the handles */
     mobject_provider_handle_release(mph);
+    if(r != 0) return r;
 
     completion->request = req;
 
-    return 0;
+    return mobject_completion_start(completion, io->cluster->mid);
 }
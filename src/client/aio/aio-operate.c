@@ -5,15 +5,88 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "mobject-store-config.h"
 #include "libmobject-store.h"
 #include "src/client/mobject-client-impl.h"
+#include "src/client/split.h"
+#include "src/client/hedge.h"
 #include "src/io-chain/prepare-write-op.h"
 #include "src/io-chain/prepare-read-op.h"
 #include "src/rpc-types/write-op.h"
 #include "src/rpc-types/read-op.h"
 #include "src/util/log.h"
 
+static mobject_request_t aio_request_create(
+        mobject_op_req_type type,
+        mobject_provider_handle_t mph)
+{
+    mobject_request_t req = calloc(1, sizeof(*req));
+    req->type        = type;
+    req->request     = MARGO_REQUEST_NULL;
+    req->handle      = HG_HANDLE_NULL;
+    req->bulk_handle = HG_BULK_NULL;
+    req->mph         = mph;
+    req->start       = ABT_get_wtime();
+    mobject_provider_handle_ref_incr(mph);
+    return req;
+}
+
+static void aio_request_free(mobject_request_t req)
+{
+    if(req->bulk_handle != HG_BULK_NULL)
+        margo_bulk_free(req->bulk_handle);
+    if(req->handle != HG_HANDLE_NULL)
+        margo_destroy(req->handle);
+    if(req->mph != MOBJECT_PROVIDER_HANDLE_NULL)
+        mobject_provider_handle_release(req->mph);
+    /* the operations of a batch can be modified and sent again once
+       its bulk handle, through which they were sent, is freed */
+    if(req->type == MOBJECT_AIO_READ_BATCH && req->batch_buffers)
+        unprepare_read_op_batch(req->read_ops, req->count, req->batch_buffers);
+    if(req->type == MOBJECT_AIO_WRITE_BATCH && req->batch_buffers)
+        unprepare_write_op_batch(req->write_ops, req->count, req->batch_buffers);
+    free(req->oid);
+    free(req->pool_name);
+    free(req->read_ops);
+    free(req->write_ops);
+    free(req);
+}
+
+/* sends a single read or write from the fields of
+   the request, again if it already was and timed out */
+static hg_return_t aio_send(mobject_request_t req)
+{
+    mobject_client_t client = req->mph->client;
+
+    req->attempts += 1;
+    if(req->type == MOBJECT_AIO_WRITE) {
+        write_op_in_t in;
+        in.object_name = req->oid;
+        in.pool_name   = req->pool_name;
+        in.write_op    = req->op.write_op;
+        in.client_addr = client->client_addr;
+        in.flags       = req->flags;
+        return mobject_client_iforward(req->mph, client->mobject_write_op_rpc_id,
+                &in, &req->handle, &req->request);
+    } else {
+        read_op_in_t in;
+        in.object_name = req->oid;
+        in.pool_name   = req->pool_name;
+        in.read_op     = req->op.read_op;
+        in.client_addr = client->client_addr;
+        return mobject_client_iforward(req->mph, client->mobject_read_op_rpc_id,
+                &in, &req->handle, &req->request);
+    }
+}
+
+/* whether a request that timed out may be sent again */
+static int aio_retriable(mobject_request_t req)
+{
+    return req->type == MOBJECT_AIO_READ
+        || (req->type == MOBJECT_AIO_WRITE && req->mph->client->retry_writes);
+}
+
 int mobject_aio_write_op_operate(
         mobject_provider_handle_t mph,
         mobject_store_write_op_t write_op,
@@ -25,40 +98,84 @@ int mobject_aio_write_op_operate(
 {   
     hg_return_t ret;
 
-    write_op_in_t in;
-    in.object_name = oid;
-    in.pool_name   = pool_name;
-    in.write_op    = write_op;
     // TODO take mtime into account
 
-    prepare_write_op(mph->client->mid, write_op);
+    if(prepare_write_op(mph->client->mid, &mph->client->buffer_finder, write_op) != 0)
+        return -1;
 
-    hg_addr_t svr_addr = mph->addr;
-    if(svr_addr == HG_ADDR_NULL) {
+    if(mph->addr == HG_ADDR_NULL) {
         fprintf(stderr, "[MOBJECT] NULL provider address passed to mobject_aio_write_op_operate\n");
         return -1;
     }
 
-    hg_handle_t h;
-    ret = margo_create(mph->client->mid, svr_addr, mph->client->mobject_write_op_rpc_id, &h);
+    mobject_request_t tmp_req = aio_request_create(MOBJECT_AIO_WRITE, mph);
+    tmp_req->op.write_op      = write_op;
+    tmp_req->oid              = strdup(oid);
+    tmp_req->pool_name        = strdup(pool_name);
+    tmp_req->flags            = flags;
+
+    ret = aio_send(tmp_req);
     if(ret != HG_SUCCESS) {
-        fprintf(stderr, "[MOBJECT] margo_create() failed in mobject_aio_write_op_operate()\n");
+        fprintf(stderr, "[MOBJECT] margo_iforward() failed in mobject_aio_write_op_operate()\n");
+        aio_request_free(tmp_req);
         return -1;
     }
 
-    margo_request mreq;
-    ret = margo_provider_iforward(mph->provider_id, h, &in, &mreq);
-    if(ret != HG_SUCCESS) {
-        fprintf(stderr, "[MOBJECT] margo_iforward() failed in mobject_aio_write_op_operate()\n");
-        margo_destroy(h);
+    *req = tmp_req;
+
+    return 0;
+}
+
+int mobject_aio_write_op_operate_batch(
+        mobject_provider_handle_t mph,
+        mobject_store_write_op_t* write_ops,
+        size_t count,
+        const char *pool_name,
+        const char* const* oids,
+        int flags,
+        mobject_request_t* req)
+{
+    hg_return_t ret;
+
+    write_op_batch_in_t in;
+    in.client_addr  = mph->client->client_addr;
+    in.pool_name    = pool_name;
+    in.count        = count;
+    in.object_names = (hg_const_string_t*)oids;
+    in.write_ops    = write_ops;
+    in.bulk_offsets = (uint64_t*)calloc(count, sizeof(uint64_t));
+    void** buffers;
+
+    if(prepare_write_op_batch(mph->client->mid, write_ops, count,
+                in.bulk_offsets, &in.bulk_handle, &in.bulk_size, &buffers) != 0) {
+        free(in.bulk_offsets);
         return -1;
     }
 
-    mobject_request_t tmp_req = calloc(1, sizeof(*tmp_req));
-    tmp_req->type             = MOBJECT_AIO_WRITE;
-    tmp_req->op.write_op      = write_op;
-    tmp_req->request          = mreq;
-    tmp_req->handle           = h;
+    hg_addr_t svr_addr = mph->addr;
+    if(svr_addr == HG_ADDR_NULL) {
+        fprintf(stderr, "[MOBJECT] NULL provider address passed to mobject_aio_write_op_operate_batch\n");
+        margo_bulk_free(in.bulk_handle);
+        unprepare_write_op_batch(write_ops, count, buffers);
+        free(in.bulk_offsets);
+        return -1;
+    }
+
+    mobject_request_t tmp_req = aio_request_create(MOBJECT_AIO_WRITE_BATCH, mph);
+    tmp_req->bulk_handle      = in.bulk_handle;
+    tmp_req->batch_buffers    = buffers;
+    tmp_req->count            = count;
+    tmp_req->write_ops        = (mobject_store_write_op_t*)calloc(count, sizeof(*write_ops));
+    memcpy(tmp_req->write_ops, write_ops, count*sizeof(*write_ops));
+
+    ret = mobject_client_iforward(mph, mph->client->mobject_write_op_batch_rpc_id,
+            &in, &tmp_req->handle, &tmp_req->request);
+    free(in.bulk_offsets);
+    if(ret != HG_SUCCESS) {
+        fprintf(stderr, "[MOBJECT] margo_iforward() failed in mobject_aio_write_op_operate_batch()\n");
+        aio_request_free(tmp_req);
+        return -1;
+    }
 
     *req = tmp_req;
 
@@ -75,39 +192,77 @@ int mobject_aio_read_op_operate(
 {   
     hg_return_t ret;
 
-    read_op_in_t in; 
-    in.object_name = oid;
-    in.pool_name   = pool_name;
-    in.read_op     = read_op;
-
-    prepare_read_op(mph->client->mid, read_op);
+    if(prepare_read_op(mph->client->mid, &mph->client->buffer_finder, read_op) != 0)
+        return -1;
 
-    hg_addr_t svr_addr = mph->addr; 
-    if(svr_addr == HG_ADDR_NULL) {
+    if(mph->addr == HG_ADDR_NULL) {
         fprintf(stderr, "[MOBJECT] NULL provider address passed to mobject_aio_read_op_operate\n");
         return -1;
     }
 
-    hg_handle_t h;
-    ret = margo_create(mph->client->mid, svr_addr, mph->client->mobject_read_op_rpc_id, &h);
+    mobject_request_t tmp_req = aio_request_create(MOBJECT_AIO_READ, mph);
+    tmp_req->op.read_op       = read_op;
+    tmp_req->oid              = strdup(oid);
+    tmp_req->pool_name        = strdup(pool_name);
+    tmp_req->flags            = flags;
+
+    ret = aio_send(tmp_req);
     if(ret != HG_SUCCESS) {
-        fprintf(stderr, "[MOBJECT] margo_forward() failed in mobject_write_op_operate()\n");
+        fprintf(stderr, "[MOBJECT] margo_iforward() failed in mobject_aio_read_op_operate()\n");
+        aio_request_free(tmp_req);
         return -1;
     }
 
-    margo_request mreq;
-    ret = margo_provider_iforward(mph->provider_id, h, &in, &mreq);
-    if(ret != HG_SUCCESS) {
-        fprintf(stderr, "[MOBJECT] margo_iforward() failed in mobject_aio_write_op_operate()\n");
-        margo_destroy(h);
+    *req = tmp_req;
+
+    return 0;
+}
+
+int mobject_aio_read_op_operate_batch(
+        mobject_provider_handle_t mph,
+        mobject_store_read_op_t* read_ops,
+        size_t count,
+        const char *pool_name,
+        const char* const* oids,
+        int flags,
+        mobject_request_t* req)
+{
+    hg_return_t ret;
+
+    read_op_batch_in_t in;
+    in.client_addr  = mph->client->client_addr;
+    in.pool_name    = pool_name;
+    in.count        = count;
+    in.object_names = (hg_const_string_t*)oids;
+    in.read_ops     = read_ops;
+    void** buffers;
+
+    if(prepare_read_op_batch(mph->client->mid, read_ops, count,
+                &in.bulk_handle, &in.bulk_size, &buffers) != 0)
+        return -1;
+
+    hg_addr_t svr_addr = mph->addr;
+    if(svr_addr == HG_ADDR_NULL) {
+        fprintf(stderr, "[MOBJECT] NULL provider address passed to mobject_aio_read_op_operate_batch\n");
+        margo_bulk_free(in.bulk_handle);
+        unprepare_read_op_batch(read_ops, count, buffers);
         return -1;
     }
 
-    mobject_request_t tmp_req = calloc(1, sizeof(*tmp_req));
-    tmp_req->type             = MOBJECT_AIO_READ;
-    tmp_req->op.read_op       = read_op;
-    tmp_req->request          = mreq;
-    tmp_req->handle           = h;
+    mobject_request_t tmp_req = aio_request_create(MOBJECT_AIO_READ_BATCH, mph);
+    tmp_req->bulk_handle      = in.bulk_handle;
+    tmp_req->batch_buffers    = buffers;
+    tmp_req->count            = count;
+    tmp_req->read_ops         = (mobject_store_read_op_t*)calloc(count, sizeof(*read_ops));
+    memcpy(tmp_req->read_ops, read_ops, count*sizeof(*read_ops));
+
+    ret = mobject_client_iforward(mph, mph->client->mobject_read_op_batch_rpc_id,
+            &in, &tmp_req->handle, &tmp_req->request);
+    if(ret != HG_SUCCESS) {
+        fprintf(stderr, "[MOBJECT] margo_iforward() failed in mobject_aio_read_op_operate_batch()\n");
+        aio_request_free(tmp_req);
+        return -1;
+    }
 
     *req = tmp_req;
 
@@ -119,11 +274,31 @@ int mobject_aio_wait(mobject_request_t req, int* ret)
     if(req == MOBJECT_REQUEST_NULL)
         return -1;
 
-    int r = margo_wait(req->request);
+    if(req->type == MOBJECT_AIO_SPLIT)
+        return mobject_split_wait(req, ret);
+    if(req->type == MOBJECT_AIO_HEDGED)
+        return mobject_hedged_wait(req, ret);
+
+    /* the request of a hedged read may already have been waited on */
+    int r = HG_SUCCESS;
+    if(req->request != MARGO_REQUEST_NULL)
+        r = margo_wait(req->request);
+    req->request = MARGO_REQUEST_NULL;
+
+    while(r == HG_TIMEOUT
+    && mobject_client_retry(req->mph->client, aio_retriable(req), req->attempts)) {
+        margo_destroy(req->handle);
+        req->handle = HG_HANDLE_NULL;
+        r = aio_send(req);
+        if(r == HG_SUCCESS)
+            r = margo_wait(req->request);
+        req->request = MARGO_REQUEST_NULL;
+    }
     if(r != HG_SUCCESS) {
+        *ret = r;
+        aio_request_free(req);
         return r;
     }
-    req->request = MARGO_REQUEST_NULL;
 
     switch(req->type) {
 
@@ -132,17 +307,34 @@ int mobject_aio_wait(mobject_request_t req, int* ret)
             r = margo_get_output(req->handle, &resp);
             if(r != HG_SUCCESS) {
                 *ret = r;
-                margo_destroy(req->handle);
-                free(req);
+                aio_request_free(req);
                 return r;
             }
             *ret = resp.ret;
+            if(req->safe_seq && resp.safe_seq > *(req->safe_seq))
+                *(req->safe_seq) = resp.safe_seq;
             r = margo_free_output(req->handle,&resp);
             if(r != HG_SUCCESS) {
                 *ret = r;
             }
-            margo_destroy(req->handle);
-            free(req);
+            aio_request_free(req);
+            return r;
+        } break;
+
+        case MOBJECT_AIO_WRITE_BATCH: {
+            write_op_batch_out_t resp;
+            r = margo_get_output(req->handle, &resp);
+            if(r != HG_SUCCESS) {
+                *ret = r;
+                aio_request_free(req);
+                return r;
+            }
+            *ret = resp.ret;
+            r = margo_free_output(req->handle, &resp);
+            if(r != HG_SUCCESS) {
+                *ret = r;
+            }
+            aio_request_free(req);
             return r;
         } break;
 
@@ -151,24 +343,59 @@ int mobject_aio_wait(mobject_request_t req, int* ret)
             r = margo_get_output(req->handle, &resp);
             if(r != HG_SUCCESS) {
                 *ret = r;
-                margo_destroy(req->handle);
-                free(req);
+                aio_request_free(req);
                 return r;
             }
+            mobject_client_record_latency(req->mph->client, ABT_get_wtime() - req->start);
             feed_read_op_pointers_from_response(req->op.read_op, resp.responses);
             r = margo_free_output(req->handle, &resp);
             if(r != HG_SUCCESS) {
                 *ret = r;
             }
-            margo_destroy(req->handle);
-            free(req);
+            aio_request_free(req);
             return r;
         } break;
+
+        case MOBJECT_AIO_READ_BATCH: {
+            read_op_batch_out_t resp;
+            size_t i;
+            r = margo_get_output(req->handle, &resp);
+            if(r != HG_SUCCESS) {
+                *ret = r;
+                aio_request_free(req);
+                return r;
+            }
+            *ret = (resp.count == req->count) ? 0 : -1;
+            for(i = 0; i < req->count && i < resp.count; i++)
+                feed_read_op_pointers_from_response(req->read_ops[i], resp.responses[i]);
+            r = margo_free_output(req->handle, &resp);
+            if(r != HG_SUCCESS) {
+                *ret = r;
+            }
+            aio_request_free(req);
+            return r;
+        } break;
+
+        default:
+            break;
     }
+    return -1;
 }
 
 int mobject_aio_test(mobject_request_t req, int* flag)
 {
     if(req == MOBJECT_REQUEST_NULL) return -1;
+    if(req->type == MOBJECT_AIO_SPLIT) return mobject_split_test(req, flag);
+    if(req->type == MOBJECT_AIO_HEDGED) return mobject_hedged_test(req, flag);
     return margo_test(req->request, flag);
 }
+
+void mobject_aio_discard(mobject_request_t req)
+{
+    if(req->request != MARGO_REQUEST_NULL) {
+        margo_cancel(req->handle);
+        margo_wait(req->request);
+        req->request = MARGO_REQUEST_NULL;
+    }
+    aio_request_free(req);
+}
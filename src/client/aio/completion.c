@@ -4,6 +4,7 @@
  * See COPYRIGHT in top-level directory.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include "mobject-store-config.h"
 #include "libmobject-store.h"
@@ -25,21 +26,147 @@ int mobject_store_aio_create_completion(void *cb_arg,
     completion->cb_complete   = cb_complete;
 	completion->cb_safe       = cb_safe;
 	completion->cb_arg        = cb_arg;
+	completion->queue         = NULL;
+	completion->driven        = (cb_complete || cb_safe);
+	completion->refs          = 1;
+	if(completion->driven) {
+		ABT_mutex_create(&completion->mutex);
+		ABT_cond_create(&completion->cond);
+	}
 	*pc = completion;
 	return 0;
 }
 
+int mobject_store_aio_create_queued_completion(mobject_store_completion_queue_t q,
+                                void *cb_arg,
+                                mobject_store_callback_t cb_complete,
+                                mobject_store_callback_t cb_safe,
+                                mobject_store_completion_t *pc)
+{
+	if(q == NULL) return -1;
+	mobject_store_aio_create_completion(cb_arg, cb_complete, cb_safe, pc);
+	if(!(*pc)->driven) {
+		ABT_mutex_create(&(*pc)->mutex);
+		ABT_cond_create(&(*pc)->cond);
+	}
+	(*pc)->driven = 1;
+	(*pc)->queue  = q;
+	return 0;
+}
+
+/* drops a reference to a driven completion, freeing it with the last one */
+static void completion_unref(mobject_store_completion_t c)
+{
+	ABT_mutex_lock(c->mutex);
+	int last = (--c->refs == 0);
+	ABT_mutex_unlock(c->mutex);
+	if(!last) return;
+	if(c->mph) mobject_provider_handle_release(c->mph);
+	ABT_mutex_free(&c->mutex);
+	ABT_cond_free(&c->cond);
+	free(c);
+}
+
+/* marks a driven completion as complete, calls its
+   callbacks and pushes it to its queue, if any */
+static void completion_done(mobject_store_completion_t c)
+{
+	/* a deferred write is complete now and safe
+	   once its provider has persisted it */
+	int deferred = (c->safe_seq != 0);
+
+	if(c->cb_safe && !deferred)
+		(c->cb_safe)(c, c->cb_arg);
+
+	if(c->cb_complete)
+		(c->cb_complete)(c, c->cb_arg);
+
+	ABT_mutex_lock(c->mutex);
+	c->complete = 1;
+	if(!deferred) c->safe = 1;
+	ABT_cond_broadcast(c->cond);
+	ABT_mutex_unlock(c->mutex);
+
+	mobject_store_completion_queue_t q = c->queue;
+	if(q) {
+		ABT_mutex_lock(q->mutex);
+		c->next = NULL;
+		if(q->tail) q->tail->next = c;
+		else q->head = c;
+		q->tail = c;
+		ABT_cond_signal(q->cond);
+		ABT_mutex_unlock(q->mutex);
+	}
+
+	if(!deferred) return;
+
+	if(mobject_write_op_wait_safe(c->mph, c->safe_seq) != 0)
+		fprintf(stderr, "[MOBJECT] Could not find out whether a deferred write is safe\n");
+
+	if(c->cb_safe)
+		(c->cb_safe)(c, c->cb_arg);
+
+	ABT_mutex_lock(c->mutex);
+	c->safe = 1;
+	ABT_cond_broadcast(c->cond);
+	ABT_mutex_unlock(c->mutex);
+}
+
+static void completion_ult(void* arg)
+{
+	mobject_store_completion_t c = (mobject_store_completion_t)arg;
+	int ret = 0;
+	if(mobject_aio_wait(c->request, &ret) != 0 && ret == 0) ret = -1;
+	c->ret_value = ret;
+	c->request   = MOBJECT_REQUEST_NULL;
+	completion_done(c);
+	completion_unref(c);
+}
+
+int mobject_completion_start(mobject_store_completion_t c, margo_instance_id mid)
+{
+	ABT_pool pool;
+	if(!c->driven) return 0;
+
+	if(c->request == MOBJECT_REQUEST_NULL) {
+		completion_done(c);
+		return 0;
+	}
+
+	/* the ULT holds a reference until it is done with the completion */
+	c->refs += 1;
+	if(margo_get_handler_pool(mid, &pool) != 0
+	|| ABT_thread_create(pool, completion_ult, c, ABT_THREAD_ATTR_NULL, NULL) != ABT_SUCCESS) {
+		fprintf(stderr, "[MOBJECT] Could not create a ULT to complete an asynchronous operation\n");
+		c->refs -= 1;
+		return -1;
+	}
+	return 0;
+}
+
 int mobject_store_aio_wait_for_complete(mobject_store_completion_t c)
 {
 	if(c == MOBJECT_COMPLETION_NULL) {
 		return -1;
 	}
+
+    /* driven completions are completed by their ULT */
+    if(c->driven) {
+        ABT_mutex_lock(c->mutex);
+        while(!c->complete)
+            ABT_cond_wait(c->cond, c->mutex);
+        ABT_mutex_unlock(c->mutex);
+        return 0;
+    }
     
-    MOBJECT_ASSERT(c->request != MARGO_REQUEST_NULL, "Invalid completion handle");
-    int ret;
-    int r = mobject_aio_wait(c->request, &ret);
-    c->ret_value = ret;
-    c->request = MARGO_REQUEST_NULL;
+    /* a NULL request means the operation completed when it was issued
+       (e.g. on erasure-coded pools) and ret_value is already set */
+    if(c->request != MOBJECT_REQUEST_NULL) {
+        int ret = 0;
+        int r = mobject_aio_wait(c->request, &ret);
+        c->ret_value = ret;
+        c->request = MARGO_REQUEST_NULL;
+    }
 
     if(c->cb_safe)
         (c->cb_safe)(c, c->cb_arg);
@@ -50,12 +177,41 @@ int mobject_store_aio_wait_for_complete(mobject_store_completion_t c)
 	return 0;
 }
 
+int mobject_store_aio_wait_for_safe(mobject_store_completion_t c)
+{
+	int r = 0;
+	if(c == MOBJECT_COMPLETION_NULL) {
+		return -1;
+	}
+
+	if(c->driven) {
+		ABT_mutex_lock(c->mutex);
+		while(!c->safe)
+			ABT_cond_wait(c->cond, c->mutex);
+		ABT_mutex_unlock(c->mutex);
+		return 0;
+	}
+
+	mobject_store_aio_wait_for_complete(c);
+	if(c->safe_seq != 0 && !c->safe)
+		r = mobject_write_op_wait_safe(c->mph, c->safe_seq);
+	if(r == 0) c->safe = 1;
+	return r;
+}
+
 int mobject_store_aio_is_complete(mobject_store_completion_t c)
 {
 	if(c == MOBJECT_COMPLETION_NULL) {
 		return 1;
 	}
 
+    if(c->driven) {
+        ABT_mutex_lock(c->mutex);
+        int complete = c->complete;
+        ABT_mutex_unlock(c->mutex);
+        return complete;
+    }
+
     if(c->request == MOBJECT_REQUEST_NULL) {
         return 1;
     }
@@ -66,6 +222,26 @@ int mobject_store_aio_is_complete(mobject_store_completion_t c)
     return flag;
 }
 
+int mobject_store_aio_is_safe(mobject_store_completion_t c)
+{
+	if(c == MOBJECT_COMPLETION_NULL) {
+		return 1;
+	}
+
+	if(c->driven) {
+		ABT_mutex_lock(c->mutex);
+		int safe = c->safe;
+		ABT_mutex_unlock(c->mutex);
+		return safe;
+	}
+
+	if(c->request != MOBJECT_REQUEST_NULL) {
+		return 0;
+	}
+
+	return c->safe_seq == 0 || c->safe;
+}
+
 int mobject_store_aio_get_return_value(mobject_store_completion_t c)
 {
 	int r;
@@ -76,10 +252,65 @@ int mobject_store_aio_get_return_value(mobject_store_completion_t c)
 	return c->ret_value;
 }
 
+void* mobject_store_aio_get_arg(mobject_store_completion_t c)
+{
+	if(c == MOBJECT_COMPLETION_NULL) return NULL;
+	return c->cb_arg;
+}
+
 void mobject_store_aio_release(mobject_store_completion_t c)
 {
     if(c == MOBJECT_COMPLETION_NULL) return;
+    /* a driven completion is freed once its ULT is done with it */
+    if(c->driven) {
+        completion_unref(c);
+        return;
+    }
     MOBJECT_ASSERT(c->request == MARGO_REQUEST_NULL,
         "Trying to release a completion handle before operation completed (will lead to memory leaks)");
+    if(c->mph) mobject_provider_handle_release(c->mph);
     free(c);
 }
+
+int mobject_store_completion_queue_create(mobject_store_completion_queue_t *pq)
+{
+	mobject_store_completion_queue_t q =
+		(mobject_store_completion_queue_t)calloc(1, sizeof(*q));
+	if(!q) return -1;
+	ABT_mutex_create(&q->mutex);
+	ABT_cond_create(&q->cond);
+	*pq = q;
+	return 0;
+}
+
+void mobject_store_completion_queue_destroy(mobject_store_completion_queue_t q)
+{
+	if(q == NULL) return;
+	ABT_mutex_free(&q->mutex);
+	ABT_cond_free(&q->cond);
+	free(q);
+}
+
+int mobject_store_completion_queue_reap(mobject_store_completion_queue_t q,
+                                        mobject_store_completion_t *completions,
+                                        unsigned max,
+                                        unsigned min)
+{
+	unsigned n = 0;
+	if(q == NULL) return -1;
+	if(min > max) min = max;
+
+	ABT_mutex_lock(q->mutex);
+	while(n < max) {
+		if(q->head == NULL) {
+			if(n >= min) break;
+			ABT_cond_wait(q->cond, q->mutex);
+			continue;
+		}
+		completions[n++] = q->head;
+		q->head = q->head->next;
+		if(q->head == NULL) q->tail = NULL;
+	}
+	ABT_mutex_unlock(q->mutex);
+	return (int)n;
+}
@@ -18,6 +18,17 @@
  * completion object.
  * mobject_store_completion* is typedef-ed as mobject_store_completion_t
  * in libmobject-store.h.
+ *
+ * A completion with callbacks or a completion queue is "driven": once
+ * its operation is issued, a ULT in the handler pool of the client's
+ * margo instance waits for the response, sets the return value, calls
+ * the callbacks and pushes the completion to its queue, so that
+ * nothing has to wait on the completion for this to happen. Other
+ * completions are completed by whoever waits on them.
+ *
+ * Writes made with LIBMOBJECT_OPERATION_DEFER_PERSIST complete when
+ * the provider replies with a non-zero safe_seq ticket, and become
+ * safe when a write_safe RPC with this ticket returns.
  */
 struct mobject_store_completion {
 	mobject_store_callback_t cb_complete;    // completion callback
@@ -25,7 +36,37 @@ struct mobject_store_completion {
 	void*                    cb_arg;         // arguments for callbacks
 	mobject_request_t        request;        // margo request to wait on
 	int                      ret_value;      // return value of the operation
+	mobject_store_completion_queue_t queue;  // where to push the completion when done
+	int                      driven;         // completed by a ULT (see above)
+	int                      complete;       // set by the ULT when done
+	int                      safe;           // set once the operation is persisted
+	mobject_provider_handle_t mph;           // provider of a deferred write
+	uint64_t                 safe_seq;       // ticket of a deferred write, 0 otherwise
+	int                      refs;           // user + running ULT, for driven completions
+	ABT_mutex                mutex;          // protects complete, safe and refs
+	ABT_cond                 cond;           // signaled when complete or safe is set
+	struct mobject_store_completion* next;   // next completion in the queue
 };
 
-#endif
+/**
+ * Queue of driven completions whose operation is done,
+ * in the order in which they completed.
+ */
+struct mobject_store_completion_queue {
+	ABT_mutex                mutex;
+	ABT_cond                 cond;           // signaled when a completion is pushed
+	mobject_store_completion_t head;
+	mobject_store_completion_t tail;
+};
 
+/**
+ * Called once the request of the completion has been set (or left
+ * to MOBJECT_REQUEST_NULL with ret_value set, for operations that
+ * completed when issued). Starts the ULT completing a driven
+ * completion; does nothing for other completions.
+ *
+ * @return 0 on success, -1 if the ULT could not be created
+ */
+int mobject_completion_start(mobject_store_completion_t c, margo_instance_id mid);
+
+#endif
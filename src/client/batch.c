@@ -0,0 +1,209 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mobject-store-config.h"
+#include "libmobject-store.h"
+#include "src/client/cluster.h"
+#include "src/client/mobject-client-impl.h"
+#include "src/io-chain/write-op-impl.h"
+#include "src/io-chain/read-op-impl.h"
+
+/* operations of a batch going to the same provider */
+typedef struct batch_group {
+    mobject_provider_handle_t mph;
+    size_t                    count;
+    size_t*                   indices;  // positions of the operations in the batch
+    mobject_request_t         req;
+} batch_group_t;
+
+/* groups the count objects of a batch by the provider they are sent to,
+   either their primary (writes) or the replica chosen for reading them;
+   returns the number of groups, or 0 if an object could not be located */
+static size_t group_by_provider(
+        struct mobject_store_handle* cluster,
+        const char* pool_name,
+        const char* const* oids,
+        size_t count,
+        int for_read,
+        int flags,
+        batch_group_t** groups)
+{
+    size_t i, g, num_groups = 0;
+    batch_group_t* gr = (batch_group_t*)calloc(count, sizeof(*gr));
+
+    for(i = 0; i < count; i++) {
+        mobject_provider_handle_t mph = for_read ?
+            mobject_store_locate_replica(cluster, pool_name, oids[i], flags) :
+            mobject_store_locate_object(cluster, oids[i]);
+        if(mph == MOBJECT_PROVIDER_HANDLE_NULL) {
+            for(g = 0; g < num_groups; g++) {
+                mobject_provider_handle_release(gr[g].mph);
+                free(gr[g].indices);
+            }
+            free(gr);
+            return 0;
+        }
+        /* each group holds a reference to its handle */
+        for(g = 0; g < num_groups; g++)
+            if(gr[g].mph == mph) break;
+        if(g < num_groups) {
+            mobject_provider_handle_release(mph);
+        } else {
+            gr[g].mph     = mph;
+            gr[g].indices = (size_t*)calloc(count, sizeof(size_t));
+            num_groups   += 1;
+        }
+        gr[g].indices[gr[g].count++] = i;
+    }
+
+    *groups = gr;
+    return num_groups;
+}
+
+static void free_groups(batch_group_t* groups, size_t num_groups)
+{
+    size_t g;
+    for(g = 0; g < num_groups; g++) {
+        mobject_provider_handle_release(groups[g].mph);
+        free(groups[g].indices);
+    }
+    free(groups);
+}
+
+/* waits for the RPCs of all the groups, setting the return
+   value of each operation to that of the RPC of its group */
+static int wait_groups(batch_group_t* groups, size_t num_groups, int* rvals)
+{
+    size_t i, g;
+    int ret = 0;
+    for(g = 0; g < num_groups; g++) {
+        batch_group_t* group = &groups[g];
+        int r = -1;
+        if(group->req != MOBJECT_REQUEST_NULL) {
+            if(mobject_aio_wait(group->req, &r) != 0) r = -1;
+        }
+        if(r != 0) ret = -1;
+        if(rvals) {
+            for(i = 0; i < group->count; i++)
+                rvals[group->indices[i]] = r;
+        }
+    }
+    return ret;
+}
+
+int mobject_store_write_op_operate_batch(
+        mobject_store_write_op_t* write_ops,
+        mobject_store_ioctx_t io,
+        const char* const* oids,
+        size_t count,
+        int* rvals,
+        int flags)
+{
+    struct mobject_store_handle* cluster = io->cluster;
+    batch_group_t* groups;
+    size_t i, g, num_groups;
+    unsigned k, m;
+    int ret = 0;
+
+    if(count == 0) return 0;
+
+    /* prepared operations keep their own bulk handle */
+    for(i = 0; i < count; i++)
+        if(write_ops[i]->ready) break;
+
+    /* replicas and erasure-coded chunks are written by the
+       per-object path, operation by operation */
+    if(i < count
+    || mobject_erasure_profile(cluster->erasure_spec, io->pool_name, &k, &m)
+    || mobject_replication_factor(cluster->replication_spec, io->pool_name) > 1) {
+        for(i = 0; i < count; i++) {
+            int r = mobject_store_write_op_operate(write_ops[i], io, oids[i], NULL, flags);
+            if(rvals) rvals[i] = r;
+            if(r != 0) ret = -1;
+        }
+        return ret;
+    }
+
+    num_groups = group_by_provider(cluster, io->pool_name, oids, count, 0, flags, &groups);
+    if(num_groups == 0) return -1;
+
+    /* send one RPC per provider, then wait for all of them */
+    for(g = 0; g < num_groups; g++) {
+        batch_group_t* group = &groups[g];
+        mobject_store_write_op_t* ops = (mobject_store_write_op_t*)calloc(group->count, sizeof(*ops));
+        const char** names = (const char**)calloc(group->count, sizeof(*names));
+        for(i = 0; i < group->count; i++) {
+            ops[i]   = write_ops[group->indices[i]];
+            names[i] = oids[group->indices[i]];
+        }
+        if(mobject_aio_write_op_operate_batch(group->mph, ops, group->count,
+                    io->pool_name, names, flags, &group->req) != 0)
+            group->req = MOBJECT_REQUEST_NULL;
+        free(ops);
+        free(names);
+    }
+
+    ret = wait_groups(groups, num_groups, rvals);
+    free_groups(groups, num_groups);
+    return ret;
+}
+
+int mobject_store_read_op_operate_batch(
+        mobject_store_read_op_t* read_ops,
+        mobject_store_ioctx_t io,
+        const char* const* oids,
+        size_t count,
+        int* rvals,
+        int flags)
+{
+    struct mobject_store_handle* cluster = io->cluster;
+    batch_group_t* groups;
+    size_t i, g, num_groups;
+    unsigned k, m;
+    int ret = 0;
+
+    if(count == 0) return 0;
+
+    /* prepared operations keep their own bulk handle */
+    for(i = 0; i < count; i++)
+        if(read_ops[i]->ready) break;
+
+    /* erasure-coded objects are decoded from their chunks,
+       operation by operation */
+    if(i < count
+    || mobject_erasure_profile(cluster->erasure_spec, io->pool_name, &k, &m)) {
+        for(i = 0; i < count; i++) {
+            int r = mobject_store_read_op_operate(read_ops[i], io, oids[i], flags);
+            if(rvals) rvals[i] = r;
+            if(r != 0) ret = -1;
+        }
+        return ret;
+    }
+
+    num_groups = group_by_provider(cluster, io->pool_name, oids, count, 1, flags, &groups);
+    if(num_groups == 0) return -1;
+
+    for(g = 0; g < num_groups; g++) {
+        batch_group_t* group = &groups[g];
+        mobject_store_read_op_t* ops = (mobject_store_read_op_t*)calloc(group->count, sizeof(*ops));
+        const char** names = (const char**)calloc(group->count, sizeof(*names));
+        for(i = 0; i < group->count; i++) {
+            ops[i]   = read_ops[group->indices[i]];
+            names[i] = oids[group->indices[i]];
+        }
+        if(mobject_aio_read_op_operate_batch(group->mph, ops, group->count,
+                    io->pool_name, names, flags, &group->req) != 0)
+            group->req = MOBJECT_REQUEST_NULL;
+        free(ops);
+        free(names);
+    }
+
+    ret = wait_groups(groups, num_groups, rvals);
+    free_groups(groups, num_groups);
+    return ret;
+}
@@ -0,0 +1,245 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "mobject-store-config.h"
+#include "src/client/buffer-pool.h"
+
+#define BUFFER_ALIGN   64
+#define PAGE_SIZE_     4096
+#define HUGE_PAGE_SIZE (2*1024*1024)
+
+struct pool_region;
+
+/* placed right before each buffer handed out */
+typedef struct buffer_header {
+    struct pool_region* region;
+    size_t              size;  // size of the block, header included
+    char                pad[BUFFER_ALIGN - sizeof(void*) - sizeof(size_t)];
+} buffer_header_t;
+
+/* free blocks of a region, sorted by offset */
+typedef struct free_block {
+    size_t             offset;
+    size_t             size;
+    struct free_block* next;
+} free_block_t;
+
+typedef struct pool_region {
+    char*               base;
+    size_t              size;
+    hg_bulk_t           bulk;      // registration of the whole region
+    free_block_t*       free_list;
+    struct pool_region* next;
+} pool_region_t;
+
+struct mobject_buffer_pool {
+    margo_instance_id mid;
+    size_t            region_size;
+    int               huge_pages;
+    pthread_mutex_t   mutex;
+    pool_region_t*    regions;
+};
+
+static size_t round_up(size_t size, size_t align)
+{
+    return (size + align - 1) / align * align;
+}
+
+/* maps and registers a region of at least size bytes */
+static pool_region_t* map_region(mobject_buffer_pool_t pool, size_t size)
+{
+    void* base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if(pool->huge_pages) {
+        base = mmap(NULL, round_up(size, HUGE_PAGE_SIZE), PROT_READ|PROT_WRITE,
+                MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if(base != MAP_FAILED) size = round_up(size, HUGE_PAGE_SIZE);
+    }
+#endif
+    /* no huge pages available, use regular ones */
+    if(base == MAP_FAILED) {
+        size = round_up(size, PAGE_SIZE_);
+        base = mmap(NULL, size, PROT_READ|PROT_WRITE,
+                MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    }
+    if(base == MAP_FAILED) {
+        fprintf(stderr, "[MOBJECT] Could not map a buffer region of %zu bytes\n", size);
+        return NULL;
+    }
+
+    pool_region_t* region = (pool_region_t*)calloc(1, sizeof(*region));
+    region->base = (char*)base;
+    region->size = size;
+
+    void* buf_ptrs[1] = { base };
+    hg_size_t buf_sizes[1] = { size };
+    hg_return_t ret = margo_bulk_create(pool->mid, 1, buf_ptrs, buf_sizes,
+            HG_BULK_READWRITE, &region->bulk);
+    if(ret != HG_SUCCESS) {
+        fprintf(stderr, "[MOBJECT] margo_bulk_create() failed for a buffer region (ret = %d)\n", ret);
+        munmap(base, size);
+        free(region);
+        return NULL;
+    }
+
+    region->free_list = (free_block_t*)calloc(1, sizeof(free_block_t));
+    region->free_list->offset = 0;
+    region->free_list->size   = size;
+    return region;
+}
+
+/* takes a block of size bytes from the region, returns its offset or -1 */
+static int64_t region_take(pool_region_t* region, size_t size)
+{
+    free_block_t *b, *prev = NULL;
+    for(b = region->free_list; b; prev = b, b = b->next) {
+        if(b->size < size) continue;
+        int64_t offset = (int64_t)b->offset;
+        if(b->size == size) {
+            if(prev) prev->next = b->next;
+            else region->free_list = b->next;
+            free(b);
+        } else {
+            b->offset += size;
+            b->size   -= size;
+        }
+        return offset;
+    }
+    return -1;
+}
+
+/* gives a block back to the region, merging it with its neighbours */
+static void region_give(pool_region_t* region, size_t offset, size_t size)
+{
+    free_block_t *b = region->free_list, *prev = NULL;
+    while(b && b->offset < offset) {
+        prev = b;
+        b = b->next;
+    }
+    if(prev && prev->offset + prev->size == offset) {
+        prev->size += size;
+        if(b && prev->offset + prev->size == b->offset) {
+            prev->size += b->size;
+            prev->next  = b->next;
+            free(b);
+        }
+        return;
+    }
+    if(b && offset + size == b->offset) {
+        b->offset  = offset;
+        b->size   += size;
+        return;
+    }
+    free_block_t* n = (free_block_t*)calloc(1, sizeof(*n));
+    n->offset = offset;
+    n->size   = size;
+    n->next   = b;
+    if(prev) prev->next = n;
+    else region->free_list = n;
+}
+
+int mobject_buffer_pool_create(margo_instance_id mid,
+        size_t region_size,
+        int huge_pages,
+        mobject_buffer_pool_t* pool)
+{
+    mobject_buffer_pool_t p = (mobject_buffer_pool_t)calloc(1, sizeof(*p));
+    if(!p) return -1;
+    p->mid         = mid;
+    p->region_size = region_size ? region_size : MOBJECT_BUFFER_POOL_DEFAULT_REGION_SIZE;
+    p->huge_pages  = huge_pages;
+    pthread_mutex_init(&p->mutex, NULL);
+    *pool = p;
+    return 0;
+}
+
+void mobject_buffer_pool_destroy(mobject_buffer_pool_t pool)
+{
+    if(!pool) return;
+    pool_region_t* region = pool->regions;
+    while(region) {
+        pool_region_t* next = region->next;
+        free_block_t* b = region->free_list;
+        while(b) {
+            free_block_t* n = b->next;
+            free(b);
+            b = n;
+        }
+        margo_bulk_free(region->bulk);
+        munmap(region->base, region->size);
+        free(region);
+        region = next;
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+void* mobject_buffer_pool_alloc(mobject_buffer_pool_t pool, size_t size)
+{
+    size_t need = round_up(size + sizeof(buffer_header_t), BUFFER_ALIGN);
+    pool_region_t* region;
+    int64_t offset = -1;
+
+    pthread_mutex_lock(&pool->mutex);
+    for(region = pool->regions; region; region = region->next) {
+        offset = region_take(region, need);
+        if(offset >= 0) break;
+    }
+    if(offset < 0) {
+        region = map_region(pool, need > pool->region_size ? need : pool->region_size);
+        if(!region) {
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        region->next  = pool->regions;
+        pool->regions = region;
+        offset = region_take(region, need);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    buffer_header_t* header = (buffer_header_t*)(region->base + offset);
+    header->region = region;
+    header->size   = need;
+    return (void*)(header + 1);
+}
+
+void mobject_buffer_pool_free(mobject_buffer_pool_t pool, void* buffer)
+{
+    if(!buffer) return;
+    buffer_header_t* header = ((buffer_header_t*)buffer) - 1;
+    pool_region_t* region = header->region;
+    size_t offset = (char*)header - region->base;
+
+    pthread_mutex_lock(&pool->mutex);
+    region_give(region, offset, header->size);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+hg_bulk_t mobject_buffer_pool_find(void* arg,
+        const void* ptr,
+        size_t len,
+        uint64_t* offset)
+{
+    mobject_buffer_pool_t pool = (mobject_buffer_pool_t)arg;
+    const char* p = (const char*)ptr;
+    hg_bulk_t bulk = HG_BULK_NULL;
+    pool_region_t* region;
+
+    pthread_mutex_lock(&pool->mutex);
+    for(region = pool->regions; region; region = region->next) {
+        if(p >= region->base && p + len <= region->base + region->size) {
+            *offset = p - region->base;
+            bulk    = region->bulk;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return bulk;
+}
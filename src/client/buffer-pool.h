@@ -0,0 +1,55 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MOBJECT_BUFFER_POOL_H
+#define __MOBJECT_BUFFER_POOL_H
+
+#include <margo.h>
+
+#define MOBJECT_BUFFER_POOL_DEFAULT_REGION_SIZE (64*1024*1024)
+
+/**
+ * A pool of buffers carved out of large memory regions, each of them
+ * registered with Mercury once, when it is mapped. Operations whose
+ * buffers come from the same region can reference the region's bulk
+ * handle instead of registering their buffers. Regions are only
+ * unmapped when the pool is destroyed.
+ */
+typedef struct mobject_buffer_pool* mobject_buffer_pool_t;
+
+/**
+ * Creates a pool whose regions are region_size bytes (larger buffers
+ * get a region of their own). If huge_pages is set, regions are backed
+ * by huge pages when the system allows it.
+ */
+int mobject_buffer_pool_create(margo_instance_id mid,
+        size_t region_size,
+        int huge_pages,
+        mobject_buffer_pool_t* pool);
+
+void mobject_buffer_pool_destroy(mobject_buffer_pool_t pool);
+
+/**
+ * Returns a buffer of size bytes, aligned on 64 bytes,
+ * or NULL if no memory could be mapped or registered.
+ */
+void* mobject_buffer_pool_alloc(mobject_buffer_pool_t pool, size_t size);
+
+/**
+ * Returns a buffer obtained from mobject_buffer_pool_alloc to the pool.
+ */
+void mobject_buffer_pool_free(mobject_buffer_pool_t pool, void* buffer);
+
+/**
+ * Returns the bulk handle of the region containing [ptr, ptr+len) and
+ * sets *offset to the position of ptr in it, or returns HG_BULK_NULL if
+ * the memory does not belong to the pool. Matches bulk_region_finder_t.
+ */
+hg_bulk_t mobject_buffer_pool_find(void* pool,
+        const void* ptr,
+        size_t len,
+        uint64_t* offset);
+
+#endif
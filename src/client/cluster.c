@@ -8,6 +8,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include <margo.h>
@@ -15,16 +16,30 @@
 
 #include "libmobject-store.h"
 #include "src/client/cluster.h"
+#include "src/client/erasure.h"
+#include "src/client/split.h"
+#include "src/client/hedge.h"
+#include "src/client/mobject-client-impl.h"
 #include "src/io-chain/prepare-write-op.h"
 #include "src/io-chain/prepare-read-op.h"
 #include "src/rpc-types/write-op.h"
 #include "src/rpc-types/read-op.h"
 #include "src/util/log.h"
 
-static unsigned long sdbm_hash(const char* str);
-
 static int mobject_store_shutdown_servers(struct mobject_store_handle *cluster_handle);
 
+static void mobject_store_membership_update_cb(void* data,
+        ssg_member_id_t member_id, ssg_member_update_type_t update_type);
+
+static int mobject_store_refresh_provider_handles(struct mobject_store_handle *cluster_handle);
+
+static void mobject_store_release_provider_handles(struct mobject_store_handle *cluster_handle);
+
+static char* mobject_store_addr_host(margo_instance_id mid, hg_addr_t addr);
+
+static int mobject_store_create_placement(struct mobject_store_handle *cluster_handle,
+        int gsize, mobject_placement_t* placement);
+
 int mobject_store_create(mobject_store_t *cluster, const char * const id)
 {
     struct mobject_store_handle *cluster_handle;
@@ -108,9 +123,13 @@ int mobject_store_connect(mobject_store_t cluster)
     for(i=0; i<24 && svr_addr_str[i] != '\0' && svr_addr_str[i] != ':'; i++)
         proto[i] = svr_addr_str[i];
 
-    /* intialize margo */
-    /* XXX: probably want to expose some way of tweaking threading parameters */
-    margo_instance_id mid = margo_init(proto, MARGO_SERVER_MODE, 0, -1);
+    /* intialize margo, with a progress execution stream on which the
+       responses are processed and the AIO callbacks are called, unless
+       MOBJECT_PROGRESS_THREAD is set to 0 */
+    int use_progress_thread = 1;
+    if(getenv(MOBJECT_PROGRESS_THREAD_ENV))
+        use_progress_thread = atoi(getenv(MOBJECT_PROGRESS_THREAD_ENV));
+    margo_instance_id mid = margo_init(proto, MARGO_SERVER_MODE, use_progress_thread, -1);
     if (mid == MARGO_INSTANCE_NULL)
     {
         fprintf(stderr, "Error: Unable to initialize margo\n");
@@ -147,12 +166,11 @@ int mobject_store_connect(mobject_store_t cluster)
         return -1;
     }
 
-    // initialize ch-placement
-    cluster_handle->ch_instance = 
-        ch_placement_initialize("static_modulo", gsize, 0, 0);
-    if(!cluster_handle->ch_instance)
+    // initialize object placement (static modulo or consistent-hash ring)
+    ret = mobject_store_create_placement(cluster_handle, gsize, &cluster_handle->placement);
+    if(ret != 0)
     {
-        fprintf(stderr, "Error: Unable to initialize ch-placement instance\n");
+        fprintf(stderr, "Error: Unable to initialize object placement\n");
         ssg_group_unobserve(cluster_handle->gid);
         margo_finalize(cluster_handle->mid);
         ssg_finalize();
@@ -166,6 +184,7 @@ int mobject_store_connect(mobject_store_t cluster)
     if(ret != 0)
     {
         fprintf(stderr, "Error: Unable to create a mobject client\n");
+        mobject_placement_free(cluster_handle->placement);
         ssg_group_unobserve(cluster_handle->gid);
         margo_finalize(cluster_handle->mid);
         ssg_finalize();
@@ -174,6 +193,88 @@ int mobject_store_connect(mobject_store_t cluster)
         return -1;
     }
 
+    // objects are spread over the providers of each server by name
+    cluster_handle->num_providers = 1;
+    if(getenv(MOBJECT_PROVIDERS_ENV))
+        cluster_handle->num_providers = atoi(getenv(MOBJECT_PROVIDERS_ENV));
+    if(cluster_handle->num_providers < 1 || cluster_handle->num_providers > MOBJECT_MAX_PROVIDERS)
+        cluster_handle->num_providers = 1;
+
+    // provider handles are created lazily, num_providers per server rank
+    cluster_handle->num_servers = gsize;
+    cluster_handle->provider_handles = (mobject_provider_handle_t*)calloc(
+            gsize * cluster_handle->num_providers, sizeof(mobject_provider_handle_t));
+    cluster_handle->server_hosts = (char**)calloc(gsize, sizeof(char*));
+    cluster_handle->membership_changed = 0;
+    ABT_rwlock_create(&cluster_handle->lock);
+    ABT_mutex_create(&cluster_handle->handles_mutex);
+
+    // replication factors of the pools, and where this client runs for localized reads
+    if(getenv(MOBJECT_REPLICATION_ENV))
+        cluster_handle->replication_spec = strdup(getenv(MOBJECT_REPLICATION_ENV));
+    if(getenv(MOBJECT_ERASURE_ENV))
+        cluster_handle->erasure_spec = strdup(getenv(MOBJECT_ERASURE_ENV));
+    // large reads and writes are split only if asked to
+    if(getenv(MOBJECT_SPLIT_SIZE_ENV))
+        cluster_handle->split_size = strtoull(getenv(MOBJECT_SPLIT_SIZE_ENV), NULL, 0);
+    cluster_handle->split_requests = MOBJECT_SPLIT_DEFAULT_REQUESTS;
+    if(getenv(MOBJECT_SPLIT_REQUESTS_ENV))
+        cluster_handle->split_requests = atoi(getenv(MOBJECT_SPLIT_REQUESTS_ENV));
+    // registered memory handed out by mobject_store_alloc_buffer
+    if(getenv(MOBJECT_BUFFER_REGION_SIZE_ENV) || getenv(MOBJECT_BUFFER_HUGE_PAGES_ENV))
+    {
+        size_t region_size = 0;
+        int huge_pages = 0;
+        if(getenv(MOBJECT_BUFFER_REGION_SIZE_ENV))
+            region_size = strtoull(getenv(MOBJECT_BUFFER_REGION_SIZE_ENV), NULL, 0);
+        if(getenv(MOBJECT_BUFFER_HUGE_PAGES_ENV))
+            huge_pages = atoi(getenv(MOBJECT_BUFFER_HUGE_PAGES_ENV));
+        if(mobject_client_set_buffer_pool(cluster_handle->mobject_clt, region_size, huge_pages) != 0)
+            fprintf(stderr, "Warning: Unable to configure the mobject buffer pool\n");
+    }
+    // operations wait forever and reads are not hedged unless asked to
+    if(getenv(MOBJECT_TIMEOUT_ENV) || getenv(MOBJECT_RETRIES_ENV))
+    {
+        double timeout = 0, backoff = 1.0;
+        unsigned retries = 0;
+        int retry_writes = 0;
+        if(getenv(MOBJECT_TIMEOUT_ENV))
+            timeout = atof(getenv(MOBJECT_TIMEOUT_ENV));
+        if(getenv(MOBJECT_RETRIES_ENV))
+            retries = atoi(getenv(MOBJECT_RETRIES_ENV));
+        if(getenv(MOBJECT_RETRY_BACKOFF_ENV))
+            backoff = atof(getenv(MOBJECT_RETRY_BACKOFF_ENV));
+        if(getenv(MOBJECT_RETRY_WRITES_ENV))
+            retry_writes = atoi(getenv(MOBJECT_RETRY_WRITES_ENV));
+        if(mobject_client_set_timeout(cluster_handle->mobject_clt, timeout, retries, backoff, retry_writes) != 0)
+            fprintf(stderr, "Warning: Invalid mobject timeout settings\n");
+    }
+    if(getenv(MOBJECT_HEDGE_PERCENTILE_ENV))
+    {
+        double min_delay = 0;
+        if(getenv(MOBJECT_HEDGE_MIN_DELAY_ENV))
+            min_delay = atof(getenv(MOBJECT_HEDGE_MIN_DELAY_ENV));
+        if(mobject_client_set_hedging(cluster_handle->mobject_clt,
+                    atof(getenv(MOBJECT_HEDGE_PERCENTILE_ENV)), min_delay) != 0)
+            fprintf(stderr, "Warning: Invalid mobject hedging settings\n");
+    }
+    {
+        hg_addr_t self_addr;
+        if(margo_addr_self(mid, &self_addr) == HG_SUCCESS)
+        {
+            cluster_handle->self_host = mobject_store_addr_host(mid, self_addr);
+            margo_addr_free(mid, self_addr);
+        }
+    }
+
+    // get notified of membership changes to refresh the provider handles
+    ret = ssg_group_add_membership_update_callback(cluster_handle->gid,
+            mobject_store_membership_update_cb, (void*)cluster_handle);
+    if(ret != SSG_SUCCESS)
+    {
+        fprintf(stderr, "Warning: Unable to track mobject cluster membership changes\n");
+    }
+
     free(svr_addr_str);
 
     return 0;
@@ -203,16 +304,70 @@ void mobject_store_shutdown(mobject_store_t cluster)
         }
     }
 
+    ssg_group_remove_membership_update_callback(cluster_handle->gid,
+            mobject_store_membership_update_cb, (void*)cluster_handle);
+    mobject_store_release_provider_handles(cluster_handle);
+    ABT_mutex_free(&cluster_handle->handles_mutex);
+    ABT_rwlock_free(&cluster_handle->lock);
+    free(cluster_handle->replication_spec);
+    free(cluster_handle->erasure_spec);
+    free(cluster_handle->self_host);
     mobject_client_finalize(cluster_handle->mobject_clt);
     ssg_group_unobserve(cluster_handle->gid);
     margo_finalize(cluster_handle->mid);
     ssg_finalize();
-    ch_placement_finalize(cluster_handle->ch_instance);
+    mobject_placement_free(cluster_handle->placement);
     free(cluster_handle);
 
     return;
 }
 
+int mobject_store_set_split(mobject_store_t cluster, size_t chunk_size, unsigned max_requests)
+{
+    struct mobject_store_handle *cluster_handle = (struct mobject_store_handle *)cluster;
+    if(cluster_handle == NULL || max_requests == 0) return -1;
+    cluster_handle->split_size     = chunk_size;
+    cluster_handle->split_requests = max_requests;
+    return 0;
+}
+
+int mobject_store_set_timeout(mobject_store_t cluster, double timeout_ms,
+        unsigned max_retries, double backoff_ms, int retry_writes)
+{
+    struct mobject_store_handle *cluster_handle = (struct mobject_store_handle *)cluster;
+    if(cluster_handle == NULL || !cluster_handle->connected) return -1;
+    return mobject_client_set_timeout(cluster_handle->mobject_clt,
+            timeout_ms, max_retries, backoff_ms, retry_writes);
+}
+
+int mobject_store_set_hedging(mobject_store_t cluster, double percentile, double min_delay_ms)
+{
+    struct mobject_store_handle *cluster_handle = (struct mobject_store_handle *)cluster;
+    if(cluster_handle == NULL || !cluster_handle->connected) return -1;
+    return mobject_client_set_hedging(cluster_handle->mobject_clt, percentile, min_delay_ms);
+}
+
+int mobject_store_get_client_stats(mobject_store_t cluster, mobject_client_stats_t *stats)
+{
+    struct mobject_store_handle *cluster_handle = (struct mobject_store_handle *)cluster;
+    if(cluster_handle == NULL || !cluster_handle->connected) return -1;
+    return mobject_client_get_stats(cluster_handle->mobject_clt, stats);
+}
+
+char* mobject_store_alloc_buffer(mobject_store_t cluster, size_t len)
+{
+    struct mobject_store_handle *cluster_handle = (struct mobject_store_handle *)cluster;
+    if(cluster_handle == NULL || !cluster_handle->connected) return NULL;
+    return (char*)mobject_client_alloc_buffer(cluster_handle->mobject_clt, len);
+}
+
+void mobject_store_free_buffer(mobject_store_t cluster, char* buf)
+{
+    struct mobject_store_handle *cluster_handle = (struct mobject_store_handle *)cluster;
+    if(cluster_handle == NULL || buf == NULL) return;
+    mobject_client_free_buffer(cluster_handle->mobject_clt, buf);
+}
+
 int mobject_store_pool_create(mobject_store_t cluster, const char * pool_name)
 {
     /* XXX: this is a NOOP -- we don't implement pools currently */
@@ -272,6 +427,14 @@ void mobject_store_write_op_write(mobject_store_write_op_t write_op,
     mobject_write_op_write(write_op, buffer, offset, len);
 }
 
+void mobject_store_write_op_writev(mobject_store_write_op_t write_op,
+        const struct iovec *iov,
+        int iovcnt,
+        uint64_t offset)
+{
+    mobject_write_op_writev(write_op, iov, iovcnt, offset);
+}
+
 void mobject_store_write_op_write_full(mobject_store_write_op_t write_op,
         const char *buffer,
         size_t len)
@@ -330,27 +493,51 @@ void mobject_store_write_op_omap_rm_keys(mobject_store_write_op_t write_op,
     mobject_write_op_omap_rm_keys(write_op, keys, keys_len);
 }
 
+int mobject_store_write_op_prepare(mobject_store_write_op_t write_op,
+        mobject_store_ioctx_t io)
+{
+    unsigned k, m;
+    if(mobject_erasure_profile(io->cluster->erasure_spec, io->pool_name, &k, &m)) {
+        fprintf(stderr, "[MOBJECT] write_ops can't be prepared for erasure-coded pools\n");
+        return -1;
+    }
+    return mobject_write_op_prepare(io->cluster->mobject_clt, write_op);
+}
+
+int mobject_store_write_op_update(mobject_store_write_op_t write_op,
+        unsigned index,
+        uint64_t offset,
+        size_t len)
+{
+    return mobject_write_op_update(write_op, index, offset, len);
+}
+
 int mobject_store_write_op_operate(mobject_store_write_op_t write_op,
         mobject_store_ioctx_t io,
         const char *oid,
         time_t *mtime,
         int flags)
 {
-    mobject_provider_handle_t mph = MOBJECT_PROVIDER_HANDLE_NULL;
-    uint64_t oid_hash = sdbm_hash(oid);
-    unsigned long server_rank;
-    ch_placement_find_closest(io->cluster->ch_instance, oid_hash, 1, &server_rank);
-    ssg_member_id_t svr_id = ssg_get_group_member_id_from_rank(io->cluster->gid, server_rank);
-    hg_addr_t svr_addr = ssg_get_group_member_addr(io->cluster->gid, svr_id);
-
-    // TODO for now multiplex id is hard-coded as 1
-    // XXX multiple providers may be in the same node (with distinct mplex ids)
-    int r = mobject_provider_handle_create(io->cluster->mobject_clt, svr_addr, 1, &mph);
-    if(r != 0) return r;
-
-    r = mobject_write_op_operate(mph, write_op, io->pool_name, oid, mtime, flags);
+    unsigned k, m;
+    if(mobject_erasure_profile(io->cluster->erasure_spec, io->pool_name, &k, &m))
+        return mobject_erasure_write_op_operate(io->cluster, write_op, io->pool_name, oid, k, m);
+
+    mobject_provider_handle_t mph = mobject_store_locate_object(io->cluster, oid);
+    if(mph == MOBJECT_PROVIDER_HANDLE_NULL) return -1;
+
+    int ret = 0;
+    if(mobject_split_write_op_count(write_op, io->cluster->split_size,
+                io->cluster->split_requests) > 1) {
+        mobject_request_t req;
+        if(mobject_split_aio_write_op_operate(mph, write_op, io->pool_name, oid, mtime, flags,
+                    io->cluster->split_size, io->cluster->split_requests, &req) != 0
+        || mobject_aio_wait(req, &ret) != 0)
+            ret = -1;
+    } else {
+        ret = mobject_write_op_operate(mph, write_op, io->pool_name, oid, mtime, flags);
+    }
     mobject_provider_handle_release(mph);
-    return r;
+    return ret;
 }
 
 mobject_store_read_op_t mobject_store_create_read_op(void)
@@ -381,6 +568,16 @@ void mobject_store_read_op_read(mobject_store_read_op_t read_op,
     mobject_read_op_read(read_op, buffer, offset, len, bytes_read, prval);
 }
 
+void mobject_store_read_op_readv(mobject_store_read_op_t read_op,
+        uint64_t offset,
+        const struct iovec *iov,
+        int iovcnt,
+        size_t *bytes_read,
+        int *prval)
+{
+    mobject_read_op_readv(read_op, iov, iovcnt, offset, bytes_read, prval);
+}
+
 void mobject_store_read_op_omap_get_keys(mobject_store_read_op_t read_op,
         const char *start_after,
         uint64_t max_return,
@@ -409,26 +606,373 @@ void mobject_store_read_op_omap_get_vals_by_keys(mobject_store_read_op_t read_op
     mobject_read_op_omap_get_vals_by_keys(read_op, keys, keys_len, iter, prval);
 }
 
+int mobject_store_read_op_prepare(mobject_store_read_op_t read_op,
+        mobject_store_ioctx_t io)
+{
+    unsigned k, m;
+    if(mobject_erasure_profile(io->cluster->erasure_spec, io->pool_name, &k, &m)) {
+        fprintf(stderr, "[MOBJECT] read_ops can't be prepared for erasure-coded pools\n");
+        return -1;
+    }
+    return mobject_read_op_prepare(io->cluster->mobject_clt, read_op);
+}
+
+int mobject_store_read_op_update(mobject_store_read_op_t read_op,
+        unsigned index,
+        uint64_t offset,
+        size_t len)
+{
+    return mobject_read_op_update(read_op, index, offset, len);
+}
+
 int mobject_store_read_op_operate(mobject_store_read_op_t read_op,
         mobject_store_ioctx_t ioctx,
         const char *oid,
         int flags)
 {
-    mobject_provider_handle_t mph = MOBJECT_PROVIDER_HANDLE_NULL;
-    uint64_t oid_hash = sdbm_hash(oid);
+    unsigned k, m;
+    if(mobject_erasure_profile(ioctx->cluster->erasure_spec, ioctx->pool_name, &k, &m))
+        return mobject_erasure_read_op_operate(ioctx->cluster, read_op, ioctx->pool_name, oid, k, m);
+
+    mobject_provider_handle_t mph = mobject_store_locate_replica(ioctx->cluster,
+            ioctx->pool_name, oid, flags);
+    mobject_provider_handle_t hedge_mph = MOBJECT_PROVIDER_HANDLE_NULL;
+    mobject_request_t req;
+    int ret = 0;
+    if(mph == MOBJECT_PROVIDER_HANDLE_NULL) return -1;
+
+    if(mobject_split_read_op_count(read_op, ioctx->cluster->split_size,
+                ioctx->cluster->split_requests) > 1) {
+        if(mobject_split_aio_read_op_operate(mph, read_op, ioctx->pool_name, oid, flags,
+                    ioctx->cluster->split_size, ioctx->cluster->split_requests, &req) != 0
+        || mobject_aio_wait(req, &ret) != 0)
+            ret = -1;
+    } else if((hedge_mph = mobject_store_locate_hedge_replica(ioctx->cluster,
+                    ioctx->pool_name, oid, mph)) != MOBJECT_PROVIDER_HANDLE_NULL) {
+        if(mobject_hedged_aio_read_op_operate(mph, hedge_mph, read_op, ioctx->pool_name,
+                    oid, flags, &req) != 0
+        || mobject_aio_wait(req, &ret) != 0)
+            ret = -1;
+        mobject_provider_handle_release(hedge_mph);
+    } else {
+        ret = mobject_read_op_operate(mph, read_op, ioctx->pool_name, oid, flags);
+    }
+    mobject_provider_handle_release(mph);
+    return ret;
+}
+
+/* takes the lock of the cluster for reading, first refreshing the
+   placement and provider handles if the membership has changed */
+static void mobject_store_lock(struct mobject_store_handle *cluster_handle)
+{
+    if(cluster_handle->membership_changed)
+    {
+        ABT_rwlock_wrlock(cluster_handle->lock);
+        if(cluster_handle->membership_changed)
+            mobject_store_refresh_provider_handles(cluster_handle);
+        ABT_rwlock_unlock(cluster_handle->lock);
+    }
+    ABT_rwlock_rdlock(cluster_handle->lock);
+}
+
+/* returns the handle cached by the cluster, without taking a
+   reference, with the lock of the cluster held for reading */
+static mobject_provider_handle_t mobject_store_cached_provider_handle(
+        struct mobject_store_handle *cluster_handle,
+        unsigned long server_rank,
+        unsigned provider)
+{
+    mobject_provider_handle_t mph;
+    unsigned long index;
+
+    if(server_rank >= (unsigned long)cluster_handle->num_servers
+    || provider >= cluster_handle->num_providers)
+        return MOBJECT_PROVIDER_HANDLE_NULL;
+
+    index = server_rank * cluster_handle->num_providers + provider;
+    ABT_mutex_lock(cluster_handle->handles_mutex);
+    mph = cluster_handle->provider_handles[index];
+    if(mph != MOBJECT_PROVIDER_HANDLE_NULL)
+    {
+        ABT_mutex_unlock(cluster_handle->handles_mutex);
+        return mph;
+    }
+
+    ssg_member_id_t svr_id = ssg_get_group_member_id_from_rank(cluster_handle->gid, server_rank);
+    hg_addr_t svr_addr = ssg_get_group_member_addr(cluster_handle->gid, svr_id);
+    if(svr_addr == HG_ADDR_NULL)
+    {
+        ABT_mutex_unlock(cluster_handle->handles_mutex);
+        fprintf(stderr, "Error: Unable to obtain address for mobject server %lu\n", server_rank);
+        return MOBJECT_PROVIDER_HANDLE_NULL;
+    }
+
+    int r = mobject_provider_handle_create(cluster_handle->mobject_clt, svr_addr,
+            MOBJECT_PROVIDER_ID_BASE + provider, &mph);
+    if(r != 0)
+    {
+        ABT_mutex_unlock(cluster_handle->handles_mutex);
+        return MOBJECT_PROVIDER_HANDLE_NULL;
+    }
+
+    cluster_handle->provider_handles[index] = mph;
+    if(!cluster_handle->server_hosts[server_rank])
+        cluster_handle->server_hosts[server_rank] =
+            mobject_store_addr_host(cluster_handle->mid, svr_addr);
+    ABT_mutex_unlock(cluster_handle->handles_mutex);
+    return mph;
+}
+
+/* same as above, taking a reference for the caller */
+static mobject_provider_handle_t mobject_store_ref_provider_handle(
+        struct mobject_store_handle *cluster_handle,
+        unsigned long server_rank,
+        unsigned provider)
+{
+    mobject_provider_handle_t mph = mobject_store_cached_provider_handle(
+            cluster_handle, server_rank, provider);
+    if(mph != MOBJECT_PROVIDER_HANDLE_NULL)
+        mobject_provider_handle_ref_incr(mph);
+    return mph;
+}
+
+mobject_provider_handle_t mobject_store_locate_object(
+        struct mobject_store_handle *cluster_handle,
+        const char *oid)
+{
+    mobject_provider_handle_t mph;
     unsigned long server_rank;
-    ch_placement_find_closest(ioctx->cluster->ch_instance, oid_hash, 1, &server_rank);
-    ssg_member_id_t svr_id = ssg_get_group_member_id_from_rank(ioctx->cluster->gid, server_rank);
-    hg_addr_t svr_addr = ssg_get_group_member_addr(ioctx->cluster->gid, svr_id);
 
-    // XXX multiple providers may be in the same node (with distinct mplex ids)
-    // TODO for now multiplex id is hard-coded as 1
-    int r = mobject_provider_handle_create(ioctx->cluster->mobject_clt, svr_addr, 1, &mph);
-    if(r != 0) return r;
+    mobject_store_lock(cluster_handle);
+    server_rank = mobject_placement_locate(cluster_handle->placement, oid);
+    mph = mobject_store_ref_provider_handle(cluster_handle, server_rank,
+            mobject_placement_locate_provider(oid, cluster_handle->num_providers));
+    ABT_rwlock_unlock(cluster_handle->lock);
+    return mph;
+}
 
-    r = mobject_read_op_operate(mph,read_op, ioctx->pool_name, oid, flags);
-    mobject_provider_handle_release(mph);
-    return r;
+unsigned mobject_store_locate_chunks(
+        struct mobject_store_handle *cluster_handle,
+        const char *oid,
+        unsigned n,
+        mobject_provider_handle_t *mph)
+{
+    unsigned long ranks[MOBJECT_MAX_REPLICAS];
+    unsigned i, provider;
+
+    if(n > MOBJECT_MAX_REPLICAS) n = MOBJECT_MAX_REPLICAS;
+    mobject_store_lock(cluster_handle);
+
+    provider = mobject_placement_locate_provider(oid, cluster_handle->num_providers);
+    n = mobject_placement_locate_replicas(cluster_handle->placement, oid, n, ranks);
+    for(i = 0; i < n; i++) {
+        mph[i] = mobject_store_ref_provider_handle(cluster_handle, ranks[i], provider);
+        if(mph[i] == MOBJECT_PROVIDER_HANDLE_NULL) break;
+    }
+    ABT_rwlock_unlock(cluster_handle->lock);
+    return i;
+}
+
+mobject_provider_handle_t mobject_store_locate_replica(
+        struct mobject_store_handle *cluster_handle,
+        const char *pool_name,
+        const char *oid,
+        int flags)
+{
+    unsigned long ranks[MOBJECT_MAX_REPLICAS];
+    mobject_provider_handle_t mph = MOBJECT_PROVIDER_HANDLE_NULL;
+    unsigned n, i, provider, next;
+    int local;
+
+    n = mobject_replication_factor(cluster_handle->replication_spec, pool_name);
+    if(n <= 1 || !(flags & (LIBMOBJECT_OPERATION_BALANCE_READS | LIBMOBJECT_OPERATION_LOCALIZE_READS)))
+        return mobject_store_locate_object(cluster_handle, oid);
+
+    mobject_store_lock(cluster_handle);
+
+    provider = mobject_placement_locate_provider(oid, cluster_handle->num_providers);
+    n = mobject_placement_locate_replicas(cluster_handle->placement, oid, n, ranks);
+
+    if((flags & LIBMOBJECT_OPERATION_LOCALIZE_READS) && cluster_handle->self_host)
+    {
+        for(i = 0; i < n; i++)
+        {
+            mph = mobject_store_cached_provider_handle(cluster_handle, ranks[i], provider);
+            if(mph == MOBJECT_PROVIDER_HANDLE_NULL) continue;
+            ABT_mutex_lock(cluster_handle->handles_mutex);
+            local = cluster_handle->server_hosts[ranks[i]]
+                 && strcmp(cluster_handle->server_hosts[ranks[i]], cluster_handle->self_host) == 0;
+            ABT_mutex_unlock(cluster_handle->handles_mutex);
+            if(local) goto found;
+        }
+    }
+
+    if(flags & LIBMOBJECT_OPERATION_BALANCE_READS)
+    {
+        ABT_mutex_lock(cluster_handle->handles_mutex);
+        next = cluster_handle->read_counter++;
+        ABT_mutex_unlock(cluster_handle->handles_mutex);
+        mph = mobject_store_cached_provider_handle(cluster_handle, ranks[next % n], provider);
+        goto found;
+    }
+
+    mph = mobject_store_cached_provider_handle(cluster_handle, ranks[0], provider);
+found:
+    if(mph != MOBJECT_PROVIDER_HANDLE_NULL)
+        mobject_provider_handle_ref_incr(mph);
+    ABT_rwlock_unlock(cluster_handle->lock);
+    return mph;
+}
+
+mobject_provider_handle_t mobject_store_locate_hedge_replica(
+        struct mobject_store_handle *cluster_handle,
+        const char *pool_name,
+        const char *oid,
+        mobject_provider_handle_t first)
+{
+    mobject_provider_handle_t mph[MOBJECT_MAX_REPLICAS];
+    mobject_provider_handle_t hedge = MOBJECT_PROVIDER_HANDLE_NULL;
+    unsigned n, i;
+
+    if(cluster_handle->mobject_clt->hedge_percentile <= 0)
+        return MOBJECT_PROVIDER_HANDLE_NULL;
+    n = mobject_replication_factor(cluster_handle->replication_spec, pool_name);
+    if(n <= 1)
+        return MOBJECT_PROVIDER_HANDLE_NULL;
+
+    n = mobject_store_locate_chunks(cluster_handle, oid, n, mph);
+    for(i = 0; i < n; i++) {
+        if(hedge == MOBJECT_PROVIDER_HANDLE_NULL && mph[i] != first)
+            hedge = mph[i];
+        else
+            mobject_provider_handle_release(mph[i]);
+    }
+    return hedge;
+}
+
+mobject_provider_handle_t mobject_store_get_provider_handle(
+        struct mobject_store_handle *cluster_handle,
+        unsigned long server_rank,
+        unsigned provider)
+{
+    mobject_provider_handle_t mph;
+
+    mobject_store_lock(cluster_handle);
+    mph = mobject_store_ref_provider_handle(cluster_handle, server_rank, provider);
+    ABT_rwlock_unlock(cluster_handle->lock);
+    return mph;
+}
+
+static void mobject_store_membership_update_cb(void* data,
+        ssg_member_id_t member_id, ssg_member_update_type_t update_type)
+{
+    struct mobject_store_handle *cluster_handle = (struct mobject_store_handle *)data;
+    (void)member_id;
+    (void)update_type;
+    /* ranks may have shifted, handles are refreshed on the next operation */
+    cluster_handle->membership_changed = 1;
+}
+
+/* drops the references of the cluster to its handles; operations
+   still using one hold their own reference */
+static void mobject_store_release_provider_handles(struct mobject_store_handle *cluster_handle)
+{
+    int i;
+    if(!cluster_handle->provider_handles) return;
+    for(i = 0; i < cluster_handle->num_servers * (int)cluster_handle->num_providers; i++)
+    {
+        if(cluster_handle->provider_handles[i] != MOBJECT_PROVIDER_HANDLE_NULL)
+            mobject_provider_handle_release(cluster_handle->provider_handles[i]);
+    }
+    for(i = 0; i < cluster_handle->num_servers; i++)
+        free(cluster_handle->server_hosts[i]);
+    free(cluster_handle->provider_handles);
+    free(cluster_handle->server_hosts);
+    cluster_handle->provider_handles = NULL;
+    cluster_handle->server_hosts = NULL;
+    cluster_handle->num_servers = 0;
+}
+
+/* called with the lock of the cluster held for writing; on failure, the
+   flag stays set and the refresh is retried by the next operation */
+static int mobject_store_refresh_provider_handles(struct mobject_store_handle *cluster_handle)
+{
+    int gsize;
+    mobject_placement_t placement = NULL;
+    mobject_provider_handle_t* provider_handles;
+    char** server_hosts;
+
+    /* cleared first, so that a change notified during the refresh is not lost */
+    cluster_handle->membership_changed = 0;
+
+    gsize = ssg_get_group_size(cluster_handle->gid);
+    if(gsize == 0)
+    {
+        fprintf(stderr, "Error: Unable to get SSG group size\n");
+        cluster_handle->membership_changed = 1;
+        return -1;
+    }
+
+    /* rebuilt even if the size did not change, since a server may have
+       been replaced by another one with a different member id */
+    if(mobject_store_create_placement(cluster_handle, gsize, &placement) != 0)
+    {
+        fprintf(stderr, "Error: Unable to initialize object placement\n");
+        cluster_handle->membership_changed = 1;
+        return -1;
+    }
+
+    provider_handles = (mobject_provider_handle_t*)calloc(
+            gsize * cluster_handle->num_providers, sizeof(mobject_provider_handle_t));
+    server_hosts = (char**)calloc(gsize, sizeof(char*));
+    if(!provider_handles || !server_hosts)
+    {
+        free(provider_handles);
+        free(server_hosts);
+        mobject_placement_free(placement);
+        cluster_handle->membership_changed = 1;
+        return -1;
+    }
+
+    mobject_placement_free(cluster_handle->placement);
+    cluster_handle->placement = placement;
+    mobject_store_release_provider_handles(cluster_handle);
+    cluster_handle->num_servers = gsize;
+    cluster_handle->provider_handles = provider_handles;
+    cluster_handle->server_hosts = server_hosts;
+
+    return 0;
+}
+
+/* placement of the current members, keyed by their SSG member ids */
+static int mobject_store_create_placement(struct mobject_store_handle *cluster_handle,
+        int gsize, mobject_placement_t* placement)
+{
+    uint64_t* member_ids;
+    int i, ret;
+
+    member_ids = (uint64_t*)calloc(gsize, sizeof(*member_ids));
+    if(!member_ids) return -1;
+    for(i = 0; i < gsize; i++)
+        member_ids[i] = ssg_get_group_member_id_from_rank(cluster_handle->gid, i);
+    ret = mobject_placement_create_from_env(gsize, member_ids, placement);
+    free(member_ids);
+    return ret;
+}
+
+/* host part of an address, e.g. "10.0.0.1" in "ofi+tcp://10.0.0.1:1234" */
+static char* mobject_store_addr_host(margo_instance_id mid, hg_addr_t addr)
+{
+    char addr_str[256];
+    hg_size_t addr_str_size = sizeof(addr_str);
+    const char *host, *end;
+
+    if(margo_addr_to_string(mid, addr_str, &addr_str_size, addr) != HG_SUCCESS)
+        return NULL;
+    host = strstr(addr_str, "://");
+    host = host ? host + 3 : addr_str;
+    end = strrchr(host, ':');
+    return strndup(host, end ? (size_t)(end - host) : strlen(host));
 }
 
 // send a shutdown signal to a server cluster
@@ -449,13 +993,3 @@ static int mobject_store_shutdown_servers(struct mobject_store_handle *cluster_h
     return mobject_shutdown(cluster_handle->mobject_clt, svr_addr);
 }
 
-static unsigned long sdbm_hash(const char* str)
-{
-    unsigned long hash = 0;
-    int c;
-
-    while (c = *str++)
-        hash = c + (hash << 6) + (hash << 16) - hash;
-
-    return hash;
-}
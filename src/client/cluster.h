@@ -8,23 +8,45 @@
 
 #include <margo.h>
 #include <ssg.h>
-#include <ch-placement.h>
 
 #include "libmobject-store.h"
 #include "mobject-client.h"
+#include "src/client/placement.h"
 
 #define MOBJECT_CLUSTER_FILE_ENV "MOBJECT_CLUSTER_FILE"
 #define MOBJECT_CLUSTER_SHUTDOWN_KILL_ENV "MOBJECT_SHUTDOWN_KILL_SERVERS"
-
-typedef struct ch_placement_instance* chi_t;
+#define MOBJECT_SPLIT_SIZE_ENV "MOBJECT_SPLIT_SIZE"
+#define MOBJECT_SPLIT_REQUESTS_ENV "MOBJECT_SPLIT_REQUESTS"
+#define MOBJECT_BUFFER_REGION_SIZE_ENV "MOBJECT_BUFFER_REGION_SIZE"
+#define MOBJECT_BUFFER_HUGE_PAGES_ENV "MOBJECT_BUFFER_HUGE_PAGES"
+#define MOBJECT_PROGRESS_THREAD_ENV "MOBJECT_PROGRESS_THREAD"
+#define MOBJECT_TIMEOUT_ENV "MOBJECT_TIMEOUT"
+#define MOBJECT_RETRIES_ENV "MOBJECT_RETRIES"
+#define MOBJECT_RETRY_BACKOFF_ENV "MOBJECT_RETRY_BACKOFF"
+#define MOBJECT_RETRY_WRITES_ENV "MOBJECT_RETRY_WRITES"
+#define MOBJECT_HEDGE_PERCENTILE_ENV "MOBJECT_HEDGE_PERCENTILE"
+#define MOBJECT_HEDGE_MIN_DELAY_ENV "MOBJECT_HEDGE_MIN_DELAY"
 
 struct mobject_store_handle
 {
-    margo_instance_id   mid;
-    mobject_client_t    mobject_clt;
-    ssg_group_id_t      gid;
-    chi_t               ch_instance;
-    int                 connected;
+    margo_instance_id          mid;
+    mobject_client_t           mobject_clt;
+    ssg_group_id_t             gid;
+    mobject_placement_t        placement;
+    int                        connected;
+    int                        num_servers;        // size of the group when handles were set up
+    unsigned                   num_providers;      // providers per server, objects are spread over them
+    mobject_provider_handle_t* provider_handles;   // num_providers per server rank, created lazily
+    volatile int               membership_changed; // set by the SSG membership callback, cleared by a successful refresh
+    ABT_rwlock                 lock;               // held for writing to refresh placement and handles, for reading to use them
+    ABT_mutex                  handles_mutex;      // protects the lazy creation of handles and server_hosts, and read_counter
+    char*                      replication_spec;   // MOBJECT_POOL_REPLICATION at connect time
+    char*                      erasure_spec;       // MOBJECT_POOL_ERASURE at connect time
+    char*                      self_host;          // host part of the client's address
+    char**                     server_hosts;       // host part of each server's address, lazily set
+    unsigned                   read_counter;       // spreads balanced reads across replicas
+    size_t                     split_size;         // granularity of range-split reads/writes, 0 to disable
+    unsigned                   split_requests;     // maximum number of sub-requests per read/write
 };
 
 struct mobject_store_ioctx
@@ -33,4 +55,66 @@ struct mobject_store_ioctx
     char*           pool_name;
 };
 
+/**
+ * Returns the handle of the provider of the given index on the server
+ * of the given rank, creating it if needed. The caller gets a reference
+ * to the handle and must release it with mobject_provider_handle_release
+ * once done with it. The cluster drops its own references when the SSG
+ * group membership changes, so that a handle in use by an operation
+ * stays valid until the operation releases it.
+ */
+mobject_provider_handle_t mobject_store_get_provider_handle(
+        struct mobject_store_handle *cluster_handle,
+        unsigned long server_rank,
+        unsigned provider);
+
+/**
+ * Returns the handle of the provider responsible for the given
+ * object, on the server responsible for it. The caller must release it.
+ */
+mobject_provider_handle_t mobject_store_locate_object(
+        struct mobject_store_handle *cluster_handle,
+        const char *oid);
+
+/**
+ * Fills mph with the provider handles of the n distinct servers
+ * following the given object in the placement, the first one being
+ * the server responsible for it. Used to place replicas and chunks.
+ * The caller must release the handles filled.
+ *
+ * @return the number of handles filled (less than n if there are
+ *         not enough servers or a handle could not be created)
+ */
+unsigned mobject_store_locate_chunks(
+        struct mobject_store_handle *cluster_handle,
+        const char *oid,
+        unsigned n,
+        mobject_provider_handle_t *mph);
+
+/**
+ * Returns the provider handle of the server a read on the given object
+ * should be sent to. Unless LIBMOBJECT_OPERATION_BALANCE_READS or
+ * LIBMOBJECT_OPERATION_LOCALIZE_READS is set in flags, or if the pool
+ * is not replicated, this is the object's primary server.
+ * The caller must release it.
+ */
+mobject_provider_handle_t mobject_store_locate_replica(
+        struct mobject_store_handle *cluster_handle,
+        const char *pool_name,
+        const char *oid,
+        int flags);
+
+/**
+ * Returns the provider handle of another replica than the one
+ * mobject_store_locate_replica returned as first, which a read
+ * on the given object can be hedged to, or
+ * MOBJECT_PROVIDER_HANDLE_NULL if the pool is not replicated.
+ * The caller must release it.
+ */
+mobject_provider_handle_t mobject_store_locate_hedge_replica(
+        struct mobject_store_handle *cluster_handle,
+        const char *pool_name,
+        const char *oid,
+        mobject_provider_handle_t first);
+
 #endif
@@ -0,0 +1,669 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include "mobject-store-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mobject-client.h"
+#include "src/client/erasure.h"
+#include "src/client/reed-solomon.h"
+#include "src/io-chain/write-op-impl.h"
+#include "src/io-chain/read-op-impl.h"
+#include "src/util/utlist.h"
+#include "src/util/log.h"
+
+#define EC_UNIT MOBJECT_EC_STRIPE_UNIT
+#define EC_HDR  MOBJECT_EC_HEADER_SIZE
+
+struct ec_object {
+    struct mobject_store_handle* cluster;
+    const char*                  pool_name;
+    const char*                  oid;
+    unsigned                     k;
+    unsigned                     m;
+    mobject_provider_handle_t    mph[MOBJECT_MAX_REPLICAS];
+    char*                        names[MOBJECT_MAX_REPLICAS]; // chunk names
+};
+
+/* chunk read issued to one server */
+struct ec_chunk_read {
+    mobject_store_read_op_t op;
+    mobject_request_t       req;
+    uint8_t*                data;
+    uint64_t                chunk_size;
+    time_t                  mtime;
+    int                     stat_rval;
+    char                    header[EC_HDR];
+    size_t                  header_read;
+    int                     header_rval;
+    size_t                  data_read;
+    int                     data_rval;
+};
+
+/* decoded content of a range of stripes of an object */
+struct ec_stripes {
+    uint64_t first;                         // first stripe
+    uint64_t count;                         // number of stripes
+    uint8_t* chunks[MOBJECT_MAX_REPLICAS];  // count*EC_UNIT bytes per chunk
+    int      present[MOBJECT_MAX_REPLICAS];
+    uint64_t sizes[MOBJECT_MAX_REPLICAS];   // size of the object per chunk
+    uint64_t gens[MOBJECT_MAX_REPLICAS];    // write generation per chunk
+    time_t   mtimes[MOBJECT_MAX_REPLICAS];
+    uint64_t size;                          // size of the object
+    time_t   mtime;
+};
+
+static int ec_open(struct ec_object* obj,
+        struct mobject_store_handle* cluster,
+        const char* pool_name, const char* oid,
+        unsigned k, unsigned m)
+{
+    unsigned i;
+
+    obj->cluster   = cluster;
+    obj->pool_name = pool_name;
+    obj->oid       = oid;
+    obj->k         = k;
+    obj->m         = m;
+    if(strchr(oid, MOBJECT_EC_CHUNK_SEP)) {
+        fprintf(stderr, "Error: invalid name for an object of erasure-coded pool %s\n",
+                pool_name);
+        return -1;
+    }
+    unsigned n = mobject_store_locate_chunks(cluster, oid, k + m, obj->mph);
+    if(n != k + m) {
+        fprintf(stderr, "Error: erasure-coded pool %s requires %u servers\n",
+                pool_name, k + m);
+        while(n > 0) mobject_provider_handle_release(obj->mph[--n]);
+        return -1;
+    }
+    for(i = 0; i < k + m; i++) {
+        obj->names[i] = mobject_erasure_chunk_name(oid, i);
+        if(!obj->names[i]) {
+            while(i > 0) free(obj->names[--i]);
+            for(i = 0; i < k + m; i++) mobject_provider_handle_release(obj->mph[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void ec_close(struct ec_object* obj)
+{
+    unsigned i;
+    for(i = 0; i < obj->k + obj->m; i++) {
+        mobject_provider_handle_release(obj->mph[i]);
+        free(obj->names[i]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                               Reading                                      //
+////////////////////////////////////////////////////////////////////////////////
+
+static void ec_stripes_free(struct ec_stripes* st)
+{
+    unsigned i;
+    for(i = 0; i < MOBJECT_MAX_REPLICAS; i++) free(st->chunks[i]);
+}
+
+/* reads the chunk held by the server of position p */
+static int ec_issue_read(struct ec_object* obj, unsigned p,
+        struct ec_stripes* st, struct ec_chunk_read* rd)
+{
+    size_t span = st->count * EC_UNIT;
+
+    memset(rd, 0, sizeof(*rd));
+    rd->stat_rval = rd->header_rval = rd->data_rval = -1;
+    rd->op = mobject_create_read_op();
+    mobject_read_op_stat(rd->op, &rd->chunk_size, &rd->mtime, &rd->stat_rval);
+    mobject_read_op_read(rd->op, rd->header, 0, EC_HDR,
+            &rd->header_read, &rd->header_rval);
+    if(span) {
+        rd->data = (uint8_t*)calloc(1, span);
+        mobject_read_op_read(rd->op, (char*)rd->data,
+                EC_HDR + st->first * EC_UNIT, span, &rd->data_read, &rd->data_rval);
+    } else {
+        rd->data_rval = 0;
+    }
+    if(mobject_aio_read_op_operate(obj->mph[p], rd->op, obj->pool_name,
+                obj->names[p], LIBMOBJECT_OPERATION_NOFLAG, &rd->req) != 0) {
+        rd->req = MOBJECT_REQUEST_NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* waits for the read of position p and keeps the chunk under the index
+   found in its header, unless a chunk of this index and of the same or
+   a newer generation was already read */
+static void ec_complete_read(struct ec_object* obj, struct ec_stripes* st,
+        unsigned p, struct ec_chunk_read* rd)
+{
+    int ret = 0;
+
+    if(rd->req != MOBJECT_REQUEST_NULL
+    && mobject_aio_wait(rd->req, &ret) == 0 && ret == 0
+    && rd->stat_rval == 0 && rd->data_rval == 0) {
+        /* a chunk created without data (e.g. only omap entries
+           set) holds an empty object and has no index */
+        uint64_t hdr[3] = { 0, 0, p };
+        if(rd->header_rval == 0 && rd->header_read == EC_HDR)
+            memcpy(hdr, rd->header, EC_HDR);
+        unsigned i = (unsigned)hdr[2];
+        if(hdr[2] >= obj->k + obj->m) {
+            fprintf(stderr, "Error: invalid chunk index %lu in %s\n",
+                    (unsigned long)hdr[2], obj->oid);
+        } else if(!st->present[i] || st->gens[i] < hdr[1]) {
+            free(st->chunks[i]);
+            st->chunks[i]  = rd->data;
+            rd->data       = NULL;
+            st->sizes[i]   = hdr[0];
+            st->gens[i]    = hdr[1];
+            st->mtimes[i]  = rd->mtime;
+            st->present[i] = 1;
+        }
+    }
+    mobject_release_read_op(rd->op);
+    free(rd->data);
+}
+
+/**
+ * Reads the given stripes from the data chunks, reading parity chunks
+ * for the data chunks that could not be read and decoding them.
+ * Chunks are identified by the index in their header rather than by
+ * the position of their server, which may differ once the membership
+ * changed. Returns the number of distinct chunks read, the stripes are
+ * valid only if it is at least k.
+ */
+static unsigned ec_read_stripes(struct ec_object* obj, mobject_rs_t rs,
+        struct ec_stripes* st)
+{
+    struct ec_chunk_read rd[MOBJECT_MAX_REPLICAS];
+    unsigned found = 0, next = 0, i, p;
+    uint64_t gen = 0;
+    size_t span = st->count * EC_UNIT;
+
+    while(1) {
+        /* only chunks of the latest generation seen can be decoded together */
+        found = 0;
+        for(i = 0; i < obj->k + obj->m; i++)
+            if(st->present[i] && st->gens[i] > gen) gen = st->gens[i];
+        for(i = 0; i < obj->k + obj->m; i++)
+            if(st->present[i] && st->gens[i] == gen) found += 1;
+        if(found >= obj->k || next == obj->k + obj->m) break;
+        /* data positions first, then as many parity positions as chunks are missing */
+        unsigned from = next;
+        unsigned to   = next + (obj->k - found);
+        if(to > obj->k + obj->m) to = obj->k + obj->m;
+        for(p = from; p < to; p++)
+            ec_issue_read(obj, p, st, &rd[p]);
+        for(p = from; p < to; p++)
+            ec_complete_read(obj, st, p, &rd[p]);
+        next = to;
+    }
+    for(i = 0; i < obj->k + obj->m; i++) {
+        if(!st->present[i]) continue;
+        if(st->gens[i] != gen) {
+            st->present[i] = 0;
+            free(st->chunks[i]);
+            st->chunks[i] = NULL;
+            continue;
+        }
+        st->size  = st->sizes[i];
+        st->mtime = st->mtimes[i];
+    }
+    if(found < obj->k || span == 0) return found;
+
+    for(i = 0; i < obj->k; i++)
+        if(!st->present[i]) st->chunks[i] = (uint8_t*)calloc(1, span);
+    if(mobject_rs_decode(rs, st->chunks, st->present, span) != 0)
+        return 0;
+    return found;
+}
+
+/* copies len bytes of the object at offset off out of decoded stripes */
+static void ec_copy_out(const struct ec_object* obj, const struct ec_stripes* st,
+        uint64_t off, size_t len, char* dst)
+{
+    uint64_t width = (uint64_t)obj->k * EC_UNIT;
+    while(len) {
+        uint64_t s   = off / width;
+        uint64_t j   = (off % width) / EC_UNIT;
+        uint64_t o   = off % EC_UNIT;
+        size_t   run = EC_UNIT - o < len ? EC_UNIT - o : len;
+        memcpy(dst, st->chunks[j] + (s - st->first) * EC_UNIT + o, run);
+        dst += run;
+        off += run;
+        len -= run;
+    }
+}
+
+static size_t ec_read_action_size(rd_action_base_t a)
+{
+    switch(a->type) {
+        case READ_OPCODE_OMAP_GET_KEYS:
+            return sizeof(struct rd_action_OMAP_GET_KEYS) - 1
+                + ((rd_action_omap_get_keys_t)a)->data_size;
+        case READ_OPCODE_OMAP_GET_VALS:
+            return sizeof(struct rd_action_OMAP_GET_VALS) - 1
+                + ((rd_action_omap_get_vals_t)a)->data_size;
+        case READ_OPCODE_OMAP_GET_VALS_BY_KEYS:
+            return sizeof(struct rd_action_OMAP_GET_VALS_BY_KEYS) - 1
+                + ((rd_action_omap_get_vals_by_keys_t)a)->data_size;
+        default:
+            return 0;
+    }
+}
+
+/* omap entries are on every chunk, the first server answering serves them */
+static int ec_read_omap(struct ec_object* obj, mobject_store_read_op_t read_op)
+{
+    mobject_store_read_op_t op = mobject_create_read_op();
+    rd_action_base_t action;
+    unsigned i;
+    int ret = -1;
+
+    DL_FOREACH(read_op->actions, action) {
+        size_t size = ec_read_action_size(action);
+        if(size == 0) continue;
+        rd_action_base_t copy = (rd_action_base_t)malloc(size);
+        memcpy(copy, action, size);
+        DL_APPEND(op->actions, copy);
+        op->num_actions += 1;
+    }
+    if(op->num_actions == 0) {
+        mobject_release_read_op(op);
+        return 0;
+    }
+
+    for(i = 0; i < obj->k + obj->m && ret != 0; i++) {
+        ret = mobject_read_op_operate(obj->mph[i], op, obj->pool_name,
+                obj->names[i], LIBMOBJECT_OPERATION_NOFLAG);
+    }
+    mobject_release_read_op(op);
+    return ret;
+}
+
+int mobject_erasure_read_op_operate(
+        struct mobject_store_handle* cluster,
+        mobject_store_read_op_t read_op,
+        const char* pool_name,
+        const char* oid,
+        unsigned k,
+        unsigned m)
+{
+    struct ec_object obj;
+    struct ec_stripes st;
+    rd_action_base_t action;
+    mobject_rs_t rs;
+    uint64_t lo = UINT64_MAX, hi = 0;
+    uint64_t width = (uint64_t)k * EC_UNIT;
+    unsigned found;
+    int has_data = 0;
+    int ret;
+
+    /* chunks are decoded into the buffers of the actions */
+    if(read_op->ready) {
+        fprintf(stderr, "[MOBJECT] prepared read_ops can't be used on erasure-coded pools\n");
+        return -1;
+    }
+
+    if(ec_open(&obj, cluster, pool_name, oid, k, m) != 0) return -1;
+
+    /* find the range of stripes covering all the reads */
+    DL_FOREACH(read_op->actions, action) {
+        if(action->type == READ_OPCODE_STAT) has_data = 1;
+        if(action->type != READ_OPCODE_READ) continue;
+        rd_action_read_t rd = (rd_action_read_t)action;
+        has_data = 1;
+        if(rd->len == 0) continue;
+        if(rd->offset < lo) lo = rd->offset;
+        if(rd->offset + rd->len > hi) hi = rd->offset + rd->len;
+    }
+
+    ret = ec_read_omap(&obj, read_op);
+    if(!has_data) {
+        ec_close(&obj);
+        return ret;
+    }
+
+    if(mobject_rs_create(k, m, &rs) != 0) {
+        ec_close(&obj);
+        return -1;
+    }
+    memset(&st, 0, sizeof(st));
+    if(hi > lo) {
+        st.first = lo / width;
+        st.count = (hi + width - 1) / width - st.first;
+    }
+    found = ec_read_stripes(&obj, rs, &st);
+    if(found > 0 && found < k)
+        fprintf(stderr, "Error: only %u chunks of %s available, %u required\n",
+                found, oid, k);
+
+    DL_FOREACH(read_op->actions, action) {
+        switch(action->type) {
+            case READ_OPCODE_STAT: {
+                rd_action_stat_t a = (rd_action_stat_t)action;
+                if(found < k) {
+                    if(a->prval) *(a->prval) = -1;
+                    break;
+                }
+                if(a->psize)  *(a->psize)  = st.size;
+                if(a->pmtime) *(a->pmtime) = st.mtime;
+                if(a->prval)  *(a->prval)  = 0;
+                break;
+            }
+            case READ_OPCODE_READ: {
+                rd_action_read_t a = (rd_action_read_t)action;
+                size_t len = 0;
+                if(found < k) {
+                    if(a->prval) *(a->prval) = -1;
+                    break;
+                }
+                if(a->offset < st.size)
+                    len = st.size - a->offset < a->len ? st.size - a->offset : a->len;
+                if(a->iovcnt == 0) {
+                    ec_copy_out(&obj, &st, a->offset, len, (char*)a->buffer.as_pointer);
+                } else {
+                    /* scatter the range over the segments */
+                    size_t i, done = 0;
+                    for(i = 0; i < a->iovcnt && done < len; i++) {
+                        size_t n = len - done < a->iov[i].iov_len ? len - done : a->iov[i].iov_len;
+                        ec_copy_out(&obj, &st, a->offset + done, n, (char*)a->iov[i].iov_base);
+                        done += n;
+                    }
+                }
+                if(a->bytes_read) *(a->bytes_read) = len;
+                if(a->prval)      *(a->prval)      = 0;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    ec_stripes_free(&st);
+    mobject_rs_free(rs);
+    ec_close(&obj);
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                               Writing                                      //
+////////////////////////////////////////////////////////////////////////////////
+
+struct ec_buffer {
+    char*    data;
+    uint64_t size;
+    uint64_t capacity;
+};
+
+static void ec_buffer_resize(struct ec_buffer* b, uint64_t size)
+{
+    if(size > b->capacity) {
+        uint64_t capacity = b->capacity ? b->capacity : EC_UNIT;
+        while(capacity < size) capacity *= 2;
+        b->data = (char*)realloc(b->data, capacity);
+        b->capacity = capacity;
+    }
+    if(size > b->size) memset(b->data + b->size, 0, size - b->size);
+    b->size = size;
+}
+
+static void ec_buffer_write(struct ec_buffer* b, uint64_t offset,
+        const char* data, size_t len)
+{
+    if(offset + len > b->size) ec_buffer_resize(b, offset + len);
+    memcpy(b->data + offset, data, len);
+}
+
+/* reads and decodes the whole object */
+static int ec_read_full(struct ec_object* obj, mobject_rs_t rs, struct ec_buffer* b)
+{
+    struct ec_stripes st;
+    uint64_t width = (uint64_t)obj->k * EC_UNIT;
+    uint64_t size;
+    unsigned found;
+
+    /* headers first, to learn the size of the object */
+    memset(&st, 0, sizeof(st));
+    found = ec_read_stripes(obj, rs, &st);
+    size  = st.size;
+    ec_stripes_free(&st);
+    if(found == 0) return 0; // the object does not exist yet
+    if(found < obj->k) return -1;
+    if(size == 0) return 0;
+
+    memset(&st, 0, sizeof(st));
+    st.count = (size + width - 1) / width;
+    found = ec_read_stripes(obj, rs, &st);
+    if(found < obj->k) {
+        ec_stripes_free(&st);
+        return -1;
+    }
+    ec_buffer_resize(b, st.size);
+    ec_copy_out(obj, &st, 0, st.size, b->data);
+    ec_stripes_free(&st);
+    return 0;
+}
+
+static size_t ec_write_action_size(wr_action_base_t a)
+{
+    switch(a->type) {
+        case WRITE_OPCODE_CREATE:
+            return sizeof(struct wr_action_CREATE);
+        case WRITE_OPCODE_OMAP_SET:
+            return sizeof(struct wr_action_OMAP_SET) - 1
+                + ((wr_action_omap_set_t)a)->data_size;
+        case WRITE_OPCODE_OMAP_RM_KEYS:
+            return sizeof(struct wr_action_RM_KEYS) - 1
+                + ((wr_action_omap_rm_keys_t)a)->data_size;
+        default:
+            return 0;
+    }
+}
+
+static void ec_append_action(mobject_store_write_op_t op, wr_action_base_t action)
+{
+    size_t size = ec_write_action_size(action);
+    wr_action_base_t copy = (wr_action_base_t)malloc(size);
+    memcpy(copy, action, size);
+    DL_APPEND(op->actions, copy);
+    op->num_actions += 1;
+}
+
+int mobject_erasure_write_op_operate(
+        struct mobject_store_handle* cluster,
+        mobject_store_write_op_t write_op,
+        const char* pool_name,
+        const char* oid,
+        unsigned k,
+        unsigned m)
+{
+    struct ec_object obj;
+    struct ec_buffer buf = { NULL, 0, 0 };
+    wr_action_base_t action, last_remove = NULL;
+    mobject_store_write_op_t ops[MOBJECT_MAX_REPLICAS];
+    mobject_request_t reqs[MOBJECT_MAX_REPLICAS];
+    uint8_t* chunks[MOBJECT_MAX_REPLICAS];
+    mobject_rs_t rs;
+    uint64_t width = (uint64_t)k * EC_UNIT;
+    uint64_t num_stripes, s;
+    size_t chunk_size;
+    int known = 0, needs_old = 0, dirty = 0;
+    int ret = 0;
+    unsigned i, j;
+
+    /* chunks are encoded from the buffers of the actions */
+    if(write_op->ready) {
+        fprintf(stderr, "[MOBJECT] prepared write_ops can't be used on erasure-coded pools\n");
+        return -1;
+    }
+
+    if(ec_open(&obj, cluster, pool_name, oid, k, m) != 0) return -1;
+
+    /* partial updates need the current content of the object */
+    DL_FOREACH(write_op->actions, action) {
+        if(action->type == WRITE_OPCODE_WRITE_FULL
+        || action->type == WRITE_OPCODE_REMOVE) {
+            known = 1;
+        } else if(!known && ec_write_action_size(action) == 0) {
+            needs_old = 1;
+            break;
+        }
+    }
+
+    if(mobject_rs_create(k, m, &rs) != 0) {
+        ec_close(&obj);
+        return -1;
+    }
+    if(needs_old && ec_read_full(&obj, rs, &buf) != 0) {
+        fprintf(stderr, "Error: unable to read %s for a partial update\n", oid);
+        mobject_rs_free(rs);
+        ec_close(&obj);
+        return -1;
+    }
+
+    /* apply the data operations locally */
+    DL_FOREACH(write_op->actions, action) {
+        switch(action->type) {
+            case WRITE_OPCODE_WRITE: {
+                wr_action_write_t a = (wr_action_write_t)action;
+                if(a->iovcnt == 0) {
+                    ec_buffer_write(&buf, a->offset, a->buffer.as_pointer, a->len);
+                } else {
+                    /* gather the segments, up to the length of the action */
+                    size_t i, done = 0;
+                    for(i = 0; i < a->iovcnt && done < a->len; i++) {
+                        size_t n = a->len - done < a->iov[i].iov_len ? a->len - done : a->iov[i].iov_len;
+                        ec_buffer_write(&buf, a->offset + done, (const char*)a->iov[i].iov_base, n);
+                        done += n;
+                    }
+                }
+                dirty = 1;
+                break;
+            }
+            case WRITE_OPCODE_WRITE_FULL: {
+                wr_action_write_full_t a = (wr_action_write_full_t)action;
+                buf.size = 0;
+                ec_buffer_write(&buf, 0, a->buffer.as_pointer, a->len);
+                dirty = 1;
+                break;
+            }
+            case WRITE_OPCODE_WRITE_SAME: {
+                wr_action_write_same_t a = (wr_action_write_same_t)action;
+                size_t done = 0;
+                while(a->data_len && done < a->write_len) {
+                    size_t n = a->write_len - done < a->data_len ? a->write_len - done : a->data_len;
+                    ec_buffer_write(&buf, a->offset + done, a->buffer.as_pointer, n);
+                    done += n;
+                }
+                dirty = 1;
+                break;
+            }
+            case WRITE_OPCODE_APPEND: {
+                wr_action_append_t a = (wr_action_append_t)action;
+                ec_buffer_write(&buf, buf.size, a->buffer.as_pointer, a->len);
+                dirty = 1;
+                break;
+            }
+            case WRITE_OPCODE_TRUNCATE: {
+                wr_action_truncate_t a = (wr_action_truncate_t)action;
+                if(a->offset > buf.size) ec_buffer_resize(&buf, a->offset);
+                else buf.size = a->offset;
+                dirty = 1;
+                break;
+            }
+            case WRITE_OPCODE_ZERO: {
+                wr_action_zero_t a = (wr_action_zero_t)action;
+                if(a->offset + a->len > buf.size) ec_buffer_resize(&buf, a->offset + a->len);
+                memset(buf.data + a->offset, 0, a->len);
+                dirty = 1;
+                break;
+            }
+            case WRITE_OPCODE_REMOVE:
+                buf.size = 0;
+                dirty = 0;
+                last_remove = action;
+                break;
+            default:
+                break;
+        }
+    }
+
+    /* encode the object into k data chunks and m parity chunks */
+    num_stripes = (buf.size + width - 1) / width;
+    chunk_size  = EC_HDR + num_stripes * EC_UNIT;
+    memset(chunks, 0, sizeof(chunks));
+    if(dirty) {
+        struct timespec now;
+        uint64_t hdr[3];
+        clock_gettime(CLOCK_REALTIME, &now);
+        hdr[0] = buf.size;
+        hdr[1] = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+        for(i = 0; i < k + m; i++) {
+            hdr[2] = i;
+            chunks[i] = (uint8_t*)calloc(1, chunk_size);
+            memcpy(chunks[i], hdr, EC_HDR);
+        }
+        for(s = 0; s < num_stripes; s++) {
+            for(j = 0; j < k; j++) {
+                uint64_t off = s * width + j * EC_UNIT;
+                if(off >= buf.size) break;
+                memcpy(chunks[j] + EC_HDR + s * EC_UNIT, buf.data + off,
+                        buf.size - off < EC_UNIT ? buf.size - off : EC_UNIT);
+            }
+        }
+        uint8_t* data[MOBJECT_MAX_REPLICAS];
+        uint8_t* parity[MOBJECT_MAX_REPLICAS];
+        for(i = 0; i < k; i++) data[i]   = chunks[i] + EC_HDR;
+        for(i = 0; i < m; i++) parity[i] = chunks[k + i] + EC_HDR;
+        mobject_rs_encode(rs, (const uint8_t* const*)data, parity, chunk_size - EC_HDR);
+    }
+
+    /* one write_op per chunk: creates, then the new content,
+       then the omap updates that follow the last remove */
+    for(i = 0; i < k + m; i++) {
+        ops[i] = mobject_create_write_op();
+        DL_FOREACH(write_op->actions, action) {
+            if(action->type == WRITE_OPCODE_CREATE)
+                ec_append_action(ops[i], action);
+        }
+        if(last_remove)
+            mobject_write_op_remove(ops[i]);
+        if(dirty)
+            mobject_write_op_write_full(ops[i], (const char*)chunks[i], chunk_size);
+        action = last_remove ? last_remove->next : write_op->actions;
+        for(; action; action = action->next) {
+            if(action->type == WRITE_OPCODE_OMAP_SET
+            || action->type == WRITE_OPCODE_OMAP_RM_KEYS)
+                ec_append_action(ops[i], action);
+        }
+        if(mobject_aio_write_op_operate(obj.mph[i], ops[i], pool_name, obj.names[i],
+                    NULL, LIBMOBJECT_OPERATION_NOFLAG, &reqs[i]) != 0)
+            reqs[i] = MOBJECT_REQUEST_NULL;
+    }
+
+    /* the update succeeds only if all the chunks were written */
+    for(i = 0; i < k + m; i++) {
+        int r = 0;
+        if(reqs[i] == MOBJECT_REQUEST_NULL
+        || mobject_aio_wait(reqs[i], &r) != 0 || r != 0)
+            ret = -1;
+        mobject_release_write_op(ops[i]);
+        free(chunks[i]);
+    }
+
+    free(buf.data);
+    mobject_rs_free(rs);
+    ec_close(&obj);
+    return ret;
+}
@@ -0,0 +1,59 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MOBJECT_ERASURE_H
+#define __MOBJECT_ERASURE_H
+
+#include "libmobject-store.h"
+#include "src/client/cluster.h"
+
+/**
+ * Objects of an erasure-coded pool (see mobject_erasure_profile) are
+ * cut in stripes of k units of MOBJECT_EC_STRIPE_UNIT bytes. Unit j of
+ * every stripe goes to data chunk j, and m parity chunks are computed
+ * stripe by stripe. The k+m chunks are stored under names derived from
+ * the object's name (see mobject_erasure_chunk_name) on the k+m distinct
+ * servers returned by the placement for the object's name,
+ * each prefixed with a MOBJECT_EC_HEADER_SIZE header holding the size
+ * of the object, the generation of the write that produced it, so
+ * that chunks left behind by a write that failed on some servers are
+ * not decoded together with newer ones, and the index of the chunk,
+ * under which reads decode it whatever server returned it. Omap entries
+ * are set on all the chunks.
+ */
+#define MOBJECT_EC_STRIPE_UNIT  4096
+#define MOBJECT_EC_HEADER_SIZE  (3*sizeof(uint64_t))
+
+/**
+ * Executes a write_op on an object of an erasure-coded pool.
+ * Operations that modify part of the object (write, append,
+ * truncate, etc.) read and decode the object first.
+ *
+ * @return 0 on success, -1 if a chunk could not be written
+ */
+int mobject_erasure_write_op_operate(
+        struct mobject_store_handle* cluster,
+        mobject_store_write_op_t write_op,
+        const char* pool_name,
+        const char* oid,
+        unsigned k,
+        unsigned m);
+
+/**
+ * Executes a read_op on an object of an erasure-coded pool.
+ * Data is read from the k data chunks, falling back to parity
+ * chunks and decoding if some of the data chunks are unavailable.
+ *
+ * @return 0 on success, -1 if no server could be contacted
+ */
+int mobject_erasure_read_op_operate(
+        struct mobject_store_handle* cluster,
+        mobject_store_read_op_t read_op,
+        const char* pool_name,
+        const char* oid,
+        unsigned k,
+        unsigned m);
+
+#endif
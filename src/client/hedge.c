@@ -0,0 +1,262 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "mobject-store-config.h"
+#include "libmobject-store.h"
+#include "src/client/mobject-client-impl.h"
+#include "src/client/hedge.h"
+#include "src/io-chain/read-op-impl.h"
+#include "src/util/utlist.h"
+
+/* milliseconds between checks of the first replica before hedging */
+#define MOBJECT_HEDGE_POLL_INTERVAL 0.05
+
+/* a copy of the read given to one replica, reading into its own memory */
+struct hedge_copy {
+    mobject_store_read_op_t read_op;
+    char*                   data;      // data of all the reads of read_op, one after the other
+};
+
+struct mobject_hedge {
+    mobject_request_t         reqs[2];   // to the first replica, and to the second once hedged
+    struct hedge_copy         copies[2]; // read by reqs[0] and reqs[1]
+    mobject_provider_handle_t hedge_mph; // second replica, NULL if hedging failed
+    mobject_store_read_op_t   read_op;
+    char*                     pool_name;
+    char*                     oid;
+    int                       flags;
+    double                    delay;     // in milliseconds after the first request
+};
+
+static size_t hedge_action_size(rd_action_base_t a)
+{
+    switch(a->type) {
+        case READ_OPCODE_STAT:
+            return sizeof(struct rd_action_STAT);
+        case READ_OPCODE_READ:
+            return sizeof(struct rd_action_READ);
+        case READ_OPCODE_OMAP_GET_KEYS:
+            return sizeof(struct rd_action_OMAP_GET_KEYS) - 1
+                + ((rd_action_omap_get_keys_t)a)->data_size;
+        case READ_OPCODE_OMAP_GET_VALS:
+            return sizeof(struct rd_action_OMAP_GET_VALS) - 1
+                + ((rd_action_omap_get_vals_t)a)->data_size;
+        case READ_OPCODE_OMAP_GET_VALS_BY_KEYS:
+            return sizeof(struct rd_action_OMAP_GET_VALS_BY_KEYS) - 1
+                + ((rd_action_omap_get_vals_by_keys_t)a)->data_size;
+        default:
+            return 0;
+    }
+}
+
+/* copies read_op, its reads going into new memory instead of their buffers;
+ * the other actions still give their results to the caller of read_op */
+static void hedge_copy_create(mobject_store_read_op_t read_op, struct hedge_copy* copy)
+{
+    rd_action_base_t action;
+    size_t size = 0;
+
+    DL_FOREACH(read_op->actions, action) {
+        if(action->type == READ_OPCODE_READ)
+            size += ((rd_action_read_t)action)->len;
+    }
+    copy->data    = (char*)calloc(1, size ? size : 1);
+    copy->read_op = mobject_create_read_op();
+
+    size = 0;
+    DL_FOREACH(read_op->actions, action) {
+        size_t action_size = hedge_action_size(action);
+        rd_action_base_t a = (rd_action_base_t)calloc(1, action_size);
+        memcpy(a, action, action_size);
+        if(a->type == READ_OPCODE_READ) {
+            rd_action_read_t rd = (rd_action_read_t)a;
+            rd->buffer.as_pointer = copy->data + size;
+            rd->iovcnt = 0;
+            size += rd->len;
+        }
+        DL_APPEND(copy->read_op->actions, a);
+        copy->read_op->num_actions += 1;
+    }
+}
+
+/* releasing the read_op of a copy deregisters its memory, after which
+ * a late response can no longer write into it */
+static void hedge_copy_free(struct hedge_copy* copy)
+{
+    if(copy->read_op == MOBJECT_READ_OP_NULL) return;
+    mobject_release_read_op(copy->read_op);
+    free(copy->data);
+    copy->read_op = MOBJECT_READ_OP_NULL;
+    copy->data    = NULL;
+}
+
+/* gives the data read into copy to the buffers of read_op */
+static void hedge_copy_done(struct hedge_copy* copy, mobject_store_read_op_t read_op)
+{
+    rd_action_base_t action;
+    const char* data = copy->data;
+    size_t i, pos;
+
+    DL_FOREACH(read_op->actions, action) {
+        if(action->type != READ_OPCODE_READ) continue;
+        rd_action_read_t rd = (rd_action_read_t)action;
+        if(rd->iovcnt == 0)
+            memcpy((char*)rd->buffer.as_pointer, data, rd->len);
+        for(i = 0, pos = 0; i < rd->iovcnt; pos += rd->iov[i].iov_len, i++)
+            memcpy(rd->iov[i].iov_base, data + pos, rd->iov[i].iov_len);
+        data += rd->len;
+    }
+}
+
+int mobject_hedged_aio_read_op_operate(
+        mobject_provider_handle_t mph,
+        mobject_provider_handle_t hedge_mph,
+        mobject_store_read_op_t read_op,
+        const char *pool_name,
+        const char *oid,
+        int flags,
+        mobject_request_t* req)
+{
+    double delay = mobject_client_hedge_delay(mph->client);
+
+    /* a prepared read_op no longer knows the buffers of its reads, so it
+     * cannot be copied, and its memory stays registered after the read */
+    if(delay < 0 || read_op->ready)
+        return mobject_aio_read_op_operate(mph, read_op, pool_name, oid, flags, req);
+
+    struct mobject_hedge* hedge = (struct mobject_hedge*)calloc(1, sizeof(*hedge));
+    hedge_copy_create(read_op, &hedge->copies[0]);
+    if(mobject_aio_read_op_operate(mph, hedge->copies[0].read_op,
+                pool_name, oid, flags, &hedge->reqs[0]) != 0) {
+        hedge_copy_free(&hedge->copies[0]);
+        free(hedge);
+        return -1;
+    }
+    hedge->hedge_mph = hedge_mph;
+    hedge->read_op   = read_op;
+    hedge->pool_name = strdup(pool_name);
+    hedge->oid       = strdup(oid);
+    hedge->flags     = flags;
+    hedge->delay     = delay;
+    mobject_provider_handle_ref_incr(hedge_mph);
+
+    mobject_request_t tmp_req = calloc(1, sizeof(*tmp_req));
+    tmp_req->type       = MOBJECT_AIO_HEDGED;
+    tmp_req->request    = MARGO_REQUEST_NULL;
+    tmp_req->handle     = HG_HANDLE_NULL;
+    tmp_req->op.read_op = read_op;
+    tmp_req->hedge      = hedge;
+
+    *req = tmp_req;
+    return 0;
+}
+
+static void hedge_free(struct mobject_hedge* hedge)
+{
+    if(hedge->hedge_mph != MOBJECT_PROVIDER_HANDLE_NULL)
+        mobject_provider_handle_release(hedge->hedge_mph);
+    hedge_copy_free(&hedge->copies[0]);
+    hedge_copy_free(&hedge->copies[1]);
+    free(hedge->pool_name);
+    free(hedge->oid);
+    free(hedge);
+}
+
+/* milliseconds left before the read should be hedged */
+static double hedge_remaining(struct mobject_hedge* hedge)
+{
+    return hedge->delay - (ABT_get_wtime() - hedge->reqs[0]->start) * 1000.0;
+}
+
+/* sends the read to the second replica */
+static void hedge_send(struct mobject_hedge* hedge)
+{
+    mobject_client_t client = hedge->reqs[0]->mph->client;
+
+    hedge_copy_create(hedge->read_op, &hedge->copies[1]);
+    if(mobject_aio_read_op_operate(hedge->hedge_mph, hedge->copies[1].read_op,
+                hedge->pool_name, hedge->oid, hedge->flags, &hedge->reqs[1]) != 0) {
+        hedge->reqs[1] = MOBJECT_REQUEST_NULL;
+        hedge_copy_free(&hedge->copies[1]);
+        mobject_provider_handle_release(hedge->hedge_mph);
+        hedge->hedge_mph = MOBJECT_PROVIDER_HANDLE_NULL;
+        return;
+    }
+    /* the latency of the read counts from the first request */
+    hedge->reqs[1]->start = hedge->reqs[0]->start;
+
+    ABT_mutex_lock(client->stats_mutex);
+    client->stats.hedges += 1;
+    ABT_mutex_unlock(client->stats_mutex);
+}
+
+int mobject_hedged_wait(mobject_request_t req, int* ret)
+{
+    struct mobject_hedge* hedge = req->hedge;
+    mobject_client_t client = hedge->reqs[0]->mph->client;
+    size_t winner = 0;
+    int flag = 0;
+    int r;
+
+    /* wait for the first replica until the delay expires */
+    while(hedge->reqs[1] == MOBJECT_REQUEST_NULL
+    && hedge->hedge_mph != MOBJECT_PROVIDER_HANDLE_NULL) {
+        margo_test(hedge->reqs[0]->request, &flag);
+        if(flag) break;
+        double remaining = hedge_remaining(hedge);
+        if(remaining <= 0) {
+            hedge_send(hedge);
+            break;
+        }
+        margo_thread_sleep(client->mid, remaining < MOBJECT_HEDGE_POLL_INTERVAL ?
+                remaining : MOBJECT_HEDGE_POLL_INTERVAL);
+    }
+
+    if(hedge->reqs[1] != MOBJECT_REQUEST_NULL) {
+        margo_request mreqs[2] = { hedge->reqs[0]->request, hedge->reqs[1]->request };
+        size_t i = 0;
+        hg_return_t hret = margo_wait_any(2, mreqs, &i);
+        hedge->reqs[i]->request = MARGO_REQUEST_NULL;
+        if(hret == HG_SUCCESS) {
+            winner = i;
+            ABT_mutex_lock(client->stats_mutex);
+            client->stats.cancelled += 1;
+            if(i == 1) client->stats.hedge_wins += 1;
+            ABT_mutex_unlock(client->stats_mutex);
+        } else {
+            /* the first replica to answer failed, the other may not */
+            winner = 1 - i;
+        }
+        /* the loser's server may still push its data: its memory is
+         * deregistered before anything is read from the winner's */
+        mobject_aio_discard(hedge->reqs[1 - winner]);
+        hedge_copy_free(&hedge->copies[1 - winner]);
+    }
+
+    r = mobject_aio_wait(hedge->reqs[winner], ret);
+    if(r == 0)
+        hedge_copy_done(&hedge->copies[winner], hedge->read_op);
+    hedge_free(hedge);
+    free(req);
+    return r;
+}
+
+int mobject_hedged_test(mobject_request_t req, int* flag)
+{
+    struct mobject_hedge* hedge = req->hedge;
+    int r;
+
+    r = margo_test(hedge->reqs[0]->request, flag);
+    if(r != 0 || *flag) return r;
+    if(hedge->reqs[1] == MOBJECT_REQUEST_NULL) {
+        if(hedge->hedge_mph != MOBJECT_PROVIDER_HANDLE_NULL && hedge_remaining(hedge) <= 0)
+            hedge_send(hedge);
+        return 0;
+    }
+    return margo_test(hedge->reqs[1]->request, flag);
+}
@@ -0,0 +1,57 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MOBJECT_HEDGE_H
+#define __MOBJECT_HEDGE_H
+
+#include "libmobject-store.h"
+#include "mobject-client.h"
+
+/**
+ * A read on a replicated pool can be hedged: it is sent to a first
+ * replica and, if no response came from it after the hedge delay of
+ * the client (see mobject_client_set_hedging), to a second one. The
+ * first successful response is used and the other request is
+ * cancelled. Cancelling does not stop the server, which may still push
+ * data afterwards, so each replica reads into memory of its own: the
+ * memory of the cancelled request is deregistered before the data of
+ * the other one is copied into the buffers of the read. A read_op that
+ * was already prepared (e.g. reused, or registered from a buffer pool)
+ * keeps its memory registered after the read and is not hedged. The
+ * second request is sent by whoever waits on or tests the request,
+ * so a hedged read that nobody waits on is never hedged.
+ */
+
+/**
+ * Issues a read to mph, to be hedged to hedge_mph. If the client does
+ * not hedge reads, or has not seen enough of them yet to know when to,
+ * or if read_op was already prepared, this is the same as mobject_aio_read_op_operate on mph. The resulting
+ * request is waited on and tested with mobject_aio_wait and
+ * mobject_aio_test like any other.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int mobject_hedged_aio_read_op_operate(
+        mobject_provider_handle_t mph,
+        mobject_provider_handle_t hedge_mph,
+        mobject_store_read_op_t read_op,
+        const char *pool_name,
+        const char *oid,
+        int flags,
+        mobject_request_t* req);
+
+/**
+ * Waits for a hedged read, hedging it when its delay expires, and
+ * frees it. Called by mobject_aio_wait.
+ */
+int mobject_hedged_wait(mobject_request_t req, int* ret);
+
+/**
+ * Tests whether a hedged read completed, hedging it if its delay
+ * expired. Called by mobject_aio_test.
+ */
+int mobject_hedged_test(mobject_request_t req, int* flag);
+
+#endif
@@ -13,6 +13,13 @@
 #include <ssg.h>
 
 #include "mobject-client.h"
+#include "src/client/buffer-pool.h"
+#include "src/io-chain/bulk-region.h"
+
+/* number of read latencies the hedge delay is computed from, and
+   number of reads that must have completed before reads are hedged */
+#define MOBJECT_LATENCY_WINDOW     256
+#define MOBJECT_HEDGE_MIN_SAMPLES  32
 
 struct mobject_client {
 
@@ -21,10 +28,30 @@ struct mobject_client {
     char* client_addr;
 
     hg_id_t mobject_write_op_rpc_id;
+    hg_id_t mobject_write_op_batch_rpc_id;
+    hg_id_t mobject_write_safe_rpc_id;
     hg_id_t mobject_read_op_rpc_id;
+    hg_id_t mobject_read_op_batch_rpc_id;
     hg_id_t mobject_shutdown_rpc_id;
 
     uint64_t num_provider_handles;
+
+    mobject_buffer_pool_t buffer_pool;   // registered memory handed out by
+    bulk_region_finder_t  buffer_finder; // mobject_client_alloc_buffer
+
+    double   timeout;          // of each attempt in ms, 0 for none
+    unsigned max_retries;      // attempts after the first one that timed out
+    double   retry_backoff;    // ms before the first retry, doubled afterwards
+    int      retry_writes;     // whether writes are retried
+    double   hedge_percentile; // of the read latencies after which reads are hedged, 0 for never
+    double   hedge_min_delay;  // ms before a read may be hedged
+
+    ABT_mutex              stats_mutex; // protects stats and the latency window
+    mobject_client_stats_t stats;
+    double   latencies[MOBJECT_LATENCY_WINDOW]; // of the last reads, in ms
+    unsigned num_latencies;    // samples in latencies
+    unsigned next_latency;     // where the next sample goes
+    double   hedge_delay;      // percentile of latencies, recomputed periodically
 };
 
 struct mobject_provider_handle {
@@ -36,9 +63,16 @@ struct mobject_provider_handle {
 
 typedef enum mobject_op_req_type {
     MOBJECT_AIO_WRITE,
-    MOBJECT_AIO_READ
+    MOBJECT_AIO_READ,
+    MOBJECT_AIO_SPLIT,
+    MOBJECT_AIO_WRITE_BATCH,
+    MOBJECT_AIO_READ_BATCH,
+    MOBJECT_AIO_HEDGED
 } mobject_op_req_type;
 
+struct mobject_split;
+struct mobject_hedge;
+
 struct mobject_request {
     mobject_op_req_type type; // type of operation that initiated the request
     union {
@@ -47,6 +81,71 @@ struct mobject_request {
     } op; // operation that initiated the request
     margo_request request; // margo request to wait on
     hg_handle_t handle;    // handle of the RPC sent for this operation
+    struct mobject_split* split; // sub-requests of a range-split operation (MOBJECT_AIO_SPLIT)
+    hg_bulk_t bulk_handle; // bulk handle shared by the operations of a batch
+    mobject_store_read_op_t* read_ops;   // operations of a batch of reads (MOBJECT_AIO_READ_BATCH)
+    mobject_store_write_op_t* write_ops; // operations of a batch of writes (MOBJECT_AIO_WRITE_BATCH)
+    size_t count;                        // number of operations in read_ops or write_ops
+    void** batch_buffers;                // buffers of the operations of a batch, given back when freed
+    uint64_t* safe_seq;    // if set, where to store the ticket of a deferred write
+    struct mobject_hedge* hedge; // requests of a hedged read (MOBJECT_AIO_HEDGED)
+    mobject_provider_handle_t mph; // provider of a single read or write, to send it again
+    char* oid;             // object and pool of a single read or write
+    char* pool_name;
+    int flags;
+    unsigned attempts;     // number of times the request was sent
+    double start;          // when the request was first sent, in seconds
 };
 
+/**
+ * Creates a handle for rpc_id and forwards in to the provider, with
+ * the timeout of the client if it has one. If the request times out
+ * and retry is set, it is sent again as configured with
+ * mobject_client_set_timeout. On success, *h holds the response and
+ * must be destroyed by the caller.
+ */
+hg_return_t mobject_client_forward(
+        mobject_provider_handle_t mph,
+        hg_id_t rpc_id,
+        void* in,
+        int retry,
+        hg_handle_t* h);
+
+/**
+ * Same as mobject_client_forward without waiting for the response,
+ * and without retries: margo_wait on the resulting request returns
+ * HG_TIMEOUT if the client has a timeout and it expired.
+ */
+hg_return_t mobject_client_iforward(
+        mobject_provider_handle_t mph,
+        hg_id_t rpc_id,
+        void* in,
+        hg_handle_t* h,
+        margo_request* req);
+
+/**
+ * Called when attempt (1 for the first) of a request timed out. Counts
+ * the timeout and, if the request may be sent again, waits for the
+ * backoff delay, counts the retry and returns 1. Returns 0 otherwise.
+ */
+int mobject_client_retry(mobject_client_t client, int retry, unsigned attempt);
+
+/**
+ * Records the latency of a read, in seconds.
+ */
+void mobject_client_record_latency(mobject_client_t client, double latency);
+
+/**
+ * Returns the delay in milliseconds after which a read should be
+ * hedged, or a negative value if reads should not be hedged (because
+ * hedging is disabled or too few reads completed to tell).
+ */
+double mobject_client_hedge_delay(mobject_client_t client);
+
+/**
+ * Frees a request that will not be waited on, cancelling
+ * its RPC first if it has not completed yet.
+ */
+void mobject_aio_discard(mobject_request_t req);
+
 #endif
@@ -8,6 +8,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include <margo.h>
@@ -50,14 +51,23 @@ static int mobject_client_register(mobject_client_t client, margo_instance_id mi
     if(flag == HG_TRUE) { /* RPCs already registered */
 
         margo_registered_name(mid, "mobject_write_op", &client->mobject_write_op_rpc_id, &flag);
+        margo_registered_name(mid, "mobject_write_op_batch", &client->mobject_write_op_batch_rpc_id, &flag);
+        margo_registered_name(mid, "mobject_write_safe", &client->mobject_write_safe_rpc_id, &flag);
         margo_registered_name(mid, "mobject_read_op",  &client->mobject_read_op_rpc_id,  &flag);
+        margo_registered_name(mid, "mobject_read_op_batch", &client->mobject_read_op_batch_rpc_id, &flag);
 
     } else {
         
         client->mobject_write_op_rpc_id =
             MARGO_REGISTER(mid, "mobject_write_op", write_op_in_t, write_op_out_t, NULL);
+        client->mobject_write_op_batch_rpc_id =
+            MARGO_REGISTER(mid, "mobject_write_op_batch", write_op_batch_in_t, write_op_batch_out_t, NULL);
+        client->mobject_write_safe_rpc_id =
+            MARGO_REGISTER(mid, "mobject_write_safe", write_safe_in_t, write_safe_out_t, NULL);
         client->mobject_read_op_rpc_id = 
             MARGO_REGISTER(mid, "mobject_read_op",  read_op_in_t,  read_op_out_t, NULL);
+        client->mobject_read_op_batch_rpc_id =
+            MARGO_REGISTER(mid, "mobject_read_op_batch", read_op_batch_in_t, read_op_batch_out_t, NULL);
     }
 
     return 0;
@@ -69,10 +79,18 @@ int mobject_client_init(margo_instance_id mid, mobject_client_t* client)
     if(!c) return -1;
 
     c->num_provider_handles = 0;
+    c->retry_backoff        = 1.0;
+    c->hedge_delay          = -1.0;
+    ABT_mutex_create(&c->stats_mutex);
 
     int ret = mobject_client_register(c, mid);
     if(ret != 0) return ret;
 
+    ret = mobject_buffer_pool_create(mid, 0, 0, &c->buffer_pool);
+    if(ret != 0) return ret;
+    c->buffer_finder.find = mobject_buffer_pool_find;
+    c->buffer_finder.arg  = c->buffer_pool;
+
     *client = c;
     return 0;
 }
@@ -84,11 +102,192 @@ int mobject_client_finalize(mobject_client_t client)
                 "[MOBJECT] Warning: %d provider handles not released before mobject_client_finalize was called\n",
                 client->num_provider_handles);
     }
+    mobject_buffer_pool_destroy(client->buffer_pool);
+    ABT_mutex_free(&client->stats_mutex);
     free(client->client_addr);
     free(client);
     return 0;
 }
 
+int mobject_client_set_buffer_pool(
+        mobject_client_t client,
+        size_t region_size,
+        int huge_pages)
+{
+    mobject_buffer_pool_t pool;
+    if(mobject_buffer_pool_create(client->mid, region_size, huge_pages, &pool) != 0)
+        return -1;
+    mobject_buffer_pool_destroy(client->buffer_pool);
+    client->buffer_pool       = pool;
+    client->buffer_finder.arg = pool;
+    return 0;
+}
+
+void* mobject_client_alloc_buffer(mobject_client_t client, size_t size)
+{
+    return mobject_buffer_pool_alloc(client->buffer_pool, size);
+}
+
+void mobject_client_free_buffer(mobject_client_t client, void* buffer)
+{
+    mobject_buffer_pool_free(client->buffer_pool, buffer);
+}
+
+int mobject_client_set_timeout(
+        mobject_client_t client,
+        double timeout_ms,
+        unsigned max_retries,
+        double backoff_ms,
+        int retry_writes)
+{
+    if(client == MOBJECT_CLIENT_NULL || timeout_ms < 0 || backoff_ms < 0) return -1;
+    client->timeout       = timeout_ms;
+    client->max_retries   = max_retries;
+    client->retry_backoff = backoff_ms;
+    client->retry_writes  = retry_writes;
+    return 0;
+}
+
+int mobject_client_set_hedging(
+        mobject_client_t client,
+        double percentile,
+        double min_delay_ms)
+{
+    if(client == MOBJECT_CLIENT_NULL || percentile < 0 || percentile > 100 || min_delay_ms < 0)
+        return -1;
+    client->hedge_percentile = percentile;
+    client->hedge_min_delay  = min_delay_ms;
+    return 0;
+}
+
+int mobject_client_get_stats(
+        mobject_client_t client,
+        mobject_client_stats_t* stats)
+{
+    if(client == MOBJECT_CLIENT_NULL) return -1;
+    ABT_mutex_lock(client->stats_mutex);
+    *stats = client->stats;
+    ABT_mutex_unlock(client->stats_mutex);
+    return 0;
+}
+
+hg_return_t mobject_client_forward(
+        mobject_provider_handle_t mph,
+        hg_id_t rpc_id,
+        void* in,
+        int retry,
+        hg_handle_t* h)
+{
+    mobject_client_t client = mph->client;
+    unsigned attempt = 0;
+    hg_return_t ret;
+
+    do {
+        attempt += 1;
+        ret = margo_create(client->mid, mph->addr, rpc_id, h);
+        if(ret != HG_SUCCESS) return ret;
+        if(client->timeout > 0)
+            ret = margo_provider_forward_timed(mph->provider_id, *h, in, client->timeout);
+        else
+            ret = margo_provider_forward(mph->provider_id, *h, in);
+        if(ret == HG_SUCCESS) return ret;
+        margo_destroy(*h);
+        *h = HG_HANDLE_NULL;
+    } while(ret == HG_TIMEOUT && mobject_client_retry(client, retry, attempt));
+
+    return ret;
+}
+
+hg_return_t mobject_client_iforward(
+        mobject_provider_handle_t mph,
+        hg_id_t rpc_id,
+        void* in,
+        hg_handle_t* h,
+        margo_request* req)
+{
+    mobject_client_t client = mph->client;
+    hg_return_t ret;
+
+    ret = margo_create(client->mid, mph->addr, rpc_id, h);
+    if(ret != HG_SUCCESS) return ret;
+    if(client->timeout > 0)
+        ret = margo_provider_iforward_timed(mph->provider_id, *h, in, client->timeout, req);
+    else
+        ret = margo_provider_iforward(mph->provider_id, *h, in, req);
+    if(ret != HG_SUCCESS) {
+        margo_destroy(*h);
+        *h = HG_HANDLE_NULL;
+    }
+    return ret;
+}
+
+int mobject_client_retry(mobject_client_t client, int retry, unsigned attempt)
+{
+    int r = retry && attempt <= client->max_retries;
+    double backoff = client->retry_backoff;
+    unsigned i;
+
+    ABT_mutex_lock(client->stats_mutex);
+    client->stats.timeouts += 1;
+    if(r) client->stats.retries += 1;
+    ABT_mutex_unlock(client->stats_mutex);
+
+    if(!r) return 0;
+    for(i = 1; i < attempt && i < 16; i++)
+        backoff *= 2;
+    if(backoff > 0)
+        margo_thread_sleep(client->mid, backoff);
+    return 1;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+void mobject_client_record_latency(mobject_client_t client, double latency)
+{
+    double sorted[MOBJECT_LATENCY_WINDOW];
+    unsigned n;
+
+    if(client->hedge_percentile <= 0) return;
+
+    ABT_mutex_lock(client->stats_mutex);
+    client->latencies[client->next_latency] = latency * 1000.0;
+    client->next_latency = (client->next_latency + 1) % MOBJECT_LATENCY_WINDOW;
+    if(client->num_latencies < MOBJECT_LATENCY_WINDOW)
+        client->num_latencies += 1;
+    n = client->num_latencies;
+    /* the percentile is recomputed every MOBJECT_HEDGE_MIN_SAMPLES reads */
+    if(n < MOBJECT_HEDGE_MIN_SAMPLES || client->next_latency % MOBJECT_HEDGE_MIN_SAMPLES != 0) {
+        ABT_mutex_unlock(client->stats_mutex);
+        return;
+    }
+    memcpy(sorted, client->latencies, n * sizeof(double));
+    ABT_mutex_unlock(client->stats_mutex);
+
+    qsort(sorted, n, sizeof(double), cmp_double);
+    unsigned i = (unsigned)(client->hedge_percentile * n / 100.0);
+    if(i >= n) i = n - 1;
+
+    ABT_mutex_lock(client->stats_mutex);
+    client->hedge_delay = sorted[i];
+    ABT_mutex_unlock(client->stats_mutex);
+}
+
+double mobject_client_hedge_delay(mobject_client_t client)
+{
+    double delay;
+
+    if(client->hedge_percentile <= 0) return -1.0;
+    ABT_mutex_lock(client->stats_mutex);
+    delay = client->hedge_delay;
+    ABT_mutex_unlock(client->stats_mutex);
+    if(delay < 0) return delay;
+    return delay < client->hedge_min_delay ? client->hedge_min_delay : delay;
+}
+
 int mobject_provider_handle_create(
         mobject_client_t client,
         hg_addr_t addr,
@@ -112,7 +311,7 @@ int mobject_provider_handle_create(
     provider->provider_id = provider_id;
     provider->refcount    = 1;
 
-    client->num_provider_handles += 1;
+    __atomic_add_fetch(&client->num_provider_handles, 1, __ATOMIC_RELAXED);
 
     *handle = provider;
     return 0;
@@ -121,17 +320,17 @@ int mobject_provider_handle_create(
 int mobject_provider_handle_ref_incr(mobject_provider_handle_t handle)
 {
     if(handle == MOBJECT_PROVIDER_HANDLE_NULL) return -1;
-    handle->refcount += 1;
+    /* handles are shared by the operations of several ULTs */
+    __atomic_add_fetch(&handle->refcount, 1, __ATOMIC_RELAXED);
     return 0;
 }
 
 int mobject_provider_handle_release(mobject_provider_handle_t handle)
 {
     if(handle == MOBJECT_PROVIDER_HANDLE_NULL) return -1;
-    handle->refcount -= 1;
-    if(handle->refcount == 0) {
+    if(__atomic_sub_fetch(&handle->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
         margo_addr_free(handle->client->mid, handle->addr);
-        handle->client->num_provider_handles -= 1;
+        __atomic_sub_fetch(&handle->client->num_provider_handles, 1, __ATOMIC_RELAXED);
         free(handle);
     }
     return 0;
@@ -157,9 +356,11 @@ int mobject_write_op_operate(
     in.pool_name   = pool_name;
     in.write_op    = write_op;
     in.client_addr = mph->client->client_addr;
+    in.flags       = flags;
     // TODO take mtime into account
 
-    prepare_write_op(mph->client->mid, write_op);
+    if(prepare_write_op(mph->client->mid, &mph->client->buffer_finder, write_op) != 0)
+        return -1;
 
     hg_addr_t svr_addr = mph->addr;
     if(svr_addr == HG_ADDR_NULL) {
@@ -168,16 +369,10 @@ int mobject_write_op_operate(
     }
 
     hg_handle_t h;
-    ret = margo_create(mph->client->mid, svr_addr, mph->client->mobject_write_op_rpc_id, &h);
-    if(ret != HG_SUCCESS) {
-        fprintf(stderr, "[MOBJECT] margo_create() failed in mobject_write_op_operate()\n");
-        return -1;
-    }
-
-    ret = margo_provider_forward(mph->provider_id, h, &in);
+    ret = mobject_client_forward(mph, mph->client->mobject_write_op_rpc_id, &in,
+            mph->client->retry_writes, &h);
     if(ret != HG_SUCCESS) {
         fprintf(stderr, "[MOBJECT] margo_forward() failed in mobject_write_op_operate()\n");
-        margo_destroy(h);
         return -1;
     }
 
@@ -196,6 +391,41 @@ int mobject_write_op_operate(
     return 0;
 }
 
+int mobject_write_op_wait_safe(
+        mobject_provider_handle_t mph,
+        uint64_t safe_seq)
+{
+    hg_return_t ret;
+    int r;
+
+    if(safe_seq == 0) return 0;
+
+    write_safe_in_t in;
+    in.seq = safe_seq;
+
+    /* waiting for a ticket is idempotent, it is always retried */
+    hg_handle_t h;
+    ret = mobject_client_forward(mph, mph->client->mobject_write_safe_rpc_id, &in, 1, &h);
+    if(ret != HG_SUCCESS) {
+        fprintf(stderr, "[MOBJECT] margo_forward() failed in mobject_write_op_wait_safe()\n");
+        return -1;
+    }
+
+    write_safe_out_t resp;
+    ret = margo_get_output(h, &resp);
+    if(ret != HG_SUCCESS) {
+        fprintf(stderr, "[MOBJECT] margo_get_output() failed in mobject_write_op_wait_safe()\n");
+        margo_destroy(h);
+        return -1;
+    }
+    r = resp.ret;
+
+    margo_free_output(h, &resp);
+    margo_destroy(h);
+
+    return r;
+}
+
 int mobject_read_op_operate(
         mobject_provider_handle_t mph,
         mobject_store_read_op_t read_op,
@@ -211,7 +441,8 @@ int mobject_read_op_operate(
     in.read_op     = read_op;
     in.client_addr = mph->client->client_addr;;
 
-    prepare_read_op(mph->client->mid, read_op);
+    if(prepare_read_op(mph->client->mid, &mph->client->buffer_finder, read_op) != 0)
+        return -1;
 
     hg_addr_t svr_addr = mph->addr;
 
@@ -220,19 +451,14 @@ int mobject_read_op_operate(
         return -1;
     }
 
+    double start = ABT_get_wtime();
     hg_handle_t h;
-    ret = margo_create(mph->client->mid, svr_addr, mph->client->mobject_read_op_rpc_id, &h);
-    if(ret != HG_SUCCESS) {
-        fprintf(stderr, "[MOBJECT] margo_create() failed in mobject_read_op_operate()\n");
-        return -1;
-    }
-
-    ret = margo_provider_forward(mph->provider_id, h, &in);
+    ret = mobject_client_forward(mph, mph->client->mobject_read_op_rpc_id, &in, 1, &h);
     if(ret != HG_SUCCESS) {
         fprintf(stderr, "[MOBJECT] margo_forward() failed in mobject_read_op_operate()\n");
-        margo_destroy(h);
         return -1;
     }
+    mobject_client_record_latency(mph->client, ABT_get_wtime() - start);
 
     read_op_out_t resp; 
     ret = margo_get_output(h, &resp); 
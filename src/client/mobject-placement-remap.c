@@ -0,0 +1,112 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "src/client/placement.h"
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mobject-placement-remap [-m mode] [-v vnodes] [-n num_objects] <from_size> <to_size>\n");
+    fprintf(stderr, "  -m mode          placement mode (%s or %s), default from %s\n",
+            MOBJECT_PLACEMENT_MODULO, MOBJECT_PLACEMENT_RING, MOBJECT_PLACEMENT_ENV);
+    fprintf(stderr, "  -v vnodes        virtual nodes per server, default from %s\n",
+            MOBJECT_PLACEMENT_VNODES_ENV);
+    fprintf(stderr, "  -n num_objects   number of object names to place (default 1000000)\n");
+    fprintf(stderr, "  <from_size>      number of servers before the change\n");
+    fprintf(stderr, "  <to_size>        number of servers after the change\n");
+    fprintf(stderr, "Per-server weights are taken from %s, servers being identified\n"
+                    "by their rank before the change; growing adds servers at the end,\n"
+                    "shrinking removes the last ones.\n", MOBJECT_PLACEMENT_WEIGHTS_ENV);
+    exit(-1);
+}
+
+static double wtime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+    long num_objects = 1000000;
+    int from_size, to_size;
+    mobject_placement_t from, to;
+    unsigned long* load;
+    long i, moved = 0;
+    unsigned long max_load = 0;
+    char name[64];
+    double t1, t2;
+    int opt;
+
+    while((opt = getopt(argc, argv, "m:v:n:")) != -1) {
+        switch(opt) {
+            case 'm':
+                setenv(MOBJECT_PLACEMENT_ENV, optarg, 1);
+                break;
+            case 'v':
+                setenv(MOBJECT_PLACEMENT_VNODES_ENV, optarg, 1);
+                break;
+            case 'n':
+                num_objects = atol(optarg);
+                break;
+            default:
+                usage();
+        }
+    }
+    if(argc - optind != 2 || num_objects <= 0)
+        usage();
+    from_size = atoi(argv[optind]);
+    to_size   = atoi(argv[optind+1]);
+
+    /* member ids default to the ranks */
+    if(mobject_placement_create_from_env(from_size, NULL, &from) != 0
+    || mobject_placement_create_from_env(to_size, NULL, &to) != 0) {
+        fprintf(stderr, "Error: Unable to create placement instances\n");
+        return -1;
+    }
+
+    load = (unsigned long*)calloc(to_size, sizeof(*load));
+
+    for(i = 0; i < num_objects; i++) {
+        snprintf(name, sizeof(name), "object-%ld", i);
+        unsigned long r1 = mobject_placement_locate(from, name);
+        unsigned long r2 = mobject_placement_locate(to, name);
+        if(r1 != r2) moved++;
+        load[r2]++;
+    }
+    for(i = 0; i < to_size; i++)
+        if(load[i] > max_load) max_load = load[i];
+
+    /* time the lookups alone, names hashed in the loop as clients do */
+    t1 = wtime();
+    for(i = 0; i < num_objects; i++) {
+        snprintf(name, sizeof(name), "object-%ld", i);
+        load[mobject_placement_locate(to, name)]++;
+    }
+    t2 = wtime();
+
+    printf("objects:             %ld\n", num_objects);
+    printf("servers:             %d -> %d\n", from_size, to_size);
+    printf("remapped fraction:   %.4f\n", (double)moved/num_objects);
+    printf("minimum fraction:    %.4f\n",
+            (double)abs(to_size - from_size)/(from_size > to_size ? from_size : to_size));
+    printf("max/avg load:        %.3f\n", (double)max_load*to_size/num_objects);
+    printf("lookup time:         %.1f ns (including name formatting)\n",
+            (t2-t1)*1e9/num_objects);
+
+    free(load);
+    mobject_placement_free(from);
+    mobject_placement_free(to);
+
+    return 0;
+}
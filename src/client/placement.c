@@ -0,0 +1,482 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ch-placement.h>
+
+#include "src/client/placement.h"
+
+typedef enum {
+    PLACEMENT_MODULO,
+    PLACEMENT_RING
+} placement_type_t;
+
+typedef struct ring_point {
+    uint64_t hash;
+    uint32_t rank;
+} ring_point_t;
+
+struct mobject_placement {
+    placement_type_t type;
+    int              num_servers;
+    /* static modulo */
+    struct ch_placement_instance* ch_instance;
+    /* consistent-hash ring, kept as two sorted arrays so that
+     * the binary search only touches the hash array */
+    size_t           num_points;
+    uint64_t*        point_hashes;
+    uint32_t*        point_ranks;
+    /* index of the first point of each bucket of hashes sharing
+     * their top index_bits bits, narrowing the binary search */
+    unsigned         index_bits;
+    uint32_t*        index;
+};
+
+static inline uint64_t fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static uint64_t hash_bytes(const char* name, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const unsigned char* c = (const unsigned char*)name;
+
+    while(len--) {
+        hash ^= *c++;
+        hash *= 0x100000001b3ULL;
+    }
+    return fmix64(hash);
+}
+
+uint64_t mobject_hash_name(const char* name)
+{
+    return hash_bytes(name, strlen(name));
+}
+
+unsigned mobject_placement_locate_provider(const char* name, unsigned num_providers)
+{
+    if(num_providers <= 1) return 0;
+    /* rehashed, so that the provider is independent from the server */
+    return (unsigned)(fmix64(mobject_hash_name(name) ^ 0x9e3779b97f4a7c15ULL) % num_providers);
+}
+
+static int compare_ring_points(const void* a, const void* b)
+{
+    const ring_point_t* pa = (const ring_point_t*)a;
+    const ring_point_t* pb = (const ring_point_t*)b;
+    if(pa->hash < pb->hash) return -1;
+    if(pa->hash > pb->hash) return 1;
+    /* break ties deterministically */
+    return (pa->rank > pb->rank) - (pa->rank < pb->rank);
+}
+
+static int build_ring(struct mobject_placement* p, const uint64_t* member_ids,
+        int vnodes, const double* weights)
+{
+    size_t i, n = 0;
+    int r, v;
+    ring_point_t* points;
+    int* counts = (int*)calloc(p->num_servers, sizeof(int));
+
+    if(!counts) return -1;
+
+    for(r = 0; r < p->num_servers; r++) {
+        double w = weights ? weights[r] : 1.0;
+        counts[r] = w > 0.0 ? (int)(w * vnodes + 0.5) : 0;
+        if(w > 0.0 && counts[r] == 0) counts[r] = 1;
+        n += counts[r];
+    }
+    if(n == 0) {
+        fprintf(stderr, "Error: consistent-hash ring has no virtual node\n");
+        free(counts);
+        return -1;
+    }
+
+    points = (ring_point_t*)malloc(n*sizeof(*points));
+    if(!points) {
+        free(counts);
+        return -1;
+    }
+    /* a virtual node's position depends only on the member id of its
+     * server and its index, not on the rank, which shifts when a server
+     * leaves: adding or removing a server only moves the objects it owns */
+    for(r = 0, i = 0; r < p->num_servers; r++) {
+        uint64_t id = fmix64(member_ids ? member_ids[r] : (uint64_t)r);
+        for(v = 0; v < counts[r]; v++, i++) {
+            points[i].hash = fmix64((id ^ (uint64_t)v) + 0x9e3779b97f4a7c15ULL);
+            points[i].rank = r;
+        }
+    }
+    free(counts);
+    qsort(points, n, sizeof(*points), compare_ring_points);
+
+    p->num_points   = n;
+    p->point_hashes = (uint64_t*)malloc(n*sizeof(uint64_t));
+    p->point_ranks  = (uint32_t*)malloc(n*sizeof(uint32_t));
+    p->index_bits   = 1;
+    while(p->index_bits < 20 && ((size_t)1 << p->index_bits) < n)
+        p->index_bits++;
+    p->index = (uint32_t*)malloc((((size_t)1 << p->index_bits) + 1)*sizeof(uint32_t));
+    if(!p->point_hashes || !p->point_ranks || !p->index) {
+        free(points);
+        return -1;
+    }
+
+    for(i = 0; i < n; i++) {
+        p->point_hashes[i] = points[i].hash;
+        p->point_ranks[i]  = points[i].rank;
+    }
+    free(points);
+
+    {
+        size_t b, nb = (size_t)1 << p->index_bits;
+        unsigned shift = 64 - p->index_bits;
+        i = 0;
+        for(b = 0; b < nb; b++) {
+            while(i < n && (p->point_hashes[i] >> shift) < b) i++;
+            p->index[b] = i;
+        }
+        p->index[nb] = n;
+    }
+    return 0;
+}
+
+int mobject_placement_create(
+        const char* mode,
+        int num_servers,
+        const uint64_t* member_ids,
+        int vnodes,
+        const double* weights,
+        mobject_placement_t* placement)
+{
+    struct mobject_placement* p;
+
+    if(num_servers <= 0) {
+        fprintf(stderr, "Error: invalid number of servers for placement (%d)\n", num_servers);
+        return -1;
+    }
+
+    p = (struct mobject_placement*)calloc(1, sizeof(*p));
+    if(!p) return -1;
+    p->num_servers = num_servers;
+
+    if(!mode || strcmp(mode, MOBJECT_PLACEMENT_MODULO) == 0) {
+        p->type = PLACEMENT_MODULO;
+        p->ch_instance = ch_placement_initialize("static_modulo", num_servers, 0, 0);
+        if(!p->ch_instance) {
+            fprintf(stderr, "Error: Unable to initialize ch-placement instance\n");
+            free(p);
+            return -1;
+        }
+    } else if(strcmp(mode, MOBJECT_PLACEMENT_RING) == 0) {
+        p->type = PLACEMENT_RING;
+        if(vnodes <= 0) vnodes = MOBJECT_PLACEMENT_DEFAULT_VNODES;
+        if(build_ring(p, member_ids, vnodes, weights) != 0) {
+            mobject_placement_free(p);
+            return -1;
+        }
+    } else {
+        fprintf(stderr, "Error: unknown placement mode \"%s\"\n", mode);
+        free(p);
+        return -1;
+    }
+
+    *placement = p;
+    return 0;
+}
+
+/* fills weights from a list of <member_id>:<weight> entries, an entry
+   without member id setting the weight of the servers not listed */
+static int parse_weights(const char* spec, int num_servers,
+        const uint64_t* member_ids, double* weights)
+{
+    const char* s = spec;
+    double dflt = 1.0;
+    int i, num_dflt = 0;
+
+    for(i = 0; i < num_servers; i++) weights[i] = -1.0;
+    while(*s) {
+        const char* end = strchr(s, ',');
+        size_t len = end ? (size_t)(end - s) : strlen(s);
+        const char* colon = memchr(s, ':', len);
+        char* wend;
+        double w = strtod(colon ? colon + 1 : s, &wend);
+        if(wend == (colon ? colon + 1 : s) || w < 0.0)
+            return -1;
+        if(colon) {
+            uint64_t id = strtoull(s, NULL, 0);
+            for(i = 0; i < num_servers; i++) {
+                if((member_ids ? member_ids[i] : (uint64_t)i) == id)
+                    weights[i] = w;
+            }
+        } else {
+            /* weights used to be given per rank, but ranks shift
+               when servers leave, so a list of them is refused */
+            if(++num_dflt > 1) return -1;
+            dflt = w;
+        }
+        if(!end) break;
+        s = end + 1;
+    }
+    for(i = 0; i < num_servers; i++)
+        if(weights[i] < 0.0) weights[i] = dflt;
+    return 0;
+}
+
+int mobject_placement_create_from_env(
+        int num_servers,
+        const uint64_t* member_ids,
+        mobject_placement_t* placement)
+{
+    const char* mode = getenv(MOBJECT_PLACEMENT_ENV);
+    const char* vnodes_str = getenv(MOBJECT_PLACEMENT_VNODES_ENV);
+    const char* weights_str = getenv(MOBJECT_PLACEMENT_WEIGHTS_ENV);
+    int vnodes = vnodes_str ? atoi(vnodes_str) : MOBJECT_PLACEMENT_DEFAULT_VNODES;
+    double* weights = NULL;
+    int ret;
+
+    if(weights_str && num_servers > 0) {
+        weights = (double*)malloc(num_servers*sizeof(double));
+        if(!weights) return -1;
+        if(parse_weights(weights_str, num_servers, member_ids, weights) != 0) {
+            fprintf(stderr, "Error: invalid %s value \"%s\" "
+                    "(expected <member_id>:<weight> entries and a default weight)\n",
+                    MOBJECT_PLACEMENT_WEIGHTS_ENV, weights_str);
+            free(weights);
+            return -1;
+        }
+    }
+
+    ret = mobject_placement_create(mode, num_servers, member_ids, vnodes, weights, placement);
+    free(weights);
+    return ret;
+}
+
+static size_t ring_find(mobject_placement_t p, uint64_t hash)
+{
+    size_t b  = hash >> (64 - p->index_bits);
+    size_t lo = p->index[b];
+    size_t hi = p->index[b+1];
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+        if(p->point_hashes[mid] < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo == p->num_points ? 0 : lo;
+}
+
+unsigned long mobject_placement_locate_hash(
+        mobject_placement_t p,
+        uint64_t hash)
+{
+    unsigned long rank = 0;
+
+    if(p->type == PLACEMENT_MODULO) {
+        ch_placement_find_closest(p->ch_instance, hash, 1, &rank);
+        return rank;
+    }
+
+    /* first point whose hash is >= the object's hash, wrapping around */
+    return p->point_ranks[ring_find(p, hash)];
+}
+
+static unsigned locate_replicas_hash(
+        mobject_placement_t p,
+        uint64_t hash,
+        unsigned n,
+        unsigned long* ranks)
+{
+    unsigned found = 0, j;
+    size_t i, pos;
+
+    if(n > (unsigned)p->num_servers) n = p->num_servers;
+    if(n == 0) return 0;
+
+    if(p->type == PLACEMENT_MODULO) {
+        ch_placement_find_closest(p->ch_instance, hash, n, ranks);
+        return n;
+    }
+
+    /* walk the ring clockwise, collecting distinct servers */
+    pos = ring_find(p, hash);
+    for(i = 0; i < p->num_points && found < n; i++) {
+        uint32_t r = p->point_ranks[(pos + i) % p->num_points];
+        for(j = 0; j < found; j++)
+            if(ranks[j] == r) break;
+        if(j == found) ranks[found++] = r;
+    }
+    return found;
+}
+
+unsigned mobject_placement_locate_replicas(
+        mobject_placement_t p,
+        const char* oid,
+        unsigned n,
+        unsigned long* ranks)
+{
+    return locate_replicas_hash(p, mobject_hash_name(oid), n, ranks);
+}
+
+long mobject_placement_locate_position(
+        mobject_placement_t p,
+        const char* name,
+        unsigned pos)
+{
+    unsigned long ranks[MOBJECT_MAX_REPLICAS];
+    uint64_t hash;
+    size_t len;
+    unsigned index;
+
+    if(mobject_erasure_parse_chunk_name(name, &len, &index)) {
+        hash = hash_bytes(name, len);
+        pos  = index;
+    } else {
+        hash = mobject_hash_name(name);
+    }
+    if(pos >= MOBJECT_MAX_REPLICAS
+    || locate_replicas_hash(p, hash, pos + 1, ranks) <= pos)
+        return -1;
+    return (long)ranks[pos];
+}
+
+static unsigned parse_replication_spec(const char* spec, const char* pool_name, int max)
+{
+    unsigned result = 1, dflt = 1, largest = 1;
+    int matched = 0;
+    const char* s = spec;
+
+    if(!spec) return 1;
+    while(*s) {
+        const char* end = strchr(s, ',');
+        const char* colon;
+        size_t len = end ? (size_t)(end - s) : strlen(s);
+        unsigned factor;
+        colon = memchr(s, ':', len);
+        factor = (unsigned)strtoul(colon ? colon + 1 : s, NULL, 10);
+        if(factor == 0) factor = 1;
+        if(factor > MOBJECT_MAX_REPLICAS) factor = MOBJECT_MAX_REPLICAS;
+        if(factor > largest) largest = factor;
+        if(!colon) {
+            dflt = factor;
+        } else if(pool_name && strlen(pool_name) == (size_t)(colon - s)
+               && strncmp(s, pool_name, colon - s) == 0) {
+            result = factor;
+            matched = 1;
+        }
+        if(!end) break;
+        s = end + 1;
+    }
+    if(max) return largest;
+    return matched ? result : dflt;
+}
+
+unsigned mobject_replication_factor(const char* spec, const char* pool_name)
+{
+    return parse_replication_spec(spec, pool_name, 0);
+}
+
+unsigned mobject_replication_max_factor(const char* spec)
+{
+    return parse_replication_spec(spec, NULL, 1);
+}
+
+static int parse_erasure_spec(const char* spec, const char* pool_name,
+        unsigned* k, unsigned* m, unsigned* largest)
+{
+    const char* s = spec;
+
+    if(largest) *largest = 1;
+    if(!spec) return 0;
+    while(*s) {
+        const char* end = strchr(s, ',');
+        size_t len = end ? (size_t)(end - s) : strlen(s);
+        const char* colon = memchr(s, ':', len);
+        char* plus;
+        unsigned long dk, dm;
+        if(colon) {
+            dk = strtoul(colon + 1, &plus, 10);
+            dm = (*plus == '+') ? strtoul(plus + 1, NULL, 10) : 0;
+            if(dk > 0 && dm > 0 && dk + dm <= MOBJECT_MAX_REPLICAS) {
+                if(largest && dk + dm > *largest) *largest = dk + dm;
+                if(pool_name && strlen(pool_name) == (size_t)(colon - s)
+                && strncmp(s, pool_name, colon - s) == 0) {
+                    *k = dk;
+                    *m = dm;
+                    return 1;
+                }
+            }
+        }
+        if(!end) break;
+        s = end + 1;
+    }
+    return 0;
+}
+
+int mobject_erasure_profile(const char* spec, const char* pool_name,
+        unsigned* k, unsigned* m)
+{
+    return parse_erasure_spec(spec, pool_name, k, m, NULL);
+}
+
+unsigned mobject_erasure_max_width(const char* spec)
+{
+    unsigned largest;
+    parse_erasure_spec(spec, NULL, NULL, NULL, &largest);
+    return largest;
+}
+
+char* mobject_erasure_chunk_name(const char* oid, unsigned index)
+{
+    size_t size = strlen(oid) + 16;
+    char* name = (char*)malloc(size);
+    if(name) snprintf(name, size, "%s%c%u", oid, MOBJECT_EC_CHUNK_SEP, index);
+    return name;
+}
+
+int mobject_erasure_parse_chunk_name(const char* name, size_t* oid_len, unsigned* index)
+{
+    const char* sep = strrchr(name, MOBJECT_EC_CHUNK_SEP);
+    unsigned long i;
+    char* end;
+
+    if(!sep || sep == name || sep[1] == '\0') return 0;
+    i = strtoul(sep + 1, &end, 10);
+    if(*end != '\0' || i >= MOBJECT_MAX_REPLICAS) return 0;
+    *oid_len = sep - name;
+    *index   = i;
+    return 1;
+}
+
+unsigned long mobject_placement_locate(
+        mobject_placement_t placement,
+        const char* oid)
+{
+    return mobject_placement_locate_hash(placement, mobject_hash_name(oid));
+}
+
+int mobject_placement_num_servers(mobject_placement_t placement)
+{
+    return placement->num_servers;
+}
+
+void mobject_placement_free(mobject_placement_t p)
+{
+    if(!p) return;
+    if(p->ch_instance) ch_placement_finalize(p->ch_instance);
+    free(p->point_hashes);
+    free(p->point_ranks);
+    free(p->index);
+    free(p);
+}
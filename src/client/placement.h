@@ -0,0 +1,207 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MOBJECT_PLACEMENT_H
+#define __MOBJECT_PLACEMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MOBJECT_PLACEMENT_ENV         "MOBJECT_PLACEMENT"
+#define MOBJECT_PLACEMENT_VNODES_ENV  "MOBJECT_PLACEMENT_VNODES"
+#define MOBJECT_PLACEMENT_WEIGHTS_ENV "MOBJECT_PLACEMENT_WEIGHTS"
+#define MOBJECT_REPLICATION_ENV       "MOBJECT_POOL_REPLICATION"
+#define MOBJECT_ERASURE_ENV           "MOBJECT_POOL_ERASURE"
+#define MOBJECT_PROVIDERS_ENV         "MOBJECT_PROVIDERS_PER_SERVER"
+
+#define MOBJECT_PLACEMENT_MODULO "static_modulo"
+#define MOBJECT_PLACEMENT_RING   "ring"
+
+#define MOBJECT_PLACEMENT_DEFAULT_VNODES 128
+
+#define MOBJECT_MAX_REPLICAS 16
+
+/* the providers of a server have ids MOBJECT_PROVIDER_ID_BASE to
+   MOBJECT_PROVIDER_ID_BASE + MOBJECT_PROVIDERS_PER_SERVER - 1 */
+#define MOBJECT_PROVIDER_ID_BASE 1
+#define MOBJECT_MAX_PROVIDERS    64
+
+typedef struct mobject_placement* mobject_placement_t;
+
+#define MOBJECT_PLACEMENT_NULL ((mobject_placement_t)NULL)
+
+/**
+ * Creates a placement instance mapping object names to server ranks.
+ * In ring mode, the virtual nodes of a server are positioned according
+ * to its SSG member id, so that the servers keep their share of the
+ * ring when the ranks shift after a server leaves.
+ *
+ * @param mode        MOBJECT_PLACEMENT_MODULO (ch-placement static modulo)
+ *                    or MOBJECT_PLACEMENT_RING (consistent-hash ring)
+ * @param num_servers number of servers
+ * @param member_ids  SSG member id of the server of each rank, may be
+ *                    NULL to use the ranks as ids (ring mode only)
+ * @param vnodes      virtual nodes per server of weight 1 (ring mode only)
+ * @param weights     weight of the server of each rank, may be NULL (ring mode only)
+ * @param placement   resulting placement instance
+ *
+ * @return 0 on success, -1 on failure
+ */
+int mobject_placement_create(
+        const char* mode,
+        int num_servers,
+        const uint64_t* member_ids,
+        int vnodes,
+        const double* weights,
+        mobject_placement_t* placement);
+
+/**
+ * Creates a placement instance configured by the MOBJECT_PLACEMENT,
+ * MOBJECT_PLACEMENT_VNODES and MOBJECT_PLACEMENT_WEIGHTS environment
+ * variables. Defaults to the static modulo placement. Weights are a
+ * comma-separated list of <member_id>:<weight> entries, plus at most
+ * one entry without member id giving the weight of the other servers
+ * (1 by default), e.g. "0.5,1234567:2".
+ *
+ * @param num_servers number of servers
+ * @param member_ids  SSG member id of the server of each rank, may be NULL
+ * @param placement   resulting placement instance
+ *
+ * @return 0 on success, -1 on failure
+ */
+int mobject_placement_create_from_env(
+        int num_servers,
+        const uint64_t* member_ids,
+        mobject_placement_t* placement);
+
+/**
+ * Returns the rank of the server responsible for the given object.
+ */
+unsigned long mobject_placement_locate(
+        mobject_placement_t placement,
+        const char* oid);
+
+/**
+ * Returns the rank of the server responsible for the given hash.
+ */
+unsigned long mobject_placement_locate_hash(
+        mobject_placement_t placement,
+        uint64_t hash);
+
+/**
+ * Fills ranks with the (distinct) servers holding the replicas of the
+ * given object, the first one being its primary.
+ *
+ * @param placement placement instance
+ * @param oid       object name
+ * @param n         number of replicas requested
+ * @param ranks     array of at least n ranks
+ *
+ * @return the number of ranks filled, at most n and the number of servers
+ */
+unsigned mobject_placement_locate_replicas(
+        mobject_placement_t placement,
+        const char* oid,
+        unsigned n,
+        unsigned long* ranks);
+
+/**
+ * Returns the rank of the server at position pos of the list returned
+ * by mobject_placement_locate_replicas for a stored name, or for the
+ * object it is a chunk of if it is the name of a chunk of an
+ * erasure-coded object (see MOBJECT_EC_CHUNK_SEP), the position then
+ * being the chunk index rather than pos.
+ *
+ * @return the rank, or -1 if there are not enough servers
+ */
+long mobject_placement_locate_position(
+        mobject_placement_t placement,
+        const char* name,
+        unsigned pos);
+
+/**
+ * Returns the number of servers the placement was created for.
+ */
+int mobject_placement_num_servers(mobject_placement_t placement);
+
+/**
+ * Frees a placement instance.
+ */
+void mobject_placement_free(mobject_placement_t placement);
+
+/**
+ * Returns the replication factor of a pool given a replication spec,
+ * i.e. the content of the MOBJECT_POOL_REPLICATION environment variable:
+ * a comma-separated list of <pool>:<factor> entries, an entry without
+ * pool name setting the default (e.g. "2,logs:1,images:3").
+ * Returns 1 if spec is NULL or does not apply to the pool. Factors are
+ * capped to MOBJECT_MAX_REPLICAS.
+ */
+unsigned mobject_replication_factor(const char* spec, const char* pool_name);
+
+/**
+ * Returns the largest replication factor found in a replication spec.
+ */
+unsigned mobject_replication_max_factor(const char* spec);
+
+/**
+ * Looks up the erasure-coding profile of a pool given an erasure spec,
+ * i.e. the content of the MOBJECT_POOL_ERASURE environment variable:
+ * a comma-separated list of <pool>:<k>+<m> entries (e.g. "images:4+2").
+ * Profiles with k+m above MOBJECT_MAX_REPLICAS are ignored.
+ *
+ * @param spec      erasure spec, may be NULL
+ * @param pool_name pool name
+ * @param k         number of data chunks (set if the pool is erasure-coded)
+ * @param m         number of parity chunks (set if the pool is erasure-coded)
+ *
+ * @return 1 if the pool is erasure-coded, 0 otherwise
+ */
+int mobject_erasure_profile(const char* spec, const char* pool_name,
+        unsigned* k, unsigned* m);
+
+/**
+ * Returns the largest number of chunks (k+m) found in an erasure spec,
+ * 1 if there is none.
+ */
+unsigned mobject_erasure_max_width(const char* spec);
+
+/**
+ * Chunk j of an erasure-coded object is stored under the name of the
+ * object followed by MOBJECT_EC_CHUNK_SEP and j, on the server at
+ * position j of mobject_placement_locate_replicas for the object's name.
+ * Servers can thus tell which server a chunk belongs to without knowing
+ * its pool, and never mix two chunks of an object. Names of objects of
+ * erasure-coded pools may not contain MOBJECT_EC_CHUNK_SEP.
+ */
+#define MOBJECT_EC_CHUNK_SEP '\x1f'
+
+/**
+ * Returns the name of chunk index of an erasure-coded object,
+ * to be freed by the caller, or NULL if it could not be allocated.
+ */
+char* mobject_erasure_chunk_name(const char* oid, unsigned index);
+
+/**
+ * Tells whether a stored name is the name of a chunk of an erasure-coded
+ * object, setting the length of the object's name and the chunk index.
+ *
+ * @return 1 for a chunk name, 0 otherwise
+ */
+int mobject_erasure_parse_chunk_name(const char* name, size_t* oid_len, unsigned* index);
+
+/**
+ * Hashes an object name (64-bit FNV-1a followed by a murmur3 finalizer).
+ */
+uint64_t mobject_hash_name(const char* name);
+
+/**
+ * Returns which of the num_providers providers of a server holds
+ * the given object. The choice does not depend on the server, so an
+ * object and its replicas are held by providers of the same index.
+ */
+unsigned mobject_placement_locate_provider(const char* name, unsigned num_providers);
+
+#endif
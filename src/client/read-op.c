@@ -9,6 +9,8 @@
 #include "mobject-store-config.h"
 #include "libmobject-store.h"
 #include "src/io-chain/read-op-impl.h"
+#include "src/io-chain/prepare-read-op.h"
+#include "src/client/mobject-client-impl.h"
 #include "src/util/utlist.h"
 #include "src/util/log.h"
 
@@ -68,6 +70,37 @@ void mobject_read_op_read(mobject_store_read_op_t read_op,
     memset(buffer, 0, len);
 }
 
+void mobject_read_op_readv(mobject_store_read_op_t read_op,
+                           const struct iovec *iov,
+                           int iovcnt,
+                           uint64_t offset,
+                           size_t *bytes_read,
+                           int *prval)
+{
+	MOBJECT_ASSERT(read_op != MOBJECT_READ_OP_NULL, "invalid mobject_store_read_op_t obect");
+	MOBJECT_ASSERT(!(read_op->ready), "can't modify a read_op that is ready to be processed");
+	MOBJECT_ASSERT(iovcnt > 0, "readv needs at least one segment");
+
+	int i;
+	rd_action_read_t action   = (rd_action_read_t)calloc(1, sizeof(*action)+(iovcnt-1)*sizeof(struct iovec));
+	action->base.type         = READ_OPCODE_READ;
+	action->offset            = offset;
+	action->buffer.as_pointer = NULL;
+	action->bytes_read        = bytes_read;
+	action->prval             = prval;
+	action->iovcnt            = iovcnt;
+	for(i = 0; i < iovcnt; i++) {
+		action->iov[i] = iov[i];
+		action->len   += iov[i].iov_len;
+		memset(iov[i].iov_base, 0, iov[i].iov_len);
+	}
+
+	READ_ACTION_UPCAST(base, action);
+	DL_APPEND(read_op->actions, base);
+
+	read_op->num_actions += 1;
+}
+
 void mobject_read_op_omap_get_keys(mobject_store_read_op_t read_op,
 				                         const char *start_after,
 				                         uint64_t max_return,
@@ -161,3 +194,48 @@ void mobject_read_op_omap_get_vals_by_keys(mobject_store_read_op_t read_op,
 	read_op->num_actions += 1;
 }
 
+
+int mobject_read_op_prepare(mobject_client_t client,
+                            mobject_store_read_op_t read_op)
+{
+	MOBJECT_ASSERT(read_op != MOBJECT_READ_OP_NULL, "invalid mobject_store_read_op_t obect");
+	return prepare_read_op(client->mid, &client->buffer_finder, read_op);
+}
+
+int mobject_read_op_update(mobject_store_read_op_t read_op,
+                           unsigned index,
+                           uint64_t offset,
+                           size_t len)
+{
+	MOBJECT_ASSERT(read_op != MOBJECT_READ_OP_NULL, "invalid mobject_store_read_op_t obect");
+
+	rd_action_base_t action = read_op->actions;
+	unsigned i;
+	for(i = 0; i < index && action; i++)
+		action = action->next;
+	if(!action || action->type != READ_OPCODE_READ) {
+		fprintf(stderr, "[MOBJECT] mobject_read_op_update: action %u is not a read\n", index);
+		return -1;
+	}
+
+	rd_action_read_t a = (rd_action_read_t)action;
+	if(!read_op->ready && a->iovcnt) {
+		uint64_t total = 0;
+		for(i = 0; i < a->iovcnt; i++)
+			total += a->iov[i].iov_len;
+		if(len > total) {
+			fprintf(stderr, "[MOBJECT] mobject_read_op_update: length %zu exceeds the segments of the read\n", len);
+			return -1;
+		}
+	}
+	if(read_op->ready) {
+		uint64_t registered = read_op->bulk_lengths ? read_op->bulk_lengths[index] : 0;
+		if(len > registered) {
+			fprintf(stderr, "[MOBJECT] mobject_read_op_update: length %zu exceeds the prepared buffer\n", len);
+			return -1;
+		}
+	}
+	a->offset = offset;
+	a->len    = len;
+	return 0;
+}
@@ -0,0 +1,308 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "src/client/reed-solomon.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RS_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define RS_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* chunks are encoded by blocks so that the data
+   and parity blocks being combined stay in cache */
+#define RS_BLOCK_SIZE (32*1024)
+
+/* dst ^= c*src, c being given by its nibble tables (16 low, 16 high) */
+typedef void (*region_fn_t)(uint8_t* dst, const uint8_t* src,
+        const uint8_t* tables, size_t len);
+
+struct mobject_rs {
+    unsigned k;
+    unsigned m;
+    uint8_t* matrix;  // (k+m) x k generator matrix, identity on top
+    uint8_t* tables;  // m x k nibble tables of the parity rows
+};
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+static pthread_once_t gf_once = PTHREAD_ONCE_INIT;
+static region_fn_t region_fn;
+static const char* region_isa;
+
+////////////////////////////////////////////////////////////////////////////////
+//                               GF(2^8)                                      //
+////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    if(a == 0 || b == 0) return 0;
+    return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+static uint8_t gf_inv(uint8_t a)
+{
+    return gf_exp[255 - gf_log[a]];
+}
+
+static void gf_tables(uint8_t c, uint8_t* tables)
+{
+    unsigned i;
+    for(i = 0; i < 16; i++) {
+        tables[i]      = gf_mul(c, (uint8_t)i);
+        tables[16 + i] = gf_mul(c, (uint8_t)(i << 4));
+    }
+}
+
+static void region_scalar(uint8_t* dst, const uint8_t* src,
+        const uint8_t* tables, size_t len)
+{
+    size_t i;
+    for(i = 0; i < len; i++)
+        dst[i] ^= tables[src[i] & 0x0f] ^ tables[16 + (src[i] >> 4)];
+}
+
+#ifdef RS_X86
+__attribute__((target("ssse3")))
+static void region_ssse3(uint8_t* dst, const uint8_t* src,
+        const uint8_t* tables, size_t len)
+{
+    const __m128i lo   = _mm_loadu_si128((const __m128i*)tables);
+    const __m128i hi   = _mm_loadu_si128((const __m128i*)(tables + 16));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(s, mask));
+        __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(s, 4), mask));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(d, _mm_xor_si128(l, h)));
+    }
+    region_scalar(dst + i, src + i, tables, len - i);
+}
+
+__attribute__((target("avx2")))
+static void region_avx2(uint8_t* dst, const uint8_t* src,
+        const uint8_t* tables, size_t len)
+{
+    const __m256i lo   = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables));
+    const __m256i hi   = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(tables + 16)));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for(; i + 32 <= len; i += 32) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask));
+        __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(d, _mm256_xor_si256(l, h)));
+    }
+    region_scalar(dst + i, src + i, tables, len - i);
+}
+#endif
+
+#ifdef RS_NEON
+static void region_neon(uint8_t* dst, const uint8_t* src,
+        const uint8_t* tables, size_t len)
+{
+    const uint8x16_t lo   = vld1q_u8(tables);
+    const uint8x16_t hi   = vld1q_u8(tables + 16);
+    const uint8x16_t mask = vdupq_n_u8(0x0f);
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x16_t d = vld1q_u8(dst + i);
+        uint8x16_t l = vqtbl1q_u8(lo, vandq_u8(s, mask));
+        uint8x16_t h = vqtbl1q_u8(hi, vshrq_n_u8(s, 4));
+        vst1q_u8(dst + i, veorq_u8(d, veorq_u8(l, h)));
+    }
+    region_scalar(dst + i, src + i, tables, len - i);
+}
+#endif
+
+static void gf_init(void)
+{
+    unsigned i, x = 1;
+    /* primitive polynomial x^8 + x^4 + x^3 + x^2 + 1 */
+    for(i = 0; i < 255; i++) {
+        gf_exp[i] = (uint8_t)x;
+        gf_log[x] = (uint8_t)i;
+        x <<= 1;
+        if(x & 0x100) x ^= 0x11d;
+    }
+    for(i = 255; i < 512; i++)
+        gf_exp[i] = gf_exp[i - 255];
+
+    region_fn  = region_scalar;
+    region_isa = "scalar";
+#ifdef RS_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        region_fn  = region_avx2;
+        region_isa = "avx2";
+    } else if(__builtin_cpu_supports("ssse3")) {
+        region_fn  = region_ssse3;
+        region_isa = "ssse3";
+    }
+#endif
+#ifdef RS_NEON
+    region_fn  = region_neon;
+    region_isa = "neon";
+#endif
+}
+
+/* inverts the n x n matrix a into inv (Gauss-Jordan), a is destroyed */
+static int gf_invert_matrix(uint8_t* a, uint8_t* inv, unsigned n)
+{
+    unsigned i, j, r;
+
+    memset(inv, 0, n*n);
+    for(i = 0; i < n; i++) inv[i*n + i] = 1;
+
+    for(i = 0; i < n; i++) {
+        if(a[i*n + i] == 0) {
+            for(r = i + 1; r < n && a[r*n + i] == 0; r++);
+            if(r == n) return -1;
+            for(j = 0; j < n; j++) {
+                uint8_t t;
+                t = a[i*n + j];   a[i*n + j]   = a[r*n + j];   a[r*n + j]   = t;
+                t = inv[i*n + j]; inv[i*n + j] = inv[r*n + j]; inv[r*n + j] = t;
+            }
+        }
+        uint8_t c = gf_inv(a[i*n + i]);
+        for(j = 0; j < n; j++) {
+            a[i*n + j]   = gf_mul(a[i*n + j], c);
+            inv[i*n + j] = gf_mul(inv[i*n + j], c);
+        }
+        for(r = 0; r < n; r++) {
+            if(r == i || a[r*n + i] == 0) continue;
+            c = a[r*n + i];
+            for(j = 0; j < n; j++) {
+                a[r*n + j]   ^= gf_mul(a[i*n + j], c);
+                inv[r*n + j] ^= gf_mul(inv[i*n + j], c);
+            }
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                               Codec                                        //
+////////////////////////////////////////////////////////////////////////////////
+
+int mobject_rs_create(unsigned k, unsigned m, mobject_rs_t* rs)
+{
+    unsigned i, j;
+    mobject_rs_t r;
+
+    if(k == 0 || m == 0 || k + m > MOBJECT_RS_MAX_CHUNKS) return -1;
+    pthread_once(&gf_once, gf_init);
+
+    r = (mobject_rs_t)calloc(1, sizeof(*r));
+    r->k = k;
+    r->m = m;
+    r->matrix = (uint8_t*)calloc((k + m)*k, 1);
+    r->tables = (uint8_t*)malloc(m*k*32);
+
+    /* systematic part */
+    for(i = 0; i < k; i++)
+        r->matrix[i*k + i] = 1;
+    /* Cauchy part: 1/(x_i + y_j) with x_i = k+i and y_j = j all distinct,
+       which makes every k x k submatrix of the generator invertible */
+    for(i = 0; i < m; i++) {
+        for(j = 0; j < k; j++) {
+            uint8_t c = gf_inv((uint8_t)((k + i) ^ j));
+            r->matrix[(k + i)*k + j] = c;
+            gf_tables(c, r->tables + (i*k + j)*32);
+        }
+    }
+
+    *rs = r;
+    return 0;
+}
+
+void mobject_rs_encode(
+        mobject_rs_t rs,
+        const uint8_t* const* data,
+        uint8_t* const* parity,
+        size_t len)
+{
+    size_t off;
+    unsigned i, j;
+
+    for(i = 0; i < rs->m; i++)
+        memset(parity[i], 0, len);
+
+    for(off = 0; off < len; off += RS_BLOCK_SIZE) {
+        size_t n = len - off < RS_BLOCK_SIZE ? len - off : RS_BLOCK_SIZE;
+        for(i = 0; i < rs->m; i++)
+            for(j = 0; j < rs->k; j++)
+                region_fn(parity[i] + off, data[j] + off,
+                        rs->tables + (i*rs->k + j)*32, n);
+    }
+}
+
+int mobject_rs_decode(
+        mobject_rs_t rs,
+        uint8_t* const* chunks,
+        const int* present,
+        size_t len)
+{
+    unsigned k = rs->k;
+    unsigned rows[MOBJECT_RS_MAX_CHUNKS];
+    uint8_t a[MOBJECT_RS_MAX_CHUNKS*MOBJECT_RS_MAX_CHUNKS];
+    uint8_t inv[MOBJECT_RS_MAX_CHUNKS*MOBJECT_RS_MAX_CHUNKS];
+    uint8_t tables[32];
+    unsigned i, j, n = 0, missing = 0;
+    size_t off;
+
+    for(i = 0; i < k; i++)
+        if(!present[i]) missing += 1;
+    if(missing == 0) return 0;
+
+    /* pick the first k chunks available */
+    for(i = 0; i < k + rs->m && n < k; i++)
+        if(present[i]) rows[n++] = i;
+    if(n < k) return -1;
+
+    for(i = 0; i < k; i++)
+        memcpy(a + i*k, rs->matrix + rows[i]*k, k);
+    if(gf_invert_matrix(a, inv, k) != 0) return -1;
+
+    /* data chunk d is row d of the inverse applied to the chunks picked */
+    for(i = 0; i < k; i++) {
+        if(present[i]) continue;
+        memset(chunks[i], 0, len);
+        for(j = 0; j < k; j++) {
+            uint8_t c = inv[i*k + j];
+            if(c == 0) continue;
+            gf_tables(c, tables);
+            for(off = 0; off < len; off += RS_BLOCK_SIZE) {
+                size_t blk = len - off < RS_BLOCK_SIZE ? len - off : RS_BLOCK_SIZE;
+                region_fn(chunks[i] + off, chunks[rows[j]] + off, tables, blk);
+            }
+        }
+    }
+    return 0;
+}
+
+const char* mobject_rs_isa(void)
+{
+    pthread_once(&gf_once, gf_init);
+    return region_isa;
+}
+
+void mobject_rs_free(mobject_rs_t rs)
+{
+    if(!rs) return;
+    free(rs->matrix);
+    free(rs->tables);
+    free(rs);
+}
@@ -0,0 +1,72 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MOBJECT_REED_SOLOMON_H
+#define __MOBJECT_REED_SOLOMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* k + m is limited by the number of distinct servers
+   the placement can return for an object */
+#define MOBJECT_RS_MAX_CHUNKS 16
+
+typedef struct mobject_rs* mobject_rs_t;
+
+#define MOBJECT_RS_NULL ((mobject_rs_t)NULL)
+
+/**
+ * Creates a systematic Reed-Solomon code over GF(2^8) with k data chunks
+ * and m parity chunks (Cauchy generator matrix, so that any k chunks out
+ * of k+m are enough to recover the data). The region multiplications use
+ * AVX2, SSSE3 or NEON table lookups when the CPU supports them.
+ *
+ * @param k  number of data chunks
+ * @param m  number of parity chunks
+ * @param rs resulting code
+ *
+ * @return 0 on success, -1 if k or m are invalid
+ */
+int mobject_rs_create(unsigned k, unsigned m, mobject_rs_t* rs);
+
+/**
+ * Computes the m parity chunks of len bytes from the k data chunks.
+ */
+void mobject_rs_encode(
+        mobject_rs_t rs,
+        const uint8_t* const* data,
+        uint8_t* const* parity,
+        size_t len);
+
+/**
+ * Reconstructs the missing data chunks in place.
+ *
+ * @param rs      code
+ * @param chunks  k+m buffers of len bytes (data chunks first); the buffers
+ *                of missing data chunks must be allocated, those of
+ *                missing parity chunks may be NULL
+ * @param present k+m flags telling which chunks hold valid content
+ * @param len     length of the chunks
+ *
+ * @return 0 on success, -1 if fewer than k chunks are present
+ */
+int mobject_rs_decode(
+        mobject_rs_t rs,
+        uint8_t* const* chunks,
+        const int* present,
+        size_t len);
+
+/**
+ * Returns the name of the instruction set used for region operations
+ * ("avx2", "ssse3", "neon" or "scalar").
+ */
+const char* mobject_rs_isa(void);
+
+/**
+ * Frees a code.
+ */
+void mobject_rs_free(mobject_rs_t rs);
+
+#endif
@@ -0,0 +1,261 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <stdlib.h>
+#include "mobject-store-config.h"
+#include "libmobject-store.h"
+#include "src/client/split.h"
+#include "src/client/mobject-client-impl.h"
+#include "src/io-chain/write-op-impl.h"
+#include "src/io-chain/read-op-impl.h"
+#include "src/util/log.h"
+
+struct mobject_split {
+    unsigned                  count;
+    uint64_t                  range;       // size of the ranges
+    mobject_request_t*        reqs;        // one per range, NULL if it could not be issued
+    mobject_store_write_op_t* write_ops;   // sub-operations (write)
+    mobject_store_read_op_t*  read_ops;    // sub-operations (read)
+    size_t*                   bytes_read;  // per range, for reads
+    int*                      prvals;      // per range, for reads
+    uint64_t                  safe_seq;    // highest ticket of the ranges of a deferred write
+    rd_action_read_t          read;        // read action of the original read_op
+};
+
+/* size of the ranges an operation of len bytes is split into */
+static uint64_t split_range_size(uint64_t len, size_t chunk_size, unsigned max_requests)
+{
+    uint64_t chunks, per_range;
+    if(chunk_size == 0 || max_requests <= 1 || len < 2*chunk_size)
+        return len;
+    chunks = (len + chunk_size - 1) / chunk_size;
+    if(chunks > max_requests) {
+        per_range = (chunks + max_requests - 1) / max_requests;
+    } else {
+        per_range = 1;
+    }
+    return per_range * chunk_size;
+}
+
+static unsigned split_count(uint64_t len, size_t chunk_size, unsigned max_requests)
+{
+    uint64_t range = split_range_size(len, chunk_size, max_requests);
+    if(range == 0) return 1;
+    return (unsigned)((len + range - 1) / range);
+}
+
+static wr_action_write_t single_write(mobject_store_write_op_t write_op)
+{
+    if(write_op == MOBJECT_WRITE_OP_NULL || write_op->ready
+    || write_op->num_actions != 1 || write_op->actions->type != WRITE_OPCODE_WRITE
+    || ((wr_action_write_t)write_op->actions)->iovcnt != 0)
+        return NULL;
+    return (wr_action_write_t)write_op->actions;
+}
+
+static rd_action_read_t single_read(mobject_store_read_op_t read_op)
+{
+    if(read_op == MOBJECT_READ_OP_NULL || read_op->ready
+    || read_op->num_actions != 1 || read_op->actions->type != READ_OPCODE_READ
+    || ((rd_action_read_t)read_op->actions)->iovcnt != 0)
+        return NULL;
+    return (rd_action_read_t)read_op->actions;
+}
+
+unsigned mobject_split_write_op_count(
+        mobject_store_write_op_t write_op,
+        size_t chunk_size,
+        unsigned max_requests)
+{
+    wr_action_write_t w = single_write(write_op);
+    if(!w) return 1;
+    return split_count(w->len, chunk_size, max_requests);
+}
+
+unsigned mobject_split_read_op_count(
+        mobject_store_read_op_t read_op,
+        size_t chunk_size,
+        unsigned max_requests)
+{
+    rd_action_read_t r = single_read(read_op);
+    if(!r) return 1;
+    return split_count(r->len, chunk_size, max_requests);
+}
+
+static struct mobject_split* split_create(uint64_t len, size_t chunk_size, unsigned max_requests)
+{
+    struct mobject_split* split = (struct mobject_split*)calloc(1, sizeof(*split));
+    split->range = split_range_size(len, chunk_size, max_requests);
+    split->count = split_count(len, chunk_size, max_requests);
+    split->reqs  = (mobject_request_t*)calloc(split->count, sizeof(mobject_request_t));
+    return split;
+}
+
+static void split_free(struct mobject_split* split)
+{
+    unsigned i;
+    for(i = 0; i < split->count; i++) {
+        if(split->write_ops) mobject_release_write_op(split->write_ops[i]);
+        if(split->read_ops)  mobject_release_read_op(split->read_ops[i]);
+    }
+    free(split->write_ops);
+    free(split->read_ops);
+    free(split->bytes_read);
+    free(split->prvals);
+    free(split->reqs);
+    free(split);
+}
+
+static mobject_request_t split_request(struct mobject_split* split)
+{
+    unsigned i, issued = 0;
+    for(i = 0; i < split->count; i++)
+        if(split->reqs[i] != MOBJECT_REQUEST_NULL) issued += 1;
+    if(issued == 0) {
+        split_free(split);
+        return MOBJECT_REQUEST_NULL;
+    }
+    mobject_request_t req = calloc(1, sizeof(*req));
+    req->type    = MOBJECT_AIO_SPLIT;
+    req->request = MARGO_REQUEST_NULL;
+    req->handle  = HG_HANDLE_NULL;
+    req->split   = split;
+    return req;
+}
+
+int mobject_split_aio_write_op_operate(
+        mobject_provider_handle_t mph,
+        mobject_store_write_op_t write_op,
+        const char *pool_name,
+        const char *oid,
+        time_t *mtime,
+        int flags,
+        size_t chunk_size,
+        unsigned max_requests,
+        mobject_request_t* req)
+{
+    unsigned i;
+    wr_action_write_t w = single_write(write_op);
+    if(!w) return -1;
+
+    struct mobject_split* split = split_create(w->len, chunk_size, max_requests);
+    split->write_ops = (mobject_store_write_op_t*)calloc(split->count, sizeof(mobject_store_write_op_t));
+
+    for(i = 0; i < split->count; i++) {
+        uint64_t lo = i*split->range;
+        uint64_t len = w->len - lo < split->range ? w->len - lo : split->range;
+        split->write_ops[i] = mobject_create_write_op();
+        mobject_write_op_write(split->write_ops[i], w->buffer.as_pointer + lo, w->offset + lo, len);
+        if(mobject_aio_write_op_operate(mph, split->write_ops[i], pool_name, oid,
+                    mtime, flags, &split->reqs[i]) != 0) {
+            fprintf(stderr, "[MOBJECT] Could not issue range %u of a split write\n", i);
+            split->reqs[i] = MOBJECT_REQUEST_NULL;
+        } else {
+            split->reqs[i]->safe_seq = &split->safe_seq;
+        }
+    }
+
+    *req = split_request(split);
+    if(*req == MOBJECT_REQUEST_NULL) return -1;
+    (*req)->op.write_op = write_op;
+    return 0;
+}
+
+int mobject_split_aio_read_op_operate(
+        mobject_provider_handle_t mph,
+        mobject_store_read_op_t read_op,
+        const char *pool_name,
+        const char *oid,
+        int flags,
+        size_t chunk_size,
+        unsigned max_requests,
+        mobject_request_t* req)
+{
+    unsigned i;
+    rd_action_read_t r = single_read(read_op);
+    if(!r) return -1;
+
+    struct mobject_split* split = split_create(r->len, chunk_size, max_requests);
+    split->read_ops   = (mobject_store_read_op_t*)calloc(split->count, sizeof(mobject_store_read_op_t));
+    split->bytes_read = (size_t*)calloc(split->count, sizeof(size_t));
+    split->prvals     = (int*)calloc(split->count, sizeof(int));
+    split->read       = r;
+
+    for(i = 0; i < split->count; i++) {
+        uint64_t lo = i*split->range;
+        uint64_t len = r->len - lo < split->range ? r->len - lo : split->range;
+        split->prvals[i] = -1;
+        split->read_ops[i] = mobject_create_read_op();
+        mobject_read_op_read(split->read_ops[i], (char*)r->buffer.as_pointer + lo,
+                r->offset + lo, len, &split->bytes_read[i], &split->prvals[i]);
+        if(mobject_aio_read_op_operate(mph, split->read_ops[i], pool_name, oid,
+                    flags, &split->reqs[i]) != 0) {
+            fprintf(stderr, "[MOBJECT] Could not issue range %u of a split read\n", i);
+            split->reqs[i] = MOBJECT_REQUEST_NULL;
+        }
+    }
+
+    *req = split_request(split);
+    if(*req == MOBJECT_REQUEST_NULL) return -1;
+    (*req)->op.read_op = read_op;
+    return 0;
+}
+
+int mobject_split_wait(mobject_request_t req, int* ret)
+{
+    struct mobject_split* split = req->split;
+    unsigned i;
+    int r = 0;
+    size_t total = 0;
+    int short_read = 0;
+
+    *ret = 0;
+    for(i = 0; i < split->count; i++) {
+        int sub_ret = 0;
+        if(split->reqs[i] == MOBJECT_REQUEST_NULL) {
+            if(*ret == 0) *ret = -1;
+            continue;
+        }
+        int sub_r = mobject_aio_wait(split->reqs[i], &sub_ret);
+        split->reqs[i] = MOBJECT_REQUEST_NULL;
+        if(sub_r != 0 && r == 0) r = sub_r;
+        if(sub_ret != 0 && *ret == 0) *ret = sub_ret;
+    }
+
+    /* the ranges went to the same provider, whose tickets are ordered */
+    if(req->safe_seq && split->safe_seq > *(req->safe_seq))
+        *(req->safe_seq) = split->safe_seq;
+
+    /* ranges are contiguous, so only the ranges before
+       the first short one (the end of the object) count */
+    if(split->read) {
+        int prval = 0;
+        for(i = 0; i < split->count; i++) {
+            if(split->prvals[i] != 0 && prval == 0) prval = split->prvals[i];
+            if(short_read) continue;
+            total += split->bytes_read[i];
+            if(split->bytes_read[i] < split->range) short_read = 1;
+        }
+        if(split->read->bytes_read) *(split->read->bytes_read) = total;
+        if(split->read->prval) *(split->read->prval) = prval;
+    }
+
+    split_free(split);
+    free(req);
+    return r;
+}
+
+int mobject_split_test(mobject_request_t req, int* flag)
+{
+    struct mobject_split* split = req->split;
+    unsigned i;
+    *flag = 1;
+    for(i = 0; i < split->count && *flag; i++) {
+        if(split->reqs[i] == MOBJECT_REQUEST_NULL) continue;
+        int r = mobject_aio_test(split->reqs[i], flag);
+        if(r != 0) return r;
+    }
+    return 0;
+}
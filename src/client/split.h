@@ -0,0 +1,92 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MOBJECT_SPLIT_H
+#define __MOBJECT_SPLIT_H
+
+#include "libmobject-store.h"
+#include "mobject-client.h"
+
+#define MOBJECT_SPLIT_DEFAULT_REQUESTS 8
+
+/**
+ * A write_op made of a single write, or a read_op made of a single
+ * read, can be split into up to max_requests sub-requests over
+ * disjoint ranges of the object, sent concurrently to the same
+ * provider so that several of its handler ULTs serve the operation.
+ * Ranges are multiples of chunk_size (except for the last one), and
+ * operations smaller than two chunks are never split. A split write
+ * is not atomic: if a sub-request fails, the others may have been
+ * applied.
+ */
+
+/**
+ * Returns the number of sub-requests the write_op would be split
+ * into, 1 meaning that it cannot or should not be split.
+ */
+unsigned mobject_split_write_op_count(
+        mobject_store_write_op_t write_op,
+        size_t chunk_size,
+        unsigned max_requests);
+
+/**
+ * Returns the number of sub-requests the read_op would be split
+ * into, 1 meaning that it cannot or should not be split.
+ */
+unsigned mobject_split_read_op_count(
+        mobject_store_read_op_t read_op,
+        size_t chunk_size,
+        unsigned max_requests);
+
+/**
+ * Issues the sub-requests of a write_op for which
+ * mobject_split_write_op_count returned more than 1. The resulting
+ * request is waited on and tested with mobject_aio_wait and
+ * mobject_aio_test like any other.
+ *
+ * @return 0 on success, -1 if no sub-request could be issued
+ */
+int mobject_split_aio_write_op_operate(
+        mobject_provider_handle_t mph,
+        mobject_store_write_op_t write_op,
+        const char *pool_name,
+        const char *oid,
+        time_t *mtime,
+        int flags,
+        size_t chunk_size,
+        unsigned max_requests,
+        mobject_request_t* req);
+
+/**
+ * Issues the sub-requests of a read_op for which
+ * mobject_split_read_op_count returned more than 1. The bytes
+ * read and return value of the read are set when the request
+ * has been waited on.
+ *
+ * @return 0 on success, -1 if no sub-request could be issued
+ */
+int mobject_split_aio_read_op_operate(
+        mobject_provider_handle_t mph,
+        mobject_store_read_op_t read_op,
+        const char *pool_name,
+        const char *oid,
+        int flags,
+        size_t chunk_size,
+        unsigned max_requests,
+        mobject_request_t* req);
+
+/**
+ * Waits for the sub-requests of a split request and frees it.
+ * Called by mobject_aio_wait.
+ */
+int mobject_split_wait(mobject_request_t req, int* ret);
+
+/**
+ * Tests whether all the sub-requests of a split request completed.
+ * Called by mobject_aio_test.
+ */
+int mobject_split_test(mobject_request_t req, int* flag);
+
+#endif
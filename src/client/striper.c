@@ -0,0 +1,521 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include "mobject-store-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libmobject-store.h"
+#include "libmobject-striper.h"
+#include "src/client/aio/completion.h"
+
+/* maximum number of sub-object operations in flight */
+#define STRIPER_WINDOW 64
+
+#define STRIPER_KEY_PREFIX       "striper."
+#define STRIPER_KEY_STRIPE_UNIT  "striper.layout.stripe_unit"
+#define STRIPER_KEY_STRIPE_COUNT "striper.layout.stripe_count"
+#define STRIPER_KEY_OBJECT_SIZE  "striper.layout.object_size"
+#define STRIPER_KEY_SIZE         "striper.size"
+
+struct mobject_striper {
+    mobject_store_ioctx_t ioctx;
+    uint64_t              stripe_unit;
+    uint64_t              stripe_count;
+    uint64_t              object_size;
+};
+
+typedef struct striper_layout {
+    uint64_t stripe_unit;
+    uint64_t stripe_count;
+    uint64_t object_size;
+} striper_layout_t;
+
+/* metadata of a striped object, kept in the omap of its first sub-object */
+typedef struct striper_meta {
+    int              exists;
+    striper_layout_t layout;
+    uint64_t         size;
+    time_t           mtime;
+} striper_meta_t;
+
+/* an operation on one sub-object, issued asynchronously */
+typedef struct striper_op {
+    mobject_store_completion_t completion;
+    mobject_store_write_op_t   write_op;
+    mobject_store_read_op_t    read_op;
+    size_t                     num_reads;
+    char**                     bufs;       // destination of each read action
+    size_t*                    lens;       // length of each read action
+    size_t*                    bytes_read;
+    int*                       prvals;
+} striper_op_t;
+
+/* bounded queue of operations in flight */
+typedef struct striper_queue {
+    striper_op_t ops[STRIPER_WINDOW];
+    unsigned     head;
+    unsigned     count;
+    int          ret;
+} striper_queue_t;
+
+////////////////////////////////////////////////////////////////////////////////
+//                               Layout                                       //
+////////////////////////////////////////////////////////////////////////////////
+
+static void sub_object_name(char* name, size_t size, const char* soid, uint64_t objno)
+{
+    snprintf(name, size, "%s.%016llx", soid, (unsigned long long)objno);
+}
+
+/* maps a logical offset to a sub-object, an offset in it,
+   and the number of bytes contiguous in both */
+static void map_offset(const striper_layout_t* l, uint64_t off,
+        uint64_t* objno, uint64_t* objoff, uint64_t* run)
+{
+    uint64_t block     = off / l->stripe_unit;
+    uint64_t stripeno  = block / l->stripe_count;
+    uint64_t stripepos = block % l->stripe_count;
+    uint64_t spo       = l->object_size / l->stripe_unit; // stripes per object
+    uint64_t setno     = stripeno / spo;
+
+    *objno  = setno * l->stripe_count + stripepos;
+    *objoff = (stripeno % spo) * l->stripe_unit + off % l->stripe_unit;
+    *run    = l->stripe_unit - off % l->stripe_unit;
+}
+
+/* size of a sub-object when the striped object has the given size */
+static uint64_t sub_object_size(const striper_layout_t* l, uint64_t size, uint64_t objno)
+{
+    uint64_t spo    = l->object_size / l->stripe_unit;
+    uint64_t setno  = objno / l->stripe_count;
+    uint64_t pos    = objno % l->stripe_count;
+    uint64_t blocks = (size + l->stripe_unit - 1) / l->stripe_unit;
+    uint64_t last;
+
+    if(blocks <= setno * spo * l->stripe_count + pos) return 0;
+    /* last stripe of the set holding a block of this sub-object */
+    last = (blocks - 1 - pos) / l->stripe_count;
+    if(last >= (setno + 1) * spo) return l->object_size;
+    uint64_t block = last * l->stripe_count + pos;
+    uint64_t in_block = size - block * l->stripe_unit;
+    if(in_block > l->stripe_unit) in_block = l->stripe_unit;
+    return (last - setno * spo) * l->stripe_unit + in_block;
+}
+
+/* number of sub-objects that hold data for the given size (at least 1) */
+static uint64_t num_sub_objects(const striper_layout_t* l, uint64_t size)
+{
+    uint64_t blocks = (size + l->stripe_unit - 1) / l->stripe_unit;
+    uint64_t b, objno, objoff, run, count = 1;
+    uint64_t first = blocks > l->stripe_count ? blocks - l->stripe_count : 0;
+
+    for(b = first; b < blocks; b++) {
+        map_offset(l, b * l->stripe_unit, &objno, &objoff, &run);
+        if(objno + 1 > count) count = objno + 1;
+    }
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                               Metadata                                     //
+////////////////////////////////////////////////////////////////////////////////
+
+static int read_meta(mobject_striper_t striper, const char* soid, striper_meta_t* meta)
+{
+    char name[1024];
+    mobject_store_omap_iter_t iter;
+    uint64_t psize;
+    int prval_stat = -1, prval_omap = -1;
+    int found = 0;
+    int ret;
+
+    memset(meta, 0, sizeof(*meta));
+    meta->layout.stripe_unit  = striper->stripe_unit;
+    meta->layout.stripe_count = striper->stripe_count;
+    meta->layout.object_size  = striper->object_size;
+
+    sub_object_name(name, sizeof(name), soid, 0);
+    mobject_store_read_op_t read_op = mobject_store_create_read_op();
+    mobject_store_read_op_stat(read_op, &psize, &meta->mtime, &prval_stat);
+    mobject_store_read_op_omap_get_vals(read_op, "", STRIPER_KEY_PREFIX, 16, &iter, &prval_omap);
+    ret = mobject_store_read_op_operate(read_op, striper->ioctx, name, LIBMOBJECT_OPERATION_NOFLAG);
+    mobject_store_release_read_op(read_op);
+    if(ret != 0) return -1;
+    if(prval_omap != 0) return 0; // the object does not exist
+
+    char* key;
+    char* val;
+    size_t len;
+    while(mobject_store_omap_get_next(iter, &key, &val, &len) == 0 && key) {
+        char str[32];
+        uint64_t v;
+        if(len >= sizeof(str)) continue;
+        memcpy(str, val, len);
+        str[len] = '\0';
+        v = strtoull(str, NULL, 10);
+        if(strcmp(key, STRIPER_KEY_STRIPE_UNIT) == 0)       meta->layout.stripe_unit  = v;
+        else if(strcmp(key, STRIPER_KEY_STRIPE_COUNT) == 0) meta->layout.stripe_count = v;
+        else if(strcmp(key, STRIPER_KEY_OBJECT_SIZE) == 0)  meta->layout.object_size  = v;
+        else if(strcmp(key, STRIPER_KEY_SIZE) == 0) {
+            meta->size = v;
+            found = 1;
+        }
+    }
+    mobject_store_omap_get_end(iter);
+
+    if(found && (meta->layout.stripe_unit == 0 || meta->layout.stripe_count == 0
+            || meta->layout.object_size % meta->layout.stripe_unit != 0)) {
+        fprintf(stderr, "Error: invalid layout for striped object %s\n", soid);
+        return -1;
+    }
+    meta->exists = found;
+    return 0;
+}
+
+/* sets the size of the striped object, and its layout if it is new */
+static int write_meta(mobject_striper_t striper, const char* soid,
+        const striper_meta_t* meta, uint64_t size)
+{
+    char name[1024];
+    char values[4][32];
+    const char* keys[4] = { STRIPER_KEY_SIZE, STRIPER_KEY_STRIPE_UNIT,
+                            STRIPER_KEY_STRIPE_COUNT, STRIPER_KEY_OBJECT_SIZE };
+    const char* vals[4] = { values[0], values[1], values[2], values[3] };
+    size_t lens[4];
+    size_t i, num = meta->exists ? 1 : 4;
+
+    snprintf(values[0], 32, "%llu", (unsigned long long)size);
+    snprintf(values[1], 32, "%llu", (unsigned long long)meta->layout.stripe_unit);
+    snprintf(values[2], 32, "%llu", (unsigned long long)meta->layout.stripe_count);
+    snprintf(values[3], 32, "%llu", (unsigned long long)meta->layout.object_size);
+    for(i = 0; i < 4; i++) lens[i] = strlen(values[i]);
+
+    sub_object_name(name, sizeof(name), soid, 0);
+    mobject_store_write_op_t write_op = mobject_store_create_write_op();
+    mobject_store_write_op_omap_set(write_op, keys, vals, lens, num);
+    int ret = mobject_store_write_op_operate(write_op, striper->ioctx, name, NULL, LIBMOBJECT_OPERATION_NOFLAG);
+    mobject_store_release_write_op(write_op);
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                           Sub-object operations                            //
+////////////////////////////////////////////////////////////////////////////////
+
+static void op_complete(striper_queue_t* q, striper_op_t* op)
+{
+    size_t i;
+
+    mobject_store_aio_wait_for_complete(op->completion);
+    if(mobject_store_aio_get_return_value(op->completion) != 0) q->ret = -1;
+    mobject_store_aio_release(op->completion);
+
+    if(op->write_op) mobject_store_release_write_op(op->write_op);
+    if(op->read_op) {
+        mobject_store_release_read_op(op->read_op);
+        /* missing sub-objects and holes read as zeros */
+        for(i = 0; i < op->num_reads; i++) {
+            size_t n = op->prvals[i] == 0 ? op->bytes_read[i] : 0;
+            if(n < op->lens[i]) memset(op->bufs[i] + n, 0, op->lens[i] - n);
+        }
+    }
+    free(op->bufs);
+    free(op->lens);
+    free(op->bytes_read);
+    free(op->prvals);
+    memset(op, 0, sizeof(*op));
+}
+
+/* returns a free slot of the queue, waiting for the oldest operation if needed */
+static striper_op_t* queue_slot(striper_queue_t* q)
+{
+    striper_op_t* op;
+    if(q->count == STRIPER_WINDOW) {
+        op_complete(q, &q->ops[q->head]);
+        q->head = (q->head + 1) % STRIPER_WINDOW;
+        q->count -= 1;
+    }
+    op = &q->ops[(q->head + q->count) % STRIPER_WINDOW];
+    memset(op, 0, sizeof(*op));
+    return op;
+}
+
+static int queue_drain(striper_queue_t* q)
+{
+    while(q->count) {
+        op_complete(q, &q->ops[q->head]);
+        q->head = (q->head + 1) % STRIPER_WINDOW;
+        q->count -= 1;
+    }
+    return q->ret;
+}
+
+/* issues a queued operation on a sub-object */
+static void op_issue(mobject_striper_t striper, striper_queue_t* q,
+        striper_op_t* op, const char* soid, uint64_t objno)
+{
+    char name[1024];
+    int r;
+
+    sub_object_name(name, sizeof(name), soid, objno);
+    mobject_store_aio_create_completion(NULL, NULL, NULL, &op->completion);
+    if(op->write_op)
+        r = mobject_store_aio_write_op_operate(op->write_op, striper->ioctx,
+                op->completion, name, NULL, LIBMOBJECT_OPERATION_NOFLAG);
+    else
+        r = mobject_store_aio_read_op_operate(op->read_op, striper->ioctx,
+                op->completion, name, LIBMOBJECT_OPERATION_NOFLAG);
+    if(r != 0) {
+        /* nothing to wait on for this operation */
+        op->completion->request   = MOBJECT_REQUEST_NULL;
+        op->completion->ret_value = -1;
+    }
+    q->count += 1;
+}
+
+/**
+ * Reads (is_write == 0) or writes (is_write == 1) the range [off, off+len)
+ * of a striped object, with one operation per sub-object and object set,
+ * up to STRIPER_WINDOW of them in flight.
+ */
+static int striped_io(mobject_striper_t striper, const char* soid,
+        const striper_layout_t* l, char* buf, size_t len, uint64_t off, int is_write)
+{
+    striper_queue_t q;
+    uint64_t su  = l->stripe_unit;
+    uint64_t sc  = l->stripe_count;
+    uint64_t spo = l->object_size / su; // stripes per object
+    uint64_t set_size = sc * l->object_size;
+    uint64_t end = off + len;
+    uint64_t setno, pos, s;
+
+    memset(&q, 0, sizeof(q));
+
+    for(setno = off / set_size; setno * set_size < end; setno++) {
+        for(pos = 0; pos < sc; pos++) {
+            striper_op_t* op = NULL;
+            /* blocks of sub-object setno*sc+pos within the range */
+            for(s = 0; s < spo; s++) {
+                uint64_t block_off = ((setno * spo + s) * sc + pos) * su;
+                uint64_t lo = block_off > off ? block_off : off;
+                uint64_t hi = block_off + su < end ? block_off + su : end;
+                if(lo >= hi) continue;
+                if(!op) {
+                    op = queue_slot(&q);
+                    if(is_write) {
+                        op->write_op = mobject_store_create_write_op();
+                    } else {
+                        op->read_op    = mobject_store_create_read_op();
+                        op->bufs       = (char**)calloc(spo, sizeof(char*));
+                        op->lens       = (size_t*)calloc(spo, sizeof(size_t));
+                        op->bytes_read = (size_t*)calloc(spo, sizeof(size_t));
+                        op->prvals     = (int*)calloc(spo, sizeof(int));
+                    }
+                }
+                char* ptr = buf + (lo - off);
+                uint64_t objoff = s * su + (lo - block_off);
+                if(is_write) {
+                    mobject_store_write_op_write(op->write_op, ptr, hi - lo, objoff);
+                } else {
+                    size_t i = op->num_reads++;
+                    op->bufs[i] = ptr;
+                    op->lens[i] = hi - lo;
+                    mobject_store_read_op_read(op->read_op, objoff, hi - lo, ptr,
+                            &op->bytes_read[i], &op->prvals[i]);
+                }
+            }
+            if(op) op_issue(striper, &q, op, soid, setno * sc + pos);
+        }
+    }
+
+    return queue_drain(&q);
+}
+
+/* removes (or truncates) the sub-objects beyond a new size */
+static int shrink_sub_objects(mobject_striper_t striper, const char* soid,
+        const striper_layout_t* l, uint64_t old_size, uint64_t new_size)
+{
+    striper_queue_t q;
+    uint64_t objno, count = num_sub_objects(l, old_size);
+
+    memset(&q, 0, sizeof(q));
+    for(objno = 0; objno < count; objno++) {
+        uint64_t old_len = sub_object_size(l, old_size, objno);
+        uint64_t new_len = sub_object_size(l, new_size, objno);
+        if(new_len >= old_len) continue;
+        striper_op_t* op = queue_slot(&q);
+        op->write_op = mobject_store_create_write_op();
+        /* the first sub-object holds the metadata */
+        if(new_len == 0 && objno != 0)
+            mobject_store_write_op_remove(op->write_op);
+        else
+            mobject_store_write_op_truncate(op->write_op, new_len);
+        op_issue(striper, &q, op, soid, objno);
+    }
+    return queue_drain(&q);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                               Public API                                   //
+////////////////////////////////////////////////////////////////////////////////
+
+int mobject_striper_create(mobject_store_ioctx_t ioctx,
+                           mobject_striper_t *striper)
+{
+    mobject_striper_t s = (mobject_striper_t)calloc(1, sizeof(*s));
+    if(!s) return -1;
+    s->ioctx        = ioctx;
+    s->stripe_unit  = MOBJECT_STRIPER_DEFAULT_STRIPE_UNIT;
+    s->stripe_count = MOBJECT_STRIPER_DEFAULT_STRIPE_COUNT;
+    s->object_size  = MOBJECT_STRIPER_DEFAULT_OBJECT_SIZE;
+    *striper = s;
+    return 0;
+}
+
+void mobject_striper_destroy(mobject_striper_t striper)
+{
+    free(striper);
+}
+
+int mobject_striper_set_object_layout_stripe_unit(mobject_striper_t striper,
+                                                  unsigned int stripe_unit)
+{
+    if(stripe_unit == 0 || striper->object_size % stripe_unit != 0) return -1;
+    striper->stripe_unit = stripe_unit;
+    return 0;
+}
+
+int mobject_striper_set_object_layout_stripe_count(mobject_striper_t striper,
+                                                   unsigned int stripe_count)
+{
+    if(stripe_count == 0) return -1;
+    striper->stripe_count = stripe_count;
+    return 0;
+}
+
+int mobject_striper_set_object_layout_object_size(mobject_striper_t striper,
+                                                  unsigned int object_size)
+{
+    if(object_size == 0 || object_size % striper->stripe_unit != 0) return -1;
+    striper->object_size = object_size;
+    return 0;
+}
+
+int mobject_striper_write(mobject_striper_t striper,
+                          const char *soid,
+                          const char *buf,
+                          size_t len,
+                          uint64_t off)
+{
+    striper_meta_t meta;
+    int ret;
+
+    if(read_meta(striper, soid, &meta) != 0) return -1;
+    ret = striped_io(striper, soid, &meta.layout, (char*)buf, len, off, 1);
+    if(ret != 0) return ret;
+    /* the size is updated once the data is written */
+    if(meta.exists && off + len <= meta.size) return 0;
+    return write_meta(striper, soid, &meta, off + len > meta.size ? off + len : meta.size);
+}
+
+int mobject_striper_write_full(mobject_striper_t striper,
+                               const char *soid,
+                               const char *buf,
+                               size_t len)
+{
+    striper_meta_t meta;
+    int ret;
+
+    if(read_meta(striper, soid, &meta) != 0) return -1;
+    if(meta.exists && meta.size != 0) {
+        ret = shrink_sub_objects(striper, soid, &meta.layout, meta.size, 0);
+        if(ret != 0) return ret;
+    }
+    ret = striped_io(striper, soid, &meta.layout, (char*)buf, len, 0, 1);
+    if(ret != 0) return ret;
+    return write_meta(striper, soid, &meta, len);
+}
+
+int mobject_striper_append(mobject_striper_t striper,
+                           const char *soid,
+                           const char *buf,
+                           size_t len)
+{
+    striper_meta_t meta;
+    int ret;
+
+    if(read_meta(striper, soid, &meta) != 0) return -1;
+    ret = striped_io(striper, soid, &meta.layout, (char*)buf, len, meta.size, 1);
+    if(ret != 0) return ret;
+    return write_meta(striper, soid, &meta, meta.size + len);
+}
+
+int mobject_striper_read(mobject_striper_t striper,
+                         const char *soid,
+                         char *buf,
+                         size_t len,
+                         uint64_t off)
+{
+    striper_meta_t meta;
+    int ret;
+
+    if(read_meta(striper, soid, &meta) != 0 || !meta.exists) return -1;
+    if(off >= meta.size) return 0;
+    if(len > meta.size - off) len = meta.size - off;
+    ret = striped_io(striper, soid, &meta.layout, buf, len, off, 0);
+    if(ret != 0) return ret;
+    return (int)len;
+}
+
+int mobject_striper_stat(mobject_striper_t striper,
+                         const char *soid,
+                         uint64_t *psize,
+                         time_t *pmtime)
+{
+    striper_meta_t meta;
+
+    if(read_meta(striper, soid, &meta) != 0 || !meta.exists) return -1;
+    if(psize)  *psize  = meta.size;
+    if(pmtime) *pmtime = meta.mtime;
+    return 0;
+}
+
+int mobject_striper_trunc(mobject_striper_t striper,
+                          const char *soid,
+                          uint64_t size)
+{
+    striper_meta_t meta;
+    int ret;
+
+    if(read_meta(striper, soid, &meta) != 0 || !meta.exists) return -1;
+    if(size < meta.size) {
+        ret = shrink_sub_objects(striper, soid, &meta.layout, meta.size, size);
+        if(ret != 0) return ret;
+    }
+    return write_meta(striper, soid, &meta, size);
+}
+
+int mobject_striper_remove(mobject_striper_t striper,
+                           const char *soid)
+{
+    striper_meta_t meta;
+    char name[1024];
+    int ret;
+
+    if(read_meta(striper, soid, &meta) != 0 || !meta.exists) return -1;
+    ret = shrink_sub_objects(striper, soid, &meta.layout, meta.size, 0);
+    if(ret != 0) return ret;
+
+    /* the first sub-object goes last, since it holds the metadata */
+    sub_object_name(name, sizeof(name), soid, 0);
+    mobject_store_write_op_t write_op = mobject_store_create_write_op();
+    mobject_store_write_op_remove(write_op);
+    ret = mobject_store_write_op_operate(write_op, striper->ioctx, name, NULL, LIBMOBJECT_OPERATION_NOFLAG);
+    mobject_store_release_write_op(write_op);
+    return ret;
+}
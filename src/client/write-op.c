@@ -9,6 +9,8 @@
 #include "mobject-store-config.h"
 #include "libmobject-store.h"
 #include "src/io-chain/write-op-impl.h"
+#include "src/io-chain/prepare-write-op.h"
+#include "src/client/mobject-client-impl.h"
 #include "src/client/aio/completion.h"
 #include "src/util/utlist.h"
 #include "src/util/log.h"
@@ -60,6 +62,32 @@ void mobject_write_op_write(mobject_store_write_op_t write_op,
 	write_op->num_actions += 1;
 }
 
+void mobject_write_op_writev(mobject_store_write_op_t write_op,
+                             const struct iovec *iov,
+                             int iovcnt,
+                             uint64_t offset)
+{
+	MOBJECT_ASSERT(write_op != MOBJECT_WRITE_OP_NULL, "invalid mobject_store_write_op_t obect");
+	MOBJECT_ASSERT(!(write_op->ready), "can't modify a write_op that is ready to be processed");
+	MOBJECT_ASSERT(iovcnt > 0, "writev needs at least one segment");
+
+	int i;
+	wr_action_write_t action  = (wr_action_write_t)calloc(1, sizeof(*action)+(iovcnt-1)*sizeof(struct iovec));
+	action->base.type         = WRITE_OPCODE_WRITE;
+	action->buffer.as_pointer = NULL;
+	action->offset            = offset;
+	action->iovcnt            = iovcnt;
+	for(i = 0; i < iovcnt; i++) {
+		action->iov[i] = iov[i];
+		action->len   += iov[i].iov_len;
+	}
+
+	WRITE_ACTION_UPCAST(base, action);
+	DL_APPEND(write_op->actions, base);
+
+	write_op->num_actions += 1;
+}
+
 void mobject_write_op_write_full(mobject_store_write_op_t write_op,
                                        const char *buffer,
                                        size_t len)
@@ -274,3 +302,93 @@ void mobject_write_op_omap_rm_keys(mobject_store_write_op_t write_op,
 
 	write_op->num_actions += 1;
 }
+
+int mobject_write_op_prepare(mobject_client_t client,
+                             mobject_store_write_op_t write_op)
+{
+	MOBJECT_ASSERT(write_op != MOBJECT_WRITE_OP_NULL, "invalid mobject_store_write_op_t obect");
+	return prepare_write_op(client->mid, &client->buffer_finder, write_op);
+}
+
+/* length registered for the data of action index of a prepared write_op */
+static uint64_t registered_length(mobject_store_write_op_t write_op, unsigned index)
+{
+	if(!write_op->bulk_lengths) return 0;
+	return write_op->bulk_lengths[index];
+}
+
+/* length of the data a vector write gathers from its segments */
+static uint64_t iov_length(wr_action_write_t action)
+{
+	uint64_t len = 0;
+	size_t i;
+	for(i = 0; i < action->iovcnt; i++)
+		len += action->iov[i].iov_len;
+	return len;
+}
+
+int mobject_write_op_update(mobject_store_write_op_t write_op,
+                            unsigned index,
+                            uint64_t offset,
+                            size_t len)
+{
+	MOBJECT_ASSERT(write_op != MOBJECT_WRITE_OP_NULL, "invalid mobject_store_write_op_t obect");
+
+	wr_action_base_t action = write_op->actions;
+	unsigned i;
+	for(i = 0; i < index && action; i++)
+		action = action->next;
+	if(!action) {
+		fprintf(stderr, "[MOBJECT] mobject_write_op_update: no action %u in write_op\n", index);
+		return -1;
+	}
+
+	switch(action->type) {
+	case WRITE_OPCODE_WRITE: {
+		wr_action_write_t a = (wr_action_write_t)action;
+		if(write_op->ready && len > registered_length(write_op, index))
+			break;
+		if(!write_op->ready && a->iovcnt && len > iov_length(a))
+			break;
+		a->offset = offset;
+		a->len    = len;
+		return 0;
+	}
+	case WRITE_OPCODE_WRITE_FULL: {
+		wr_action_write_full_t a = (wr_action_write_full_t)action;
+		if(write_op->ready && len > registered_length(write_op, index))
+			break;
+		a->len = len;
+		return 0;
+	}
+	case WRITE_OPCODE_APPEND: {
+		wr_action_append_t a = (wr_action_append_t)action;
+		if(write_op->ready && len > registered_length(write_op, index))
+			break;
+		a->len = len;
+		return 0;
+	}
+	case WRITE_OPCODE_WRITE_SAME: {
+		wr_action_write_same_t a = (wr_action_write_same_t)action;
+		a->offset    = offset;
+		a->write_len = len;
+		return 0;
+	}
+	case WRITE_OPCODE_ZERO: {
+		wr_action_zero_t a = (wr_action_zero_t)action;
+		a->offset = offset;
+		a->len    = len;
+		return 0;
+	}
+	case WRITE_OPCODE_TRUNCATE: {
+		wr_action_truncate_t a = (wr_action_truncate_t)action;
+		a->offset = offset;
+		return 0;
+	}
+	default:
+		break;
+	}
+
+	fprintf(stderr, "[MOBJECT] mobject_write_op_update: action %u can't be updated this way\n", index);
+	return -1;
+}
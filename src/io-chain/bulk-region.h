@@ -0,0 +1,45 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MOBJECT_BULK_REGION_H
+#define __MOBJECT_BULK_REGION_H
+
+#include <margo.h>
+
+/**
+ * Lets prepare_write_op and prepare_read_op find out whether the buffers
+ * of an operation lie in memory that is already registered. find returns
+ * the bulk handle of the registered region containing [ptr, ptr+len) and
+ * sets *offset to the position of ptr in it, or HG_BULK_NULL if the buffer
+ * is not in a registered region.
+ */
+typedef struct bulk_region_finder {
+	hg_bulk_t (*find)(void* arg, const void* ptr, size_t len, uint64_t* offset);
+	void*     arg;
+} bulk_region_finder_t;
+
+/**
+ * Returns the bulk handle of the region containing all the count buffers
+ * (pointers[i], lengths[i]), filling positions with their offsets in it,
+ * or HG_BULK_NULL if they are not all in the same registered region.
+ */
+static inline hg_bulk_t bulk_region_find_all(const bulk_region_finder_t* finder,
+                                             void** pointers,
+                                             const size_t* lengths,
+                                             uint32_t count,
+                                             uint64_t* positions)
+{
+	hg_bulk_t bulk = HG_BULK_NULL;
+	uint32_t i;
+	if(!finder || !finder->find || count == 0) return HG_BULK_NULL;
+	for(i = 0; i < count; i++) {
+		hg_bulk_t b = finder->find(finder->arg, pointers[i], lengths[i], positions+i);
+		if(b == HG_BULK_NULL || (i > 0 && b != bulk)) return HG_BULK_NULL;
+		bulk = b;
+	}
+	return bulk;
+}
+
+#endif
@@ -8,64 +8,221 @@
 #include "src/util/utlist.h"
 #include "src/util/log.h"
 
-static void prepare_read(uint64_t* cur_offset,
-                          rd_action_read_t action,
-                          void** ptr,
-                          size_t* len);
+static size_t count_segments(mobject_store_read_op_t read_op,
+                             int* vectored);
 
-void prepare_read_op(margo_instance_id mid, mobject_store_read_op_t read_op) 
+static uint32_t prepare_read(uint64_t* cur_offset,
+                             rd_action_read_t action,
+                             void** ptr,
+                             size_t* len);
+
+int prepare_read_op(margo_instance_id mid,
+                    const bulk_region_finder_t* finder,
+                    mobject_store_read_op_t read_op) 
 {
-	if(read_op->ready == 1) return;
+	if(read_op->ready == 1) return 0;
 	if(read_op->num_actions == 0) {
 		read_op->ready = 1;
-		return;
+		return 0;
 	}
 
 	rd_action_base_t action;
 
-	void** pointers = (void**)calloc(read_op->num_actions, sizeof(void*));
-	size_t* lengths = (size_t*)calloc(read_op->num_actions, sizeof(size_t));
+	int vectored = 0;
+	size_t num_segments = count_segments(read_op, &vectored);
+	void** pointers = (void**)calloc(num_segments, sizeof(void*));
+	size_t* lengths = (size_t*)calloc(num_segments, sizeof(size_t));
+	uint64_t* positions = (uint64_t*)calloc(num_segments, sizeof(uint64_t));
 	uint64_t current_offset = 0;
-	size_t i = 0;
+	size_t i = 0, j = 0, k, n;
+	int r = 0;
 
 	DL_FOREACH(read_op->actions, action) {
 
 		switch(action->type) {
 		case READ_OPCODE_READ:
-			prepare_read(&current_offset, 
+			i += prepare_read(&current_offset, 
 				(rd_action_read_t)action, pointers+i, lengths+i);
-			i += 1;
 			break;
 		}	
 	}
 
 	uint32_t count = i;
-	if(count != 0) {
+	/* the segments of a vector read must follow each other in the
+	   bulk handle, which they generally don't in a buffer pool */
+	hg_bulk_t region = vectored ? HG_BULK_NULL :
+		bulk_region_find_all(finder, pointers, lengths, count, positions);
+	if(region != HG_BULK_NULL) {
+		read_op->bulk_handle   = region;
+		read_op->bulk_borrowed = 1;
+	} else if(count != 0) {
 		hg_return_t ret = margo_bulk_create(mid, count,
     						pointers, lengths, HG_BULK_WRITE_ONLY, 
 							&(read_op->bulk_handle));
-		// TODO handle error
+		if(ret != HG_SUCCESS) {
+			fprintf(stderr, "[MOBJECT] margo_bulk_create() failed in prepare_read_op()\n");
+			read_op->bulk_handle = HG_BULK_NULL;
+			r = -1;
+		}
+	}
 
+	/* record the length registered for each read, and
+	   move them to their position in the region if any */
+	if(count != 0) {
+		read_op->bulk_lengths = (uint64_t*)calloc(read_op->num_actions, sizeof(uint64_t));
+		i = 0;
+		DL_FOREACH(read_op->actions, action) {
+			if(action->type == READ_OPCODE_READ) {
+				rd_action_read_t a = (rd_action_read_t)action;
+				if(read_op->bulk_borrowed)
+					a->buffer.as_offset = positions[i];
+				n = a->iovcnt ? a->iovcnt : 1;
+				for(k = 0; k < n; k++)
+					read_op->bulk_lengths[j] += lengths[i+k];
+				i += n;
+			}
+			j += 1;
+		}
 	}
 
 	read_op->ready = 1;
 
 	free(pointers);
 	free(lengths);
+	free(positions);
+	return r;
+}
+
+int prepare_read_op_batch(margo_instance_id mid,
+                          mobject_store_read_op_t* read_ops,
+                          size_t num_ops,
+                          hg_bulk_t* bulk_handle,
+                          uint64_t* bulk_size,
+                          void*** buffers)
+{
+	size_t i, num_segments = 0;
+	uint32_t count = 0;
+	uint64_t current_offset = 0;
+	rd_action_base_t action;
+	int vectored;
+
+	*bulk_handle = HG_BULK_NULL;
+	*bulk_size   = 0;
+	*buffers     = NULL;
+
+	for(i = 0; i < num_ops; i++) {
+		if(read_ops[i]->ready) {
+			fprintf(stderr, "[MOBJECT] prepare_read_op_batch: read_op %zu already prepared\n", i);
+			return -1;
+		}
+		num_segments += count_segments(read_ops[i], &vectored);
+	}
+
+	void** pointers = (void**)calloc(num_segments + 1, sizeof(void*));
+	size_t* lengths = (size_t*)calloc(num_segments + 1, sizeof(size_t));
+
+	for(i = 0; i < num_ops; i++) {
+		DL_FOREACH(read_ops[i]->actions, action) {
+			if(action->type == READ_OPCODE_READ) {
+				count += prepare_read(&current_offset,
+					(rd_action_read_t)action, pointers+count, lengths+count);
+			}
+		}
+		read_ops[i]->ready = 1;
+	}
+
+	int r = 0;
+	if(count != 0) {
+		hg_return_t ret = margo_bulk_create(mid, count,
+							pointers, lengths, HG_BULK_WRITE_ONLY,
+							bulk_handle);
+		if(ret != HG_SUCCESS) {
+			fprintf(stderr, "[MOBJECT] margo_bulk_create() failed in prepare_read_op_batch()\n");
+			r = -1;
+		}
+	}
+	*bulk_size = current_offset;
+
+	free(lengths);
+	if(r != 0) {
+		*bulk_handle = HG_BULK_NULL;
+		unprepare_read_op_batch(read_ops, num_ops, pointers);
+	} else {
+		*buffers = pointers;
+	}
+	return r;
+}
+
+void unprepare_read_op_batch(mobject_store_read_op_t* read_ops,
+                             size_t num_ops,
+                             void** buffers)
+{
+	rd_action_base_t action;
+	size_t i, k = 0;
+
+	for(i = 0; i < num_ops; i++) {
+		DL_FOREACH(read_ops[i]->actions, action) {
+			if(action->type != READ_OPCODE_READ) continue;
+			rd_action_read_t a = (rd_action_read_t)action;
+			/* the data of a vector read goes to its iovec */
+			if(a->iovcnt) {
+				k += a->iovcnt;
+				a->buffer.as_pointer = NULL;
+			} else {
+				a->buffer.as_pointer = (const char*)buffers[k++];
+			}
+		}
+		read_ops[i]->ready = 0;
+	}
+	free(buffers);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //                          STATIC FUNCTIONS BELOW                            //
 ////////////////////////////////////////////////////////////////////////////////
 
-static void prepare_read(uint64_t* cur_offset,
-                          rd_action_read_t action,
-                          void** ptr,
-                          size_t* len)
+/* returns the number of buffers to register for the
+   actions, setting *vectored if some come from an iovec */
+static size_t count_segments(mobject_store_read_op_t read_op,
+                             int* vectored)
+{
+	rd_action_base_t action;
+	size_t n = 0;
+
+	*vectored = 0;
+	DL_FOREACH(read_op->actions, action) {
+		if(action->type == READ_OPCODE_READ
+		&& ((rd_action_read_t)action)->iovcnt != 0) {
+			n += ((rd_action_read_t)action)->iovcnt;
+			*vectored = 1;
+		} else {
+			n += 1;
+		}
+	}
+	return n;
+}
+
+static uint32_t prepare_read(uint64_t* cur_offset,
+                             rd_action_read_t action,
+                             void** ptr,
+                             size_t* len)
 {
 	uint64_t pos = *cur_offset;
-	*cur_offset += action->len;
-	*ptr         = (void*)action->buffer.as_pointer;
-	*len         = action->len;
+	size_t i;
+	if(action->iovcnt == 0) {
+		*cur_offset += action->len;
+		*ptr         = (void*)action->buffer.as_pointer;
+		*len         = action->len;
+		action->buffer.as_offset = pos;
+		return 1;
+	}
+	/* the segments are exposed one after the other, the
+	   server sees them as a single range of the bulk handle */
+	for(i = 0; i < action->iovcnt; i++) {
+		ptr[i]       = action->iov[i].iov_base;
+		len[i]       = action->iov[i].iov_len;
+		*cur_offset += action->iov[i].iov_len;
+	}
 	action->buffer.as_offset = pos;
+	return action->iovcnt;
 }
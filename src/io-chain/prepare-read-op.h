@@ -8,14 +8,49 @@
 
 #include <margo.h>
 #include "libmobject-store.h"
+#include "src/io-chain/bulk-region.h"
 
 /**
  * This function takes a read_op that was created by the client
  * and prepares it to be sent to a server. This means creating a bulk
  * handle that stiches together all the buffers that the user wants to use
  * as a destination, and replacing all pointers in the chain of actions
- * by offsets within the resulting hg_bultk_t object.
+ * by offsets within the resulting hg_bultk_t object. A read_op that is
+ * already prepared keeps its bulk handle, so it can be sent again.
+ * If finder is not NULL and all the buffers lie in the same registered
+ * region, the read_op borrows the bulk handle of that region instead
+ * of registering its buffers.
+ *
+ * @return 0 on success, -1 if the bulk handle could not be created
  */
-void prepare_read_op(margo_instance_id mid, mobject_store_read_op_t read_op);
+int prepare_read_op(margo_instance_id mid,
+                    const bulk_region_finder_t* finder,
+                    mobject_store_read_op_t read_op);
+
+/**
+ * Prepares num_ops read_ops to be sent together to a server. A single
+ * bulk handle is created for the buffers of all the read_ops, and the
+ * pointers are replaced by positions in this bulk handle. The read_ops
+ * keep a null bulk handle; once the batch is processed, they must be
+ * given to unprepare_read_op_batch along with *buffers. Returns 0 on
+ * success, -1 on failure (e.g. if one of the read_ops has already been
+ * prepared), the read_ops being then unchanged.
+ */
+int prepare_read_op_batch(margo_instance_id mid,
+                          mobject_store_read_op_t* read_ops,
+                          size_t num_ops,
+                          hg_bulk_t* bulk_handle,
+                          uint64_t* bulk_size,
+                          void*** buffers);
+
+/**
+ * Gives the read_ops of a processed batch their buffers back, from the
+ * buffers set by prepare_read_op_batch, which are freed. The read_ops
+ * are no longer ready: they can be modified, and sent again in a batch
+ * or on their own.
+ */
+void unprepare_read_op_batch(mobject_store_read_op_t* read_ops,
+                             size_t num_ops,
+                             void** buffers);
 
 #endif
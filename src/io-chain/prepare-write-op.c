@@ -8,10 +8,22 @@
 #include "src/util/utlist.h"
 #include "src/util/log.h"
 
-static void convert_write(uint64_t* cur_offset,
-                          wr_action_write_t action,
-                          void** ptr,
-                          size_t* len);
+static uint32_t convert_write_op(mobject_store_write_op_t write_op,
+                                 uint64_t* cur_offset,
+                                 void** pointers,
+                                 size_t* lengths);
+
+static size_t count_segments(mobject_store_write_op_t write_op,
+                             int* vectored);
+
+static void place_write_op(mobject_store_write_op_t write_op,
+                           const uint64_t* positions,
+                           const size_t* lengths);
+
+static uint32_t convert_write(uint64_t* cur_offset,
+                              wr_action_write_t action,
+                              void** ptr,
+                              size_t* len);
 
 static void convert_write_full(uint64_t* cur_offset,
                                wr_action_write_full_t action,
@@ -28,73 +40,280 @@ static void convert_append(uint64_t* cur_offset,
                            void** ptr,
                            size_t* len);
 
-void prepare_write_op(margo_instance_id mid, mobject_store_write_op_t write_op) 
+int prepare_write_op(margo_instance_id mid,
+                     const bulk_region_finder_t* finder,
+                     mobject_store_write_op_t write_op) 
 {
-	if(write_op->ready == 1) return;
+	if(write_op->ready == 1) return 0;
 	if(write_op->num_actions == 0) {
 		write_op->ready = 1;
-		return;
+		return 0;
 	}	
 
-	wr_action_base_t action;
+	int vectored = 0;
+	size_t num_segments = count_segments(write_op, &vectored);
+	void** pointers = (void**)calloc(num_segments, sizeof(void*));
+	size_t* lengths = (size_t*)calloc(num_segments, sizeof(size_t));
+	uint64_t* positions = (uint64_t*)calloc(num_segments, sizeof(uint64_t));
+	uint64_t current_offset = 0;
+	int r = 0;
+
+	uint32_t count = convert_write_op(write_op, &current_offset, pointers, lengths);
+	/* the segments of a vector write must follow each other in the bulk
+	   handle, which they generally don't in a region of a buffer pool */
+	hg_bulk_t region = vectored ? HG_BULK_NULL :
+		bulk_region_find_all(finder, pointers, lengths, count, positions);
+	if(region != HG_BULK_NULL) {
+		write_op->bulk_handle   = region;
+		write_op->bulk_borrowed = 1;
+		place_write_op(write_op, positions, lengths);
+	} else if(count != 0) {
+		hg_return_t ret = margo_bulk_create(mid, count,
+    						pointers, lengths, HG_BULK_READ_ONLY, 
+							&(write_op->bulk_handle));
+		if(ret != HG_SUCCESS) {
+			fprintf(stderr, "[MOBJECT] margo_bulk_create() failed in prepare_write_op()\n");
+			write_op->bulk_handle = HG_BULK_NULL;
+			r = -1;
+		}
+		place_write_op(write_op, NULL, lengths);
+	}
 
-	void** pointers = (void**)calloc(write_op->num_actions, sizeof(void*));
-	size_t* lengths = (size_t*)calloc(write_op->num_actions, sizeof(size_t));
+	write_op->ready = 1;
+
+	free(pointers);
+	free(lengths);
+	free(positions);
+	return r;
+}
+
+int prepare_write_op_batch(margo_instance_id mid,
+                           mobject_store_write_op_t* write_ops,
+                           size_t num_ops,
+                           uint64_t* bulk_offsets,
+                           hg_bulk_t* bulk_handle,
+                           uint64_t* bulk_size,
+                           void*** buffers)
+{
+	size_t i, num_segments = 0;
+	uint32_t count = 0;
 	uint64_t current_offset = 0;
+	int vectored;
+
+	*bulk_handle = HG_BULK_NULL;
+	*bulk_size   = 0;
+	*buffers     = NULL;
+
+	for(i = 0; i < num_ops; i++) {
+		if(write_ops[i]->ready) {
+			fprintf(stderr, "[MOBJECT] prepare_write_op_batch: write_op %zu already prepared\n", i);
+			return -1;
+		}
+		num_segments += count_segments(write_ops[i], &vectored);
+	}
+
+	void** pointers = (void**)calloc(num_segments + 1, sizeof(void*));
+	size_t* lengths = (size_t*)calloc(num_segments + 1, sizeof(size_t));
+
+	for(i = 0; i < num_ops; i++) {
+		uint64_t op_offset = 0;
+		bulk_offsets[i] = current_offset;
+		count += convert_write_op(write_ops[i], &op_offset,
+				pointers + count, lengths + count);
+		current_offset += op_offset;
+		write_ops[i]->ready = 1;
+	}
+
+	int r = 0;
+	if(count != 0) {
+		hg_return_t ret = margo_bulk_create(mid, count,
+							pointers, lengths, HG_BULK_READ_ONLY,
+							bulk_handle);
+		if(ret != HG_SUCCESS) {
+			fprintf(stderr, "[MOBJECT] margo_bulk_create() failed in prepare_write_op_batch()\n");
+			r = -1;
+		}
+	}
+	*bulk_size = current_offset;
+
+	free(lengths);
+	if(r != 0) {
+		*bulk_handle = HG_BULK_NULL;
+		unprepare_write_op_batch(write_ops, num_ops, pointers);
+	} else {
+		*buffers = pointers;
+	}
+	return r;
+}
+
+void unprepare_write_op_batch(mobject_store_write_op_t* write_ops,
+                              size_t num_ops,
+                              void** buffers)
+{
+	wr_action_base_t action;
+	buffer_u* buffer;
+	size_t i, k = 0;
+
+	for(i = 0; i < num_ops; i++) {
+		DL_FOREACH(write_ops[i]->actions, action) {
+			switch(action->type) {
+			case WRITE_OPCODE_WRITE:
+				buffer = &((wr_action_write_t)action)->buffer;
+				break;
+			case WRITE_OPCODE_WRITE_FULL:
+				buffer = &((wr_action_write_full_t)action)->buffer;
+				break;
+			case WRITE_OPCODE_WRITE_SAME:
+				buffer = &((wr_action_write_same_t)action)->buffer;
+				break;
+			case WRITE_OPCODE_APPEND:
+				buffer = &((wr_action_append_t)action)->buffer;
+				break;
+			default:
+				buffer = NULL;
+			}
+			if(!buffer) continue;
+			/* the data of a vector write stays in its iovec */
+			if(action->type == WRITE_OPCODE_WRITE && ((wr_action_write_t)action)->iovcnt) {
+				k += ((wr_action_write_t)action)->iovcnt;
+				buffer->as_pointer = NULL;
+			} else {
+				buffer->as_pointer = (const char*)buffers[k++];
+			}
+		}
+		write_ops[i]->ready = 0;
+	}
+	free(buffers);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                          STATIC FUNCTIONS BELOW                            //
+////////////////////////////////////////////////////////////////////////////////
+
+/* converts the pointers of the actions into positions starting at
+   *cur_offset, storing them in pointers/lengths; returns their number */
+static uint32_t convert_write_op(mobject_store_write_op_t write_op,
+                                 uint64_t* cur_offset,
+                                 void** pointers,
+                                 size_t* lengths)
+{
+	wr_action_base_t action;
 	size_t i = 0;
 
 	DL_FOREACH(write_op->actions, action) {
 
 		switch(action->type) {
 		case WRITE_OPCODE_WRITE:
-			convert_write(&current_offset, 
+			i += convert_write(cur_offset, 
 				(wr_action_write_t)action, pointers+i, lengths+i);
-			i += 1;
 			break;
 		case WRITE_OPCODE_WRITE_FULL:
-			convert_write_full(&current_offset,
+			convert_write_full(cur_offset,
 				(wr_action_write_full_t)action, pointers+i, lengths+i);
 			i += 1;
 			break;
 		case WRITE_OPCODE_WRITE_SAME:
-			convert_write_same(&current_offset, 
+			convert_write_same(cur_offset, 
 				(wr_action_write_same_t)action, pointers+i, lengths+i);
 			i += 1;
 			break;
 		case WRITE_OPCODE_APPEND:
-			convert_append(&current_offset, 
+			convert_append(cur_offset, 
 				(wr_action_append_t)action, pointers+i, lengths+i);
 			i += 1;
 			break;
 		}	
 	}
+	return i;
+}
 
-	uint32_t count = i;
-	if(count != 0) {
-		hg_return_t ret = margo_bulk_create(mid, count,
-    						pointers, lengths, HG_BULK_READ_ONLY, 
-							&(write_op->bulk_handle));
-		// TODO handle error
+/* returns the number of buffers to register for the
+   actions, setting *vectored if some come from an iovec */
+static size_t count_segments(mobject_store_write_op_t write_op,
+                             int* vectored)
+{
+	wr_action_base_t action;
+	size_t n = 0;
 
+	*vectored = 0;
+	DL_FOREACH(write_op->actions, action) {
+		if(action->type == WRITE_OPCODE_WRITE
+		&& ((wr_action_write_t)action)->iovcnt != 0) {
+			n += ((wr_action_write_t)action)->iovcnt;
+			*vectored = 1;
+		} else {
+			n += 1;
+		}
 	}
-
-	write_op->ready = 1;
+	return n;
 }
 
-////////////////////////////////////////////////////////////////////////////////
-//                          STATIC FUNCTIONS BELOW                            //
-////////////////////////////////////////////////////////////////////////////////
+/* records the length registered for the data of each action, moving
+   the data to the given positions in the bulk handle if not NULL */
+static void place_write_op(mobject_store_write_op_t write_op,
+                           const uint64_t* positions,
+                           const size_t* lengths)
+{
+	wr_action_base_t action;
+	buffer_u* buffer;
+	size_t i = 0, j = 0, k, n;
+
+	write_op->bulk_lengths = (uint64_t*)calloc(write_op->num_actions, sizeof(uint64_t));
 
-static void convert_write(uint64_t* cur_offset,
-                          wr_action_write_t action,
-                          void** ptr,
-                          size_t* len)
+	DL_FOREACH(write_op->actions, action) {
+
+		switch(action->type) {
+		case WRITE_OPCODE_WRITE:
+			buffer = &((wr_action_write_t)action)->buffer;
+			break;
+		case WRITE_OPCODE_WRITE_FULL:
+			buffer = &((wr_action_write_full_t)action)->buffer;
+			break;
+		case WRITE_OPCODE_WRITE_SAME:
+			buffer = &((wr_action_write_same_t)action)->buffer;
+			break;
+		case WRITE_OPCODE_APPEND:
+			buffer = &((wr_action_append_t)action)->buffer;
+			break;
+		default:
+			buffer = NULL;
+		}
+		if(buffer) {
+			n = 1;
+			if(action->type == WRITE_OPCODE_WRITE && ((wr_action_write_t)action)->iovcnt)
+				n = ((wr_action_write_t)action)->iovcnt;
+			if(positions) buffer->as_offset = positions[i];
+			for(k = 0; k < n; k++)
+				write_op->bulk_lengths[j] += lengths[i+k];
+			i += n;
+		}
+		j += 1;
+	}
+}
+
+static uint32_t convert_write(uint64_t* cur_offset,
+                              wr_action_write_t action,
+                              void** ptr,
+                              size_t* len)
 {
 	uint64_t pos = *cur_offset;
-	*cur_offset += action->len;
-	*ptr         = (void*)action->buffer.as_pointer;
-	*len         = action->len;
+	size_t i;
+	if(action->iovcnt == 0) {
+		*cur_offset += action->len;
+		*ptr         = (void*)action->buffer.as_pointer;
+		*len         = action->len;
+		action->buffer.as_offset = pos;
+		return 1;
+	}
+	/* the segments are exposed one after the other,
+	   the data of the action being their concatenation */
+	for(i = 0; i < action->iovcnt; i++) {
+		ptr[i]       = action->iov[i].iov_base;
+		len[i]       = action->iov[i].iov_len;
+		*cur_offset += action->iov[i].iov_len;
+	}
 	action->buffer.as_offset = pos;
+	return action->iovcnt;
 }
 
 static void convert_write_full(uint64_t* cur_offset,
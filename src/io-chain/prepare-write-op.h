@@ -8,14 +8,53 @@
 
 #include <margo.h>
 #include "libmobject-store.h"
+#include "src/io-chain/bulk-region.h"
 
 /**
- * This function takes a read_op that was created by the client
+ * This function takes a write_op that was created by the client
  * and prepares it to be sent to a server. This means creating a bulk
  * handle that stiches together all the buffers that the user wants to use
- * as a destination, and replacing all pointers in the chain of actions
- * by offsets within the resulting hg_bultk_t object.
+ * as a source, and replacing all pointers in the chain of actions
+ * by offsets within the resulting hg_bultk_t object. A write_op that is
+ * already prepared keeps its bulk handle, so it can be sent again.
+ * If finder is not NULL and all the buffers lie in the same registered
+ * region, the write_op borrows the bulk handle of that region instead
+ * of registering its buffers.
+ *
+ * @return 0 on success, -1 if the bulk handle could not be created
  */
-void prepare_write_op(margo_instance_id mid, mobject_store_write_op_t write_op);
+int prepare_write_op(margo_instance_id mid,
+                     const bulk_region_finder_t* finder,
+                     mobject_store_write_op_t write_op);
+
+/**
+ * Prepares a batch of write_ops to be sent together: a single bulk
+ * handle exposes the buffers of all of them, the data of write_ops[i]
+ * starting at bulk_offsets[i] (the offsets in the actions of write_ops[i]
+ * are relative to bulk_offsets[i]). The write_ops are made ready but do not
+ * own the bulk handle, which the caller must free once the batch has
+ * been processed, and must then be given to unprepare_write_op_batch
+ * along with *buffers. None of the write_ops must have been prepared
+ * before.
+ *
+ * @return 0 on success, -1 on failure (the write_ops are then unchanged)
+ */
+int prepare_write_op_batch(margo_instance_id mid,
+                           mobject_store_write_op_t* write_ops,
+                           size_t num_ops,
+                           uint64_t* bulk_offsets,
+                           hg_bulk_t* bulk_handle,
+                           uint64_t* bulk_size,
+                           void*** buffers);
+
+/**
+ * Gives the write_ops of a processed batch their buffers back, from
+ * the buffers set by prepare_write_op_batch, which are freed. The
+ * write_ops are no longer ready: they can be modified, and sent again
+ * in a batch or on their own.
+ */
+void unprepare_write_op_batch(mobject_store_write_op_t* write_ops,
+                              size_t num_ops,
+                              void** buffers);
 
 #endif
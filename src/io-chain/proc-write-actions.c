@@ -246,7 +246,7 @@ static hg_return_t encode_write_action_write(hg_proc_t proc,
                                              wr_action_write_t action)
 {
 	args_wr_action_write a;
-	a.buffer_position = *pos;
+	a.buffer_position = action->buffer.as_offset;
 	a.len             = action->len;
 	a.offset          = action->offset;
 	*pos             += action->len;
@@ -263,7 +263,7 @@ static hg_return_t decode_write_action_write(hg_proc_t proc,
 	if(ret != HG_SUCCESS) return ret;
 
 	*action = (wr_action_write_t)calloc(1, sizeof(**action));
-	(*action)->buffer.as_offset = *pos;
+	(*action)->buffer.as_offset = a.buffer_position;
 	(*action)->len              = a.len;
 	(*action)->offset           = a.offset;
 	*pos                       += a.len;
@@ -276,7 +276,7 @@ static hg_return_t encode_write_action_write_full(hg_proc_t proc,
                                                   wr_action_write_full_t action)
 {
 	args_wr_action_write_full a;
-	a.buffer_position = *pos;
+	a.buffer_position = action->buffer.as_offset;
 	a.len             = action->len;
 	*pos             += action->len;
 	return hg_proc_memcpy(proc, &a, sizeof(a));
@@ -292,7 +292,7 @@ static hg_return_t decode_write_action_write_full(hg_proc_t proc,
 	if(ret != HG_SUCCESS) return ret;
 
 	*action = (wr_action_write_full_t)calloc(1, sizeof(**action));
-	(*action)->buffer.as_offset = *pos;
+	(*action)->buffer.as_offset = a.buffer_position;
 	(*action)->len       = a.len;
 	*pos                += a.len;
 
@@ -304,7 +304,7 @@ static hg_return_t encode_write_action_write_same(hg_proc_t proc,
                                                   wr_action_write_same_t action)
 {
 	args_wr_action_write_same a;
-	a.buffer_position = *pos;
+	a.buffer_position = action->buffer.as_offset;
 	a.data_len        = action->data_len;
 	a.write_len       = action->write_len;
 	a.offset          = action->offset;
@@ -322,7 +322,7 @@ static hg_return_t decode_write_action_write_same(hg_proc_t proc,
 	if(ret != HG_SUCCESS) return ret;
 
 	*action = (wr_action_write_same_t)calloc(1, sizeof(**action));
-	(*action)->buffer.as_offset = *pos;
+	(*action)->buffer.as_offset = a.buffer_position;
 	(*action)->data_len         = a.data_len;
 	(*action)->write_len        = a.write_len;
 	(*action)->offset           = a.offset;
@@ -336,7 +336,7 @@ static hg_return_t encode_write_action_append(hg_proc_t proc,
                                               wr_action_append_t action)
 {
 	args_wr_action_append a;
-	a.buffer_position = *pos;
+	a.buffer_position = action->buffer.as_offset;
 	a.len             = action->len;
 	*pos             += action->len;
 	return hg_proc_memcpy(proc, &a, sizeof(a));
@@ -352,7 +352,7 @@ static hg_return_t decode_write_action_append(hg_proc_t proc,
 	if(ret != HG_SUCCESS) return ret;
 	
 	*action = (wr_action_append_t)calloc(1, sizeof(**action));
-	(*action)->buffer.as_offset = *pos;
+	(*action)->buffer.as_offset = a.buffer_position;
 	(*action)->len              = a.len;
 	*pos                       += a.len;
 
@@ -6,6 +6,7 @@
 #ifndef __MOBJECT_READ_OPCODES_H
 #define __MOBJECT_READ_OPCODES_H
 
+#include <sys/uio.h>
 #include "mobject-store-config.h"
 #include "libmobject-store.h"
 #include "src/util/buffer-union.h"
@@ -49,7 +50,12 @@ typedef struct rd_action_READ {
 	buffer_u              buffer;
 	size_t*               bytes_read;
 	int*                  prval;
+	size_t                iovcnt;
+	struct iovec          iov[1];
 }* rd_action_read_t;
+// on the client side, a read may scatter its data into iovcnt
+// segments in iov instead of buffer (iovcnt is then non-zero),
+// see wr_action_WRITE.
 
 typedef struct rd_action_OMAP_GET_KEYS {
 	struct rd_action_BASE base;
@@ -19,6 +19,8 @@ mobject_store_read_op_t create_read_op(void)
 	MOBJECT_ASSERT(read_op != MOBJECT_READ_OP_NULL, "Could not allocate read_op");
 	read_op->actions     = (rd_action_base_t)0;
 	read_op->bulk_handle = HG_BULK_NULL;
+	read_op->bulk_borrowed = 0;
+	read_op->bulk_lengths  = NULL;
 	read_op->ready       = 0;
 	return read_op;
 }
@@ -26,6 +28,9 @@ mobject_store_read_op_t create_read_op(void)
 void release_read_op(mobject_store_read_op_t read_op)
 {
 	if(read_op == MOBJECT_READ_OP_NULL) return;
+
+	if(read_op->bulk_handle != HG_BULK_NULL && !read_op->bulk_borrowed)
+		margo_bulk_free(read_op->bulk_handle);
 	
 	rd_action_base_t action, tmp;
 
@@ -34,5 +39,6 @@ void release_read_op(mobject_store_read_op_t read_op)
 		free(action);
 	}
 
+	free(read_op->bulk_lengths);
 	free(read_op);
 }
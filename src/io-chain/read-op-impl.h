@@ -22,6 +22,8 @@
 struct mobject_store_read_op {
 	int              ready;
 	hg_bulk_t        bulk_handle;
+	int              bulk_borrowed; // bulk_handle belongs to a buffer pool
+	uint64_t*        bulk_lengths;  // per action, length registered by prepare_read_op
 	size_t           num_actions;
 	rd_action_base_t actions;
 };
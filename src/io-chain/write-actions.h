@@ -6,6 +6,7 @@
 #ifndef __MOBJECT_WRITE_OPCODES_H
 #define __MOBJECT_WRITE_OPCODES_H
 
+#include <sys/uio.h>
 #include "mobject-store-config.h"
 #include "src/util/buffer-union.h"
 
@@ -49,7 +50,14 @@ typedef struct wr_action_WRITE {
 	buffer_u              buffer;
 	size_t                len;
 	uint64_t              offset;
+	size_t                iovcnt;
+	struct iovec          iov[1];
 }* wr_action_write_t;
+// on the client side, a write may gather its data from iovcnt
+// segments in iov instead of buffer (iovcnt is then non-zero).
+// The segments are registered in the bulk handle one after the
+// other, so that once prepared the write is sent as a single
+// contiguous range of the bulk handle.
 
 typedef struct wr_action_WRITE_FULL {
 	struct wr_action_BASE base;
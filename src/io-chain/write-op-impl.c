@@ -19,6 +19,8 @@ mobject_store_write_op_t create_write_op(void)
 	MOBJECT_ASSERT(write_op != MOBJECT_WRITE_OP_NULL, "Could not allocate write_op");
 	write_op->actions     = (wr_action_base_t)0;
 	write_op->bulk_handle = HG_BULK_NULL;
+	write_op->bulk_borrowed = 0;
+	write_op->bulk_lengths  = NULL;
 	write_op->num_actions = 0;
 	write_op->ready       = 0;
 	return write_op;
@@ -28,7 +30,7 @@ void release_write_op(mobject_store_write_op_t write_op)
 {
 	if(write_op == MOBJECT_WRITE_OP_NULL) return;
 
-	if(write_op->bulk_handle != HG_BULK_NULL) 
+	if(write_op->bulk_handle != HG_BULK_NULL && !write_op->bulk_borrowed) 
 		margo_bulk_free(write_op->bulk_handle);
 	
 	wr_action_base_t action, tmp;
@@ -38,5 +40,6 @@ void release_write_op(mobject_store_write_op_t write_op)
 		free(action);
 	}
 
+	free(write_op->bulk_lengths);
 	free(write_op);
 }
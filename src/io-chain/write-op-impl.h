@@ -36,6 +36,9 @@ struct mobject_store_write_op {
 	int              ready;        // whether the unions in the actions are 
 	                               // to be interpreted as offsets in bulk handles
 	hg_bulk_t        bulk_handle;  // bulk handle exposing the data
+	int              bulk_borrowed; // whether bulk_handle belongs to a buffer pool
+	uint64_t*        bulk_lengths; // per action, length of the data registered
+	                               // when prepared (NULL if not prepared alone)
 	size_t           num_actions;  // number of action in the linked-list bellow
 	wr_action_base_t actions;      // list of actions
 };
@@ -0,0 +1,26 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __RPC_TYPE_MIGRATE_H
+#define __RPC_TYPE_MIGRATE_H
+
+#include <mercury.h>
+#include <mercury_macros.h>
+#include <mercury_proc_string.h>
+
+/* A migration message exposes, through bulk_handle, a buffer made of
+ * a metadata part of meta_size bytes (header, segment descriptors, data
+ * of small segments and omap entries, see core-migrate.cpp) followed by
+ * the content of the bake regions of the migrated segments. */
+MERCURY_GEN_PROC(migrate_in_t,
+    ((hg_const_string_t)(sender_addr))\
+    ((hg_const_string_t)(object_name))\
+    ((hg_bulk_t)(bulk_handle))\
+    ((uint64_t)(meta_size))\
+    ((uint64_t)(total_size)))
+
+MERCURY_GEN_PROC(migrate_out_t, ((int32_t)(ret)))
+
+#endif
@@ -22,4 +22,91 @@ MERCURY_GEN_PROC(read_op_in_t,
 
 MERCURY_GEN_PROC(read_op_out_t, ((read_response_t)(responses)))
 
+/* Output of a read_op forwarded to the previous owner of its object.
+ * found is 0 if that server does not have the object (it was migrated
+ * and removed, or created after the membership change), in which case
+ * the read_op was not executed and the forwarding server executes it. */
+MERCURY_GEN_PROC(forward_read_op_out_t,
+    ((int32_t)(found))\
+    ((read_response_t)(responses)))
+
+/* A batch of read_ops on objects of the same pool, sent to the server
+ * responsible for all the objects. The buffers of all the read_ops are
+ * exposed by a single bulk handle of bulk_size bytes, the read_ops having
+ * been prepared with prepare_read_op_batch so that their offsets are
+ * positions in this bulk handle. */
+typedef struct {
+    hg_const_string_t        client_addr;
+    hg_const_string_t        pool_name;
+    hg_bulk_t                bulk_handle;
+    uint64_t                 bulk_size;
+    uint32_t                 count;
+    hg_const_string_t*       object_names;
+    mobject_store_read_op_t* read_ops;
+} read_op_batch_in_t;
+
+static inline hg_return_t hg_proc_read_op_batch_in_t(hg_proc_t proc, void* data)
+{
+    read_op_batch_in_t* in = (read_op_batch_in_t*)data;
+    hg_return_t ret;
+    uint32_t i;
+
+    ret = hg_proc_hg_const_string_t(proc, &in->client_addr);
+    if(ret != HG_SUCCESS) return ret;
+    ret = hg_proc_hg_const_string_t(proc, &in->pool_name);
+    if(ret != HG_SUCCESS) return ret;
+    ret = hg_proc_hg_bulk_t(proc, &in->bulk_handle);
+    if(ret != HG_SUCCESS) return ret;
+    ret = hg_proc_uint64_t(proc, &in->bulk_size);
+    if(ret != HG_SUCCESS) return ret;
+    ret = hg_proc_uint32_t(proc, &in->count);
+    if(ret != HG_SUCCESS) return ret;
+
+    if(hg_proc_get_op(proc) == HG_DECODE) {
+        in->object_names = (hg_const_string_t*)calloc(in->count, sizeof(hg_const_string_t));
+        in->read_ops     = (mobject_store_read_op_t*)calloc(in->count, sizeof(mobject_store_read_op_t));
+    }
+
+    for(i = 0; i < in->count; i++) {
+        ret = hg_proc_hg_const_string_t(proc, &in->object_names[i]);
+        if(ret != HG_SUCCESS) return ret;
+        ret = hg_proc_mobject_store_read_op_t(proc, &in->read_ops[i]);
+        if(ret != HG_SUCCESS) return ret;
+    }
+
+    if(hg_proc_get_op(proc) == HG_FREE) {
+        free(in->object_names);
+        free(in->read_ops);
+    }
+    return HG_SUCCESS;
+}
+
+/* The responses to the read_ops of a batch, in the same order. */
+typedef struct {
+    uint32_t         count;
+    read_response_t* responses;
+} read_op_batch_out_t;
+
+static inline hg_return_t hg_proc_read_op_batch_out_t(hg_proc_t proc, void* data)
+{
+    read_op_batch_out_t* out = (read_op_batch_out_t*)data;
+    hg_return_t ret;
+    uint32_t i;
+
+    ret = hg_proc_uint32_t(proc, &out->count);
+    if(ret != HG_SUCCESS) return ret;
+
+    if(hg_proc_get_op(proc) == HG_DECODE)
+        out->responses = (read_response_t*)calloc(out->count, sizeof(read_response_t));
+
+    for(i = 0; i < out->count; i++) {
+        ret = hg_proc_read_response_t(proc, &out->responses[i]);
+        if(ret != HG_SUCCESS) return ret;
+    }
+
+    if(hg_proc_get_op(proc) == HG_FREE)
+        free(out->responses);
+    return HG_SUCCESS;
+}
+
 #endif
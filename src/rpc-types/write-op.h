@@ -18,8 +18,76 @@ MERCURY_GEN_PROC(write_op_in_t,
     ((hg_const_string_t)(client_addr))\
     ((hg_const_string_t)(pool_name))\
 	((hg_const_string_t)(object_name))\
-	((mobject_store_write_op_t)(write_op)))
+	((mobject_store_write_op_t)(write_op))\
+    ((uint32_t)(flags)))
 
-MERCURY_GEN_PROC(write_op_out_t, ((int32_t)(ret)))
+/* safe_seq is 0 if the write was persisted before the reply, otherwise
+ * it is the ticket to pass to a write_safe RPC to find out when it is */
+MERCURY_GEN_PROC(write_op_out_t,
+    ((int32_t)(ret))\
+    ((uint64_t)(safe_seq)))
+
+/* Waits for a write acknowledged before being persisted */
+MERCURY_GEN_PROC(write_safe_in_t, ((uint64_t)(seq)))
+
+MERCURY_GEN_PROC(write_safe_out_t, ((int32_t)(ret)))
+
+/* A batch of write_ops on objects of the same pool, sent to the server
+ * responsible for all the objects. The data of all the write_ops is
+ * exposed by a single bulk handle, the data of write_ops[i] starting
+ * at bulk_offsets[i]. The write_ops must have been prepared with
+ * prepare_write_op_batch. */
+typedef struct {
+    hg_const_string_t         client_addr;
+    hg_const_string_t         pool_name;
+    hg_bulk_t                 bulk_handle;
+    uint64_t                  bulk_size;
+    uint32_t                  count;
+    hg_const_string_t*        object_names;
+    uint64_t*                 bulk_offsets;
+    mobject_store_write_op_t* write_ops;
+} write_op_batch_in_t;
+
+static inline hg_return_t hg_proc_write_op_batch_in_t(hg_proc_t proc, void* data)
+{
+    write_op_batch_in_t* in = (write_op_batch_in_t*)data;
+    hg_return_t ret;
+    uint32_t i;
+
+    ret = hg_proc_hg_const_string_t(proc, &in->client_addr);
+    if(ret != HG_SUCCESS) return ret;
+    ret = hg_proc_hg_const_string_t(proc, &in->pool_name);
+    if(ret != HG_SUCCESS) return ret;
+    ret = hg_proc_hg_bulk_t(proc, &in->bulk_handle);
+    if(ret != HG_SUCCESS) return ret;
+    ret = hg_proc_uint64_t(proc, &in->bulk_size);
+    if(ret != HG_SUCCESS) return ret;
+    ret = hg_proc_uint32_t(proc, &in->count);
+    if(ret != HG_SUCCESS) return ret;
+
+    if(hg_proc_get_op(proc) == HG_DECODE) {
+        in->object_names = (hg_const_string_t*)calloc(in->count, sizeof(hg_const_string_t));
+        in->bulk_offsets = (uint64_t*)calloc(in->count, sizeof(uint64_t));
+        in->write_ops    = (mobject_store_write_op_t*)calloc(in->count, sizeof(mobject_store_write_op_t));
+    }
+
+    for(i = 0; i < in->count; i++) {
+        ret = hg_proc_hg_const_string_t(proc, &in->object_names[i]);
+        if(ret != HG_SUCCESS) return ret;
+        ret = hg_proc_uint64_t(proc, &in->bulk_offsets[i]);
+        if(ret != HG_SUCCESS) return ret;
+        ret = hg_proc_mobject_store_write_op_t(proc, &in->write_ops[i]);
+        if(ret != HG_SUCCESS) return ret;
+    }
+
+    if(hg_proc_get_op(proc) == HG_FREE) {
+        free(in->object_names);
+        free(in->bulk_offsets);
+        free(in->write_ops);
+    }
+    return HG_SUCCESS;
+}
+
+MERCURY_GEN_PROC(write_op_batch_out_t, ((int32_t)(ret)))
 
 #endif
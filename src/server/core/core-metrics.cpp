@@ -0,0 +1,402 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <time.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <atomic>
+#include <string>
+#include <symbiomon/symbiomon-server.h>
+#include "src/server/core/core-metrics.h"
+
+/* number of per-xstream slots, xstreams of higher rank share them */
+#define METRICS_SLOTS 32
+/* latency buckets: [0,1us), [1,2us), [2,4us), ..., [2^22us, +inf) */
+#define METRICS_BUCKETS 24
+
+static const char* op_names[CORE_NUM_OPS] = {
+    "create", "write", "write_full", "writesame", "append", "remove",
+    "truncate", "zero", "omap_set", "omap_rm_keys", "stat", "read",
+    "omap_get_keys", "omap_get_vals", "omap_get_vals_by_keys"
+};
+
+static const char* call_names[CORE_NUM_CALLS] = { "sdskv", "bake" };
+
+struct alignas(64) metrics_slot {
+    std::atomic<uint64_t> op_count[CORE_NUM_OPS];
+    std::atomic<uint64_t> op_time[CORE_NUM_OPS];   /* nanoseconds */
+    std::atomic<uint64_t> op_hist[CORE_NUM_OPS][METRICS_BUCKETS];
+    std::atomic<uint64_t> bytes_in;
+    std::atomic<uint64_t> bytes_out;
+    std::atomic<uint64_t> call_count[CORE_NUM_CALLS];
+    std::atomic<uint64_t> call_time[CORE_NUM_CALLS]; /* nanoseconds */
+    std::atomic<uint64_t> cache_hits;
+    std::atomic<uint64_t> cache_misses;
+};
+
+/* sum of the slots at some point in time */
+struct metrics_totals {
+    uint64_t op_count[CORE_NUM_OPS];
+    uint64_t op_time[CORE_NUM_OPS];
+    uint64_t op_hist[CORE_NUM_OPS][METRICS_BUCKETS];
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t call_count[CORE_NUM_CALLS];
+    uint64_t call_time[CORE_NUM_CALLS];
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+};
+
+struct core_metrics {
+    metrics_slot*        slots;
+    /* publication, only touched by the publishing ULT once started */
+    symbiomon_provider_t provider;
+    symbiomon_taglist_t  taglist;
+    symbiomon_metric_t   op_count[CORE_NUM_OPS];
+    symbiomon_metric_t   op_latency[CORE_NUM_OPS];
+    symbiomon_metric_t   op_hist[CORE_NUM_OPS][METRICS_BUCKETS]; /* created once non-zero */
+    symbiomon_metric_t   bytes_in;
+    symbiomon_metric_t   bytes_out;
+    symbiomon_metric_t   call_count[CORE_NUM_CALLS];
+    symbiomon_metric_t   call_time[CORE_NUM_CALLS];
+    symbiomon_metric_t   cache_hit_ratio;
+    metrics_totals       last;     /* totals of the previous publication */
+    double               interval; /* milliseconds */
+    ABT_thread           thread;
+    ABT_mutex            mutex;
+    ABT_cond             cond;     /* signaled to stop the ULT */
+    bool                 stop;
+};
+
+static inline metrics_slot* my_slot(core_metrics* m)
+{
+    int rank;
+    if(ABT_xstream_self_rank(&rank) != ABT_SUCCESS || rank < 0) rank = 0;
+    return &m->slots[rank % METRICS_SLOTS];
+}
+
+static inline void add(std::atomic<uint64_t>& c, uint64_t v)
+{
+    c.fetch_add(v, std::memory_order_relaxed);
+}
+
+static inline uint64_t elapsed_ns(double start)
+{
+    double t = ABT_get_wtime() - start;
+    return t > 0 ? (uint64_t)(t*1e9) : 0;
+}
+
+/* index of the bucket of a latency given in nanoseconds */
+static inline int bucket_of(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    int b = 0;
+    while(us && b < METRICS_BUCKETS-1) {
+        us >>= 1;
+        b += 1;
+    }
+    return b;
+}
+
+/* upper bound of a bucket in microseconds */
+static inline unsigned long long bucket_bound(int b)
+{
+    return 1ULL << b;
+}
+
+static void sum_slots(core_metrics* m, metrics_totals* t)
+{
+    memset(t, 0, sizeof(*t));
+    for(int s = 0; s < METRICS_SLOTS; s++) {
+        metrics_slot& slot = m->slots[s];
+        for(int i = 0; i < CORE_NUM_OPS; i++) {
+            t->op_count[i] += slot.op_count[i].load(std::memory_order_relaxed);
+            t->op_time[i]  += slot.op_time[i].load(std::memory_order_relaxed);
+            for(int b = 0; b < METRICS_BUCKETS; b++)
+                t->op_hist[i][b] += slot.op_hist[i][b].load(std::memory_order_relaxed);
+        }
+        t->bytes_in  += slot.bytes_in.load(std::memory_order_relaxed);
+        t->bytes_out += slot.bytes_out.load(std::memory_order_relaxed);
+        for(int i = 0; i < CORE_NUM_CALLS; i++) {
+            t->call_count[i] += slot.call_count[i].load(std::memory_order_relaxed);
+            t->call_time[i]  += slot.call_time[i].load(std::memory_order_relaxed);
+        }
+        t->cache_hits   += slot.cache_hits.load(std::memory_order_relaxed);
+        t->cache_misses += slot.cache_misses.load(std::memory_order_relaxed);
+    }
+}
+
+extern "C" void core_metrics_init(struct mobject_server_context* srv_ctx)
+{
+    const char* interval = getenv(MOBJECT_METRICS_INTERVAL_ENV);
+    void* slots = NULL;
+
+    srv_ctx->metrics = NULL;
+    if(posix_memalign(&slots, alignof(metrics_slot), METRICS_SLOTS*sizeof(metrics_slot)) != 0) {
+        fprintf(stderr, "core_metrics_init: could not allocate counters, metrics are disabled\n");
+        return;
+    }
+    auto m = new core_metrics;
+    m->slots = static_cast<metrics_slot*>(slots);
+    for(int s = 0; s < METRICS_SLOTS; s++)
+        new (&m->slots[s]) metrics_slot(); /* zero-initialized */
+    m->provider = NULL;
+    m->taglist  = NULL;
+    memset(&m->last, 0, sizeof(m->last));
+    m->interval = interval ? atof(interval) : MOBJECT_METRICS_INTERVAL_DEFAULT;
+    if(m->interval <= 0) m->interval = MOBJECT_METRICS_INTERVAL_DEFAULT;
+    m->thread = ABT_THREAD_NULL;
+    m->stop   = false;
+    ABT_mutex_create(&m->mutex);
+    ABT_cond_create(&m->cond);
+    srv_ctx->metrics = m;
+}
+
+extern "C" void core_metrics_op(struct mobject_server_context* srv_ctx, core_op_t op,
+        double start, size_t bytes_in, size_t bytes_out)
+{
+    auto m = srv_ctx->metrics;
+    if(!m) return;
+    metrics_slot* slot = my_slot(m);
+    uint64_t ns = elapsed_ns(start);
+    add(slot->op_count[op], 1);
+    add(slot->op_time[op], ns);
+    add(slot->op_hist[op][bucket_of(ns)], 1);
+    if(bytes_in)  add(slot->bytes_in, bytes_in);
+    if(bytes_out) add(slot->bytes_out, bytes_out);
+}
+
+extern "C" void core_metrics_call(struct mobject_server_context* srv_ctx, core_call_t call,
+        double start)
+{
+    auto m = srv_ctx->metrics;
+    if(!m) return;
+    metrics_slot* slot = my_slot(m);
+    add(slot->call_count[call], 1);
+    add(slot->call_time[call], elapsed_ns(start));
+}
+
+extern "C" void core_metrics_cache(struct mobject_server_context* srv_ctx, int hit)
+{
+    auto m = srv_ctx->metrics;
+    if(!m) return;
+    if(hit) add(my_slot(m)->cache_hits, 1);
+    else    add(my_slot(m)->cache_misses, 1);
+}
+
+static int create_metric(core_metrics* m, const std::string& name,
+        symbiomon_metric_type_t type, const std::string& desc, symbiomon_metric_t* metric)
+{
+    int ret = symbiomon_metric_create("mobject", name.c_str(), type, desc.c_str(),
+            m->taglist, metric, m->provider);
+    if(ret != 0) {
+        fprintf(stderr, "core_metrics_publish: could not create metric %s (ret = %d)\n",
+                name.c_str(), ret);
+        *metric = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void update_metrics(core_metrics* m)
+{
+    metrics_totals t;
+    sum_slots(m, &t);
+
+    for(int i = 0; i < CORE_NUM_OPS; i++) {
+        uint64_t count = t.op_count[i] - m->last.op_count[i];
+        if(count == 0) continue;
+        symbiomon_metric_update(m->op_count[i], (double)t.op_count[i]);
+        /* average latency over the last interval */
+        symbiomon_metric_update(m->op_latency[i],
+                (t.op_time[i] - m->last.op_time[i])*1e-9/count);
+        for(int b = 0; b < METRICS_BUCKETS; b++) {
+            if(t.op_hist[i][b] == m->last.op_hist[i][b]) continue;
+            if(!m->op_hist[i][b]) {
+                std::string name = std::string(op_names[i]) + "_latency_";
+                std::string desc = std::string("Number of ") + op_names[i] + " actions taking ";
+                if(b == METRICS_BUCKETS-1) {
+                    name += "inf";
+                    desc += "at least " + std::to_string(bucket_bound(b-1)) + " microseconds";
+                } else {
+                    name += "lt_" + std::to_string(bucket_bound(b)) + "us";
+                    desc += "less than " + std::to_string(bucket_bound(b)) + " microseconds";
+                }
+                if(create_metric(m, name, SYMBIOMON_TYPE_COUNTER, desc, &m->op_hist[i][b]) != 0)
+                    continue;
+            }
+            symbiomon_metric_update(m->op_hist[i][b], (double)t.op_hist[i][b]);
+        }
+    }
+    if(t.bytes_in != m->last.bytes_in)
+        symbiomon_metric_update(m->bytes_in, (double)t.bytes_in);
+    if(t.bytes_out != m->last.bytes_out)
+        symbiomon_metric_update(m->bytes_out, (double)t.bytes_out);
+    for(int i = 0; i < CORE_NUM_CALLS; i++) {
+        if(t.call_count[i] == m->last.call_count[i]) continue;
+        symbiomon_metric_update(m->call_count[i], (double)t.call_count[i]);
+        symbiomon_metric_update(m->call_time[i], t.call_time[i]*1e-9);
+    }
+    if(t.cache_hits != m->last.cache_hits || t.cache_misses != m->last.cache_misses)
+        symbiomon_metric_update(m->cache_hit_ratio,
+                (double)t.cache_hits/(t.cache_hits + t.cache_misses));
+    m->last = t;
+}
+
+static void publish_ult(void* arg)
+{
+    auto m = static_cast<core_metrics*>(arg);
+
+    ABT_mutex_lock(m->mutex);
+    while(!m->stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec  += (time_t)(m->interval/1000.0);
+        deadline.tv_nsec += (long)((m->interval - 1000.0*(time_t)(m->interval/1000.0))*1000000.0);
+        deadline.tv_sec  += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        ABT_cond_timedwait(m->cond, m->mutex, &deadline);
+        if(m->stop) break;
+        ABT_mutex_unlock(m->mutex);
+        update_metrics(m);
+        ABT_mutex_lock(m->mutex);
+    }
+    ABT_mutex_unlock(m->mutex);
+}
+
+extern "C" int core_metrics_publish(struct mobject_server_context* srv_ctx,
+        struct symbiomon_provider* metric_provider)
+{
+    auto m = srv_ctx->metrics;
+    if(!m) {
+        fprintf(stderr, "core_metrics_publish: metrics are disabled\n");
+        return -1;
+    }
+    if(m->provider) {
+        fprintf(stderr, "core_metrics_publish: metrics are already published\n");
+        return -1;
+    }
+
+    std::string tag = "provider:" + std::to_string(srv_ctx->provider_id);
+    int ret = symbiomon_taglist_create(&m->taglist, 1, tag.c_str());
+    if(ret != 0) {
+        fprintf(stderr, "core_metrics_publish: could not create taglist (ret = %d)\n", ret);
+        return -1;
+    }
+    m->provider = metric_provider;
+    memset(m->op_count, 0, sizeof(m->op_count));
+    memset(m->op_latency, 0, sizeof(m->op_latency));
+    memset(m->op_hist, 0, sizeof(m->op_hist));
+
+    ret = 0;
+    for(int i = 0; i < CORE_NUM_OPS && ret == 0; i++) {
+        ret = create_metric(m, std::string(op_names[i]) + "_count", SYMBIOMON_TYPE_COUNTER,
+                std::string("Number of ") + op_names[i] + " actions", &m->op_count[i]);
+        if(ret == 0)
+            ret = create_metric(m, std::string(op_names[i]) + "_latency", SYMBIOMON_TYPE_TIMER,
+                    std::string("Average time of ") + op_names[i] + " actions in seconds",
+                    &m->op_latency[i]);
+    }
+    if(ret == 0)
+        ret = create_metric(m, "bytes_in", SYMBIOMON_TYPE_COUNTER,
+                "Bytes written by clients", &m->bytes_in);
+    if(ret == 0)
+        ret = create_metric(m, "bytes_out", SYMBIOMON_TYPE_COUNTER,
+                "Bytes read by clients", &m->bytes_out);
+    for(int i = 0; i < CORE_NUM_CALLS && ret == 0; i++) {
+        ret = create_metric(m, std::string(call_names[i]) + "_calls", SYMBIOMON_TYPE_COUNTER,
+                std::string("Number of calls to ") + call_names[i], &m->call_count[i]);
+        if(ret == 0)
+            ret = create_metric(m, std::string(call_names[i]) + "_time", SYMBIOMON_TYPE_COUNTER,
+                    std::string("Time spent in calls to ") + call_names[i] + " in seconds",
+                    &m->call_time[i]);
+    }
+    if(ret == 0)
+        ret = create_metric(m, "oid_cache_hit_ratio", SYMBIOMON_TYPE_GAUGE,
+                "Fraction of name lookups served by the oid cache", &m->cache_hit_ratio);
+    if(ret == 0)
+        ret = ABT_thread_create(srv_ctx->pool, publish_ult, m,
+                ABT_THREAD_ATTR_NULL, &m->thread) == ABT_SUCCESS ? 0 : -1;
+    if(ret != 0) {
+        m->thread = ABT_THREAD_NULL;
+        fprintf(stderr, "core_metrics_publish: could not start publishing metrics\n");
+        return -1;
+    }
+    return 0;
+}
+
+extern "C" void core_metrics_finalize(struct mobject_server_context* srv_ctx)
+{
+    auto m = srv_ctx->metrics;
+    if(!m) return;
+
+    if(m->thread != ABT_THREAD_NULL) {
+        ABT_mutex_lock(m->mutex);
+        m->stop = true;
+        ABT_cond_signal(m->cond);
+        ABT_mutex_unlock(m->mutex);
+        ABT_thread_join(m->thread);
+        ABT_thread_free(&m->thread);
+    }
+    if(m->provider) {
+        symbiomon_metric_t* metrics[] = {
+            &m->op_count[0], &m->op_latency[0], &m->op_hist[0][0],
+            &m->bytes_in, &m->bytes_out, &m->call_count[0], &m->call_time[0],
+            &m->cache_hit_ratio
+        };
+        size_t counts[] = {
+            CORE_NUM_OPS, CORE_NUM_OPS, CORE_NUM_OPS*METRICS_BUCKETS,
+            1, 1, CORE_NUM_CALLS, CORE_NUM_CALLS, 1
+        };
+        for(size_t i = 0; i < sizeof(counts)/sizeof(counts[0]); i++)
+            for(size_t j = 0; j < counts[i]; j++)
+                if(metrics[i][j]) symbiomon_metric_destroy(metrics[i][j], m->provider);
+        symbiomon_taglist_destroy(m->taglist);
+    }
+    ABT_cond_free(&m->cond);
+    ABT_mutex_free(&m->mutex);
+    free(m->slots);
+    delete m;
+    srv_ctx->metrics = NULL;
+}
+
+/* smallest bucket bound under which a fraction p of the actions fall */
+static unsigned long long percentile(const uint64_t* hist, uint64_t count, double p)
+{
+    uint64_t seen = 0;
+    for(int b = 0; b < METRICS_BUCKETS-1; b++) {
+        seen += hist[b];
+        if(seen >= p*count) return bucket_bound(b);
+    }
+    return bucket_bound(METRICS_BUCKETS-1);
+}
+
+extern "C" void core_metrics_print(struct mobject_server_context* srv_ctx, FILE* out)
+{
+    auto m = srv_ctx->metrics;
+    if(!m) return;
+    metrics_totals t;
+    sum_slots(m, &t);
+
+    fprintf(out, "\tActions:\n");
+    for(int i = 0; i < CORE_NUM_OPS; i++) {
+        if(t.op_count[i] == 0) continue;
+        fprintf(out, "\t\t%s: %lu, avg %.1lf us, p50 < %llu us, p99 < %llu us\n",
+                op_names[i], (unsigned long)t.op_count[i],
+                t.op_time[i]*1e-3/t.op_count[i],
+                percentile(t.op_hist[i], t.op_count[i], 0.5),
+                percentile(t.op_hist[i], t.op_count[i], 0.99));
+    }
+    fprintf(out, "\tBytes in: %lu, bytes out: %lu\n",
+            (unsigned long)t.bytes_in, (unsigned long)t.bytes_out);
+    for(int i = 0; i < CORE_NUM_CALLS; i++)
+        fprintf(out, "\tCalls to %s: %lu, %.4lf s\n", call_names[i],
+                (unsigned long)t.call_count[i], t.call_time[i]*1e-9);
+    if(t.cache_hits + t.cache_misses)
+        fprintf(out, "\tOid cache hit ratio: %.3lf (%lu lookups)\n",
+                (double)t.cache_hits/(t.cache_hits + t.cache_misses),
+                (unsigned long)(t.cache_hits + t.cache_misses));
+}
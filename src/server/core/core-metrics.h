@@ -0,0 +1,101 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __CORE_METRICS_H
+#define __CORE_METRICS_H
+
+#include <stdio.h>
+#include "src/server/mobject-server-context.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct symbiomon_provider;
+
+/* actions of read_ops and write_ops, counted and timed separately */
+typedef enum {
+    CORE_OP_CREATE,
+    CORE_OP_WRITE,
+    CORE_OP_WRITE_FULL,
+    CORE_OP_WRITESAME,
+    CORE_OP_APPEND,
+    CORE_OP_REMOVE,
+    CORE_OP_TRUNCATE,
+    CORE_OP_ZERO,
+    CORE_OP_OMAP_SET,
+    CORE_OP_OMAP_RM_KEYS,
+    CORE_OP_STAT,
+    CORE_OP_READ,
+    CORE_OP_OMAP_GET_KEYS,
+    CORE_OP_OMAP_GET_VALS,
+    CORE_OP_OMAP_GET_VALS_BY_KEYS,
+    CORE_NUM_OPS
+} core_op_t;
+
+/* calls made to the backends while executing the actions */
+typedef enum {
+    CORE_CALL_KV,
+    CORE_CALL_BAKE,
+    CORE_NUM_CALLS
+} core_call_t;
+
+/**
+ * The provider counts the actions it executes by type, with their total
+ * time and a histogram of their latencies (power-of-two buckets of
+ * microseconds), the bytes written and read, the number and time of its
+ * calls to sdskv and bake, and the hits and misses of its oid cache.
+ * Counters are kept per xstream, in slots indexed by the rank of the
+ * xstream and updated with relaxed atomics, so that recording never
+ * takes a lock nor shares a cache line with the other xstreams.
+ *
+ * Once mobject_provider_set_symbiomon is called, a ULT sums up the
+ * slots every MOBJECT_METRICS_INTERVAL milliseconds and publishes the
+ * totals as SYMBIOMON metrics tagged with the provider id.
+ */
+void core_metrics_init(struct mobject_server_context* srv_ctx);
+
+void core_metrics_finalize(struct mobject_server_context* srv_ctx);
+
+/* records an action that started at start (from ABT_get_wtime) and
+   moved bytes_in bytes from the client or bytes_out bytes to it */
+void core_metrics_op(struct mobject_server_context* srv_ctx, core_op_t op,
+        double start, size_t bytes_in, size_t bytes_out);
+
+/* records a call to a backend that started at start */
+void core_metrics_call(struct mobject_server_context* srv_ctx, core_call_t call,
+        double start);
+
+/* records a lookup in the oid cache */
+void core_metrics_cache(struct mobject_server_context* srv_ctx, int hit);
+
+/* creates the SYMBIOMON metrics and starts the ULT publishing them */
+int core_metrics_publish(struct mobject_server_context* srv_ctx,
+        struct symbiomon_provider* metric_provider);
+
+/* prints the counters of each action type, the bytes moved,
+   the backend calls and the oid cache hit ratio */
+void core_metrics_print(struct mobject_server_context* srv_ctx, FILE* out);
+
+#ifdef __cplusplus
+}
+
+/* evaluates a call to a backend, counting it and its time:
+   ret = CORE_METERED(srv_ctx, CORE_CALL_KV, sdskv_get(...)); */
+template<typename F>
+static inline auto core_metered_call(struct mobject_server_context* srv_ctx,
+        core_call_t call, F f) -> decltype(f())
+{
+    double start = ABT_get_wtime();
+    auto ret = f();
+    core_metrics_call(srv_ctx, call, start);
+    return ret;
+}
+#define CORE_METERED(srv_ctx, call, expr) \
+    core_metered_call((srv_ctx), (call), [&]() { return (expr); })
+
+#endif
+
+#endif
@@ -0,0 +1,861 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <map>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <bake-client.h>
+#include "src/server/core/core-migrate.h"
+#include "src/server/core/core-write-op.h"
+#include "src/server/core/key-types.h"
+#include "src/rpc-types/migrate.h"
+#include "src/client/placement.h"
+
+#if 0
+static int tabs = 0;
+#define ENTERING {for(int i=0; i<tabs; i++) fprintf(stderr," "); fprintf(stderr,"[ENTERING]>> %s\n",__FUNCTION__); tabs += 1;}
+#define LEAVING  {tabs -= 1; for(int i=0; i<tabs; i++) fprintf(stderr," "); fprintf(stderr,"[LEAVING]<<< %s\n",__FUNCTION__); }
+#define ERROR    {for(int i=0; i<(tabs+1); i++) fprintf(stderr, " "); fprintf(stderr,"[ERROR] "); }
+#else
+#define ENTERING
+#define LEAVING
+#define ERROR
+#endif
+
+#define MAX_OBJECT_NAME_SIZE 1024
+#define MIGRATE_DEFAULT_BATCH_SIZE (16*1024*1024)
+#define MIGRATE_LIST_SIZE 64
+
+/* defined in core-write-op.cpp */
+oid_t get_or_create_oid(
+        sdskv_provider_handle_t ph,
+        sdskv_database_id_t name_db_id,
+        sdskv_database_id_t oid_db_id,
+        const char* object_name);
+
+int remove_object(
+        struct mobject_server_context *srv_ctx,
+        const char* object_name,
+        oid_t oid);
+
+/* The metadata part of a migration message is made of a migrate_header_t,
+   num_segments migrate_segment_t, small_size bytes of SMALL_REGION data,
+   and num_omap entries, each of which is a migrate_omap_t followed by the
+   key (null-terminated) and the value. The data of the BAKE_REGION segments
+   follows the metadata part in the bulk handle. A region larger than the
+   batch size is sent in slices, in as many messages, the first of which
+   (at region_offset 0) creates the region on the new owner. */
+struct migrate_header_t {
+    uint64_t num_segments;
+    uint64_t num_omap;
+    uint64_t small_size;
+    uint64_t complete;     // non-zero in the last message of the object
+};
+
+struct migrate_segment_t {
+    segment_key_t key;
+    uint64_t      data_offset;   // offset of the segment's data in the bulk handle
+    uint64_t      region_offset; // for BAKE_REGION segments, offset and size
+    uint64_t      region_size;   // of the slice of the region in this message
+};
+
+struct migrate_omap_t {
+    uint64_t key_size;
+    uint64_t val_size;
+};
+
+/* Objects of which the last migration message was received since the last
+   membership change. Until then, an object found in name_db may only be the
+   start of a migration, or a write received during it. */
+struct migrated_objects {
+    std::unordered_set<std::string> names;
+};
+
+/* Objects whose local copy is being removed after their migration, and
+   number of writes in progress on each object. Writes to an object being
+   removed wait for the removal, so that none is lost in between. */
+struct migration_guard {
+    ABT_mutex                            mutex;
+    ABT_cond                             cond;
+    std::unordered_set<std::string>      removing;
+    std::unordered_map<std::string, int> writing;
+};
+
+/* Part of an object accumulated until it is sent to its new owner. */
+class migration_message {
+
+    std::vector<migrate_segment_t> segments;
+    std::vector<char>              small_data;
+    std::vector<char>              omap_data;
+    std::vector<char>              bake_data;
+    uint64_t                       num_omap = 0;
+
+    public:
+
+    bool empty() const {
+        return segments.empty() && num_omap == 0;
+    }
+
+    size_t data_size() const {
+        return small_data.size() + omap_data.size() + bake_data.size();
+    }
+
+    void add_segment(const segment_key_t& key, const void* data, size_t len) {
+        // data_offset is relative to small_data until the message is sent
+        segments.push_back(migrate_segment_t{key, small_data.size(), 0, 0});
+        if(len) small_data.insert(small_data.end(), (const char*)data, (const char*)data + len);
+    }
+
+    char* add_bake_segment(const segment_key_t& key, uint64_t region_offset, size_t len) {
+        // data_offset is relative to bake_data until the message is sent
+        size_t offset = bake_data.size();
+        segments.push_back(migrate_segment_t{key, offset, region_offset, len});
+        bake_data.resize(offset + len);
+        return bake_data.data() + offset;
+    }
+
+    void add_omap(const char* key, const void* val, size_t val_size) {
+        migrate_omap_t entry = { strlen(key)+1, val_size };
+        const char* e = (const char*)&entry;
+        omap_data.insert(omap_data.end(), e, e + sizeof(entry));
+        omap_data.insert(omap_data.end(), key, key + entry.key_size);
+        omap_data.insert(omap_data.end(), (const char*)val, (const char*)val + val_size);
+        num_omap += 1;
+    }
+
+    int send(struct mobject_server_context* srv_ctx, const char* object_name,
+             hg_addr_t dest_addr, bool complete, size_t* bytes_sent);
+};
+
+int migration_message::send(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name,
+        hg_addr_t dest_addr,
+        bool complete,
+        size_t* bytes_sent)
+{
+    ENTERING;
+    margo_instance_id mid = srv_ctx->mid;
+    migrate_header_t header = { segments.size(), num_omap, small_data.size(), complete };
+    uint64_t small_base = sizeof(header) + segments.size()*sizeof(migrate_segment_t);
+    uint64_t meta_size  = small_base + small_data.size() + omap_data.size();
+    hg_return_t hret;
+    int ret = -1;
+
+    std::vector<char> meta(meta_size);
+    char* p = meta.data();
+    std::memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    for(auto seg : segments) {
+        seg.data_offset += seg.key.type == seg_type_t::BAKE_REGION ? meta_size : small_base;
+        std::memcpy(p, &seg, sizeof(seg));
+        p += sizeof(seg);
+    }
+    if(!small_data.empty()) std::memcpy(p, small_data.data(), small_data.size());
+    p += small_data.size();
+    if(!omap_data.empty()) std::memcpy(p, omap_data.data(), omap_data.size());
+
+    /* expose the metadata and the bake data without copying them together */
+    void*     buf_ptrs[2]  = { meta.data(), bake_data.data() };
+    hg_size_t buf_sizes[2] = { meta_size, bake_data.size() };
+    uint32_t  count = bake_data.empty() ? 1 : 2;
+    hg_bulk_t bulk;
+    hret = margo_bulk_create(mid, count, buf_ptrs, buf_sizes, HG_BULK_READ_ONLY, &bulk);
+    if(hret != HG_SUCCESS) {
+        ERROR fprintf(stderr, "margo_bulk_create returned %d\n", hret);
+        LEAVING;
+        return -1;
+    }
+
+    hg_handle_t h;
+    hret = margo_create(mid, dest_addr, srv_ctx->migrate_rpc_id, &h);
+    if(hret != HG_SUCCESS) {
+        ERROR fprintf(stderr, "margo_create returned %d\n", hret);
+        margo_bulk_free(bulk);
+        LEAVING;
+        return -1;
+    }
+
+    migrate_in_t in;
+    in.sender_addr = srv_ctx->self_addr_str;
+    in.object_name = object_name;
+    in.bulk_handle = bulk;
+    in.meta_size   = meta_size;
+    in.total_size  = meta_size + bake_data.size();
+
+    hret = margo_provider_forward(srv_ctx->provider_id, h, &in);
+    if(hret == HG_SUCCESS) {
+        migrate_out_t out;
+        hret = margo_get_output(h, &out);
+        if(hret == HG_SUCCESS) {
+            ret = out.ret;
+            margo_free_output(h, &out);
+        }
+    }
+    if(hret != HG_SUCCESS) {
+        ERROR fprintf(stderr, "migration of %s failed (hret = %d)\n", object_name, hret);
+    }
+
+    margo_destroy(h);
+    margo_bulk_free(bulk);
+
+    if(ret == 0) *bytes_sent += in.total_size;
+
+    segments.clear();
+    small_data.clear();
+    omap_data.clear();
+    bake_data.clear();
+    num_omap = 0;
+
+    LEAVING;
+    return ret;
+}
+
+/* Adds the segments of oid newer than since (all of them if since is NULL)
+   to msg, from the most recent to the oldest, sending msg whenever it holds
+   batch_size bytes. If newest is not NULL, it is set to the most recent
+   segment and *has_newest tells whether there was one. */
+static int migrate_segments(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name,
+        oid_t oid,
+        hg_addr_t dest_addr,
+        size_t batch_size,
+        const segment_key_t* since,
+        segment_key_t* newest,
+        bool* has_newest,
+        migration_message& msg,
+        size_t* bytes_sent)
+{
+    ENTERING;
+    sdskv_provider_handle_t sdskv_ph = srv_ctx->sdskv_ph;
+    bake_provider_handle_t bake_ph = srv_ctx->bake_ph;
+    int ret;
+
+    if(newest) *has_newest = false;
+
+    segment_key_t lb;
+    std::memset(&lb, 0, sizeof(lb));
+    lb.oid       = oid;
+    lb.timestamp = std::numeric_limits<time_t>::max();
+    lb.seq_id    = MOBJECT_SEQ_ID_MAX;
+
+    segment_key_t    segment_keys[MIGRATE_LIST_SIZE];
+    void*            segment_keys_addrs[MIGRATE_LIST_SIZE];
+    hg_size_t        segment_keys_size[MIGRATE_LIST_SIZE];
+    char             segment_data[MIGRATE_LIST_SIZE][sizeof(region_value_t)];
+    void*            segment_data_addrs[MIGRATE_LIST_SIZE];
+    hg_size_t        segment_data_size[MIGRATE_LIST_SIZE];
+    for(auto i = 0; i < MIGRATE_LIST_SIZE; i++) {
+        segment_keys_addrs[i] = (void*)(&segment_keys[i]);
+        segment_data_addrs[i] = (void*)(&segment_data[i][0]);
+    }
+
+    bool done = false;
+    bool first = true;
+    while(!done) {
+        size_t num_segments = MIGRATE_LIST_SIZE;
+        for(auto i = 0; i < MIGRATE_LIST_SIZE; i++) {
+            segment_keys_size[i] = sizeof(segment_key_t);
+            segment_data_size[i] = sizeof(region_value_t);
+        }
+        ret = sdskv_list_keyvals(sdskv_ph, srv_ctx->segment_db_id,
+                (const void*)&lb, sizeof(lb),
+                segment_keys_addrs, segment_keys_size,
+                segment_data_addrs, segment_data_size,
+                &num_segments);
+        if(ret != SDSKV_SUCCESS) {
+            ERROR fprintf(stderr, "sdskv_list_keyvals returned %d\n", ret);
+            LEAVING;
+            return -1;
+        }
+        for(size_t i = 0; i < num_segments; i++) {
+            const segment_key_t& seg = segment_keys[i];
+            if(seg.oid != oid
+            || (since && seg.timestamp == since->timestamp && seg.seq_id == since->seq_id)) {
+                done = true;
+                break;
+            }
+            /* the lower bound may be returned again */
+            if(!first && seg.timestamp == lb.timestamp && seg.seq_id == lb.seq_id)
+                continue;
+            lb = seg;
+            if(newest && !*has_newest) {
+                *newest = seg;
+                *has_newest = true;
+            }
+            if(seg.type == seg_type_t::BAKE_REGION) {
+                uint64_t len = seg.end_index - seg.start_index;
+                region_value_t region;
+                std::memcpy(&region, segment_data[i], sizeof(region));
+                bake_target_id_t bti = core_region_target(srv_ctx, &region, segment_data_size[i]);
+                /* regions are read in slices of at most batch_size bytes */
+                uint64_t offset = 0;
+                do {
+                    uint64_t part = std::min<uint64_t>(len - offset, batch_size);
+                    if(!msg.empty() && msg.data_size() + part > batch_size) {
+                        if(msg.send(srv_ctx, object_name, dest_addr, false, bytes_sent) != 0) {
+                            LEAVING;
+                            return -1;
+                        }
+                    }
+                    char* dst = msg.add_bake_segment(seg, offset, part);
+                    uint64_t bytes_read = 0;
+                    ret = bake_read(bake_ph, bti, region.region, offset, dst, part, &bytes_read);
+                    if(ret != BAKE_SUCCESS || bytes_read != part) {
+                        ERROR bake_perror("bake_read", ret);
+                        LEAVING;
+                        return -1;
+                    }
+                    offset += part;
+                } while(offset < len);
+            } else if(seg.type == seg_type_t::SMALL_REGION) {
+                msg.add_segment(seg, segment_data[i], seg.end_index - seg.start_index);
+            } else {
+                msg.add_segment(seg, nullptr, 0);
+                /* nothing older than a full truncation is visible */
+                if(seg.type == seg_type_t::TOMBSTONE && seg.start_index == 0) {
+                    done = true;
+                    break;
+                }
+            }
+        }
+        if(num_segments != MIGRATE_LIST_SIZE) done = true;
+        first = false;
+    }
+
+    LEAVING;
+    return 0;
+}
+
+/* Adds the omap entries of oid that are not in sent to msg, sending msg
+   whenever it holds batch_size bytes, and records their keys in sent. */
+static int migrate_omap(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name,
+        oid_t oid,
+        hg_addr_t dest_addr,
+        size_t batch_size,
+        std::map<std::string, std::vector<char>>& sent,
+        migration_message& msg,
+        size_t* bytes_sent)
+{
+    ENTERING;
+    sdskv_provider_handle_t sdskv_ph = srv_ctx->sdskv_ph;
+    hg_size_t key_len = MAX_OMAP_KEY_SIZE + sizeof(omap_key_t);
+    hg_size_t val_len = MAX_OMAP_VAL_SIZE;
+    std::vector<char> lb_buffer(key_len, 0);
+    omap_key_t* lb = (omap_key_t*)lb_buffer.data();
+    lb->oid = oid;
+    hg_size_t lb_size = sizeof(omap_key_t);
+    int ret;
+
+    std::vector<void*> keys(MIGRATE_LIST_SIZE);
+    std::vector<void*> vals(MIGRATE_LIST_SIZE);
+    std::vector<hg_size_t> ksizes(MIGRATE_LIST_SIZE);
+    std::vector<hg_size_t> vsizes(MIGRATE_LIST_SIZE);
+    std::vector<std::vector<char>> key_buffers(MIGRATE_LIST_SIZE, std::vector<char>(key_len));
+    std::vector<std::vector<char>> val_buffers(MIGRATE_LIST_SIZE, std::vector<char>(val_len));
+    for(auto i = 0; i < MIGRATE_LIST_SIZE; i++) {
+        keys[i] = (void*)key_buffers[i].data();
+        vals[i] = (void*)val_buffers[i].data();
+    }
+
+    bool done = false;
+    while(!done) {
+        hg_size_t num_items = MIGRATE_LIST_SIZE;
+        std::fill(ksizes.begin(), ksizes.end(), key_len);
+        std::fill(vsizes.begin(), vsizes.end(), val_len);
+        ret = sdskv_list_keyvals(sdskv_ph, srv_ctx->omap_db_id,
+                (const void*)lb, lb_size,
+                keys.data(), ksizes.data(),
+                vals.data(), vsizes.data(),
+                &num_items);
+        if(ret != SDSKV_SUCCESS) {
+            ERROR fprintf(stderr, "sdskv_list_keyvals returned %d\n", ret);
+            LEAVING;
+            return -1;
+        }
+        for(size_t i = 0; i < num_items; i++) {
+            const omap_key_t* k = (const omap_key_t*)keys[i];
+            if(k->oid != oid) {
+                done = true;
+                break;
+            }
+            /* the lower bound may be returned again */
+            if(strcmp(k->key, lb->key) == 0)
+                continue;
+            std::fill(lb_buffer.begin(), lb_buffer.end(), 0);
+            lb->oid = oid;
+            strcpy(lb->key, k->key);
+            lb_size = strlen(lb->key) + sizeof(omap_key_t);
+            if(sent.count(k->key))
+                continue;
+            if(!msg.empty() && msg.data_size() > batch_size) {
+                if(msg.send(srv_ctx, object_name, dest_addr, false, bytes_sent) != 0) {
+                    LEAVING;
+                    return -1;
+                }
+            }
+            msg.add_omap(k->key, vals[i], vsizes[i]);
+            sent.emplace(k->key, std::vector<char>((const char*)keys[i], (const char*)keys[i] + ksizes[i]));
+        }
+        if(num_items != MIGRATE_LIST_SIZE) done = true;
+    }
+
+    LEAVING;
+    return 0;
+}
+
+/* waits for the writes in progress on an object, new ones waiting in turn */
+static void migration_hold_writes(struct mobject_server_context* srv_ctx, const char* object_name)
+{
+    migration_guard* guard = srv_ctx->migration_guard;
+    std::string name(object_name);
+    ABT_mutex_lock(guard->mutex);
+    guard->removing.insert(name);
+    while(guard->writing.count(name))
+        ABT_cond_wait(guard->cond, guard->mutex);
+    ABT_mutex_unlock(guard->mutex);
+}
+
+static void migration_release_writes(struct mobject_server_context* srv_ctx, const char* object_name)
+{
+    migration_guard* guard = srv_ctx->migration_guard;
+    ABT_mutex_lock(guard->mutex);
+    guard->removing.erase(object_name);
+    ABT_cond_broadcast(guard->cond);
+    ABT_mutex_unlock(guard->mutex);
+}
+
+extern "C" int core_migrate_object(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name,
+        hg_addr_t dest_addr,
+        size_t* bytes_sent)
+{
+    ENTERING;
+    sdskv_provider_handle_t sdskv_ph = srv_ctx->sdskv_ph;
+    size_t batch_size = srv_ctx->rebalance_batch_size ?
+        srv_ctx->rebalance_batch_size : MIGRATE_DEFAULT_BATCH_SIZE;
+    migration_message msg;
+    std::map<std::string, std::vector<char>> omap_keys;
+    segment_key_t newest;
+    bool has_newest = false;
+    int ret;
+
+    /* the segments and regions sent must be in the KV store and persisted */
+    core_persist_pending(srv_ctx);
+
+    oid_t oid = 0;
+    hg_size_t oid_size = sizeof(oid);
+    ret = sdskv_get(sdskv_ph, srv_ctx->name_db_id, (const void*)object_name,
+            strlen(object_name)+1, (void*)&oid, &oid_size);
+    if(ret == SDSKV_ERR_UNKNOWN_KEY) {
+        /* removed in the meantime */
+        LEAVING;
+        return 0;
+    }
+    if(ret != SDSKV_SUCCESS) {
+        ERROR fprintf(stderr, "sdskv_get returned %d\n", ret);
+        LEAVING;
+        return -1;
+    }
+
+    if(migrate_segments(srv_ctx, object_name, oid, dest_addr, batch_size,
+                nullptr, &newest, &has_newest, msg, bytes_sent) != 0
+    || migrate_omap(srv_ctx, object_name, oid, dest_addr, batch_size,
+                omap_keys, msg, bytes_sent) != 0) {
+        LEAVING;
+        return -1;
+    }
+
+    /* clients with an outdated placement may have written to the object
+       since it was listed: with writes held, what they added is listed
+       again, then the local copy is removed */
+    migration_hold_writes(srv_ctx, object_name);
+    core_persist_pending(srv_ctx);
+    ret = migrate_segments(srv_ctx, object_name, oid, dest_addr, batch_size,
+            has_newest ? &newest : nullptr, nullptr, nullptr, msg, bytes_sent);
+    if(ret == 0)
+        ret = migrate_omap(srv_ctx, object_name, oid, dest_addr, batch_size,
+                omap_keys, msg, bytes_sent);
+
+    /* the last message, possibly empty, tells the new owner that it has
+       the whole object (an empty object still needs to be created there) */
+    if(ret == 0)
+        ret = msg.send(srv_ctx, object_name, dest_addr, true, bytes_sent);
+
+    /* the new owner has everything, the local copy can go */
+    if(ret == 0) {
+        ret = remove_object(srv_ctx, object_name, oid);
+        for(auto& k : omap_keys) {
+            sdskv_erase(sdskv_ph, srv_ctx->omap_db_id, (const void*)k.second.data(), k.second.size());
+        }
+    }
+    migration_release_writes(srv_ctx, object_name);
+
+    LEAVING;
+    return ret;
+}
+
+extern "C" int core_receive_object(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name,
+        const char* sender_addr_str,
+        hg_addr_t sender_addr,
+        hg_bulk_t bulk,
+        uint64_t meta_size)
+{
+    ENTERING;
+    margo_instance_id mid = srv_ctx->mid;
+    sdskv_provider_handle_t sdskv_ph = srv_ctx->sdskv_ph;
+    bake_provider_handle_t bake_ph = srv_ctx->bake_ph;
+    hg_return_t hret;
+    int ret;
+
+    if(meta_size < sizeof(migrate_header_t)) {
+        ERROR fprintf(stderr, "invalid migration message for %s\n", object_name);
+        LEAVING;
+        return -1;
+    }
+
+    /* pull the metadata part of the message */
+    std::vector<char> meta(meta_size);
+    {
+        void* buf_ptrs[1] = { meta.data() };
+        hg_size_t buf_sizes[1] = { meta_size };
+        hg_bulk_t handle;
+        hret = margo_bulk_create(mid, 1, buf_ptrs, buf_sizes, HG_BULK_WRITE_ONLY, &handle);
+        if(hret != HG_SUCCESS) {
+            ERROR fprintf(stderr, "margo_bulk_create returned %d\n", hret);
+            LEAVING;
+            return -1;
+        }
+        hret = margo_bulk_transfer(mid, HG_BULK_PULL, sender_addr, bulk, 0, handle, 0, meta_size);
+        margo_bulk_free(handle);
+        if(hret != HG_SUCCESS) {
+            ERROR fprintf(stderr, "margo_bulk_transfer returned %d\n", hret);
+            LEAVING;
+            return -1;
+        }
+    }
+
+    migrate_header_t header;
+    std::memcpy(&header, meta.data(), sizeof(header));
+    uint64_t small_base = sizeof(header) + header.num_segments*sizeof(migrate_segment_t);
+    if(small_base + header.small_size > meta_size) {
+        ERROR fprintf(stderr, "invalid migration message for %s\n", object_name);
+        LEAVING;
+        return -1;
+    }
+
+    oid_t oid = get_or_create_oid(sdskv_ph, srv_ctx->name_db_id, srv_ctx->oid_db_id, object_name);
+    if(oid == 0) {
+        ERROR fprintf(stderr, "could not create oid for %s\n", object_name);
+        LEAVING;
+        return -1;
+    }
+
+    /* segments keep their timestamp and sequence number so that writes
+       received by this provider since the membership change remain newer */
+    const char* p = meta.data() + sizeof(header);
+    for(uint64_t i = 0; i < header.num_segments; i++, p += sizeof(migrate_segment_t)) {
+        migrate_segment_t seg;
+        std::memcpy(&seg, p, sizeof(seg));
+        seg.key.oid = oid;
+        uint64_t len = seg.key.end_index - seg.key.start_index;
+
+        if(seg.key.type == seg_type_t::BAKE_REGION) {
+            region_value_t region;
+            if(seg.region_offset + seg.region_size > len) {
+                ERROR fprintf(stderr, "invalid migration message for %s\n", object_name);
+                LEAVING;
+                return -1;
+            }
+            /* the first slice creates the region, the next ones find it
+               through the segment entry put once the first one is written */
+            if(seg.region_offset == 0) {
+                region.target = core_next_bake_target(srv_ctx);
+                ret = bake_create(bake_ph, region.target, len, &region.region);
+                if(ret != BAKE_SUCCESS) {
+                    ERROR bake_perror("bake_create", ret);
+                    LEAVING;
+                    return -1;
+                }
+            } else {
+                hg_size_t vsize = sizeof(region);
+                ret = sdskv_get(sdskv_ph, srv_ctx->segment_db_id,
+                        (const void*)&seg.key, sizeof(seg.key), (void*)&region, &vsize);
+                if(ret != SDSKV_SUCCESS || vsize != sizeof(region)) {
+                    ERROR fprintf(stderr, "region of a migrated segment of %s not found\n", object_name);
+                    LEAVING;
+                    return -1;
+                }
+            }
+            ret = bake_proxy_write(bake_ph, region.target, region.region, seg.region_offset,
+                    bulk, seg.data_offset, sender_addr_str, seg.region_size);
+            if(ret != BAKE_SUCCESS) {
+                ERROR bake_perror("bake_proxy_write", ret);
+                LEAVING;
+                return -1;
+            }
+            ret = bake_persist(bake_ph, region.target, region.region,
+                    seg.region_offset, seg.region_size);
+            if(ret != BAKE_SUCCESS) {
+                ERROR bake_perror("bake_persist", ret);
+            }
+            ret = SDSKV_SUCCESS;
+            if(seg.region_offset == 0)
+                ret = sdskv_put(sdskv_ph, srv_ctx->segment_db_id,
+                        (const void*)&seg.key, sizeof(seg.key),
+                        (const void*)&region, sizeof(region));
+        } else if(seg.key.type == seg_type_t::SMALL_REGION) {
+            if(seg.data_offset + len > meta_size) {
+                ERROR fprintf(stderr, "invalid migration message for %s\n", object_name);
+                LEAVING;
+                return -1;
+            }
+            ret = sdskv_put(sdskv_ph, srv_ctx->segment_db_id,
+                    (const void*)&seg.key, sizeof(seg.key),
+                    (const void*)(meta.data() + seg.data_offset), len);
+        } else {
+            ret = sdskv_put(sdskv_ph, srv_ctx->segment_db_id,
+                    (const void*)&seg.key, sizeof(seg.key),
+                    (const void*)nullptr, 0);
+        }
+        if(ret != SDSKV_SUCCESS) {
+            ERROR fprintf(stderr, "sdskv_put returned %d\n", ret);
+            LEAVING;
+            return -1;
+        }
+    }
+
+    /* omap entries set since the membership change take precedence */
+    p = meta.data() + small_base + header.small_size;
+    const char* end = meta.data() + meta_size;
+    std::vector<char> key_buffer;
+    for(uint64_t i = 0; i < header.num_omap; i++) {
+        migrate_omap_t entry;
+        if(p + sizeof(entry) > end) break;
+        std::memcpy(&entry, p, sizeof(entry));
+        p += sizeof(entry);
+        if(p + entry.key_size + entry.val_size > end) break;
+        const char* key = p;
+        const char* val = p + entry.key_size;
+        p += entry.key_size + entry.val_size;
+
+        hg_size_t ksize = strlen(key) + sizeof(omap_key_t);
+        key_buffer.assign(ksize, 0);
+        omap_key_t* k = (omap_key_t*)key_buffer.data();
+        k->oid = oid;
+        strcpy(k->key, key);
+
+        hg_size_t vsize;
+        ret = sdskv_length(sdskv_ph, srv_ctx->omap_db_id, (const void*)k, ksize, &vsize);
+        if(ret == SDSKV_SUCCESS) continue;
+        ret = sdskv_put(sdskv_ph, srv_ctx->omap_db_id,
+                (const void*)k, ksize, (const void*)val, entry.val_size);
+        if(ret != SDSKV_SUCCESS) {
+            ERROR fprintf(stderr, "sdskv_put returned %d\n", ret);
+        }
+    }
+
+    if(header.complete) {
+        ABT_mutex_lock(srv_ctx->mutex);
+        if(!srv_ctx->migrated) srv_ctx->migrated = new migrated_objects;
+        srv_ctx->migrated->names.insert(object_name);
+        ABT_mutex_unlock(srv_ctx->mutex);
+    }
+
+    LEAVING;
+    return 0;
+}
+
+extern "C" int core_migration_complete(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name)
+{
+    return srv_ctx->migrated && srv_ctx->migrated->names.count(object_name);
+}
+
+extern "C" void core_migration_clear(struct mobject_server_context* srv_ctx)
+{
+    delete srv_ctx->migrated;
+    srv_ctx->migrated = nullptr;
+}
+
+extern "C" void core_migration_init(struct mobject_server_context* srv_ctx)
+{
+    migration_guard* guard = new migration_guard;
+    ABT_mutex_create(&guard->mutex);
+    ABT_cond_create(&guard->cond);
+    srv_ctx->migration_guard = guard;
+}
+
+extern "C" void core_migration_finalize(struct mobject_server_context* srv_ctx)
+{
+    migration_guard* guard = srv_ctx->migration_guard;
+    if(!guard) return;
+    ABT_mutex_free(&guard->mutex);
+    ABT_cond_free(&guard->cond);
+    delete guard;
+    srv_ctx->migration_guard = nullptr;
+}
+
+extern "C" void core_migration_write_begin(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name)
+{
+    migration_guard* guard = srv_ctx->migration_guard;
+    std::string name(object_name);
+    ABT_mutex_lock(guard->mutex);
+    while(guard->removing.count(name))
+        ABT_cond_wait(guard->cond, guard->mutex);
+    guard->writing[name] += 1;
+    ABT_mutex_unlock(guard->mutex);
+}
+
+extern "C" void core_migration_write_end(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name)
+{
+    migration_guard* guard = srv_ctx->migration_guard;
+    ABT_mutex_lock(guard->mutex);
+    auto it = guard->writing.find(object_name);
+    if(it != guard->writing.end() && --it->second == 0) {
+        guard->writing.erase(it);
+        ABT_cond_broadcast(guard->cond);
+    }
+    ABT_mutex_unlock(guard->mutex);
+}
+
+static bool rebalance_interrupted(struct mobject_server_context* srv_ctx)
+{
+    bool interrupted;
+    ABT_mutex_lock(srv_ctx->mutex);
+    interrupted = srv_ctx->rebalance_pending || srv_ctx->finalizing;
+    ABT_mutex_unlock(srv_ctx->mutex);
+    return interrupted;
+}
+
+extern "C" int core_rebalance(struct mobject_server_context* srv_ctx)
+{
+    ENTERING;
+    margo_instance_id mid = srv_ctx->mid;
+    ssg_member_id_t self_id = ssg_get_self_id(mid);
+    size_t bytes_sent = 0;
+    unsigned long num_migrated = 0;
+    unsigned long num_failed = 0;
+    double start = ABT_get_wtime();
+    int ret;
+
+    /* only the rebalancing ULT replaces the placement,
+       so it can be used here without holding the mutex */
+    mobject_placement_t placement = srv_ctx->placement;
+    ssg_member_id_t* members = srv_ctx->members;
+    mobject_placement_t prev_placement = srv_ctx->prev_placement;
+    ssg_member_id_t* prev_members = srv_ctx->prev_members;
+    /* objects are kept on any of the servers that may hold one of their
+       replicas, whatever their pool */
+    unsigned max_replicas = mobject_replication_max_factor(srv_ctx->replication_spec);
+
+    std::string lb;
+    std::vector<void*> keys(MIGRATE_LIST_SIZE);
+    std::vector<hg_size_t> ksizes(MIGRATE_LIST_SIZE);
+    std::vector<std::vector<char>> key_buffers(MIGRATE_LIST_SIZE,
+            std::vector<char>(MAX_OBJECT_NAME_SIZE));
+    for(auto i = 0; i < MIGRATE_LIST_SIZE; i++)
+        keys[i] = (void*)key_buffers[i].data();
+
+    bool done = false;
+    while(!done && !rebalance_interrupted(srv_ctx)) {
+        hg_size_t num_items = MIGRATE_LIST_SIZE;
+        std::fill(ksizes.begin(), ksizes.end(), MAX_OBJECT_NAME_SIZE);
+        ret = sdskv_list_keys(srv_ctx->sdskv_ph, srv_ctx->name_db_id,
+                (const void*)lb.c_str(), lb.size()+1,
+                keys.data(), ksizes.data(), &num_items);
+        if(ret != SDSKV_SUCCESS) {
+            ERROR fprintf(stderr, "sdskv_list_keys returned %d\n", ret);
+            num_failed += 1;
+            break;
+        }
+        if(num_items != MIGRATE_LIST_SIZE) done = true;
+
+        /* copy the batch first: migrating removes names from the database */
+        std::vector<std::string> names;
+        for(size_t i = 0; i < num_items; i++) {
+            const char* name = (const char*)keys[i];
+            if(lb == name) continue;
+            names.emplace_back(name);
+        }
+        if(names.empty()) {
+            done = true;
+            break;
+        }
+        lb = names.back();
+
+        for(auto& name : names) {
+            ssg_member_id_t dest;
+            size_t oid_len;
+            unsigned index;
+            if(mobject_erasure_parse_chunk_name(name.c_str(), &oid_len, &index)) {
+                /* a chunk belongs to the server of its position only, which
+                   holds no other chunk of the object under this name */
+                long rank = mobject_placement_locate_position(placement, name.c_str(), 0);
+                if(rank < 0 || members[rank] == self_id) continue;
+                dest = members[rank];
+            } else {
+                /* the pool of an object is not recorded, so an object stays
+                   wherever it could be a replica in the most replicated pool */
+                unsigned long ranks[MOBJECT_MAX_REPLICAS];
+                unsigned n = mobject_placement_locate_replicas(placement, name.c_str(), max_replicas, ranks);
+                bool keep = false;
+                for(unsigned i = 0; i < n && !keep; i++)
+                    keep = members[ranks[i]] == self_id;
+                if(keep) continue;
+                /* a replica moves to the position it had before the change */
+                unsigned pos = 0;
+                if(prev_placement) {
+                    unsigned long prev_ranks[MOBJECT_MAX_REPLICAS];
+                    unsigned prev_n = mobject_placement_locate_replicas(prev_placement,
+                            name.c_str(), max_replicas, prev_ranks);
+                    for(unsigned i = 0; i < prev_n && i < n; i++)
+                        if(prev_members[prev_ranks[i]] == self_id) pos = i;
+                }
+                dest = members[ranks[pos]];
+            }
+            hg_addr_t dest_addr = ssg_get_group_member_addr(srv_ctx->gid, dest);
+            if(dest_addr != HG_ADDR_NULL
+            && core_migrate_object(srv_ctx, name.c_str(), dest_addr, &bytes_sent) == 0)
+                num_migrated += 1;
+            else
+                num_failed += 1;
+        }
+
+        /* keep the average migration bandwidth under the limit */
+        if(srv_ctx->rebalance_bandwidth) {
+            double elapsed  = ABT_get_wtime() - start;
+            double expected = (double)bytes_sent / srv_ctx->rebalance_bandwidth;
+            if(expected > elapsed)
+                margo_thread_sleep(mid, (expected - elapsed)*1000.0);
+        }
+    }
+
+    if(num_migrated) {
+        fprintf(stderr, "Rebalancing: migrated %lu objects (%lu bytes) in %.3f s\n",
+                num_migrated, bytes_sent, ABT_get_wtime() - start);
+    }
+    if(num_failed) {
+        fprintf(stderr, "Rebalancing: unable to migrate %lu objects\n", num_failed);
+    }
+    LEAVING;
+    return done && num_failed == 0 ? 0 : -1;
+}
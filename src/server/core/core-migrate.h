@@ -0,0 +1,102 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __CORE_MIGRATE_H
+#define __CORE_MIGRATE_H
+
+#include <margo.h>
+#include "src/server/mobject-server-context.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Sends the segments, data and omap of an object to the provider at
+ * dest_addr, then removes the object locally. What was written to the
+ * object while it was sent is sent as well before the removal.
+ *
+ * @param srv_ctx     local provider
+ * @param object_name name of the object to migrate
+ * @param dest_addr   address of the new owner
+ * @param bytes_sent  incremented by the number of bytes transferred
+ *
+ * @return 0 on success, -1 on failure (the object is then kept locally)
+ */
+int core_migrate_object(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name,
+        hg_addr_t dest_addr,
+        size_t* bytes_sent);
+
+/**
+ * Stores the part of an object sent by core_migrate_object.
+ *
+ * @param srv_ctx         local provider
+ * @param object_name     name of the object
+ * @param sender_addr_str address of the sender, as a string
+ * @param sender_addr     address of the sender
+ * @param bulk            bulk handle exposing the migrated content
+ * @param meta_size       size of the metadata part of the bulk handle
+ *
+ * @return 0 on success, -1 on failure
+ */
+int core_receive_object(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name,
+        const char* sender_addr_str,
+        hg_addr_t sender_addr,
+        hg_bulk_t bulk,
+        uint64_t meta_size);
+
+/**
+ * Tells whether the last migration message of an object was received
+ * since the last call to core_migration_clear, i.e. whether the object
+ * is whole on this provider. The caller holds srv_ctx->mutex.
+ */
+int core_migration_complete(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name);
+
+/**
+ * Forgets the objects received so far, on membership changes and once
+ * the previous placement is dropped. The caller holds srv_ctx->mutex.
+ */
+void core_migration_clear(struct mobject_server_context* srv_ctx);
+
+/**
+ * Creates and frees the state that keeps writes to an object from
+ * reaching it while its local copy is removed after its migration.
+ */
+void core_migration_init(struct mobject_server_context* srv_ctx);
+void core_migration_finalize(struct mobject_server_context* srv_ctx);
+
+/**
+ * Surround the execution of a write on an object. Writes to an object
+ * whose migration is completing wait until its local copy is removed.
+ */
+void core_migration_write_begin(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name);
+void core_migration_write_end(
+        struct mobject_server_context* srv_ctx,
+        const char* object_name);
+
+/**
+ * Walks all the objects stored by the provider and migrates those
+ * that the current placement assigns to another server, in batches
+ * limited by srv_ctx->rebalance_bandwidth. Returns early if another
+ * rebalancing was requested in the meantime.
+ *
+ * @return 0 if all the objects to migrate were migrated, -1 if the
+ * rebalancing was interrupted or some objects could not be migrated
+ */
+int core_rebalance(struct mobject_server_context* srv_ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
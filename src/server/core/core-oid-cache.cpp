@@ -0,0 +1,78 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+#include <string>
+#include <unordered_map>
+#include "src/server/core/core-oid-cache.h"
+#include "src/server/core/core-metrics.h"
+
+struct oid_cache {
+    ABT_mutex                              mutex;
+    std::unordered_map<std::string, oid_t> oids;
+    size_t                                 max_entries;
+    uint64_t                               erasures; // number of erase calls
+};
+
+extern "C" void core_oid_cache_init(struct mobject_server_context* srv_ctx, size_t max_entries)
+{
+    srv_ctx->oid_cache = NULL;
+    if(max_entries == 0) return;
+    auto cache = new oid_cache;
+    ABT_mutex_create(&cache->mutex);
+    cache->max_entries = max_entries;
+    cache->erasures = 0;
+    srv_ctx->oid_cache = cache;
+}
+
+extern "C" void core_oid_cache_finalize(struct mobject_server_context* srv_ctx)
+{
+    auto cache = srv_ctx->oid_cache;
+    if(!cache) return;
+    ABT_mutex_free(&cache->mutex);
+    delete cache;
+    srv_ctx->oid_cache = NULL;
+}
+
+extern "C" oid_t core_oid_cache_lookup(struct mobject_server_context* srv_ctx, const char* object_name, uint64_t* gen)
+{
+    auto cache = srv_ctx->oid_cache;
+    oid_t oid = 0;
+    *gen = 0;
+    if(!cache) return 0;
+    ABT_mutex_lock(cache->mutex);
+    auto it = cache->oids.find(object_name);
+    if(it != cache->oids.end()) oid = it->second;
+    *gen = cache->erasures;
+    ABT_mutex_unlock(cache->mutex);
+    core_metrics_cache(srv_ctx, oid != 0);
+    return oid;
+}
+
+extern "C" void core_oid_cache_insert(struct mobject_server_context* srv_ctx, const char* object_name, oid_t oid, uint64_t gen)
+{
+    auto cache = srv_ctx->oid_cache;
+    if(!cache || oid == 0) return;
+    ABT_mutex_lock(cache->mutex);
+    /* the oid may have been read before a removal erased it */
+    if(cache->erasures != gen) {
+        ABT_mutex_unlock(cache->mutex);
+        return;
+    }
+    /* no eviction policy: start over once full */
+    if(cache->oids.size() >= cache->max_entries)
+        cache->oids.clear();
+    cache->oids[object_name] = oid;
+    ABT_mutex_unlock(cache->mutex);
+}
+
+extern "C" void core_oid_cache_erase(struct mobject_server_context* srv_ctx, const char* object_name)
+{
+    auto cache = srv_ctx->oid_cache;
+    if(!cache) return;
+    ABT_mutex_lock(cache->mutex);
+    cache->oids.erase(object_name);
+    cache->erasures += 1;
+    ABT_mutex_unlock(cache->mutex);
+}
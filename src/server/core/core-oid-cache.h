@@ -0,0 +1,46 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __CORE_OID_CACHE_H
+#define __CORE_OID_CACHE_H
+
+#include "src/server/mobject-server-context.h"
+#include "src/server/core/key-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The provider keeps the name -> oid entries of the objects it has
+ * looked up or created, so that operations on known objects do not
+ * have to ask the KV store. Every entry of name_map is written and
+ * erased by this provider, so the cache only has to forget the
+ * objects it removes. At most max_entries entries are kept, 0
+ * disabling the cache.
+ *
+ * An oid read from the KV store after a missed lookup is only inserted
+ * if no object was removed in the meantime: it may belong to an object
+ * whose name_map entry was erased after it was read.
+ */
+void core_oid_cache_init(struct mobject_server_context* srv_ctx, size_t max_entries);
+
+void core_oid_cache_finalize(struct mobject_server_context* srv_ctx);
+
+/* returns the oid of the object, 0 if it is not in the cache, in which
+   case gen is set to the value to pass to core_oid_cache_insert */
+oid_t core_oid_cache_lookup(struct mobject_server_context* srv_ctx, const char* object_name, uint64_t* gen);
+
+/* inserts an oid found after a lookup that returned gen */
+void core_oid_cache_insert(struct mobject_server_context* srv_ctx, const char* object_name, oid_t oid, uint64_t gen);
+
+/* to be called once the name_map entry of the object is erased */
+void core_oid_cache_erase(struct mobject_server_context* srv_ctx, const char* object_name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
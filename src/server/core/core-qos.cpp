@@ -0,0 +1,333 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <time.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include "src/server/core/core-qos.h"
+
+/* tokens a bucket holds at most, in seconds of its rate */
+#define QOS_BURST 0.1
+/* cost of an operation besides its data, in bytes, for round robin */
+#define QOS_OP_COST 4096
+/* milliseconds a throttled operation waits before checking its buckets again */
+#define QOS_POLL_INTERVAL 1.0
+/* number of clients kept track of before the idle ones are forgotten */
+#define QOS_MAX_IDLE_CLIENTS 4096
+
+struct qos_limit {
+    double ops;    /* operations/sec, 0 for unlimited */
+    double bytes;  /* bytes/sec, 0 for unlimited */
+};
+
+struct token_bucket {
+    double rate;
+    double tokens;
+    double last;
+
+    void init(double r, double now) {
+        rate   = r;
+        tokens = r*QOS_BURST;
+        last   = now;
+    }
+    void refill(double now) {
+        if(rate == 0) return;
+        tokens += (now - last)*rate;
+        if(tokens > rate*QOS_BURST) tokens = rate*QOS_BURST;
+        last = now;
+    }
+    /* a bucket may go in debt, so that operations larger
+       than its capacity are admitted once it is not */
+    bool ready() const { return rate == 0 || tokens > 0; }
+    void take(double amount) { if(rate != 0) tokens -= amount; }
+};
+
+struct qos_buckets {
+    token_bucket ops;
+    token_bucket bytes;
+
+    void init(const qos_limit& limit, double now) {
+        ops.init(limit.ops, now);
+        bytes.init(limit.bytes, now);
+    }
+    bool ready(double now) {
+        ops.refill(now);
+        bytes.refill(now);
+        return ops.ready() && bytes.ready();
+    }
+    void take(size_t num_ops, size_t size) {
+        ops.take(num_ops);
+        bytes.take(size);
+    }
+};
+
+struct qos_waiter {
+    size_t       ops;
+    size_t       bytes;
+    qos_buckets* pool;
+    bool         admitted;
+};
+
+struct qos_client {
+    qos_buckets             buckets;
+    std::deque<qos_waiter*> queue;
+    double                  deficit;
+    bool                    in_ring;
+    uint64_t                admitted;
+    uint64_t                waited;   /* admitted operations that were queued */
+};
+
+struct qos_state {
+    ABT_mutex                                    mutex;
+    ABT_cond                                     cond;   /* signaled when waiters are admitted */
+    qos_limit                                    client_limit;
+    qos_limit                                    default_pool_limit;
+    std::unordered_map<std::string, qos_limit>   pool_limits;
+    std::unordered_map<std::string, qos_client>  clients;
+    std::unordered_map<std::string, qos_buckets> pools;
+    std::list<qos_client*>                       ring;   /* clients with queued operations */
+    size_t                                       max_active;
+    size_t                                       active;
+    size_t                                       queued;
+    size_t                                       max_queued;
+    double                                       quantum;
+};
+
+/* parses <ops/sec>/<bytes/sec>, either part being optional */
+static qos_limit parse_limit(const char* s)
+{
+    qos_limit limit = { 0, 0 };
+    char* end;
+    limit.ops = strtod(s, &end);
+    if(*end == '/') limit.bytes = strtod(end + 1, NULL);
+    if(limit.ops < 0) limit.ops = 0;
+    if(limit.bytes < 0) limit.bytes = 0;
+    return limit;
+}
+
+/* parses a list of [<pool>:]<limit> entries, see MOBJECT_QOS_POOL_LIMIT_ENV */
+static void parse_pool_limits(qos_state* qos, const char* spec)
+{
+    std::string s(spec);
+    size_t start = 0;
+    while(start <= s.size()) {
+        size_t end = s.find(',', start);
+        if(end == std::string::npos) end = s.size();
+        std::string entry = s.substr(start, end - start);
+        size_t colon = entry.find(':');
+        if(colon == std::string::npos)
+            qos->default_pool_limit = parse_limit(entry.c_str());
+        else
+            qos->pool_limits[entry.substr(0, colon)] = parse_limit(entry.c_str() + colon + 1);
+        start = end + 1;
+    }
+}
+
+extern "C" void core_qos_init(struct mobject_server_context* srv_ctx)
+{
+    const char* client_limit = getenv(MOBJECT_QOS_CLIENT_LIMIT_ENV);
+    const char* pool_limit   = getenv(MOBJECT_QOS_POOL_LIMIT_ENV);
+    const char* max_active   = getenv(MOBJECT_QOS_MAX_ACTIVE_ENV);
+    const char* quantum      = getenv(MOBJECT_QOS_QUANTUM_ENV);
+
+    srv_ctx->qos = NULL;
+    if(!client_limit && !pool_limit && !max_active) return;
+
+    auto qos = new qos_state;
+    ABT_mutex_create(&qos->mutex);
+    ABT_cond_create(&qos->cond);
+    qos->client_limit       = client_limit ? parse_limit(client_limit) : qos_limit{ 0, 0 };
+    qos->default_pool_limit = qos_limit{ 0, 0 };
+    if(pool_limit) parse_pool_limits(qos, pool_limit);
+    qos->max_active = max_active ? strtoul(max_active, NULL, 0) : 0;
+    qos->quantum    = quantum ? atof(quantum) : MOBJECT_QOS_QUANTUM_DEFAULT;
+    if(qos->quantum < QOS_OP_COST) qos->quantum = QOS_OP_COST;
+    qos->active     = 0;
+    qos->queued     = 0;
+    qos->max_queued = 0;
+    srv_ctx->qos = qos;
+}
+
+extern "C" void core_qos_finalize(struct mobject_server_context* srv_ctx)
+{
+    auto qos = srv_ctx->qos;
+    if(!qos) return;
+    ABT_cond_free(&qos->cond);
+    ABT_mutex_free(&qos->mutex);
+    delete qos;
+    srv_ctx->qos = NULL;
+}
+
+static qos_client* get_client(qos_state* qos, const char* addr, double now)
+{
+    auto it = qos->clients.find(addr);
+    if(it != qos->clients.end()) return &it->second;
+    /* forget the clients that have nothing queued; their buckets
+       start over full, as they would after a long enough pause */
+    if(qos->clients.size() >= QOS_MAX_IDLE_CLIENTS) {
+        for(auto c = qos->clients.begin(); c != qos->clients.end(); ) {
+            if(c->second.in_ring) ++c;
+            else c = qos->clients.erase(c);
+        }
+    }
+    qos_client& client = qos->clients[addr];
+    client.buckets.init(qos->client_limit, now);
+    client.deficit  = 0;
+    client.in_ring  = false;
+    client.admitted = 0;
+    client.waited   = 0;
+    return &client;
+}
+
+static qos_buckets* get_pool(qos_state* qos, const char* pool_name, double now)
+{
+    auto it = qos->pools.find(pool_name);
+    if(it != qos->pools.end()) return &it->second;
+    auto limit = qos->pool_limits.find(pool_name);
+    qos_buckets& pool = qos->pools[pool_name];
+    pool.init(limit != qos->pool_limits.end() ? limit->second : qos->default_pool_limit, now);
+    return &pool;
+}
+
+static bool slot_available(qos_state* qos)
+{
+    return qos->max_active == 0 || qos->active < qos->max_active;
+}
+
+/* whether the next operation of every client in the ring but one is throttled */
+static bool others_throttled(qos_state* qos, qos_client* client, double now)
+{
+    for(auto c : qos->ring) {
+        if(c == client) continue;
+        if(c->buckets.ready(now) && c->queue.front()->pool->ready(now))
+            return false;
+    }
+    return true;
+}
+
+/* admits queued operations in deficit round robin while there are free
+   slots, skipping the clients whose next operation is throttled; stops
+   once a whole round only found throttled clients */
+static void dispatch(qos_state* qos, double now)
+{
+    size_t throttled = 0;
+    bool admitted = false;
+
+    while(!qos->ring.empty() && slot_available(qos) && throttled < qos->ring.size()) {
+        qos_client* client = qos->ring.front();
+        qos_waiter* w = client->queue.front();
+        double cost = (double)w->bytes + QOS_OP_COST;
+        if(!client->buckets.ready(now) || !w->pool->ready(now)) {
+            qos->ring.splice(qos->ring.end(), qos->ring, qos->ring.begin());
+            throttled += 1;
+            continue;
+        }
+        if(client->deficit < cost) {
+            /* the only client able to run gets at once the quanta of
+               the rounds it would otherwise wait for */
+            if(others_throttled(qos, client, now))
+                client->deficit += qos->quantum*ceil((cost - client->deficit)/qos->quantum);
+            else
+                client->deficit += qos->quantum;
+            qos->ring.splice(qos->ring.end(), qos->ring, qos->ring.begin());
+            throttled = 0;
+            continue;
+        }
+        client->deficit -= cost;
+        client->buckets.take(w->ops, w->bytes);
+        w->pool->take(w->ops, w->bytes);
+        client->queue.pop_front();
+        client->admitted += 1;
+        client->waited   += 1;
+        w->admitted = true;
+        admitted = true;
+        qos->active += 1;
+        qos->queued -= 1;
+        throttled = 0;
+        if(client->queue.empty()) {
+            qos->ring.pop_front();
+            client->in_ring = false;
+            client->deficit = 0;
+        }
+    }
+    if(admitted) ABT_cond_broadcast(qos->cond);
+}
+
+extern "C" void core_qos_admit(struct mobject_server_context* srv_ctx,
+        const char* client_addr, const char* pool_name, size_t ops, size_t bytes)
+{
+    auto qos = srv_ctx->qos;
+    if(!qos) return;
+
+    ABT_mutex_lock(qos->mutex);
+    double now = ABT_get_wtime();
+    qos_client* client = get_client(qos, client_addr ? client_addr : "", now);
+    qos_buckets* pool  = get_pool(qos, pool_name ? pool_name : "", now);
+
+    /* nobody is waiting: admit right away if possible */
+    if(qos->ring.empty() && slot_available(qos)
+    && client->buckets.ready(now) && pool->ready(now)) {
+        client->buckets.take(ops, bytes);
+        pool->take(ops, bytes);
+        client->admitted += 1;
+        qos->active += 1;
+        ABT_mutex_unlock(qos->mutex);
+        return;
+    }
+
+    qos_waiter w = { ops, bytes, pool, false };
+    client->queue.push_back(&w);
+    qos->queued += 1;
+    if(qos->queued > qos->max_queued) qos->max_queued = qos->queued;
+    if(!client->in_ring) {
+        qos->ring.push_back(client);
+        client->in_ring = true;
+        client->deficit = 0;
+    }
+    dispatch(qos, now);
+
+    /* waiters are admitted when a slot is released, and check
+       the buckets of throttled operations periodically */
+    while(!w.admitted) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)(QOS_POLL_INTERVAL*1000000.0);
+        deadline.tv_sec  += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        ABT_cond_timedwait(qos->cond, qos->mutex, &deadline);
+        if(!w.admitted) dispatch(qos, ABT_get_wtime());
+    }
+    ABT_mutex_unlock(qos->mutex);
+}
+
+extern "C" void core_qos_release(struct mobject_server_context* srv_ctx)
+{
+    auto qos = srv_ctx->qos;
+    if(!qos) return;
+    ABT_mutex_lock(qos->mutex);
+    qos->active -= 1;
+    dispatch(qos, ABT_get_wtime());
+    ABT_mutex_unlock(qos->mutex);
+}
+
+extern "C" void core_qos_print_stats(struct mobject_server_context* srv_ctx, FILE* out)
+{
+    auto qos = srv_ctx->qos;
+    if(!qos) return;
+    ABT_mutex_lock(qos->mutex);
+    fprintf(out, "\tQoS: %zu operations executing (max %zu), %zu queued (max %zu), %zu clients\n",
+            qos->active, qos->max_active, qos->queued, qos->max_queued, qos->clients.size());
+    for(auto& c : qos->clients) {
+        if(c.second.queue.empty()) continue;
+        fprintf(out, "\t\tclient %s: %zu queued, %lu admitted (%lu after waiting)\n",
+                c.first.c_str(), c.second.queue.size(),
+                (unsigned long)c.second.admitted, (unsigned long)c.second.waited);
+    }
+    ABT_mutex_unlock(qos->mutex);
+}
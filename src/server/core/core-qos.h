@@ -0,0 +1,47 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __CORE_QOS_H
+#define __CORE_QOS_H
+
+#include <stdio.h>
+#include "src/server/mobject-server-context.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Operations of clients go through admission before being executed.
+ * Each client (identified by its address) and each pool has a token
+ * bucket for operations and one for bytes, refilled at the rates given
+ * by MOBJECT_QOS_CLIENT_LIMIT and MOBJECT_QOS_POOL_LIMIT. At most
+ * MOBJECT_QOS_MAX_ACTIVE operations execute at once. Operations that
+ * cannot be admitted right away wait in a queue of their client, the
+ * queues being served in deficit round robin, so that a client sending
+ * many or large operations does not delay the others. Without any of
+ * these settings, srv_ctx->qos is NULL and admission is free.
+ */
+void core_qos_init(struct mobject_server_context* srv_ctx);
+
+void core_qos_finalize(struct mobject_server_context* srv_ctx);
+
+/* blocks the calling ULT until ops operations (more than one for a batch)
+   of client_addr on pool_name, moving bytes in total, may be executed */
+void core_qos_admit(struct mobject_server_context* srv_ctx,
+        const char* client_addr, const char* pool_name, size_t ops, size_t bytes);
+
+/* signals the end of an admitted operation */
+void core_qos_release(struct mobject_server_context* srv_ctx);
+
+/* prints the number of executing and queued operations and, for each
+   client with queued operations, its queue depth */
+void core_qos_print_stats(struct mobject_server_context* srv_ctx, FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
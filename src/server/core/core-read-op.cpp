@@ -10,8 +10,13 @@
 #include <vector>
 #include <list>
 #include <cinttypes>
+#include <cstring>
+#include <limits>
 #include <bake-client.h>
 #include "src/server/core/core-read-op.h"
+#include "src/server/core/core-write-op.h"
+#include "src/server/core/core-oid-cache.h"
+#include "src/server/core/core-metrics.h"
 #include "src/server/visitor-args.h"
 #include "src/io-chain/read-op-visitor.h"
 #include "src/io-chain/read-resp-impl.h"
@@ -37,243 +42,450 @@ static void read_op_exec_omap_get_vals(void*, const char*, const char*, uint64_t
 static void read_op_exec_omap_get_vals_by_keys(void*, char const* const*, size_t, mobject_store_omap_iter_t*, int*);
 static void read_op_exec_end(void*);
 
-/* defined in core-write-op.cpp */
-extern uint64_t mobject_compute_object_size(
-        sdskv_provider_handle_t ph,
-        sdskv_database_id_t seg_db_id,
-        oid_t oid, time_t ts);
-
 static oid_t get_oid_from_name(
         sdskv_provider_handle_t ph,
         sdskv_database_id_t name_db_id,
         const char* name);
 
-#if 0
-struct read_request_t {
-    double timestamp;              // timestamp at which the segment was created
-    uint64_t absolute_start_index; // start index within the object
-    uint64_t absolute_end_index;   // end index within the object
-    uint64_t region_start_index;   // where to start within the region
-    uint64_t region_end_index;     // where to end within the region
-    uint64_t client_offset;        // offset within the client's buffer
-    bake_region_id_t region;  // region id
+/* A read action whose resolution has been deferred to the end of the read_op,
+   so that all the read actions of the operation can share a single scan of
+   the object's segments. */
+struct pending_read_t {
+    uint64_t            offset;     // offset within the object
+    size_t              len;        // length of the read
+    buffer_u            buf;        // position in the client's bulk handle
+    size_t*             bytes_read; // where to store the number of bytes read
+    int*                prval;      // where to store the return value
+    covermap<uint64_t>  coverage;   // parts of the range already resolved
+
+    pending_read_t(uint64_t o, size_t l, buffer_u b, size_t* br, int* r)
+    : offset(o), len(l), buf(b), bytes_read(br), prval(r), coverage(o, o+l) {}
+};
+
+/* A stat action whose resolution has been deferred to the end of the read_op. */
+struct pending_stat_t {
+    uint64_t* psize;
+    int*      prval;
+};
+
+/* A transfer resolved from the segment scan, to be issued once the scan
+   is complete. For SMALL_REGION segments, region holds the data itself. */
+struct read_transfer_t {
+    seg_type_t       type;
+    bake_region_id_t region;        // region id (or inline data)
+    bake_target_id_t target;        // bake target of the region
+    uint64_t         region_offset; // offset within the region
+    uint64_t         remote_offset; // offset within the client's bulk handle
+    uint64_t         size;          // number of bytes to transfer
+    int*             prval;         // return value of the read action
+};
+
+/* Arguments passed to the visitor functions. */
+struct read_op_exec_args {
+    server_visitor_args_t       vargs;
+    std::vector<pending_read_t> reads;
+    std::vector<pending_stat_t> stats;
 };
-#endif
+
+static int resolve_segments(read_op_exec_args* args,
+        std::vector<read_transfer_t>& transfers);
+static void issue_read_transfers(read_op_exec_args* args,
+        const std::vector<read_transfer_t>& transfers);
+
+/* bytes of keys and values an omap action returns */
+static size_t omap_iter_bytes(mobject_store_omap_iter_t iter)
+{
+    size_t bytes = 0;
+    if(!iter) return 0;
+    for(omap_iter_node_t n = iter->head; n; n = n->next)
+        bytes += n->key_size + n->value_size;
+    return bytes;
+}
+
+/* omap actions are counted and timed around their execution, stats
+   and reads in read_op_exec_end, where they are actually resolved */
+#define METERED_OMAP(op, call) do { \
+        auto _vargs = static_cast<read_op_exec_args*>(u)->vargs; \
+        double _start = ABT_get_wtime(); \
+        call; \
+        core_metrics_op(_vargs->srv_ctx, op, _start, 0, omap_iter_bytes(*iter)); \
+    } while(0)
+
+static void metered_omap_get_keys(void* u, const char* start_after, uint64_t max_return,
+        mobject_store_omap_iter_t* iter, int* prval)
+{ METERED_OMAP(CORE_OP_OMAP_GET_KEYS,
+        read_op_exec_omap_get_keys(u, start_after, max_return, iter, prval)); }
+
+static void metered_omap_get_vals(void* u, const char* start_after, const char* filter_prefix,
+        uint64_t max_return, mobject_store_omap_iter_t* iter, int* prval)
+{ METERED_OMAP(CORE_OP_OMAP_GET_VALS,
+        read_op_exec_omap_get_vals(u, start_after, filter_prefix, max_return, iter, prval)); }
+
+static void metered_omap_get_vals_by_keys(void* u, char const* const* keys, size_t num_keys,
+        mobject_store_omap_iter_t* iter, int* prval)
+{ METERED_OMAP(CORE_OP_OMAP_GET_VALS_BY_KEYS,
+        read_op_exec_omap_get_vals_by_keys(u, keys, num_keys, iter, prval)); }
 
 static struct read_op_visitor read_op_exec = {
 	.visit_begin                 = read_op_exec_begin,
 	.visit_stat                  = read_op_exec_stat,
 	.visit_read                  = read_op_exec_read,
-	.visit_omap_get_keys         = read_op_exec_omap_get_keys,
-	.visit_omap_get_vals         = read_op_exec_omap_get_vals,
-	.visit_omap_get_vals_by_keys = read_op_exec_omap_get_vals_by_keys,
+	.visit_omap_get_keys         = metered_omap_get_keys,
+	.visit_omap_get_vals         = metered_omap_get_vals,
+	.visit_omap_get_vals_by_keys = metered_omap_get_vals_by_keys,
 	.visit_end                   = read_op_exec_end
 };
 
 extern "C" void core_read_op(mobject_store_read_op_t read_op, server_visitor_args_t vargs)
 {
-	execute_read_op_visitor(&read_op_exec, read_op, (void*)vargs);
+    read_op_exec_args args;
+    args.vargs = vargs;
+    /* segments of acknowledged writes must be visible */
+    core_flush_segment_log(vargs->srv_ctx);
+	execute_read_op_visitor(&read_op_exec, read_op, (void*)&args);
+}
+
+extern "C" void core_read_op_batch(
+        mobject_store_read_op_t* read_ops,
+        const char* const* object_names,
+        size_t count,
+        server_visitor_args_t vargs)
+{
+    struct mobject_server_context* srv_ctx = vargs->srv_ctx;
+    std::vector<oid_t> oids(count, 0);
+    size_t i;
+
+    core_flush_segment_log(srv_ctx);
+
+    /* look up the oids of all the objects at once; objects that are
+       not found keep a 0 oid and are looked up again individually */
+    if(count > 0) {
+        std::vector<const void*> keys(count);
+        std::vector<hg_size_t>   ksizes(count);
+        std::vector<void*>       values(count);
+        std::vector<hg_size_t>   vsizes(count, sizeof(oid_t));
+        for(i = 0; i < count; i++) {
+            keys[i]   = (const void*)object_names[i];
+            ksizes[i] = strlen(object_names[i])+1;
+            values[i] = (void*)&oids[i];
+        }
+        int ret = CORE_METERED(srv_ctx, CORE_CALL_KV,
+                sdskv_get_multi(srv_ctx->sdskv_ph, srv_ctx->name_db_id, count,
+                    keys.data(), ksizes.data(), values.data(), vsizes.data()));
+        for(i = 0; i < count; i++) {
+            if(ret != SDSKV_SUCCESS || vsizes[i] != sizeof(oid_t))
+                oids[i] = 0;
+        }
+    }
+
+    for(i = 0; i < count; i++) {
+        read_op_exec_args args;
+        args.vargs = vargs;
+        vargs->object_name = object_names[i];
+        vargs->oid         = oids[i];
+        execute_read_op_visitor(&read_op_exec, read_ops[i], (void*)&args);
+    }
 }
 
 void read_op_exec_begin(void* u)
 {
     ENTERING;
-    auto vargs = static_cast<server_visitor_args_t>(u);
+    auto vargs = static_cast<read_op_exec_args*>(u)->vargs;
     // find oid
     const char* object_name = vargs->object_name;
     oid_t oid = vargs->oid;
+    uint64_t gen = 0;
+    if(oid == 0)
+        oid = core_oid_cache_lookup(vargs->srv_ctx, object_name, &gen);
     if(oid == 0) {
         sdskv_provider_handle_t sdskv_ph = vargs->srv_ctx->sdskv_ph;
         sdskv_database_id_t name_db_id = vargs->srv_ctx->name_db_id;
-        oid = get_oid_from_name(sdskv_ph, name_db_id, object_name);
-        vargs->oid = oid;
+        oid = CORE_METERED(vargs->srv_ctx, CORE_CALL_KV,
+                get_oid_from_name(sdskv_ph, name_db_id, object_name));
+        core_oid_cache_insert(vargs->srv_ctx, object_name, oid, gen);
     }
+    vargs->oid = oid;
     LEAVING
 }
 
 void read_op_exec_stat(void* u, uint64_t* psize, time_t* pmtime, int* prval)
 {
     ENTERING;
-    auto vargs = static_cast<server_visitor_args_t>(u);
-    sdskv_provider_handle_t sdskv_ph = vargs->srv_ctx->sdskv_ph;
-    sdskv_database_id_t seg_db_id = vargs->srv_ctx->segment_db_id;
+    auto args = static_cast<read_op_exec_args*>(u);
     // find oid
-    oid_t oid = vargs->oid;
+    oid_t oid = args->vargs->oid;
     if(oid == 0) {
         *prval = -1;
         LEAVING;
         return;
     }
-    
-    time_t ts = time(NULL);
-    *psize = mobject_compute_object_size(sdskv_ph, seg_db_id, oid, ts);
-
+    // the size is computed in read_op_exec_end, along with the reads
+    args->stats.push_back(pending_stat_t{psize, prval});
     LEAVING;
 }
 
 void read_op_exec_read(void* u, uint64_t offset, size_t len, buffer_u buf, size_t* bytes_read, int* prval)
 {
     ENTERING;
-    auto vargs = static_cast<server_visitor_args_t>(u);
-    bake_provider_handle_t bph = vargs->srv_ctx->bake_ph;
-    bake_target_id_t bti = vargs->srv_ctx->bake_tid;
-    bake_region_id_t rid;
-    hg_bulk_t remote_bulk = vargs->bulk_handle;
-    const char* remote_addr_str = vargs->client_addr_str;
-    hg_addr_t   remote_addr     = vargs->client_addr;
-    sdskv_provider_handle_t sdskv_ph = vargs->srv_ctx->sdskv_ph;
-    sdskv_database_id_t seg_db_id = vargs->srv_ctx->segment_db_id;
-    int ret;
-
-    uint64_t client_start_index = offset;
-    uint64_t client_end_index = offset+len;
+    auto args = static_cast<read_op_exec_args*>(u);
 
     *prval = 0;
 
     // find oid
-    oid_t oid = vargs->oid;
+    oid_t oid = args->vargs->oid;
     if(oid == 0) {
         *prval = -1;
         ERROR fprintf(stderr,"oid == 0\n");
         LEAVING;
         return;
     }
+    // the read is resolved in read_op_exec_end, along with the other reads
+    args->reads.emplace_back(offset, len, buf, bytes_read, prval);
+    LEAVING;
+}
+
+/**
+ * Walks the object's segments once, from the most recent to the oldest,
+ * resolving the ranges of all the pending reads as well as the size of
+ * the object for the pending stats. The data transfers required by the
+ * reads are appended to the transfers vector rather than issued.
+ */
+static int resolve_segments(read_op_exec_args* args,
+        std::vector<read_transfer_t>& transfers)
+{
+    ENTERING;
+    auto vargs = args->vargs;
+    sdskv_provider_handle_t sdskv_ph = vargs->srv_ctx->sdskv_ph;
+    sdskv_database_id_t seg_db_id = vargs->srv_ctx->segment_db_id;
+    oid_t oid = vargs->oid;
+    int ret;
 
     segment_key_t lb;
     lb.oid = oid;
     lb.timestamp = time(NULL);
     lb.seq_id = MOBJECT_SEQ_ID_MAX;
 
-    covermap<uint64_t> coverage(offset, offset+len);
+    uint64_t size = 0; // current assumed size
+    uint64_t max_size = std::numeric_limits<uint64_t>::max();
+    bool size_done = args->stats.empty();
+    size_t reads_done = 0;
+    for(auto& r : args->reads)
+        if(r.coverage.full()) reads_done += 1;
 
     size_t max_segments = 128; // XXX this is a pretty arbitrary number
-    segment_key_t       segment_keys[max_segments];
-    void*               segment_keys_addrs[max_segments];
-    hg_size_t           segment_keys_size[max_segments];
-    bake_region_id_t    segment_data[max_segments];
-    void*               segment_data_addrs[max_segments];
-    hg_size_t           segment_data_size[max_segments];
-    for(auto i = 0 ; i < max_segments; i++) {
-        segment_keys_addrs[i] = (void*)(&segment_keys[i]);
-        segment_keys_size[i]  = sizeof(segment_key_t);
-        segment_data_addrs[i] = (void*)(&segment_data[i]);
-        segment_data_size[i]  = sizeof(bake_region_id_t);
-    }
+    std::vector<segment_key_t>    segment_keys(max_segments);
+    std::vector<void*>            segment_keys_addrs(max_segments);
+    std::vector<hg_size_t>        segment_keys_size(max_segments);
+    std::vector<region_value_t>   segment_data(max_segments);
+    std::vector<void*>            segment_data_addrs(max_segments);
+    std::vector<hg_size_t>        segment_data_size(max_segments);
 
     bool done = false;
-    int seg_start_ndx =  0;
-    while(!coverage.full() && !done) {
+    while(!done && !(size_done && reads_done == args->reads.size())) {
+
+        for(auto i = 0 ; i < max_segments; i++) {
+            segment_keys_addrs[i] = (void*)(&segment_keys[i]);
+            segment_keys_size[i]  = sizeof(segment_key_t);
+            segment_data_addrs[i] = (void*)(&segment_data[i]);
+            segment_data_size[i]  = sizeof(region_value_t);
+        }
 
         // get the next max_segments segments
         size_t num_segments = max_segments;
-        ret = sdskv_list_keyvals(sdskv_ph, seg_db_id,
+        ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_KV,
+                sdskv_list_keyvals(sdskv_ph, seg_db_id,
                     (const void*)&lb, sizeof(lb),
-                    segment_keys_addrs, segment_keys_size,
-                    segment_data_addrs, segment_data_size,
-                    &num_segments);
+                    segment_keys_addrs.data(), segment_keys_size.data(),
+                    segment_data_addrs.data(), segment_data_size.data(),
+                    &num_segments));
 
         if(ret != SDSKV_SUCCESS) {
             ERROR fprintf(stderr, "sdskv_list_keyvals returned %d\n", ret);
-            *prval = -1;
             LEAVING;
-            return;
+            return -1;
         }
 
+        // note: a segment seen twice (if lb is included in the listing)
+        // is harmless, since both the coverage maps and the size are idempotent
         size_t i;
-        for(i=seg_start_ndx; i < num_segments; i++) {
+        for(i=0; i < num_segments; i++) {
+
+            const segment_key_t&  seg    = segment_keys[i];
+            const region_value_t& region = segment_data[i];
 
-            const segment_key_t&    seg    = segment_keys[i];
-            const bake_region_id_t& region = segment_data[i];
-       
-            if(seg.oid != oid || coverage.full()) {
+            if(seg.oid != oid || (size_done && reads_done == args->reads.size())) {
                 done = true;
                 break;
             }
 
-            switch(seg.type) {
-
-                case seg_type_t::ZERO:
-                    coverage.set(seg.start_index, seg.end_index);
-                    break;
+            if(!size_done) {
+                if(seg.type < seg_type_t::TOMBSTONE) {
+                    if(size < seg.end_index) {
+                        size = std::min(seg.end_index, max_size);
+                    }
+                } else if(seg.type == seg_type_t::TOMBSTONE) {
+                    if(max_size > seg.start_index) {
+                        max_size = seg.start_index;
+                    }
+                    if(size < seg.start_index) {
+                        size = seg.start_index;
+                    }
+                    size_done = true;
+                }
+            }
 
-                case seg_type_t::TOMBSTONE:
-                    coverage.set(seg.start_index, seg.end_index);
-                    break;
+            for(auto& r : args->reads) {
+
+                if(r.coverage.full()) continue;
+
+                auto ranges = r.coverage.set(seg.start_index, seg.end_index);
+                if(r.coverage.full()) reads_done += 1;
+
+                if(seg.type != seg_type_t::BAKE_REGION
+                && seg.type != seg_type_t::SMALL_REGION) continue;
+
+                bake_target_id_t target = core_region_target(vargs->srv_ctx,
+                        &region, segment_data_size[i]);
+                for(auto& range : ranges) {
+                    read_transfer_t t;
+                    t.type          = static_cast<seg_type_t>(seg.type);
+                    t.region        = region.region;
+                    t.target        = target;
+                    t.region_offset = range.start - seg.start_index;
+                    t.remote_offset = r.buf.as_offset + range.start - r.offset;
+                    t.size          = range.end - range.start;
+                    t.prval         = r.prval;
+                    transfers.push_back(t);
+                }
+            }
 
-                case seg_type_t::BAKE_REGION: {
-                    auto ranges = coverage.set(seg.start_index, seg.end_index);
-                    for(auto r : ranges) {
-                        uint64_t segment_size  = r.end - r.start;
-                        uint64_t region_offset = r.start - seg.start_index;
-                        uint64_t remote_offset = r.start - offset;
-                        uint64_t bytes_read = 0;
-                        ret = bake_proxy_read(bph, bti, region, region_offset, remote_bulk,
-                                remote_offset, remote_addr_str, segment_size, &bytes_read);
-                        if(ret != 0) {
-                            *prval = -1;
-                            ERROR fprintf(stderr,"bake_proxy_read returned %d\n", ret);
-                            LEAVING;
-                            return;
-                        }
-                        else if (bytes_read != segment_size) {
-                            *prval = -1;
-                            ERROR fprintf(stderr,"bake_proxy_read invalid read of %" PRIu64 \
-                                                 " (requested=%" PRIu64 ")\n", bytes_read, segment_size);
-                            LEAVING;
-                            return;
-                        }
-                    }
-                    break;
-                } // end case seg_type_t::BAKE_REGION
-
-                case seg_type_t::SMALL_REGION: {
-                    auto ranges = coverage.set(seg.start_index, seg.end_index);
-                    const char* base = static_cast<const char*>((void*)(&region));
-                    margo_instance_id mid = vargs->srv_ctx->mid;
-                    for(auto r : ranges) {
-                        uint64_t segment_size  = r.end - r.start;
-                        uint64_t region_offset = r.start - seg.start_index;
-                        uint64_t remote_offset = r.start - offset;
-                        void* buf_ptrs[1] = { const_cast<char*>(base + region_offset) };
-                        hg_size_t buf_sizes[1] = { segment_size };
-                        hg_bulk_t handle;
-                        ret = margo_bulk_create(mid,1, buf_ptrs, buf_sizes, HG_BULK_READ_ONLY, &handle);
-                        if(ret != HG_SUCCESS) {
-                            ERROR fprintf(stderr,"margo_bulk_create returned %d\n", ret);
-                            LEAVING;
-                            *prval = -1;
-                            return;
-                        } // end if
-                        ret = margo_bulk_transfer(mid, HG_BULK_PUSH, 
-                                remote_addr, remote_bulk, 
-                                buf.as_offset+remote_offset, 
-                                handle, 0, segment_size);
-                        if(ret != HG_SUCCESS) {
-                            ERROR fprintf(stderr,"margo_bulk_transfer returned %d\n", ret);
-                            *prval = -1;
-                            LEAVING;
-                            return;
-                        } // end if
-                        ret = margo_bulk_free(handle);
-                        if(ret != HG_SUCCESS) {
-                            ERROR fprintf(stderr,"margo_bulk_free returned %d\n", ret);
-                            *prval = -1;
-                            LEAVING;
-                            return;
-                        } // end if
-                    } // end for
-                } // end case seg_type_t::SMALL_REGION
-
-            } // end switch
             // update the start key timestamp to that of the last processed segment
             lb.timestamp = seg.timestamp;
             lb.seq_id = seg.seq_id;
         } // end for
 
-        seg_start_ndx = 1;
         if(num_segments != max_segments) done = true;
     }
-    *bytes_read = coverage.bytes_read();
+
+    for(auto& s : args->stats) {
+        *(s.psize) = size;
+    }
+    for(auto& r : args->reads) {
+        *(r.bytes_read) = r.coverage.bytes_read();
+    }
+
+    LEAVING;
+    return 0;
+}
+
+/**
+ * Issues the transfers resolved by resolve_segments. Data held in
+ * SMALL_REGION segments is gathered in a single local buffer so that
+ * only one bulk handle needs to be created for all of them. If the
+ * caller provides a local copy of the client's buffers (batches of
+ * reads), the data is placed in it instead, to be pushed at once.
+ */
+static void issue_read_transfers(read_op_exec_args* args,
+        const std::vector<read_transfer_t>& transfers)
+{
+    ENTERING;
+    auto vargs = args->vargs;
+    bake_provider_handle_t bph = vargs->srv_ctx->bake_ph;
+    hg_bulk_t remote_bulk = vargs->bulk_handle;
+    const char* remote_addr_str = vargs->client_addr_str;
+    hg_addr_t   remote_addr     = vargs->client_addr;
+    margo_instance_id mid = vargs->srv_ctx->mid;
+    int ret;
+
+    if(vargs->local_data) {
+        for(auto& t : transfers) {
+            char* dst = vargs->local_data + t.remote_offset;
+            if(t.type == seg_type_t::BAKE_REGION) {
+                uint64_t bytes_read = 0;
+                ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_BAKE,
+                        bake_read(bph, t.target, t.region, t.region_offset, dst, t.size, &bytes_read));
+                if(ret != 0 || bytes_read != t.size) {
+                    *(t.prval) = -1;
+                    ERROR fprintf(stderr,"bake_read returned %d\n", ret);
+                }
+            } else if(t.type == seg_type_t::SMALL_REGION) {
+                const char* base = reinterpret_cast<const char*>(&t.region);
+                memcpy(dst, base + t.region_offset, t.size);
+            }
+        }
+        LEAVING;
+        return;
+    }
+
+    size_t small_size = 0;
+    for(auto& t : transfers) {
+        if(t.type == seg_type_t::SMALL_REGION) small_size += t.size;
+    }
+
+    std::vector<char> small_data(small_size);
+    hg_bulk_t small_handle = HG_BULK_NULL;
+    if(small_size != 0) {
+        void* buf_ptrs[1] = { (void*)small_data.data() };
+        hg_size_t buf_sizes[1] = { small_size };
+        ret = margo_bulk_create(mid, 1, buf_ptrs, buf_sizes, HG_BULK_READ_ONLY, &small_handle);
+        if(ret != HG_SUCCESS) {
+            ERROR fprintf(stderr,"margo_bulk_create returned %d\n", ret);
+            small_handle = HG_BULK_NULL;
+        }
+    }
+
+    size_t small_offset = 0;
+    for(auto& t : transfers) {
+
+        switch(t.type) {
+
+            case seg_type_t::BAKE_REGION: {
+                uint64_t bytes_read = 0;
+                ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_BAKE,
+                        bake_proxy_read(bph, t.target, t.region, t.region_offset, remote_bulk,
+                            t.remote_offset, remote_addr_str, t.size, &bytes_read));
+                if(ret != 0) {
+                    *(t.prval) = -1;
+                    ERROR fprintf(stderr,"bake_proxy_read returned %d\n", ret);
+                }
+                else if (bytes_read != t.size) {
+                    *(t.prval) = -1;
+                    ERROR fprintf(stderr,"bake_proxy_read invalid read of %" PRIu64 \
+                                         " (requested=%" PRIu64 ")\n", bytes_read, t.size);
+                }
+                break;
+            } // end case seg_type_t::BAKE_REGION
+
+            case seg_type_t::SMALL_REGION: {
+                if(small_handle == HG_BULK_NULL) {
+                    *(t.prval) = -1;
+                    break;
+                }
+                const char* base = reinterpret_cast<const char*>(&t.region);
+                memcpy(small_data.data() + small_offset, base + t.region_offset, t.size);
+                ret = margo_bulk_transfer(mid, HG_BULK_PUSH,
+                        remote_addr, remote_bulk,
+                        t.remote_offset,
+                        small_handle, small_offset, t.size);
+                if(ret != HG_SUCCESS) {
+                    *(t.prval) = -1;
+                    ERROR fprintf(stderr,"margo_bulk_transfer returned %d\n", ret);
+                } // end if
+                small_offset += t.size;
+                break;
+            } // end case seg_type_t::SMALL_REGION
+
+            default:
+                break;
+        } // end switch
+    }
+
+    if(small_handle != HG_BULK_NULL) {
+        ret = margo_bulk_free(small_handle);
+        if(ret != HG_SUCCESS) {
+            ERROR fprintf(stderr,"margo_bulk_free returned %d\n", ret);
+        }
+    }
     LEAVING;
 }
 
@@ -281,7 +493,7 @@ void read_op_exec_omap_get_keys(void* u, const char* start_after, uint64_t max_r
 				mobject_store_omap_iter_t* iter, int* prval)
 {
     ENTERING;
-    auto vargs = static_cast<server_visitor_args_t>(u);
+    auto vargs = static_cast<read_op_exec_args*>(u)->vargs;
     const char* object_name = vargs->object_name;
     sdskv_provider_handle_t sdskv_ph = vargs->srv_ctx->sdskv_ph;
     sdskv_database_id_t omap_db_id = vargs->srv_ctx->omap_db_id;
@@ -312,10 +524,11 @@ void read_op_exec_omap_get_keys(void* u, const char* start_after, uint64_t max_r
     hg_size_t keys_retrieved = max_keys;
     hg_size_t count = 0;
     do {
-        ret = sdskv_list_keys(sdskv_ph, omap_db_id,
-                (const void*)lb, lb_size,
-                keys.data(), ksizes.data(),
-                &keys_retrieved);
+        ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_KV,
+                sdskv_list_keys(sdskv_ph, omap_db_id,
+                    (const void*)lb, lb_size,
+                    keys.data(), ksizes.data(),
+                    &keys_retrieved));
         if(ret != SDSKV_SUCCESS) {
             *prval = -1;
             ERROR fprintf(stderr, "sdskv_list_keys returned %d\n", ret);
@@ -343,7 +556,7 @@ out:
 void read_op_exec_omap_get_vals(void* u, const char* start_after, const char* filter_prefix, uint64_t max_return, mobject_store_omap_iter_t* iter, int* prval)
 {
     ENTERING;
-    auto vargs = static_cast<server_visitor_args_t>(u);
+    auto vargs = static_cast<read_op_exec_args*>(u)->vargs;
     const char* object_name = vargs->object_name;
     sdskv_provider_handle_t sdskv_ph = vargs->srv_ctx->sdskv_ph;
     sdskv_database_id_t omap_db_id = vargs->srv_ctx->omap_db_id;
@@ -393,13 +606,14 @@ void read_op_exec_omap_get_vals(void* u, const char* start_after, const char* fi
     hg_size_t items_retrieved = max_items;
     hg_size_t count = 0;
     do {
-        ret = sdskv_list_keyvals_with_prefix(
-                sdskv_ph, omap_db_id,
-                (const void*)lb, lb_size,
-                (const void*)prefix, prefix_actual_size,
-                keys.data(), ksizes.data(),
-                vals.data(), vsizes.data(),
-                &items_retrieved);
+        ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_KV,
+                sdskv_list_keyvals_with_prefix(
+                    sdskv_ph, omap_db_id,
+                    (const void*)lb, lb_size,
+                    (const void*)prefix, prefix_actual_size,
+                    keys.data(), ksizes.data(),
+                    vals.data(), vsizes.data(),
+                    &items_retrieved));
         if(ret != SDSKV_SUCCESS) {
             *prval = -1;
             ERROR fprintf(stderr, "sdskv_list_keyvals_with_prefix returned %d\n", ret);
@@ -428,7 +642,7 @@ out:
 void read_op_exec_omap_get_vals_by_keys(void* u, char const* const* keys, size_t num_keys, mobject_store_omap_iter_t* iter, int* prval)
 {
     ENTERING;
-    auto vargs = static_cast<server_visitor_args_t>(u);
+    auto vargs = static_cast<read_op_exec_args*>(u)->vargs;
     const char* object_name = vargs->object_name;
     sdskv_provider_handle_t sdskv_ph = vargs->srv_ctx->sdskv_ph;
     sdskv_database_id_t omap_db_id = vargs->srv_ctx->omap_db_id;
@@ -462,17 +676,19 @@ void read_op_exec_omap_get_vals_by_keys(void* u, char const* const* keys, size_t
         strcpy(key->key, keys[i]);
         // get length of the value
         hg_size_t vsize;
-        ret = sdskv_length(sdskv_ph, omap_db_id, 
-                (const void*)key, ksizes[i], &vsize);
+        ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_KV,
+                sdskv_length(sdskv_ph, omap_db_id,
+                    (const void*)key, ksizes[i], &vsize));
         if(ret != SDSKV_SUCCESS) {
             *prval = -1;
             ERROR fprintf(stderr, "sdskv_length returned %d\n", ret);
             break;
         }
         std::vector<char> value(vsize);
-        ret = sdskv_get(sdskv_ph, omap_db_id,
-                (const void*)key, ksizes[i],
-                (void*)value.data(), &vsize);
+        ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_KV,
+                sdskv_get(sdskv_ph, omap_db_id,
+                    (const void*)key, ksizes[i],
+                    (void*)value.data(), &vsize));
         if(ret != SDSKV_SUCCESS) {
             *prval = -1;
             ERROR fprintf(stderr, "sdskv_get returned %d\n", ret);
@@ -485,7 +701,32 @@ void read_op_exec_omap_get_vals_by_keys(void* u, char const* const* keys, size_t
 
 void read_op_exec_end(void* u)
 {
-    auto vargs = static_cast<server_visitor_args_t>(u);
+    ENTERING;
+    auto args = static_cast<read_op_exec_args*>(u);
+    if(args->reads.empty() && args->stats.empty()) {
+        LEAVING;
+        return;
+    }
+
+    struct mobject_server_context* srv_ctx = args->vargs->srv_ctx;
+    double start = ABT_get_wtime();
+    std::vector<read_transfer_t> transfers;
+    int ret = resolve_segments(args, transfers);
+    if(ret != 0) {
+        for(auto& r : args->reads) *(r.prval) = -1;
+        for(auto& s : args->stats) *(s.prval) = -1;
+    } else {
+        issue_read_transfers(args, transfers);
+    }
+
+    /* the stats and reads of the read_op are resolved together,
+       each of them is accounted for the time they took */
+    for(size_t i = 0; i < args->stats.size(); i++)
+        core_metrics_op(srv_ctx, CORE_OP_STAT, start, 0, 0);
+    for(auto& r : args->reads)
+        core_metrics_op(srv_ctx, CORE_OP_READ, start, 0,
+                *(r.prval) == 0 ? *(r.bytes_read) : 0);
+    LEAVING;
 }
 
 static oid_t get_oid_from_name( 
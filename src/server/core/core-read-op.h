@@ -16,6 +16,17 @@ extern "C" {
 
 void core_read_op(mobject_store_read_op_t read_op, server_visitor_args_t vargs);
 
+/**
+ * Executes a batch of read_ops, read_ops[i] targeting object_names[i].
+ * The oids of the objects are looked up all together beforehand.
+ * If vargs->local_data is set, the data read is placed in it at the
+ * offsets of the read actions instead of being pushed to the client.
+ */
+void core_read_op_batch(mobject_store_read_op_t* read_ops,
+                        const char* const* object_names,
+                        size_t count,
+                        server_visitor_args_t vargs);
+
 #ifdef __cplusplus
 }
 #endif
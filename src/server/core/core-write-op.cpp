@@ -4,13 +4,21 @@
  * See COPYRIGHT in top-level directory.
  */
 #include <map>
+#include <vector>
 #include <cstring>
 #include <string>
 #include <iostream>
 #include <limits>
+#include <ctime>
 #include <bake-client.h>
 #include "src/server/visitor-args.h"
+#include "src/server/core/core-write-op.h"
+#include "src/server/core/core-oid-cache.h"
+#include "src/server/core/core-metrics.h"
+#include "src/server/core/core-migrate.h"
 #include "src/io-chain/write-op-visitor.h"
+#include "src/io-chain/write-op-impl.h"
+#include "src/util/utlist.h"
 
 #if 0
 static int tabs = 0;
@@ -36,29 +44,34 @@ static void write_op_exec_zero(void*, uint64_t, uint64_t);
 static void write_op_exec_omap_set(void*, char const* const*, char const* const*, const size_t*, size_t);
 static void write_op_exec_omap_rm_keys(void*, char const* const*, size_t);
 
-static oid_t get_or_create_oid(
+oid_t get_or_create_oid(
         sdskv_provider_handle_t ph,
         sdskv_database_id_t name_db_id,
         sdskv_database_id_t oid_db_id,
         const char* object_name);
 
+int remove_object(
+        struct mobject_server_context *srv_ctx,
+        const char* object_name,
+        oid_t oid);
+
 static void insert_region_log_entry(
-                struct mobject_server_context *srv_ctx,
+                server_visitor_args_t vargs,
                 oid_t oid, uint64_t offset, uint64_t len, 
-                bake_region_id_t* region, time_t ts = 0);
+                region_value_t* region, time_t ts = 0);
 
 static void insert_small_region_log_entry(
-                struct mobject_server_context *srv_ctx,
+                server_visitor_args_t vargs,
                 oid_t oid, uint64_t offset, uint64_t len,
                 const char* data, time_t ts = 0);
 
 static void insert_zero_log_entry(
-                struct mobject_server_context *srv_ctx,
+                server_visitor_args_t vargs,
                 oid_t oid, uint64_t offset, 
                 uint64_t len, time_t ts=0);
 
 static void insert_punch_log_entry(
-                struct mobject_server_context *srv_ctx,
+                server_visitor_args_t vargs,
                 oid_t oid, uint64_t offset, time_t ts=0);
 
 uint64_t mobject_compute_object_size(
@@ -66,25 +79,189 @@ uint64_t mobject_compute_object_size(
                 sdskv_database_id_t seg_db_id,
                 oid_t oid, time_t ts);
 
+/* segment entries of a batch of write_ops, put in the KV store with
+   a single sdskv_put_multi when the batch completes, or before an
+   action that needs to read the segments of an object */
+struct segment_batch {
+    std::vector<segment_key_t> keys;
+    std::vector<std::string>   values;
+};
+
+static void put_segment(
+                server_visitor_args_t vargs,
+                const segment_key_t& seg,
+                const void* value, size_t vsize);
+
+static void flush_segment_batch(
+                struct mobject_server_context *srv_ctx,
+                struct segment_batch* batch);
+
+/* writes made with LIBMOBJECT_OPERATION_DEFER_PERSIST are acknowledged
+   before their bake regions are persisted and their segment entries are
+   put in the KV store; the persist ULT does both for all the writes that
+   accumulated since its last pass, then marks them as safe */
+struct persist_log {
+    std::vector<std::pair<region_value_t, uint64_t>> regions; // regions and their size
+    struct segment_batch                              segments;
+};
+
+static int persist_region(
+                server_visitor_args_t vargs,
+                const region_value_t& region, uint64_t len);
+
+static int create_region(
+                server_visitor_args_t vargs,
+                buffer_u buf, size_t len,
+                region_value_t* region);
+
+static void persist_ult(void* arg);
+
+static void commit_segment(
+                struct mobject_server_context *srv_ctx,
+                const segment_key_t& seg,
+                const void* value, size_t vsize);
+
+static int pull_small_region(
+                server_visitor_args_t vargs,
+                buffer_u buf, char* data, size_t len);
+
+static int write_region(
+                server_visitor_args_t vargs,
+                const region_value_t& region,
+                buffer_u buf, size_t len);
+
+/* the visitor counts and times each action around its execution */
+#define METERED(op, bytes_in, call) do { \
+        auto _vargs = static_cast<server_visitor_args_t>(u); \
+        double _start = ABT_get_wtime(); \
+        call; \
+        core_metrics_op(_vargs->srv_ctx, op, _start, bytes_in, 0); \
+    } while(0)
+
+static void metered_create(void* u, int exclusive)
+{ METERED(CORE_OP_CREATE, 0, write_op_exec_create(u, exclusive)); }
+
+static void metered_write(void* u, buffer_u buf, size_t len, uint64_t offset)
+{ METERED(CORE_OP_WRITE, len, write_op_exec_write(u, buf, len, offset)); }
+
+static void metered_write_full(void* u, buffer_u buf, size_t len)
+{ METERED(CORE_OP_WRITE_FULL, len, write_op_exec_write_full(u, buf, len)); }
+
+static void metered_writesame(void* u, buffer_u buf, size_t data_len, size_t write_len, uint64_t offset)
+{ METERED(CORE_OP_WRITESAME, data_len, write_op_exec_writesame(u, buf, data_len, write_len, offset)); }
+
+static void metered_append(void* u, buffer_u buf, size_t len)
+{ METERED(CORE_OP_APPEND, len, write_op_exec_append(u, buf, len)); }
+
+static void metered_remove(void* u)
+{ METERED(CORE_OP_REMOVE, 0, write_op_exec_remove(u)); }
+
+static void metered_truncate(void* u, uint64_t offset)
+{ METERED(CORE_OP_TRUNCATE, 0, write_op_exec_truncate(u, offset)); }
+
+static void metered_zero(void* u, uint64_t offset, uint64_t len)
+{ METERED(CORE_OP_ZERO, 0, write_op_exec_zero(u, offset, len)); }
+
+static void metered_omap_set(void* u, char const* const* keys, char const* const* vals,
+        const size_t* lens, size_t num)
+{
+    size_t bytes = 0;
+    for(size_t i = 0; i < num; i++) bytes += strlen(keys[i]) + lens[i];
+    METERED(CORE_OP_OMAP_SET, bytes, write_op_exec_omap_set(u, keys, vals, lens, num));
+}
+
+static void metered_omap_rm_keys(void* u, char const* const* keys, size_t num_keys)
+{ METERED(CORE_OP_OMAP_RM_KEYS, 0, write_op_exec_omap_rm_keys(u, keys, num_keys)); }
+
 static struct write_op_visitor write_op_exec = {
 	.visit_begin        = write_op_exec_begin,
-	.visit_create       = write_op_exec_create,
-	.visit_write        = write_op_exec_write,
-	.visit_write_full   = write_op_exec_write_full,
-	.visit_writesame    = write_op_exec_writesame,
-	.visit_append       = write_op_exec_append,
-	.visit_remove       = write_op_exec_remove,
-	.visit_truncate     = write_op_exec_truncate,
-	.visit_zero         = write_op_exec_zero,
-	.visit_omap_set     = write_op_exec_omap_set,
-	.visit_omap_rm_keys = write_op_exec_omap_rm_keys,
+	.visit_create       = metered_create,
+	.visit_write        = metered_write,
+	.visit_write_full   = metered_write_full,
+	.visit_writesame    = metered_writesame,
+	.visit_append       = metered_append,
+	.visit_remove       = metered_remove,
+	.visit_truncate     = metered_truncate,
+	.visit_zero         = metered_zero,
+	.visit_omap_set     = metered_omap_set,
+	.visit_omap_rm_keys = metered_omap_rm_keys,
 	.visit_end          = write_op_exec_end
 };
 
 extern "C" void core_write_op(mobject_store_write_op_t write_op, server_visitor_args_t vargs)
 {
 	/* Execute the operation chain */
+    core_migration_write_begin(vargs->srv_ctx, vargs->object_name);
 	execute_write_op_visitor(&write_op_exec, write_op, (void*)vargs);
+    core_migration_write_end(vargs->srv_ctx, vargs->object_name);
+
+    /* deferred writes become safe once the persist ULT has processed
+       everything logged up to the ticket they get here */
+    if(vargs->defer_persist) {
+        struct mobject_server_context* srv_ctx = vargs->srv_ctx;
+        ABT_mutex_lock(srv_ctx->persist_mutex);
+        vargs->safe_seq = ++srv_ctx->persist_seq;
+        ABT_cond_broadcast(srv_ctx->persist_cond);
+        ABT_mutex_unlock(srv_ctx->persist_mutex);
+    }
+}
+
+extern "C" void core_write_op_batch(
+        mobject_store_write_op_t* write_ops,
+        const char* const* object_names,
+        const uint64_t* bulk_offsets,
+        size_t count,
+        server_visitor_args_t vargs)
+{
+    struct mobject_server_context* srv_ctx = vargs->srv_ctx;
+    std::vector<oid_t> oids(count, 0);
+    struct segment_batch batch;
+    bool removes = false;
+    size_t i;
+
+    for(i = 0; i < count; i++) {
+        wr_action_base_t action;
+        DL_FOREACH(write_ops[i]->actions, action) {
+            if(action->type == WRITE_OPCODE_REMOVE) removes = true;
+        }
+    }
+
+    /* look up the oids of all the objects at once, unless an object
+       may be removed and created again within the batch */
+    if(!removes && count > 0) {
+        std::vector<const void*> keys(count);
+        std::vector<hg_size_t>   ksizes(count);
+        std::vector<void*>       values(count);
+        std::vector<hg_size_t>   vsizes(count, sizeof(oid_t));
+        for(i = 0; i < count; i++) {
+            keys[i]   = (const void*)object_names[i];
+            ksizes[i] = strlen(object_names[i])+1;
+            values[i] = (void*)&oids[i];
+        }
+        int ret = CORE_METERED(srv_ctx, CORE_CALL_KV,
+                sdskv_get_multi(srv_ctx->sdskv_ph, srv_ctx->name_db_id, count,
+                    keys.data(), ksizes.data(), values.data(), vsizes.data()));
+        for(i = 0; i < count; i++) {
+            if(ret != SDSKV_SUCCESS || vsizes[i] != sizeof(oid_t))
+                oids[i] = 0;
+        }
+    }
+
+    /* new objects get their oid in write_op_exec_begin, and
+       segment entries are put all together at the end */
+    for(i = 0; i < count; i++)
+        core_migration_write_begin(srv_ctx, object_names[i]);
+    vargs->seg_batch = &batch;
+    for(i = 0; i < count; i++) {
+        vargs->object_name = object_names[i];
+        vargs->oid         = oids[i];
+        vargs->bulk_offset = bulk_offsets[i];
+        execute_write_op_visitor(&write_op_exec, write_ops[i], (void*)vargs);
+    }
+    flush_segment_batch(srv_ctx, &batch);
+    vargs->seg_batch = NULL;
+    for(i = 0; i < count; i++)
+        core_migration_write_end(srv_ctx, object_names[i]);
 }
 
 void write_op_exec_begin(void* u)
@@ -93,8 +270,15 @@ void write_op_exec_begin(void* u)
     sdskv_provider_handle_t sdskv_ph = vargs->srv_ctx->sdskv_ph;
     sdskv_database_id_t name_db_id = vargs->srv_ctx->name_db_id;
     sdskv_database_id_t oid_db_id  = vargs->srv_ctx->oid_db_id;
-    oid_t oid = get_or_create_oid(sdskv_ph, name_db_id, oid_db_id, vargs->object_name);
-    vargs->oid = oid;
+    uint64_t gen = 0;
+    /* batches look up the oids of their objects beforehand */
+    if(vargs->oid == 0)
+        vargs->oid = core_oid_cache_lookup(vargs->srv_ctx, vargs->object_name, &gen);
+    if(vargs->oid == 0) {
+        vargs->oid = CORE_METERED(vargs->srv_ctx, CORE_CALL_KV,
+                get_or_create_oid(sdskv_ph, name_db_id, oid_db_id, vargs->object_name));
+        core_oid_cache_insert(vargs->srv_ctx, vargs->object_name, vargs->oid, gen);
+    }
 }
 
 void write_op_exec_end(void* u)
@@ -127,12 +311,7 @@ void write_op_exec_write(void* u, buffer_u buf, size_t len, uint64_t offset)
     }
 
     struct mobject_server_context *srv_ctx = vargs->srv_ctx;
-    bake_provider_handle_t bake_ph = srv_ctx->bake_ph;
-    bake_target_id_t bti = srv_ctx->bake_tid;
-    bake_region_id_t rid;
-    hg_bulk_t remote_bulk = vargs->bulk_handle;
-    const char* remote_addr_str = vargs->client_addr_str;
-    hg_addr_t   remote_addr     = vargs->client_addr;
+    region_value_t region;
     double wr_start, wr_end;
 
     int ret;
@@ -146,41 +325,18 @@ void write_op_exec_write(void* u, buffer_u buf, size_t len, uint64_t offset)
     ABT_mutex_unlock(srv_ctx->stats_mutex);
 
     if(len > SMALL_REGION_THRESHOLD) {
-        ret = bake_create(bake_ph, bti, len, &rid);
+        ret = create_region(vargs, buf, len, &region);
         if(ret != 0) {
-            ERROR bake_perror("bake_create",ret);
+            LEAVING;
             return;
         }
-        ret = bake_proxy_write(bake_ph, bti, rid, 0, remote_bulk, buf.as_offset, remote_addr_str, len);
-        if(ret != 0) {
-            ERROR bake_perror( "bake_proxy_write", ret);
-        }
-        ret = bake_persist(bake_ph, bti, rid, 0, len);
-        if(ret != 0) {
-            ERROR bake_perror("bake_persist", ret);
-        }
-   
-        insert_region_log_entry(srv_ctx, oid, offset, len, &rid);
+
+        insert_region_log_entry(vargs, oid, offset, len, &region);
     } else {
-        margo_instance_id mid = vargs->srv_ctx->mid;
         char data[SMALL_REGION_THRESHOLD];
-        void* buf_ptrs[1] = {(void*)(&data[0])};
-        hg_size_t buf_sizes[1] = {len};
-        hg_bulk_t handle;
-        ret = margo_bulk_create(mid,1, buf_ptrs, buf_sizes, HG_BULK_WRITE_ONLY, &handle);
-        if(ret != 0) {
-            ERROR fprintf(stderr, "margo_bulk_create returned %d\n", ret);
-        }
-        ret = margo_bulk_transfer(mid, HG_BULK_PULL, remote_addr, remote_bulk, buf.as_offset, handle, 0, len);
-        if(ret != 0) {
-            ERROR fprintf(stderr, "margo_bulk_transfer returned %d\n", ret);
-        }
-        ret = margo_bulk_free(handle);
-        if(ret != 0) {
-            ERROR fprintf(stderr, "margo_bulk_free returned %d\n", ret);
-        }
+        ret = pull_small_region(vargs, buf, data, len);
 
-        insert_small_region_log_entry(srv_ctx, oid, offset, len, data);
+        insert_small_region_log_entry(vargs, oid, offset, len, data);
     }
 
     ABT_mutex_lock(srv_ctx->stats_mutex);
@@ -218,32 +374,14 @@ void write_op_exec_writesame(void* u, buffer_u buf, size_t data_len, size_t writ
         return;
     }
 
-    hg_bulk_t remote_bulk = vargs->bulk_handle;
-    const char* remote_addr_str = vargs->client_addr_str;
-    hg_addr_t   remote_addr     = vargs->client_addr;
     int ret;
 
     if(data_len > SMALL_REGION_THRESHOLD) {
 
-        bake_provider_handle_t bph = vargs->srv_ctx->bake_ph;
-        bake_target_id_t bti = vargs->srv_ctx->bake_tid;
-        bake_region_id_t rid;
+        region_value_t region;
 
-        ret = bake_create(bph, bti, data_len, &rid);
-        if(ret != 0) {
-            ERROR bake_perror("bake_create", ret);
-            LEAVING;
-            return;
-        }
-        ret = bake_proxy_write(bph, bti, rid, 0, remote_bulk, buf.as_offset, remote_addr_str, data_len);
+        ret = create_region(vargs, buf, data_len, &region);
         if(ret != 0) {
-            ERROR bake_perror("bake_proxy_write", ret);
-            LEAVING;
-            return;
-        }
-        ret = bake_persist(bph, bti, rid, 0, data_len);
-        if(ret != 0) {
-            ERROR bake_perror("bake_persist", ret);
             LEAVING;
             return;
         }
@@ -253,33 +391,18 @@ void write_op_exec_writesame(void* u, buffer_u buf, size_t data_len, size_t writ
         //time_t ts = time(NULL);
         for(i=0; i < write_len; i += data_len) {
             // TODO normally we should have the same timestamps but right now it bugs...
-            insert_region_log_entry(vargs->srv_ctx, oid, offset+i,
-                    std::min(data_len, write_len - i), &rid);//, ts);
+            insert_region_log_entry(vargs, oid, offset+i,
+                    std::min(data_len, write_len - i), &region);//, ts);
         }
 
     } else {
         
-        margo_instance_id mid = vargs->srv_ctx->mid;
         char data[SMALL_REGION_THRESHOLD];
-        void* buf_ptrs[1] = {(void*)(&data[0])};
-        hg_size_t buf_sizes[1] = {data_len};
-        hg_bulk_t handle;
-        ret = margo_bulk_create(mid,1, buf_ptrs, buf_sizes, HG_BULK_WRITE_ONLY, &handle);
-        if(ret != 0) {
-            ERROR fprintf(stderr, "margo_bulk_create returned %d\n", ret);
-        }
-        ret = margo_bulk_transfer(mid, HG_BULK_PULL, remote_addr, remote_bulk, buf.as_offset, handle, 0, data_len);
-        if(ret != 0) {
-            ERROR fprintf(stderr, "margo_bulk_transfer returned %d\n", ret);
-        }
-        ret = margo_bulk_free(handle);
-        if(ret != 0) {
-            ERROR fprintf(stderr, "margo_bulk_free returned %d\n", ret);
-        }
+        ret = pull_small_region(vargs, buf, data, data_len);
 
         size_t i;
         for(i=0; i < write_len; i+= data_len) {
-            insert_small_region_log_entry(vargs->srv_ctx, oid, offset+i,
+            insert_small_region_log_entry(vargs, oid, offset+i,
                     std::min(data_len, write_len-i), data);
         }
     }
@@ -297,52 +420,34 @@ void write_op_exec_append(void* u, buffer_u buf, size_t len)
         return;
     }
 
-    hg_bulk_t remote_bulk = vargs->bulk_handle;
-    const char* remote_addr_str = vargs->client_addr_str;
-    hg_addr_t   remote_addr     = vargs->client_addr;
     int ret;
 
-     // find out the current length of the object
+    // find out the current length of the object
+    if(vargs->seg_batch) flush_segment_batch(vargs->srv_ctx, vargs->seg_batch);
+    core_flush_segment_log(vargs->srv_ctx);
     time_t ts = time(NULL);
-    uint64_t offset = mobject_compute_object_size(vargs->srv_ctx->sdskv_ph,
-            vargs->srv_ctx->segment_db_id, oid, ts);
+    uint64_t offset = CORE_METERED(vargs->srv_ctx, CORE_CALL_KV,
+            mobject_compute_object_size(vargs->srv_ctx->sdskv_ph,
+                vargs->srv_ctx->segment_db_id, oid, ts));
 
     if(len > SMALL_REGION_THRESHOLD) {
 
-        bake_provider_handle_t bph = vargs->srv_ctx->bake_ph;
-        bake_target_id_t bti = vargs->srv_ctx->bake_tid;
-        bake_region_id_t rid;
+        region_value_t region;
 
-        ret = bake_create(bph, bti, len, &rid);
-        if (ret != 0) bake_perror("bake_create", ret);
-        ret = bake_proxy_write(bph, bti, rid, 0, remote_bulk, buf.as_offset, remote_addr_str, len);
-        if (ret != 0) bake_perror("bake_proxy_write", ret);
-        ret = bake_persist(bph, bti, rid, 0, len);
-        if (ret != 0) bake_perror("bake_persist", ret);
+        ret = create_region(vargs, buf, len, &region);
+        if(ret != 0) {
+            LEAVING;
+            return;
+        }
 
-        insert_region_log_entry(vargs->srv_ctx, oid, offset, len, &rid, ts);
+        insert_region_log_entry(vargs, oid, offset, len, &region, ts);
 
     } else {
 
-        margo_instance_id mid = vargs->srv_ctx->mid;
         char data[SMALL_REGION_THRESHOLD];
-        void* buf_ptrs[1] = {(void*)(&data[0])};
-        hg_size_t buf_sizes[1] = {len};
-        hg_bulk_t handle;
-        ret = margo_bulk_create(mid,1, buf_ptrs, buf_sizes, HG_BULK_WRITE_ONLY, &handle);
-        if(ret != 0) {
-            ERROR fprintf(stderr, "margo_bulk_create returned %d\n", ret);
-        }
-        ret = margo_bulk_transfer(mid, HG_BULK_PULL, remote_addr, remote_bulk, buf.as_offset, handle, 0, len);
-        if(ret != 0) {
-            ERROR fprintf(stderr, "margo_bulk_transfer returned %d\n", ret);
-        }
-        ret = margo_bulk_free(handle);
-        if(ret != 0) {
-            ERROR fprintf(stderr, "margo_bulk_free returned %d\n", ret);
-        }
+        ret = pull_small_region(vargs, buf, data, len);
 
-        insert_small_region_log_entry(vargs->srv_ctx, oid, offset, len, data);
+        insert_small_region_log_entry(vargs, oid, offset, len, data);
     }
     LEAVING;
 }
@@ -351,34 +456,47 @@ void write_op_exec_remove(void* u)
 {
     ENTERING;
 	auto vargs = static_cast<server_visitor_args_t>(u);
-    const char *object_name = vargs->object_name;
-    oid_t oid = vargs->oid;
-    bake_provider_handle_t bake_ph = vargs->srv_ctx->bake_ph;
-    bake_target_id_t bti = vargs->srv_ctx->bake_tid;
-    sdskv_provider_handle_t sdskv_ph = vargs->srv_ctx->sdskv_ph;
-    sdskv_database_id_t name_db_id = vargs->srv_ctx->name_db_id;
-    sdskv_database_id_t oid_db_id = vargs->srv_ctx->oid_db_id;
-    sdskv_database_id_t seg_db_id = vargs->srv_ctx->segment_db_id;
-    int ret;
+    if(vargs->seg_batch) flush_segment_batch(vargs->srv_ctx, vargs->seg_batch);
+    remove_object(vargs->srv_ctx, vargs->object_name, vargs->oid);
+    LEAVING;
+}
 
-    /* remove name->OID entry to make object no longer visible to clients */
-    ret = sdskv_erase(sdskv_ph, name_db_id, (const void *)object_name,
-            strlen(object_name)+1);
+int remove_object(
+        struct mobject_server_context *srv_ctx,
+        const char* object_name,
+        oid_t oid)
+{
+    ENTERING;
+    bake_provider_handle_t bake_ph = srv_ctx->bake_ph;
+    sdskv_provider_handle_t sdskv_ph = srv_ctx->sdskv_ph;
+    sdskv_database_id_t name_db_id = srv_ctx->name_db_id;
+    sdskv_database_id_t oid_db_id = srv_ctx->oid_db_id;
+    sdskv_database_id_t seg_db_id = srv_ctx->segment_db_id;
+    int ret;
+    /* deferred writes may still reference the regions of the object */
+    core_persist_pending(srv_ctx);
+    /* remove name->OID entry to make object no longer visible to clients,
+       then forget it, so that lookups that read it before are not cached */
+    ret = CORE_METERED(srv_ctx, CORE_CALL_KV,
+            sdskv_erase(sdskv_ph, name_db_id, (const void *)object_name,
+                strlen(object_name)+1));
     if(ret != SDSKV_SUCCESS) {
-        ERROR fprintf(stderr,"write_op_exec_remove: "
+        ERROR fprintf(stderr,"remove_object: "
             "error in name_db sdskv_erase() (ret = %d)\n", ret);
         LEAVING;
-        return;
+        return -1;
     }
+    core_oid_cache_erase(srv_ctx, object_name);
 
     /* TODO bg thread for everything beyond this point */
 
-    ret = sdskv_erase(sdskv_ph, oid_db_id, &oid, sizeof(oid));
+    ret = CORE_METERED(srv_ctx, CORE_CALL_KV,
+            sdskv_erase(sdskv_ph, oid_db_id, &oid, sizeof(oid)));
     if(ret != SDSKV_SUCCESS) {
-        ERROR fprintf(stderr,"write_op_exec_remove: "
+        ERROR fprintf(stderr,"remove_object: "
             "error in oid_db sdskv_erase() (ret = %d)\n", ret);
         LEAVING;
-        return;
+        return -1;
     }
 
     segment_key_t lb;
@@ -390,14 +508,12 @@ void write_op_exec_remove(void* u)
     segment_key_t       segment_keys[max_segments];
     void*               segment_keys_addrs[max_segments];
     hg_size_t           segment_keys_size[max_segments];
-    bake_region_id_t    segment_data[max_segments];
+    region_value_t      segment_data[max_segments];
     void*               segment_data_addrs[max_segments];
     hg_size_t           segment_data_size[max_segments];
     for(auto i = 0 ; i < max_segments; i++) {
         segment_keys_addrs[i] = (void*)(&segment_keys[i]);
-        segment_keys_size[i]  = sizeof(segment_key_t);
         segment_data_addrs[i] = (void*)(&segment_data[i]);
-        segment_data_size[i]  = sizeof(bake_region_id_t);
     }
 
     /* iterate over and remove all segments for this oid */
@@ -405,25 +521,30 @@ void write_op_exec_remove(void* u)
     int seg_start_ndx = 0;
     while(!done) {
         size_t num_segments = max_segments;
+        for(auto i = 0 ; i < max_segments; i++) {
+            segment_keys_size[i]  = sizeof(segment_key_t);
+            segment_data_size[i]  = sizeof(region_value_t);
+        }
 
-        ret = sdskv_list_keyvals(sdskv_ph, seg_db_id,
+        ret = CORE_METERED(srv_ctx, CORE_CALL_KV,
+                sdskv_list_keyvals(sdskv_ph, seg_db_id,
                     (const void *)&lb, sizeof(lb),
                     segment_keys_addrs, segment_keys_size,
                     segment_data_addrs, segment_data_size,
-                    &num_segments);
+                    &num_segments));
 
         if(ret != SDSKV_SUCCESS) {
             /* XXX should save the error and keep removing */
-            ERROR fprintf(stderr, "write_op_exec_remove: "
+            ERROR fprintf(stderr, "remove_object: "
                 "error in sdskv_list_keyvals() (ret = %d)\n", ret);
             LEAVING;
-            return;
+            return -1;
         }
 
         size_t i;
         for(i = seg_start_ndx; i < num_segments; i++) {
-            const segment_key_t&    seg    = segment_keys[i];
-            const bake_region_id_t& region = segment_data[i];
+            const segment_key_t&  seg    = segment_keys[i];
+            const region_value_t& region = segment_data[i];
 
             if(seg.oid != oid) {
                 done = true;
@@ -431,21 +552,24 @@ void write_op_exec_remove(void* u)
             }
 
             if(seg.type == seg_type_t::BAKE_REGION) {
-                ret = bake_remove(bake_ph, bti, region);
+                bake_target_id_t bti = core_region_target(srv_ctx, &region, segment_data_size[i]);
+                ret = CORE_METERED(srv_ctx, CORE_CALL_BAKE,
+                        bake_remove(bake_ph, bti, region.region));
                 if (ret != BAKE_SUCCESS) {
                     /* XXX should save the error and keep removing */
-                    ERROR bake_perror("write_op_exec_remove: "
+                    ERROR bake_perror("remove_object: "
                         "error in bake_remove()", ret);
                     LEAVING;
-                    return;
+                    return -1;
                 }
             }
-            ret = sdskv_erase(sdskv_ph, seg_db_id, &seg, sizeof(seg));
+            ret = CORE_METERED(srv_ctx, CORE_CALL_KV,
+                    sdskv_erase(sdskv_ph, seg_db_id, &seg, sizeof(seg)));
             if(ret != SDSKV_SUCCESS) {
-                ERROR fprintf(stderr,"write_op_exec_remove: "
+                ERROR fprintf(stderr,"remove_object: "
                     "error in seg_db sdskv_erase() (ret = %d)\n", ret);
                 LEAVING;
-                return;
+                return -1;
             }
         }
         if(num_segments != max_segments) {
@@ -455,6 +579,7 @@ void write_op_exec_remove(void* u)
     }
 
     LEAVING;
+    return 0;
 }
 
 void write_op_exec_truncate(void* u, uint64_t offset)
@@ -467,7 +592,7 @@ void write_op_exec_truncate(void* u, uint64_t offset)
         LEAVING;
     }
 
-    insert_punch_log_entry(vargs->srv_ctx, oid, offset);
+    insert_punch_log_entry(vargs, oid, offset);
     LEAVING;
 }
 
@@ -482,7 +607,7 @@ void write_op_exec_zero(void* u, uint64_t offset, uint64_t len)
         return;
     }
 
-    insert_zero_log_entry(vargs->srv_ctx, oid, offset, len);
+    insert_zero_log_entry(vargs, oid, offset, len);
     LEAVING;
 }
 
@@ -520,9 +645,10 @@ void write_op_exec_omap_set(void* u, char const* const* keys,
         memset(k, 0, max_k_len + sizeof(omap_key_t));
         k->oid = oid;
         strcpy(k->key, keys[i]);
-        ret = sdskv_put(sdskv_ph, omap_db_id,
-                (const void*)k, k_len,
-                (const void*)vals[i], lens[i]);
+        ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_KV,
+                sdskv_put(sdskv_ph, omap_db_id,
+                    (const void*)k, k_len,
+                    (const void*)vals[i], lens[i]));
         if(ret != SDSKV_SUCCESS) {
             fprintf(stderr, "write_op_exec_omap_set: error in sdskv_put() (ret = %d)\n", ret);
         }
@@ -548,15 +674,16 @@ void write_op_exec_omap_rm_keys(void* u, char const* const* keys, size_t num_key
     }
 
     for(auto i=0; i<num_keys; i++) {
-        ret = sdskv_erase(sdskv_ph, omap_db_id, 
-                (const void*)keys[i], strlen(keys[i])+1);
+        ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_KV,
+                sdskv_erase(sdskv_ph, omap_db_id,
+                    (const void*)keys[i], strlen(keys[i])+1));
         if(ret != SDSKV_SUCCESS)
             fprintf(stderr, "write_op_exec_omap_rm_keys: error in sdskv_erase() (ret = %d)\n", ret);
     }
     LEAVING;
 }
 
-static oid_t get_or_create_oid(
+oid_t get_or_create_oid(
         sdskv_provider_handle_t ph,
         sdskv_database_id_t name_db_id,
         sdskv_database_id_t oid_db_id,
@@ -624,13 +751,12 @@ static oid_t get_or_create_oid(
 }
 
 static void insert_region_log_entry(
-        struct mobject_server_context* srv_ctx,
+        server_visitor_args_t vargs,
         oid_t oid, uint64_t offset, uint64_t len, 
-        bake_region_id_t* region, time_t ts)
+        region_value_t* region, time_t ts)
 {
     ENTERING;
-    sdskv_provider_handle_t sdskv_ph = srv_ctx->sdskv_ph;
-    sdskv_database_id_t seg_db_id = srv_ctx->segment_db_id;
+    struct mobject_server_context* srv_ctx = vargs->srv_ctx;
     segment_key_t seg;
 
     seg.oid       = oid;
@@ -641,23 +767,17 @@ static void insert_region_log_entry(
     ABT_mutex_lock(srv_ctx->mutex);
     seg.seq_id = srv_ctx->seq_id++;
     ABT_mutex_unlock(srv_ctx->mutex);
-    int ret = sdskv_put(sdskv_ph, seg_db_id, 
-            (const void*)&seg, sizeof(seg),
-            (const void*)region, sizeof(*region));
-    if(ret != SDSKV_SUCCESS) {
-        ERROR fprintf(stderr, "sdskv_put returned %d\n", ret);
-    }
+    put_segment(vargs, seg, (const void*)region, sizeof(*region));
     LEAVING;
 }
 
 static void insert_small_region_log_entry(
-        struct mobject_server_context* srv_ctx,
+        server_visitor_args_t vargs,
         oid_t oid, uint64_t offset, uint64_t len,
         const char* data, time_t ts)
 {
     ENTERING;
-    sdskv_provider_handle_t sdskv_ph = srv_ctx->sdskv_ph;
-    sdskv_database_id_t seg_db_id = srv_ctx->segment_db_id;
+    struct mobject_server_context* srv_ctx = vargs->srv_ctx;
     segment_key_t seg;
 
     seg.oid       = oid;
@@ -668,22 +788,16 @@ static void insert_small_region_log_entry(
     ABT_mutex_lock(srv_ctx->mutex);
     seg.seq_id = srv_ctx->seq_id++;
     ABT_mutex_unlock(srv_ctx->mutex);
-    int ret = sdskv_put(sdskv_ph, seg_db_id,
-            (const void*)&seg, sizeof(seg),
-            (const void*)data, len);
-    if(ret != SDSKV_SUCCESS) {
-        ERROR fprintf(stderr, "sdskv_put returned %d\n", ret);
-    }
+    put_segment(vargs, seg, (const void*)data, len);
     LEAVING;
 }
 
 static void insert_zero_log_entry(
-        struct mobject_server_context* srv_ctx,
+        server_visitor_args_t vargs,
         oid_t oid, uint64_t offset, uint64_t len, time_t ts)
 {
     ENTERING;
-    sdskv_provider_handle_t sdskv_ph = srv_ctx->sdskv_ph;
-    sdskv_database_id_t seg_db_id = srv_ctx->segment_db_id;
+    struct mobject_server_context* srv_ctx = vargs->srv_ctx;
     segment_key_t seg;
 
     seg.oid       = oid;
@@ -694,22 +808,16 @@ static void insert_zero_log_entry(
     ABT_mutex_lock(srv_ctx->mutex);
     seg.seq_id = srv_ctx->seq_id++;
     ABT_mutex_unlock(srv_ctx->mutex);
-    int ret = sdskv_put(sdskv_ph, seg_db_id,
-            (const void*)&seg, sizeof(seg),
-            (const void*)nullptr, 0);
-    if(ret != SDSKV_SUCCESS) {
-        ERROR fprintf(stderr, "sdskv_put returned %d\n", ret);
-    }
+    put_segment(vargs, seg, (const void*)nullptr, 0);
     LEAVING;
 }
 
 static void insert_punch_log_entry(
-        struct mobject_server_context* srv_ctx,
+        server_visitor_args_t vargs,
         oid_t oid, uint64_t offset, time_t ts)
 {
     ENTERING;
-    sdskv_provider_handle_t sdskv_ph = srv_ctx->sdskv_ph;
-    sdskv_database_id_t seg_db_id = srv_ctx->segment_db_id;
+    struct mobject_server_context* srv_ctx = vargs->srv_ctx;
     segment_key_t seg;
 
     seg.oid       = oid;
@@ -720,15 +828,379 @@ static void insert_punch_log_entry(
     ABT_mutex_lock(srv_ctx->mutex);
     seg.seq_id = srv_ctx->seq_id++;
     ABT_mutex_unlock(srv_ctx->mutex);
-    int ret = sdskv_put(sdskv_ph, seg_db_id,
-            (const void*)&seg, sizeof(seg),
-            (const void*)nullptr, 0);
+    put_segment(vargs, seg, (const void*)nullptr, 0);
+    LEAVING;
+}
+
+static void put_segment(
+        server_visitor_args_t vargs,
+        const segment_key_t& seg,
+        const void* value, size_t vsize)
+{
+    if(vargs->seg_batch) {
+        vargs->seg_batch->keys.push_back(seg);
+        vargs->seg_batch->values.emplace_back((const char*)value, vsize);
+        return;
+    }
+    if(vargs->defer_persist) {
+        struct mobject_server_context* srv_ctx = vargs->srv_ctx;
+        ABT_mutex_lock(srv_ctx->persist_mutex);
+        srv_ctx->persist_log->segments.keys.push_back(seg);
+        srv_ctx->persist_log->segments.values.emplace_back((const char*)value, vsize);
+        ABT_mutex_unlock(srv_ctx->persist_mutex);
+        return;
+    }
+    commit_segment(vargs->srv_ctx, seg, value, vsize);
+}
+
+/* Queues a segment entry and returns once it is in the KV store. The
+   first ULT to find no commit in progress becomes the leader: it waits
+   up to commit_window microseconds (or until commit_max entries are
+   queued) for other ULTs to queue their entries, puts all of them with
+   a single sdskv_put_multi and wakes their ULTs up. Entries queued
+   during a commit go in the next one. */
+static void commit_segment(
+        struct mobject_server_context* srv_ctx,
+        const segment_key_t& seg,
+        const void* value, size_t vsize)
+{
+    ABT_mutex_lock(srv_ctx->commit_mutex);
+    srv_ctx->commit_queue->keys.push_back(seg);
+    srv_ctx->commit_queue->values.emplace_back((const char*)value, vsize);
+    uint64_t ticket = ++srv_ctx->commit_enqueued;
+    if(srv_ctx->commit_queue->keys.size() >= srv_ctx->commit_max)
+        ABT_cond_signal(srv_ctx->commit_full_cond);
+
+    while(srv_ctx->commit_done < ticket) {
+        if(srv_ctx->committing) {
+            ABT_cond_wait(srv_ctx->commit_cond, srv_ctx->commit_mutex);
+            continue;
+        }
+        srv_ctx->committing = 1;
+        if(srv_ctx->commit_window > 0
+        && srv_ctx->commit_queue->keys.size() < srv_ctx->commit_max) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)(srv_ctx->commit_window*1000.0);
+            deadline.tv_sec  += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            ABT_cond_timedwait(srv_ctx->commit_full_cond, srv_ctx->commit_mutex, &deadline);
+        }
+        struct segment_batch batch;
+        std::swap(batch, *(srv_ctx->commit_queue));
+        uint64_t last = srv_ctx->commit_enqueued;
+        ABT_mutex_unlock(srv_ctx->commit_mutex);
+
+        flush_segment_batch(srv_ctx, &batch);
+
+        ABT_mutex_lock(srv_ctx->commit_mutex);
+        srv_ctx->commit_done = last;
+        srv_ctx->committing  = 0;
+        ABT_cond_broadcast(srv_ctx->commit_cond);
+    }
+    ABT_mutex_unlock(srv_ctx->commit_mutex);
+}
+
+extern "C" void core_commit_init(struct mobject_server_context* srv_ctx)
+{
+    ABT_mutex_create(&srv_ctx->commit_mutex);
+    ABT_cond_create(&srv_ctx->commit_cond);
+    ABT_cond_create(&srv_ctx->commit_full_cond);
+    srv_ctx->commit_queue    = new segment_batch;
+    srv_ctx->commit_enqueued = 0;
+    srv_ctx->commit_done     = 0;
+    srv_ctx->committing      = 0;
+}
+
+extern "C" void core_commit_finalize(struct mobject_server_context* srv_ctx)
+{
+    delete srv_ctx->commit_queue;
+    ABT_cond_free(&srv_ctx->commit_full_cond);
+    ABT_cond_free(&srv_ctx->commit_cond);
+    ABT_mutex_free(&srv_ctx->commit_mutex);
+}
+
+static void flush_segment_batch(
+        struct mobject_server_context* srv_ctx,
+        struct segment_batch* batch)
+{
+    ENTERING;
+    size_t i, count = batch->keys.size();
+    if(count == 0) {
+        LEAVING;
+        return;
+    }
+    std::vector<const void*> keys(count);
+    std::vector<hg_size_t>   ksizes(count, sizeof(segment_key_t));
+    std::vector<const void*> values(count);
+    std::vector<hg_size_t>   vsizes(count);
+    for(i = 0; i < count; i++) {
+        keys[i]   = (const void*)&batch->keys[i];
+        values[i] = (const void*)batch->values[i].data();
+        vsizes[i] = batch->values[i].size();
+    }
+    int ret = CORE_METERED(srv_ctx, CORE_CALL_KV,
+            sdskv_put_multi(srv_ctx->sdskv_ph, srv_ctx->segment_db_id, count,
+                keys.data(), ksizes.data(), values.data(), vsizes.data()));
     if(ret != SDSKV_SUCCESS) {
-        ERROR fprintf(stderr, "sdskv_put returned %d\n", ret);
+        ERROR fprintf(stderr, "sdskv_put_multi returned %d\n", ret);
     }
+    batch->keys.clear();
+    batch->values.clear();
     LEAVING;
 }
 
+static int persist_region(
+        server_visitor_args_t vargs,
+        const region_value_t& region, uint64_t len)
+{
+    struct mobject_server_context* srv_ctx = vargs->srv_ctx;
+    if(!vargs->defer_persist)
+        return CORE_METERED(srv_ctx, CORE_CALL_BAKE,
+                bake_persist(srv_ctx->bake_ph, region.target, region.region, 0, len));
+    ABT_mutex_lock(srv_ctx->persist_mutex);
+    srv_ctx->persist_log->regions.emplace_back(region, len);
+    ABT_mutex_unlock(srv_ctx->persist_mutex);
+    return 0;
+}
+
+/* stores len bytes of the operation's data in a new bake region; unless
+   the write is deferred, the region is created, written and persisted
+   in a single call to the bake provider instead of three */
+static int create_region(
+        server_visitor_args_t vargs,
+        buffer_u buf, size_t len,
+        region_value_t* region)
+{
+    bake_provider_handle_t bph = vargs->srv_ctx->bake_ph;
+    uint64_t remote_offset = vargs->bulk_offset + buf.as_offset;
+    int ret;
+
+    region->target = core_next_bake_target(vargs->srv_ctx);
+
+    if(!vargs->defer_persist) {
+        if(vargs->local_data)
+            ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_BAKE,
+                    bake_create_write_persist(bph, region->target,
+                        vargs->local_data + remote_offset, len, &region->region));
+        else
+            ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_BAKE,
+                    bake_create_write_persist_proxy(bph, region->target, vargs->bulk_handle,
+                        remote_offset, vargs->client_addr_str, len, &region->region));
+        if(ret != 0) {
+            ERROR bake_perror("bake_create_write_persist", ret);
+        }
+        return ret;
+    }
+
+    ret = CORE_METERED(vargs->srv_ctx, CORE_CALL_BAKE,
+            bake_create(bph, region->target, len, &region->region));
+    if(ret != 0) {
+        ERROR bake_perror("bake_create", ret);
+        return ret;
+    }
+    ret = write_region(vargs, *region, buf, len);
+    if(ret != 0) {
+        ERROR bake_perror("bake_proxy_write", ret);
+        return ret;
+    }
+    return persist_region(vargs, *region, len);
+}
+
+extern "C" bake_target_id_t core_next_bake_target(struct mobject_server_context* srv_ctx)
+{
+    ABT_mutex_lock(srv_ctx->mutex);
+    uint64_t i = srv_ctx->next_bake_target;
+    srv_ctx->next_bake_target = (i + 1) % srv_ctx->num_bake_targets;
+    ABT_mutex_unlock(srv_ctx->mutex);
+    return srv_ctx->bake_tids[i];
+}
+
+extern "C" bake_target_id_t core_region_target(
+        struct mobject_server_context* srv_ctx,
+        const region_value_t* value, size_t vsize)
+{
+    if(vsize < sizeof(region_value_t))
+        return srv_ctx->bake_tids[0];
+    return value->target;
+}
+
+/* puts the segment entries of the persist log in the KV store,
+   with srv_ctx->log_flush_mutex held */
+static void flush_segment_log(struct mobject_server_context* srv_ctx)
+{
+    struct segment_batch batch;
+    ABT_mutex_lock(srv_ctx->persist_mutex);
+    std::swap(batch, srv_ctx->persist_log->segments);
+    ABT_mutex_unlock(srv_ctx->persist_mutex);
+    flush_segment_batch(srv_ctx, &batch);
+}
+
+extern "C" void core_flush_segment_log(struct mobject_server_context* srv_ctx)
+{
+    /* the flush mutex is held while the entries are put, so that
+       a caller returning from here sees all of them in the KV store */
+    ABT_mutex_lock(srv_ctx->log_flush_mutex);
+    flush_segment_log(srv_ctx);
+    ABT_mutex_unlock(srv_ctx->log_flush_mutex);
+}
+
+extern "C" void core_persist_pending(struct mobject_server_context* srv_ctx)
+{
+    std::vector<std::pair<region_value_t, uint64_t>> regions;
+    uint64_t seq;
+
+    /* passes are serialized, so that safe_seq only moves past
+       the regions of a pass once they have been persisted */
+    ABT_mutex_lock(srv_ctx->persist_pass_mutex);
+
+    /* writes with a ticket up to seq have logged all their regions
+       and segments: the latter are put first, holding the flush mutex
+       only for that, so that reads do not wait for the persists */
+    ABT_mutex_lock(srv_ctx->log_flush_mutex);
+    ABT_mutex_lock(srv_ctx->persist_mutex);
+    std::swap(regions, srv_ctx->persist_log->regions);
+    seq = srv_ctx->persist_seq;
+    ABT_mutex_unlock(srv_ctx->persist_mutex);
+    flush_segment_log(srv_ctx);
+    ABT_mutex_unlock(srv_ctx->log_flush_mutex);
+
+    for(auto& r : regions) {
+        int ret = CORE_METERED(srv_ctx, CORE_CALL_BAKE,
+                bake_persist(srv_ctx->bake_ph, r.first.target, r.first.region, 0, r.second));
+        if(ret != 0) {
+            ERROR bake_perror("bake_persist", ret);
+        }
+    }
+
+    ABT_mutex_lock(srv_ctx->persist_mutex);
+    if(seq > srv_ctx->safe_seq) {
+        srv_ctx->safe_seq = seq;
+        ABT_cond_broadcast(srv_ctx->persist_cond);
+    }
+    ABT_mutex_unlock(srv_ctx->persist_mutex);
+    ABT_mutex_unlock(srv_ctx->persist_pass_mutex);
+}
+
+static void persist_ult(void* arg)
+{
+    auto srv_ctx = static_cast<struct mobject_server_context*>(arg);
+    while(1) {
+        ABT_mutex_lock(srv_ctx->persist_mutex);
+        while(srv_ctx->persist_seq == srv_ctx->safe_seq && !srv_ctx->persist_stop)
+            ABT_cond_wait(srv_ctx->persist_cond, srv_ctx->persist_mutex);
+        int stop = srv_ctx->persist_stop;
+        ABT_mutex_unlock(srv_ctx->persist_mutex);
+        /* let concurrent writes join this pass */
+        if(!stop && srv_ctx->persist_interval > 0)
+            margo_thread_sleep(srv_ctx->mid, srv_ctx->persist_interval);
+        core_persist_pending(srv_ctx);
+        if(stop) break;
+    }
+}
+
+extern "C" int core_persist_init(struct mobject_server_context* srv_ctx)
+{
+    ABT_mutex_create(&srv_ctx->persist_mutex);
+    ABT_mutex_create(&srv_ctx->log_flush_mutex);
+    ABT_mutex_create(&srv_ctx->persist_pass_mutex);
+    ABT_cond_create(&srv_ctx->persist_cond);
+    srv_ctx->persist_log  = new persist_log;
+    srv_ctx->persist_seq  = 0;
+    srv_ctx->safe_seq     = 0;
+    srv_ctx->persist_stop = 0;
+    int ret = ABT_thread_create(srv_ctx->pool, persist_ult, (void*)srv_ctx,
+            ABT_THREAD_ATTR_NULL, &srv_ctx->persist_thread);
+    if(ret != ABT_SUCCESS) {
+        ERROR fprintf(stderr, "core_persist_init: could not create the persist ULT\n");
+        srv_ctx->persist_thread = ABT_THREAD_NULL;
+        return -1;
+    }
+    return 0;
+}
+
+extern "C" void core_persist_finalize(struct mobject_server_context* srv_ctx)
+{
+    ABT_mutex_lock(srv_ctx->persist_mutex);
+    srv_ctx->persist_stop = 1;
+    ABT_cond_broadcast(srv_ctx->persist_cond);
+    ABT_mutex_unlock(srv_ctx->persist_mutex);
+    if(srv_ctx->persist_thread != ABT_THREAD_NULL) {
+        ABT_thread_join(srv_ctx->persist_thread);
+        ABT_thread_free(&srv_ctx->persist_thread);
+    } else {
+        core_persist_pending(srv_ctx);
+    }
+    delete srv_ctx->persist_log;
+    ABT_cond_free(&srv_ctx->persist_cond);
+    ABT_mutex_free(&srv_ctx->log_flush_mutex);
+    ABT_mutex_free(&srv_ctx->persist_pass_mutex);
+    ABT_mutex_free(&srv_ctx->persist_mutex);
+}
+
+extern "C" int core_wait_safe(struct mobject_server_context* srv_ctx, uint64_t seq)
+{
+    ABT_mutex_lock(srv_ctx->persist_mutex);
+    /* not a ticket given by this provider */
+    if(seq > srv_ctx->persist_seq) {
+        ABT_mutex_unlock(srv_ctx->persist_mutex);
+        return -1;
+    }
+    /* the last pass, when the provider is finalized, covers all tickets */
+    while(srv_ctx->safe_seq < seq)
+        ABT_cond_wait(srv_ctx->persist_cond, srv_ctx->persist_mutex);
+    ABT_mutex_unlock(srv_ctx->persist_mutex);
+    return 0;
+}
+
+static int pull_small_region(
+        server_visitor_args_t vargs,
+        buffer_u buf, char* data, size_t len)
+{
+    uint64_t remote_offset = vargs->bulk_offset + buf.as_offset;
+    if(vargs->local_data) {
+        memcpy(data, vargs->local_data + remote_offset, len);
+        return 0;
+    }
+
+    margo_instance_id mid = vargs->srv_ctx->mid;
+    void* buf_ptrs[1] = {(void*)data};
+    hg_size_t buf_sizes[1] = {len};
+    hg_bulk_t handle;
+    int ret = margo_bulk_create(mid,1, buf_ptrs, buf_sizes, HG_BULK_WRITE_ONLY, &handle);
+    if(ret != 0) {
+        ERROR fprintf(stderr, "margo_bulk_create returned %d\n", ret);
+        return ret;
+    }
+    ret = margo_bulk_transfer(mid, HG_BULK_PULL, vargs->client_addr, vargs->bulk_handle,
+            remote_offset, handle, 0, len);
+    if(ret != 0) {
+        ERROR fprintf(stderr, "margo_bulk_transfer returned %d\n", ret);
+    }
+    int r = margo_bulk_free(handle);
+    if(r != 0) {
+        ERROR fprintf(stderr, "margo_bulk_free returned %d\n", r);
+    }
+    return ret;
+}
+
+static int write_region(
+        server_visitor_args_t vargs,
+        const region_value_t& region,
+        buffer_u buf, size_t len)
+{
+    bake_provider_handle_t bph = vargs->srv_ctx->bake_ph;
+    uint64_t remote_offset = vargs->bulk_offset + buf.as_offset;
+    if(vargs->local_data)
+        return CORE_METERED(vargs->srv_ctx, CORE_CALL_BAKE,
+                bake_write(bph, region.target, region.region, 0,
+                    vargs->local_data + remote_offset, len));
+    return CORE_METERED(vargs->srv_ctx, CORE_CALL_BAKE,
+            bake_proxy_write(bph, region.target, region.region, 0,
+                vargs->bulk_handle, remote_offset,
+                vargs->client_addr_str, len));
+}
+
 uint64_t mobject_compute_object_size(
         sdskv_provider_handle_t ph,
         sdskv_database_id_t seg_db_id,
@@ -16,6 +16,69 @@ extern "C" {
 
 void core_write_op(mobject_store_write_op_t write_op, server_visitor_args_t vargs);
 
+/**
+ * Executes a batch of write_ops on objects of the same pool. The
+ * data of write_op i starts at bulk_offsets[i] in vargs->bulk_handle.
+ * The oids of the objects are looked up together and the segment
+ * entries of the whole batch are put in the KV store together.
+ */
+void core_write_op_batch(
+        mobject_store_write_op_t* write_ops,
+        const char* const* object_names,
+        const uint64_t* bulk_offsets,
+        size_t count,
+        server_visitor_args_t vargs);
+
+/**
+ * Returns the bake target on which to create a new region. Regions
+ * are spread round-robin over the targets of the provider.
+ */
+bake_target_id_t core_next_bake_target(struct mobject_server_context* srv_ctx);
+
+/**
+ * Returns the bake target of the region held in the value (of vsize
+ * bytes) of a BAKE_REGION segment.
+ */
+bake_target_id_t core_region_target(
+        struct mobject_server_context* srv_ctx,
+        const region_value_t* value, size_t vsize);
+
+/**
+ * Sets up the queue through which the segment entries put by concurrent
+ * write ULTs are committed together (see commit_window and commit_max
+ * in mobject_server_context), and core_commit_finalize tears it down.
+ */
+void core_commit_init(struct mobject_server_context* srv_ctx);
+
+void core_commit_finalize(struct mobject_server_context* srv_ctx);
+
+/**
+ * Starts the ULT persisting the writes made with
+ * LIBMOBJECT_OPERATION_DEFER_PERSIST, and core_persist_finalize
+ * stops it once everything pending has been persisted.
+ */
+int core_persist_init(struct mobject_server_context* srv_ctx);
+
+void core_persist_finalize(struct mobject_server_context* srv_ctx);
+
+/**
+ * Puts the segment entries logged by deferred writes in the KV store.
+ * Must be called before looking up the segments of an object.
+ */
+void core_flush_segment_log(struct mobject_server_context* srv_ctx);
+
+/**
+ * Persists the bake regions and puts the segment entries of all the
+ * deferred writes that have been acknowledged, and marks them as safe.
+ */
+void core_persist_pending(struct mobject_server_context* srv_ctx);
+
+/**
+ * Blocks until the deferred write that got ticket seq is safe.
+ * Returns -1 if seq is not a ticket given by this provider.
+ */
+int core_wait_safe(struct mobject_server_context* srv_ctx, uint64_t seq);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,10 @@ typedef enum seg_type_t {
    of sizeof(bake_region_id_t). */
 /* a TOMSTONE segment is used to invalidate a portion
    of an object. This portion if [start_index, +infinity[. */
+/* the value of a BAKE_REGION segment also holds the bake
+   target the region was created on (region_value_t). Values
+   made of the bake_region_id_t alone come from providers that
+   had a single target, which is the first target of the provider. */
 
 typedef struct segment_key_t {
     oid_t oid;
@@ -43,6 +47,11 @@ typedef struct segment_key_t {
     uint64_t end_index;  // end index is not included
 } segment_key_t;
 
+typedef struct region_value_t {
+    bake_region_id_t region;
+    bake_target_id_t target;
+} region_value_t;
+
 typedef struct omap_key_t {
     oid_t oid;
     char key[1];
@@ -11,12 +11,65 @@
 #include <bake-client.h>
 #include <sdskv-client.h>
 #include <ssg-mpi.h>
+#include "src/client/placement.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define MOBJECT_SEQ_ID_MAX UINT32_MAX
+/* batches of write_ops with at most this much data are pulled at once */
+#define MOBJECT_BATCH_PULL_MAX (16*1024*1024)
+/* milliseconds the persist ULT waits for concurrent deferred writes */
+#define MOBJECT_PERSIST_INTERVAL_ENV "MOBJECT_PERSIST_INTERVAL"
+#define MOBJECT_PERSIST_INTERVAL_DEFAULT 1.0
+
+/* microseconds the first of concurrent segment inserts waits for the
+   others, and number of inserts committing a batch before that */
+#define MOBJECT_COMMIT_WINDOW_ENV "MOBJECT_COMMIT_WINDOW"
+#define MOBJECT_COMMIT_MAX_ENV "MOBJECT_COMMIT_MAX"
+#define MOBJECT_COMMIT_MAX_DEFAULT 256
+
+/* replicated writes to the objects hashed to the same lock are applied
+   one at a time by the primary, so that replicas see them in its order */
+#define MOBJECT_REPLICA_WRITE_LOCKS 256
+
+/* maximum number of bake targets (storage devices) used by a provider */
+#define MOBJECT_MAX_BAKE_TARGETS 64
+
+/* number of name -> oid entries a provider keeps in memory, 0 to disable */
+#define MOBJECT_OID_CACHE_SIZE_ENV "MOBJECT_OID_CACHE_SIZE"
+#define MOBJECT_OID_CACHE_SIZE_DEFAULT (64*1024)
+
+/* quality of service: rate limits of each client and of each pool,
+   given as <ops/sec>/<bytes/sec> (0 for unlimited), the pool limits as
+   a list of [<pool>:]<limit> entries (e.g. "1000/0,logs:100/1048576");
+   number of operations executed at once, the others waiting in per-client
+   queues served in deficit round robin, 0 for unlimited; bytes a client
+   may execute per round */
+#define MOBJECT_QOS_CLIENT_LIMIT_ENV "MOBJECT_QOS_CLIENT_LIMIT"
+#define MOBJECT_QOS_POOL_LIMIT_ENV "MOBJECT_QOS_POOL_LIMIT"
+#define MOBJECT_QOS_MAX_ACTIVE_ENV "MOBJECT_QOS_MAX_ACTIVE"
+#define MOBJECT_QOS_QUANTUM_ENV "MOBJECT_QOS_QUANTUM"
+#define MOBJECT_QOS_QUANTUM_DEFAULT (1024*1024)
+
+/* milliseconds without incoming migration, counted from the last
+   membership change at the earliest, after which a provider that completed
+   its own rebalancing stops forwarding reads to previous owners */
+#define MOBJECT_REBALANCE_SETTLE_ENV "MOBJECT_REBALANCE_SETTLE"
+#define MOBJECT_REBALANCE_SETTLE_DEFAULT 5000.0
+
+/* milliseconds between two publications of the metrics to SYMBIOMON */
+#define MOBJECT_METRICS_INTERVAL_ENV "MOBJECT_METRICS_INTERVAL"
+#define MOBJECT_METRICS_INTERVAL_DEFAULT 1000.0
+
+struct persist_log;
+struct segment_batch;
+struct oid_cache;
+struct qos_state;
+struct core_metrics;
+struct migrated_objects;
+struct migration_guard;
 
 struct mobject_server_context
 {
@@ -24,19 +77,73 @@ struct mobject_server_context
     margo_instance_id mid;
     uint16_t provider_id;
     ABT_pool pool;
+    ABT_pool bulk_pool;       /* pool of the bulk operations, ABT_POOL_NULL to use pool */
+    size_t bulk_threshold;    /* bytes of data from which an operation is a bulk one */
     ABT_mutex mutex;
     ABT_mutex stats_mutex;
     /* ssg-related data */
     ssg_group_id_t gid;
+    char* self_addr_str;
+    /* placement-related data, protected by mutex */
+    mobject_placement_t placement;      /* current placement */
+    ssg_member_id_t* members;           /* member id of each rank in placement */
+    mobject_placement_t prev_placement; /* placement before the last membership change */
+    ssg_member_id_t* prev_members;      /* member id of each rank in prev_placement */
+    /* replication */
+    char* replication_spec;             /* MOBJECT_POOL_REPLICATION at startup */
+    char* erasure_spec;                 /* MOBJECT_POOL_ERASURE at startup */
+    hg_id_t replica_write_op_rpc_id;
+    ABT_mutex replica_write_locks[MOBJECT_REPLICA_WRITE_LOCKS];
+    /* rebalancing, flags protected by mutex */
+    hg_id_t migrate_rpc_id;
+    hg_id_t forward_read_op_rpc_id;
+    ABT_thread rebalance_thread;
+    int rebalance_running;
+    int rebalance_pending;
+    int finalizing;
+    size_t rebalance_bandwidth;  /* bytes/sec, 0 for unlimited */
+    size_t rebalance_batch_size; /* max bytes of data per migration message */
+    double rebalance_settle;     /* milliseconds, see MOBJECT_REBALANCE_SETTLE_ENV */
+    double rebalance_start;      /* ABT_get_wtime() of the last placement change */
+    double last_migration;       /* ABT_get_wtime() of the last received migration */
+    struct migrated_objects* migrated; /* objects received whole, see core-migrate.h */
+    struct migration_guard* migration_guard; /* writes held during removals after migrations */
     /* bake-related data */
     bake_provider_handle_t bake_ph;
-    bake_target_id_t bake_tid;
+    bake_target_id_t* bake_tids;       /* targets new regions are spread over */
+    uint64_t num_bake_targets;
+    uint64_t next_bake_target;         /* round-robin index, protected by mutex */
     /* sdskv-related data */
     sdskv_provider_handle_t sdskv_ph;
     sdskv_database_id_t oid_db_id;
     sdskv_database_id_t name_db_id;
     sdskv_database_id_t segment_db_id;
     sdskv_database_id_t omap_db_id;
+    struct oid_cache* oid_cache;       /* known name -> oid entries, NULL if disabled */
+    struct core_metrics* metrics;      /* per-xstream counters, see core-metrics.h */
+    /* admission of client operations, NULL if there is no QoS setting */
+    struct qos_state* qos;
+    /* group commit of segment entries, protected by commit_mutex */
+    ABT_mutex commit_mutex;
+    ABT_cond commit_cond;              /* signaled when a commit is done */
+    ABT_cond commit_full_cond;         /* signaled when commit_max entries are queued */
+    struct segment_batch* commit_queue;
+    uint64_t commit_enqueued;          /* ticket of the last queued entry */
+    uint64_t commit_done;              /* entries up to this ticket are committed */
+    int committing;
+    double commit_window;              /* microseconds */
+    size_t commit_max;
+    /* writes acknowledged before being persisted, protected by persist_mutex */
+    ABT_mutex persist_mutex;
+    ABT_cond persist_cond;           /* signaled when writes are logged or become safe */
+    ABT_mutex log_flush_mutex;       /* serializes flushes of the segments of persist_log */
+    ABT_mutex persist_pass_mutex;    /* serializes passes of core_persist_pending */
+    struct persist_log* persist_log; /* regions to persist and segments to put */
+    uint64_t persist_seq;            /* ticket of the last deferred write */
+    uint64_t safe_seq;               /* deferred writes up to this ticket are safe */
+    double persist_interval;         /* milliseconds to wait for concurrent writes */
+    int persist_stop;
+    ABT_thread persist_thread;
     /* other data */
     uint32_t seq_id;
     int ref_count;
@@ -6,6 +6,7 @@
 
 #include <unistd.h>
 #include <getopt.h>
+#include <sys/stat.h>
 #include <mpi.h>
 #include <margo.h>
 #include <ssg.h>
@@ -15,30 +16,75 @@
 #include <sdskv-client.h>
 #include <sdskv-server.h>
 #include <symbiomon/symbiomon-server.h>
+#include "mobject-store-config.h"
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
 
 #include "mobject-server.h"
+#include "src/client/placement.h"
+
+/* bake pools (storage targets) a server can be given */
+#define MAX_POOL_FILES 64
+/* CPUs xstreams can be bound to */
+#define MAX_CPUS 1024
 
 #define ASSERT(__cond, __msg, ...) { if(!(__cond)) { fprintf(stderr, "[%s:%d] " __msg, __FILE__, __LINE__, __VA_ARGS__); exit(-1); } }
 
 typedef struct {
     bake_client_t          client;
-    bake_provider_handle_t provider_handle;
+    bake_provider_handle_t provider_handles[MOBJECT_MAX_PROVIDERS];
+    int                    num_handles;
 } bake_client_data;
 
 typedef struct {
     sdskv_client_t         client;
-    sdskv_provider_handle_t provider_handle;
+    sdskv_provider_handle_t provider_handles[MOBJECT_MAX_PROVIDERS];
+    int                    num_handles;
 } sdskv_client_data;
 
+/* what one of the providers of the server (a shard) is made of */
+typedef struct {
+    ABT_pool         pool;
+    ABT_pool         bulk_pool;
+    ABT_xstream*     xstreams;
+    int              num_xstreams;
+    bake_provider_t  bake_prov;
+    sdskv_provider_t sdskv_prov;
+    char*            kv_path;
+    char*            pool_files[MAX_POOL_FILES];
+    int              num_pool_files;
+    int              numa_node;    /* -1 if not bound to a node */
+    int*             cpus;         /* CPUs of numa_node */
+    int              num_cpus;
+    int              next_cpu;
+} shard_data;
+
 typedef struct {
     char*           listen_addr;
     char*           cluster_file;
     int             handler_xstreams;
-    char *          pool_file;
+    int             bulk_xstreams;
+    size_t          bulk_threshold;
+    int             bulk_shared;
+    int             num_providers;
+    char *          pool_files[MAX_POOL_FILES];
+    int             num_pool_files;
     size_t          pool_size;
     char *          kv_path;
     sdskv_db_type_t kv_backend;
     int             disable_pipelining;
+    int             join;
+    size_t          rebalance_bandwidth;
+    size_t          rebalance_batch_size;
+    int             cpus[MAX_CPUS];
+    int             num_cpus;
+    int             next_cpu;
+    int             progress_cpu;
+    char*           numa_spec;      /* --numa-node argument */
+    int             numa_node;      /* node the whole server is bound to, -1 if none */
+    int             numa_spread;    /* provider k is bound to node k % numa_nodes */
+    int             numa_nodes;
 } mobject_server_options;
 
 static void usage(void)
@@ -48,25 +94,49 @@ static void usage(void)
     fprintf(stderr, "  <cluster_file>           the file to write mobject cluster connect info to\n");
     fprintf(stderr, "  OPTIONS:\n");
     fprintf(stderr, "    --handler-xstreams     Number of xtreams to user for RPC handlers [default: 4]\n"); 
-    fprintf(stderr, "    --pool-file            Bake pool location [default: /dev/shm/mobject.dat]\n");
+    fprintf(stderr, "    --bulk-xstreams        Number of xstreams dedicated to bulk operations, split among the providers, 0 to run them with the others [default: 0]\n");
+    fprintf(stderr, "    --bulk-threshold       Bytes of data from which an operation is a bulk one [default: 256KiB]\n");
+    fprintf(stderr, "    --bulk-shared          Let the handler xstreams run bulk operations when no other operation is pending (requires --bulk-xstreams)\n");
+    fprintf(stderr, "    --providers            Number of independent providers, sharing the xstreams [default: $" MOBJECT_PROVIDERS_ENV " or 1]\n");
+    fprintf(stderr, "    --pool-file            Bake pool location, repeat to use several devices [default: /dev/shm/mobject.dat]\n");
     fprintf(stderr, "    --pool-size            Bake pool size for each server [default: 1GiB]\n");
     fprintf(stderr, "    --kv-backend           SDSKV backend to use (mapdb, leveldb, berkeleydb) [default: stdmap]\n");
     fprintf(stderr, "    --kv-path              SDSKV storage location [default: /dev/shm]\n");
     fprintf(stderr, "    --disable-pipelining   Disable use of Bake pipelining\n");
+    fprintf(stderr, "    --join                 Join the running cluster described by <cluster_file>\n");
+    fprintf(stderr, "    --rebalance-bandwidth  Max bytes/sec used to migrate objects on membership changes [default: unlimited]\n");
+    fprintf(stderr, "    --rebalance-batch      Max bytes of data per object migration message [default: 16MiB]\n");
+    fprintf(stderr, "    --cpus                 CPUs to bind the handler and bulk xstreams to, e.g. 0-7,16-23\n");
+    fprintf(stderr, "    --progress-cpu         CPU to bind the progress loop to\n");
+    fprintf(stderr, "    --numa-node            NUMA node to bind the xstreams and the memory to: a number, nic:<device>\n");
+    fprintf(stderr, "                           for the node of a network device, auto for one node per server of\n");
+    fprintf(stderr, "                           the host (by local MPI rank), or spread to spread the providers over the nodes\n");
     exit(-1);
 }
 
+static int parse_cpu_list(const char* list, int* cpus, int max);
+
 static void parse_args(int argc, char **argv, mobject_server_options *opts)
 {
     int c;
-    char *short_options = "x:f:s:p:k:d";
+    char *short_options = "x:X:T:SP:f:s:p:k:djb:B:c:C:N:";
     struct option long_options[] = {
         {"handler-xstreams", required_argument, 0, 'x'},
+        {"bulk-xstreams", required_argument, 0, 'X'},
+        {"bulk-threshold", required_argument, 0, 'T'},
+        {"bulk-shared", no_argument, 0, 'S'},
+        {"providers", required_argument, 0, 'P'},
         {"pool-file", required_argument, 0, 'f'},
         {"pool-size", required_argument, 0, 's'},
         {"kv-path", required_argument, 0, 'p'},
         {"kv-backend", required_argument, 0, 'k'},
         {"disable-pipelining", no_argument, 0, 'd'},
+        {"join", no_argument, 0, 'j'},
+        {"rebalance-bandwidth", required_argument, 0, 'b'},
+        {"rebalance-batch", required_argument, 0, 'B'},
+        {"cpus", required_argument, 0, 'c'},
+        {"progress-cpu", required_argument, 0, 'C'},
+        {"numa-node", required_argument, 0, 'N'},
     };
 
     while ((c = getopt_long(argc, argv, short_options, long_options, NULL)) != -1)
@@ -76,8 +146,24 @@ static void parse_args(int argc, char **argv, mobject_server_options *opts)
             case 'x':
                 opts->handler_xstreams = atoi(optarg);
                 break;
+            case 'X':
+                opts->bulk_xstreams = atoi(optarg);
+                break;
+            case 'T':
+                opts->bulk_threshold = strtoul(optarg, NULL, 0);
+                break;
+            case 'S':
+                opts->bulk_shared = 1;
+                break;
+            case 'P':
+                opts->num_providers = atoi(optarg);
+                break;
             case 'f':
-                opts->pool_file = optarg;
+                if(opts->num_pool_files == MAX_POOL_FILES) {
+                    fprintf(stderr, "Error: at most %d pool files can be used\n", MAX_POOL_FILES);
+                    usage();
+                }
+                opts->pool_files[opts->num_pool_files++] = optarg;
                 break;
             case 's':
                 opts->pool_size = strtoul(optarg, NULL, 0);
@@ -98,6 +184,28 @@ static void parse_args(int argc, char **argv, mobject_server_options *opts)
             case 'd':
                 opts->disable_pipelining = 1;
                 break;
+            case 'j':
+                opts->join = 1;
+                break;
+            case 'b':
+                opts->rebalance_bandwidth = strtoul(optarg, NULL, 0);
+                break;
+            case 'B':
+                opts->rebalance_batch_size = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                opts->num_cpus = parse_cpu_list(optarg, opts->cpus, MAX_CPUS);
+                if(opts->num_cpus <= 0) {
+                    fprintf(stderr, "Error: invalid CPU list %s\n", optarg);
+                    usage();
+                }
+                break;
+            case 'C':
+                opts->progress_cpu = atoi(optarg);
+                break;
+            case 'N':
+                opts->numa_spec = optarg;
+                break;
             default:
                 usage();
         }
@@ -108,9 +216,45 @@ static void parse_args(int argc, char **argv, mobject_server_options *opts)
     opts->listen_addr = argv[optind++];
     opts->cluster_file = argv[optind++];
 
+    if (opts->num_pool_files == 0)
+        opts->pool_files[opts->num_pool_files++] = "/dev/shm/mobject.dat";
+
+    /* clients find the number of providers in the same variable */
+    if (opts->num_providers == 0 && getenv(MOBJECT_PROVIDERS_ENV))
+        opts->num_providers = atoi(getenv(MOBJECT_PROVIDERS_ENV));
+    if (opts->num_providers == 0)
+        opts->num_providers = 1;
+    if (opts->num_providers < 0 || opts->num_providers > MOBJECT_MAX_PROVIDERS) {
+        fprintf(stderr, "Error: the number of providers must be between 1 and %d\n",
+                MOBJECT_MAX_PROVIDERS);
+        usage();
+    }
+
+    /* bulk xstreams are split among the providers, each getting at least one */
+    if (opts->bulk_shared && opts->bulk_xstreams <= 0) {
+        fprintf(stderr, "Error: --bulk-shared requires --bulk-xstreams\n");
+        usage();
+    }
+    if (opts->bulk_xstreams > 0 && opts->bulk_xstreams < opts->num_providers) {
+        fprintf(stderr, "Error: at least one bulk xstream per provider is required (%d providers)\n",
+                opts->num_providers);
+        usage();
+    }
+    if (opts->bulk_xstreams > 0 && opts->bulk_xstreams % opts->num_providers != 0)
+        fprintf(stderr, "Warning: %d bulk xstreams split among %d providers, %d of them unused\n",
+                opts->bulk_xstreams, opts->num_providers,
+                opts->bulk_xstreams % opts->num_providers);
+
     return;
 }
 
+static void setup_shard(mobject_server_options* opts, int k, shard_data* shard);
+static void setup_shard_xstreams(mobject_server_options* opts, shard_data* shard);
+static int own_xstreams(mobject_server_options* opts);
+static void resolve_numa_node(mobject_server_options* opts);
+static int numa_node_cpus(int node, int* cpus, int max);
+static void bind_memory(int node);
+static void bind_xstream(mobject_server_options* opts, shard_data* shard, ABT_xstream xstream);
 static void finalize_ssg_cb(void* data);
 static void finalize_bake(void* data);
 static void finalize_sdskv(void* data);
@@ -121,11 +265,22 @@ int main(int argc, char *argv[])
 {
     mobject_server_options server_opts = {
         .handler_xstreams = 4, /* default to 4 rpc handler xstreams */
-        .pool_file = "/dev/shm/mobject.dat", /* default bake pool file */
+        .bulk_xstreams = 0, /* bulk operations run in the handler pool */
+        .bulk_threshold = 0, /* provider default */
+        .bulk_shared = 0, /* handler xstreams only run small operations */
+        .num_providers = 0, /* set by parse_args */
+        .num_pool_files = 0, /* default bake pool file set by parse_args */
         .pool_size = 1*1024*1024*1024, /* 1 GiB default */
         .kv_path = "/dev/shm", /* default sdskv path */
         .kv_backend = KVDB_MAP, /* in-memory map default */
         .disable_pipelining = 0, /* use pipelining by default */
+        .join = 0, /* create a new cluster by default */
+        .rebalance_bandwidth = 0, /* unlimited */
+        .rebalance_batch_size = 0, /* provider default */
+        .num_cpus = 0, /* xstreams are not bound to CPUs */
+        .progress_cpu = -1, /* nor is the progress loop */
+        .numa_spec = NULL, /* nor the memory to a NUMA node */
+        .numa_node = -1,
     }; 
     margo_instance_id mid;
     ssg_group_config_t group_config = SSG_GROUP_CONFIG_INITIALIZER;
@@ -138,14 +293,29 @@ int main(int argc, char *argv[])
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    /* Margo initialization */
+    /* memory is bound before any thread is created, so that all of
+       them (progress, handlers, bake, sdskv) inherit the binding */
+    resolve_numa_node(&server_opts);
+    bind_memory(server_opts.numa_node);
+
+    /* Margo initialization; with several providers, separate bulk
+       xstreams or bound xstreams, the handler xstreams are created
+       by setup_shard instead */
     mid = margo_init(server_opts.listen_addr, MARGO_SERVER_MODE, 0, 
-        server_opts.handler_xstreams);
+        own_xstreams(&server_opts) ? 0 : server_opts.handler_xstreams);
     if (mid == MARGO_INSTANCE_NULL)
     {
         fprintf(stderr, "Error: Unable to initialize margo\n");
         return -1;
     }
+    /* the progress loop runs in the primary xstream */
+    if (server_opts.progress_cpu >= 0) {
+        ABT_xstream self;
+        ABT_xstream_self(&self);
+        if (ABT_xstream_set_cpubind(self, server_opts.progress_cpu) != ABT_SUCCESS)
+            fprintf(stderr, "Warning: unable to bind the progress loop to CPU %d\n",
+                    server_opts.progress_cpu);
+    }
     margo_enable_remote_shutdown(mid);
 
     /* SSG initialization */
@@ -163,95 +333,397 @@ int main(int argc, char *argv[])
     if(ret != 0)
         fprintf(stderr, "Error: symbiomon_provider_register() failed. Continuing on.\n");
 
-    /* Bake provider initialization */
-    /* XXX mplex id and target name should be taken from config file */
-    uint8_t bake_mplex_id = 1;
-    /* create the bake target if it does not exist */
-    if(-1 == access(server_opts.pool_file, F_OK)) {
-        // XXX creating a pool of 10MB - this should come from a config file
-        ret = bake_makepool(server_opts.pool_file, server_opts.pool_size, 0664);
-        if (ret != 0) bake_perror("bake_makepool", ret);
-        ASSERT(ret == 0, "bake_makepool() failed (ret = %d)\n", ret);
-    }
-    bake_provider_t bake_prov;
-    bake_target_id_t bake_tid;
-    ret = bake_provider_register(mid, bake_mplex_id, BAKE_ABT_POOL_DEFAULT, &bake_prov);
-    if (ret != 0) bake_perror("bake_provider_register", ret);
-    ASSERT(ret == 0, "bake_provider_register() failed (ret = %d)\n", ret);
-    ret = bake_provider_set_symbiomon(bake_prov, metric_provider);
-    if(ret != 0)
-        fprintf(stderr, "Error: bake_provider_set_symbiomon() failed. Contuinuing on.\n");
-    ret = bake_provider_add_storage_target(bake_prov, server_opts.pool_file, &bake_tid);
-    if (ret != 0) bake_perror("bake_provider_add_storage_target", ret);
-    ASSERT(ret == 0, "bake_provider_add_storage_target() failed to add target %s (ret = %d)\n",
-            server_opts.pool_file, ret);
-    if (!server_opts.disable_pipelining)
-        bake_provider_set_conf(bake_prov, "pipeline_enabled", "1");
-
-    /* Bake provider handle initialization from self addr */
+    /* Bake and SDSKV providers, one of each per shard */
+    /* XXX mplex ids and target names should be taken from config file */
+    int num_providers = server_opts.num_providers;
+    shard_data shards[MOBJECT_MAX_PROVIDERS];
     bake_client_data bake_clt_data;
+    sdskv_client_data sdskv_clt_data;
+    int i, k;
+
     ret = bake_client_init(mid, &(bake_clt_data.client));
     if (ret != 0) bake_perror("bake_client_init", ret);
     ASSERT(ret == 0, "bake_client_init() failed (ret = %d)\n", ret);
-    ret = bake_provider_handle_create(bake_clt_data.client, self_addr, bake_mplex_id, &(bake_clt_data.provider_handle));
-    if (ret != 0) bake_perror("bake_provider_handle_create", ret);
-    ASSERT(ret == 0, "bake_provider_handle_create() failed (ret = %d)\n", ret);
+    bake_clt_data.num_handles = 0;
     margo_push_finalize_callback(mid, &finalize_bake_client_cb, (void*)&bake_clt_data);
 
-    /* SDSKV provider initialization */
-    uint8_t sdskv_mplex_id = 2;
-    sdskv_provider_t sdskv_prov;
-    ret = sdskv_provider_register(mid, sdskv_mplex_id, SDSKV_ABT_POOL_DEFAULT, &sdskv_prov);
-    ASSERT(ret == 0, "sdskv_provider_register() failed (ret = %d)\n", ret);
-
-    ret = sdskv_provider_set_symbiomon(sdskv_prov, metric_provider);
-    if(ret != 0)
-        fprintf(stderr, "Error: sdskv_provider_set_symbiomon() failed. Contuinuing on.\n");
-
-    ret = mobject_sdskv_provider_setup(sdskv_prov, server_opts.kv_path, server_opts.kv_backend);
-
-    /* SDSKV provider handle initialization from self addr */
-    sdskv_client_data sdskv_clt_data;
     ret = sdskv_client_init(mid, &(sdskv_clt_data.client));
     ASSERT(ret == 0, "sdskv_client_init() failed (ret = %d)\n", ret);
-    ret = sdskv_provider_handle_create(sdskv_clt_data.client, self_addr, sdskv_mplex_id, &(sdskv_clt_data.provider_handle));
-    ASSERT(ret == 0, "sdskv_provider_handle_create() failed (ret = %d)\n", ret);
+    sdskv_clt_data.num_handles = 0;
     margo_push_finalize_callback(mid, &finalize_sdskv_client_cb, (void*)&sdskv_clt_data);
 
+    for(k = 0; k < num_providers; k++) {
+        shard_data* shard = &shards[k];
+        /* the xstreams, bake pools and databases of a provider
+           spread over the NUMA nodes are allocated on its node */
+        if(server_opts.numa_spread)
+            bind_memory(k % server_opts.numa_nodes);
+        setup_shard(&server_opts, k, shard);
+
+        /* Bake provider initialization */
+        uint8_t bake_mplex_id = 1 + k;
+        /* create the bake targets that do not exist */
+        for(i = 0; i < shard->num_pool_files; i++) {
+            if(-1 == access(shard->pool_files[i], F_OK)) {
+                // XXX creating a pool of 10MB - this should come from a config file
+                ret = bake_makepool(shard->pool_files[i], server_opts.pool_size, 0664);
+                if (ret != 0) bake_perror("bake_makepool", ret);
+                ASSERT(ret == 0, "bake_makepool() failed (ret = %d)\n", ret);
+            }
+        }
+        bake_target_id_t bake_tid;
+        /* bake moves the data of the objects, it is served by the bulk xstreams */
+        ret = bake_provider_register(mid, bake_mplex_id,
+                shard->bulk_pool != ABT_POOL_NULL ? shard->bulk_pool : shard->pool,
+                &shard->bake_prov);
+        if (ret != 0) bake_perror("bake_provider_register", ret);
+        ASSERT(ret == 0, "bake_provider_register() failed (ret = %d)\n", ret);
+        ret = bake_provider_set_symbiomon(shard->bake_prov, metric_provider);
+        if(ret != 0)
+            fprintf(stderr, "Error: bake_provider_set_symbiomon() failed. Contuinuing on.\n");
+        /* the mobject provider spreads new regions over all the targets */
+        for(i = 0; i < shard->num_pool_files; i++) {
+            ret = bake_provider_add_storage_target(shard->bake_prov, shard->pool_files[i], &bake_tid);
+            if (ret != 0) bake_perror("bake_provider_add_storage_target", ret);
+            ASSERT(ret == 0, "bake_provider_add_storage_target() failed to add target %s (ret = %d)\n",
+                    shard->pool_files[i], ret);
+        }
+        if (!server_opts.disable_pipelining)
+            bake_provider_set_conf(shard->bake_prov, "pipeline_enabled", "1");
+
+        /* Bake provider handle initialization from self addr */
+        ret = bake_provider_handle_create(bake_clt_data.client, self_addr, bake_mplex_id,
+                &(bake_clt_data.provider_handles[k]));
+        if (ret != 0) bake_perror("bake_provider_handle_create", ret);
+        ASSERT(ret == 0, "bake_provider_handle_create() failed (ret = %d)\n", ret);
+        bake_clt_data.num_handles += 1;
+
+        /* SDSKV provider initialization */
+        uint8_t sdskv_mplex_id = 2 + k;
+        ret = sdskv_provider_register(mid, sdskv_mplex_id, shard->pool, &shard->sdskv_prov);
+        ASSERT(ret == 0, "sdskv_provider_register() failed (ret = %d)\n", ret);
+
+        ret = sdskv_provider_set_symbiomon(shard->sdskv_prov, metric_provider);
+        if(ret != 0)
+            fprintf(stderr, "Error: sdskv_provider_set_symbiomon() failed. Contuinuing on.\n");
+
+        ret = mobject_sdskv_provider_setup(shard->sdskv_prov, shard->kv_path, server_opts.kv_backend);
+
+        /* SDSKV provider handle initialization from self addr */
+        ret = sdskv_provider_handle_create(sdskv_clt_data.client, self_addr, sdskv_mplex_id,
+                &(sdskv_clt_data.provider_handles[k]));
+        ASSERT(ret == 0, "sdskv_provider_handle_create() failed (ret = %d)\n", ret);
+        sdskv_clt_data.num_handles += 1;
+    }
+    if(server_opts.numa_spread)
+        bind_memory(-1);
+
     /* SSG group creation */
-    group_config.swim_period_length_ms = 10000; /* 10-second period length ... */
-    ssg_group_id_t gid = ssg_group_create_mpi(mid, MOBJECT_SERVER_GROUP_NAME, MPI_COMM_WORLD, &group_config, NULL, NULL);
-    ASSERT(gid != SSG_GROUP_ID_INVALID, "ssg_group_create_mpi() failed (ret = %s)","SSG_GROUP_ID_NULL");
+    ssg_group_id_t gid;
+    if(server_opts.join) {
+        /* join a running cluster, whose servers will migrate objects to us */
+        int num_addrs = SSG_ALL_MEMBERS;
+        ret = ssg_group_id_load(server_opts.cluster_file, &num_addrs, &gid);
+        ASSERT(ret == 0, "ssg_group_id_load() failed (ret = %d)\n", ret);
+        ret = ssg_group_join(mid, gid, NULL, NULL);
+        ASSERT(ret == 0, "ssg_group_join() failed (ret = %d)\n", ret);
+    } else {
+        group_config.swim_period_length_ms = 10000; /* 10-second period length ... */
+        gid = ssg_group_create_mpi(mid, MOBJECT_SERVER_GROUP_NAME, MPI_COMM_WORLD, &group_config, NULL, NULL);
+        ASSERT(gid != SSG_GROUP_ID_INVALID, "ssg_group_create_mpi() failed (ret = %s)","SSG_GROUP_ID_NULL");
+    }
     margo_push_prefinalize_callback(mid, &finalize_ssg_cb, (void*)&gid);
 
-    /* Mobject provider initialization */
-    mobject_provider_t mobject_prov;
-    ret = mobject_provider_register(mid, 1, 
-            MOBJECT_ABT_POOL_DEFAULT, 
-            bake_clt_data.provider_handle, 
-            sdskv_clt_data.provider_handle,
-            gid, server_opts.cluster_file, &mobject_prov);
-    if (ret != 0)
-    {
-        fprintf(stderr, "Error: Unable to initialize mobject provider\n");
-        margo_finalize(mid);
-        return -1;
+    /* Mobject provider initialization: clients send the operations on
+       an object to the provider MOBJECT_PROVIDER_ID_BASE + k, k being
+       given by the object's name, so the providers share nothing */
+    for(k = 0; k < num_providers; k++) {
+        mobject_provider_t mobject_prov;
+        ret = mobject_provider_register(mid, MOBJECT_PROVIDER_ID_BASE + k,
+                shards[k].pool,
+                bake_clt_data.provider_handles[k],
+                sdskv_clt_data.provider_handles[k],
+                gid, server_opts.cluster_file, &mobject_prov);
+        if (ret != 0)
+        {
+            fprintf(stderr, "Error: Unable to initialize mobject provider\n");
+            margo_finalize(mid);
+            return -1;
+        }
+        mobject_provider_set_rebalancing(mobject_prov,
+                server_opts.rebalance_bandwidth, server_opts.rebalance_batch_size);
+        if(shards[k].bulk_pool != ABT_POOL_NULL)
+            mobject_provider_set_bulk_pool(mobject_prov, shards[k].bulk_pool,
+                    server_opts.bulk_threshold);
+        ret = mobject_provider_set_symbiomon(mobject_prov, metric_provider);
+        if(ret != 0)
+            fprintf(stderr, "Error: mobject_provider_set_symbiomon() failed. Continuing on.\n");
     }
 
     margo_addr_free(mid, self_addr);
-    margo_push_prefinalize_callback(mid, &finalize_sdskv, (void*)&sdskv_prov);
-    margo_push_prefinalize_callback(mid, &finalize_bake, (void*)&bake_prov);
-
-
-
+    for(k = 0; k < num_providers; k++) {
+        margo_push_prefinalize_callback(mid, &finalize_sdskv, (void*)&shards[k].sdskv_prov);
+        margo_push_prefinalize_callback(mid, &finalize_bake, (void*)&shards[k].bake_prov);
+    }
 
     margo_wait_for_finalize(mid);
 
+    for(k = 0; k < num_providers; k++) {
+        for(i = 0; i < shards[k].num_xstreams; i++) {
+            ABT_xstream_join(shards[k].xstreams[i]);
+            ABT_xstream_free(&shards[k].xstreams[i]);
+        }
+        free(shards[k].xstreams);
+        free(shards[k].cpus);
+        if(num_providers > 1) {
+            free(shards[k].kv_path);
+            for(i = 0; i < shards[k].num_pool_files; i++)
+                free(shards[k].pool_files[i]);
+        }
+    }
+
     MPI_Finalize();
 
     return 0;
 }
 
+/* gives shard k its pool files, KV path and NUMA node, and with several
+   providers, bulk xstreams or bound xstreams, its own Argobots pools served
+   by its own share of the handler xstreams (and of the bulk xstreams) */
+static void setup_shard(mobject_server_options* opts, int k, shard_data* shard)
+{
+    int K = opts->num_providers;
+    int i;
+
+    memset(shard, 0, sizeof(*shard));
+    shard->pool      = ABT_POOL_NULL; /* margo's handler pool */
+    shard->bulk_pool = ABT_POOL_NULL;
+    shard->numa_node = opts->numa_spread ? k % opts->numa_nodes : opts->numa_node;
+    if(shard->numa_node >= 0) {
+        shard->cpus = calloc(MAX_CPUS, sizeof(int));
+        shard->num_cpus = numa_node_cpus(shard->numa_node, shard->cpus, MAX_CPUS);
+        if(shard->num_cpus < 0) {
+            fprintf(stderr, "Warning: unable to find the CPUs of NUMA node %d\n", shard->numa_node);
+            shard->num_cpus = 0;
+        }
+    }
+    if(K == 1) {
+        shard->kv_path = opts->kv_path;
+        for(i = 0; i < opts->num_pool_files; i++)
+            shard->pool_files[shard->num_pool_files++] = opts->pool_files[i];
+        if(own_xstreams(opts))
+            setup_shard_xstreams(opts, shard);
+        return;
+    }
+
+    /* pool files are dealt to the providers; if there are fewer files
+       than providers, each provider makes its own from one of them */
+    if(opts->num_pool_files >= K) {
+        for(i = k; i < opts->num_pool_files; i += K)
+            shard->pool_files[shard->num_pool_files++] = strdup(opts->pool_files[i]);
+    } else {
+        const char* base = opts->pool_files[k % opts->num_pool_files];
+        char* file = malloc(strlen(base) + 16);
+        sprintf(file, "%s.%d", base, k);
+        shard->pool_files[shard->num_pool_files++] = file;
+    }
+
+    shard->kv_path = malloc(strlen(opts->kv_path) + 32);
+    sprintf(shard->kv_path, "%s/mobject-provider-%d", opts->kv_path, k);
+    mkdir(shard->kv_path, 0775);
+
+    setup_shard_xstreams(opts, shard);
+}
+
+/* creates the pools of a shard and the xstreams serving them: handler
+   xstreams run the operations received by the shard's providers and the
+   small ones among them, bulk xstreams run bulk operations, and with
+   --bulk-shared, handler xstreams also run bulk operations but only when
+   no other ULT is ready (priority scheduler, which polls its pools) */
+static void setup_shard_xstreams(mobject_server_options* opts, shard_data* shard)
+{
+    int K = opts->num_providers;
+    int num_handler, num_bulk = 0;
+    int i, ret;
+
+    ret = ABT_pool_create_basic(ABT_POOL_FIFO_WAIT, ABT_POOL_ACCESS_MPMC, ABT_TRUE, &shard->pool);
+    ASSERT(ret == ABT_SUCCESS, "ABT_pool_create_basic() failed (ret = %d)\n", ret);
+    num_handler = opts->handler_xstreams / K;
+    if(num_handler < 1) num_handler = 1;
+    if(opts->bulk_xstreams > 0) {
+        ret = ABT_pool_create_basic(ABT_POOL_FIFO_WAIT, ABT_POOL_ACCESS_MPMC, ABT_TRUE, &shard->bulk_pool);
+        ASSERT(ret == ABT_SUCCESS, "ABT_pool_create_basic() failed (ret = %d)\n", ret);
+        num_bulk = opts->bulk_xstreams / K;
+    }
+
+    shard->xstreams = calloc(num_handler + num_bulk, sizeof(ABT_xstream));
+    for(i = 0; i < num_handler; i++) {
+        ABT_pool pools[2] = { shard->pool, shard->bulk_pool };
+        if(num_bulk > 0 && opts->bulk_shared)
+            ret = ABT_xstream_create_basic(ABT_SCHED_PRIO, 2, pools,
+                    ABT_SCHED_CONFIG_NULL, &shard->xstreams[shard->num_xstreams++]);
+        else
+            ret = ABT_xstream_create_basic(ABT_SCHED_BASIC_WAIT, 1, pools,
+                    ABT_SCHED_CONFIG_NULL, &shard->xstreams[shard->num_xstreams++]);
+        ASSERT(ret == ABT_SUCCESS, "ABT_xstream_create_basic() failed (ret = %d)\n", ret);
+        bind_xstream(opts, shard, shard->xstreams[shard->num_xstreams-1]);
+    }
+    for(i = 0; i < num_bulk; i++) {
+        ret = ABT_xstream_create_basic(ABT_SCHED_BASIC_WAIT, 1, &shard->bulk_pool,
+                ABT_SCHED_CONFIG_NULL, &shard->xstreams[shard->num_xstreams++]);
+        ASSERT(ret == ABT_SUCCESS, "ABT_xstream_create_basic() failed (ret = %d)\n", ret);
+        bind_xstream(opts, shard, shard->xstreams[shard->num_xstreams-1]);
+    }
+}
+
+/* whether the daemon creates the handler xstreams itself rather than margo */
+static int own_xstreams(mobject_server_options* opts)
+{
+    return opts->num_providers > 1 || opts->bulk_xstreams > 0
+        || opts->num_cpus > 0 || opts->numa_spec != NULL;
+}
+
+/* binds an xstream of a shard to the next of the CPUs given with --cpus,
+   or else to the next CPU of the NUMA node of the shard */
+static void bind_xstream(mobject_server_options* opts, shard_data* shard, ABT_xstream xstream)
+{
+    int cpu;
+    if(opts->num_cpus > 0)
+        cpu = opts->cpus[opts->next_cpu++ % opts->num_cpus];
+    else if(shard->num_cpus > 0)
+        cpu = shard->cpus[shard->next_cpu++ % shard->num_cpus];
+    else
+        return;
+    if(ABT_xstream_set_cpubind(xstream, cpu) != ABT_SUCCESS)
+        fprintf(stderr, "Warning: unable to bind an xstream to CPU %d\n", cpu);
+}
+
+/* parses a list of CPUs such as 0-3,8,10-11, returns their number or -1 */
+static int parse_cpu_list(const char* list, int* cpus, int max)
+{
+    const char* p = list;
+    char* end;
+    int n = 0;
+    while(*p != '\0' && *p != '\n') {
+        long lo = strtol(p, &end, 10), hi = lo;
+        if(end == p || lo < 0) return -1;
+        if(*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if(end == p || hi < lo) return -1;
+        }
+        for(; lo <= hi && n < max; lo++)
+            cpus[n++] = (int)lo;
+        p = end;
+        if(*p == ',') p++;
+    }
+    return n;
+}
+
+/* CPUs of a NUMA node, as listed by sysfs, returns their number or -1 */
+static int numa_node_cpus(int node, int* cpus, int max)
+{
+    char path[128], list[4096];
+    FILE* f;
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    f = fopen(path, "r");
+    if(!f) return -1;
+    if(!fgets(list, sizeof(list), f)) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return parse_cpu_list(list, cpus, max);
+}
+
+/* NUMA node of a network or InfiniBand device, -1 if unknown */
+static int device_numa_node(const char* device)
+{
+    const char* formats[2] = {
+        "/sys/class/net/%s/device/numa_node",
+        "/sys/class/infiniband/%s/device/numa_node"
+    };
+    char path[256];
+    int i, node = -1;
+    for(i = 0; i < 2 && node < 0; i++) {
+        FILE* f;
+        snprintf(path, sizeof(path), formats[i], device);
+        f = fopen(path, "r");
+        if(!f) continue;
+        if(fscanf(f, "%d", &node) != 1) node = -1;
+        fclose(f);
+    }
+    return node;
+}
+
+/* turns the --numa-node argument into the node the server is bound
+   to, or into spreading its providers over the nodes */
+static void resolve_numa_node(mobject_server_options* opts)
+{
+    char path[128];
+    const char* spec = opts->numa_spec;
+    if(spec == NULL) return;
+
+    opts->numa_nodes = 0;
+    for(;;) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", opts->numa_nodes);
+        if(access(path, F_OK) != 0) break;
+        opts->numa_nodes += 1;
+    }
+    if(opts->numa_nodes == 0) {
+        fprintf(stderr, "Warning: no NUMA node found, --numa-node is ignored\n");
+        opts->numa_spec = NULL;
+        return;
+    }
+
+    if(strcmp(spec, "spread") == 0) {
+        opts->numa_spread = 1;
+    } else if(strcmp(spec, "auto") == 0) {
+        /* servers of the same host get a node each, in turn */
+        MPI_Comm local_comm;
+        int local_rank;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &local_comm);
+        MPI_Comm_rank(local_comm, &local_rank);
+        MPI_Comm_free(&local_comm);
+        opts->numa_node = local_rank % opts->numa_nodes;
+    } else if(strncmp(spec, "nic:", 4) == 0) {
+        opts->numa_node = device_numa_node(spec + 4);
+        if(opts->numa_node < 0) {
+            fprintf(stderr, "Warning: unable to find the NUMA node of %s\n", spec + 4);
+            opts->numa_spec = NULL;
+        }
+    } else {
+        opts->numa_node = atoi(spec);
+        if(opts->numa_node < 0 || opts->numa_node >= opts->numa_nodes) {
+            fprintf(stderr, "Error: NUMA node %s does not exist\n", spec);
+            exit(-1);
+        }
+    }
+}
+
+/* binds the memory allocated by the calling thread, and by the threads
+   it creates from now on, to a NUMA node (-1 for all the nodes) */
+static void bind_memory(int node)
+{
+#ifdef HAVE_LIBNUMA
+    if(numa_available() < 0) return;
+    if(node < 0) {
+        numa_set_membind(numa_all_nodes_ptr);
+    } else {
+        struct bitmask* mask = numa_allocate_nodemask();
+        numa_bitmask_setbit(mask, node);
+        numa_set_membind(mask);
+        numa_free_nodemask(mask);
+    }
+#else
+    static int warned = 0;
+    if(node >= 0 && !warned) {
+        fprintf(stderr, "Warning: built without libnuma, memory is not bound to NUMA nodes\n");
+        warned = 1;
+    }
+#endif
+}
+
 static void finalize_sdskv(void *data)
 {
 
@@ -276,13 +748,17 @@ static void finalize_ssg_cb(void* data)
 static void finalize_bake_client_cb(void* data)
 {
     bake_client_data* clt_data = (bake_client_data*)data;
-    bake_provider_handle_release(clt_data->provider_handle);
+    int i;
+    for(i = 0; i < clt_data->num_handles; i++)
+        bake_provider_handle_release(clt_data->provider_handles[i]);
     bake_client_finalize(clt_data->client);
 }
 
 static void finalize_sdskv_client_cb(void* data)
 {
     sdskv_client_data* clt_data = (sdskv_client_data*)data;
-    sdskv_provider_handle_release(clt_data->provider_handle);
+    int i;
+    for(i = 0; i < clt_data->num_handles; i++)
+        sdskv_provider_handle_release(clt_data->provider_handles[i]);
     sdskv_client_finalize(clt_data->client);
 }
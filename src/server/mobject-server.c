@@ -17,26 +17,53 @@
 #include "src/server/mobject-server-context.h"
 #include "src/rpc-types/write-op.h"
 #include "src/rpc-types/read-op.h"
+#include "src/rpc-types/migrate.h"
 //#include "src/server/print-write-op.h"
 //#include "src/server/print-read-op.h"
 #include "src/io-chain/write-op-impl.h"
 #include "src/io-chain/read-op-impl.h"
+#include "src/util/utlist.h"
 #include "src/server/visitor-args.h"
 #ifdef FAKE_CPP_SERVER
 #include "src/server/fake/fake-read-op.h"
 #include "src/server/fake/fake-write-op.h"
 #else
 #include "src/server/core/core-read-op.h"
-#include "src/server/core/core-write-op.h"
 #endif
+#include "src/server/core/core-write-op.h"
+#include "src/server/core/core-migrate.h"
+#include "src/server/core/core-oid-cache.h"
+#include "src/server/core/core-qos.h"
+#include "src/server/core/core-metrics.h"
 
 DECLARE_MARGO_RPC_HANDLER(mobject_write_op_ult)
+DECLARE_MARGO_RPC_HANDLER(mobject_write_op_batch_ult)
 DECLARE_MARGO_RPC_HANDLER(mobject_read_op_ult)
+DECLARE_MARGO_RPC_HANDLER(mobject_read_op_batch_ult)
 DECLARE_MARGO_RPC_HANDLER(mobject_server_clean_ult)
 DECLARE_MARGO_RPC_HANDLER(mobject_server_stat_ult)
+DECLARE_MARGO_RPC_HANDLER(mobject_migrate_ult)
+DECLARE_MARGO_RPC_HANDLER(mobject_forwarded_read_op_ult)
+DECLARE_MARGO_RPC_HANDLER(mobject_replica_write_op_ult)
+DECLARE_MARGO_RPC_HANDLER(mobject_write_safe_ult)
 
 static void mobject_finalize_cb(void* data);
 
+static int mobject_server_refresh_placement(mobject_provider_t srv_ctx);
+
+static void mobject_server_membership_update_cb(void* data,
+        ssg_member_id_t member_id, ssg_member_update_type_t update_type);
+
+static void mobject_server_rebalance_ult(void* data);
+static void mobject_server_drop_previous_placement(mobject_provider_t srv_ctx);
+
+static hg_addr_t mobject_server_previous_owner(
+        mobject_provider_t srv_ctx, const char* object_name);
+
+static unsigned mobject_server_replicas(
+        mobject_provider_t srv_ctx, const char* pool_name,
+        const char* object_name, ssg_member_id_t* replicas);
+
 int mobject_provider_register(
         margo_instance_id mid,
         uint16_t provider_id,
@@ -49,7 +76,7 @@ int mobject_provider_register(
 {
     mobject_provider_t srv_ctx;
     int my_rank;
-    int ret;
+    int ret, i;
 
     /* check if a provider with the same multiplex id already exists */
     {
@@ -72,9 +99,44 @@ int mobject_provider_register(
     srv_ctx->ref_count = 1;
     ABT_mutex_create(&srv_ctx->mutex);
     ABT_mutex_create(&srv_ctx->stats_mutex);
+    for(i = 0; i < MOBJECT_REPLICA_WRITE_LOCKS; i++)
+        ABT_mutex_create(&srv_ctx->replica_write_locks[i]);
 
     srv_ctx->gid = gid; 
     my_rank = ssg_get_group_self_rank(srv_ctx->gid);
+    srv_ctx->rebalance_thread = ABT_THREAD_NULL;
+    if(srv_ctx->pool == ABT_POOL_NULL)
+        margo_get_handler_pool(mid, &srv_ctx->pool);
+    srv_ctx->bulk_pool = ABT_POOL_NULL;
+    srv_ctx->bulk_threshold = MOBJECT_BULK_THRESHOLD_DEFAULT;
+
+    {
+        hg_addr_t self_addr;
+        char self_addr_str[128];
+        hg_size_t self_addr_str_size = 128;
+        margo_addr_self(mid, &self_addr);
+        margo_addr_to_string(mid, self_addr_str, &self_addr_str_size, self_addr);
+        margo_addr_free(mid, self_addr);
+        srv_ctx->self_addr_str = strdup(self_addr_str);
+    }
+
+    /* replication factors and erasure-coding profiles of the pools */
+    if(getenv(MOBJECT_REPLICATION_ENV))
+        srv_ctx->replication_spec = strdup(getenv(MOBJECT_REPLICATION_ENV));
+    if(getenv(MOBJECT_ERASURE_ENV))
+        srv_ctx->erasure_spec = strdup(getenv(MOBJECT_ERASURE_ENV));
+
+    /* compute the placement of objects in the current group */
+    ret = mobject_server_refresh_placement(srv_ctx);
+    if(ret != 0)
+    {
+        fprintf(stderr, "Error: unable to initialize object placement\n");
+        free(srv_ctx->self_addr_str);
+        free(srv_ctx->replication_spec);
+        free(srv_ctx->erasure_spec);
+        free(srv_ctx);
+        return -1;
+    }
 
     /* one proccess writes cluster connect info to file for clients to find later */
     if (my_rank == 0)
@@ -96,16 +158,22 @@ int mobject_provider_register(
     bake_provider_handle_ref_incr(bake_ph);
     srv_ctx->bake_ph = bake_ph;
     uint64_t num_targets;
-    ret = bake_probe(bake_ph, 1, &(srv_ctx->bake_tid), &num_targets);
+    srv_ctx->bake_tids = calloc(MOBJECT_MAX_BAKE_TARGETS, sizeof(bake_target_id_t));
+    ret = bake_probe(bake_ph, MOBJECT_MAX_BAKE_TARGETS, srv_ctx->bake_tids, &num_targets);
     if(ret != 0) {
         fprintf(stderr, "Error: unable to probe bake server for targets\n");
+        free(srv_ctx->bake_tids);
         return -1;
     }
     if(num_targets < 1) {
         fprintf(stderr, "Error: unable to find a target on bake provider\n");
+        free(srv_ctx->bake_tids);
         free(srv_ctx);
         return -1;
     }
+    /* new regions are created round-robin on all the targets */
+    srv_ctx->num_bake_targets = num_targets;
+    srv_ctx->next_bake_target = 0;
     /* SDSKV settings initialization */
     sdskv_provider_handle_ref_incr(sdskv_ph);
     srv_ctx->sdskv_ph = sdskv_ph;
@@ -138,6 +206,45 @@ int mobject_provider_register(
         free(srv_ctx);
     }
 
+    /* operations on known objects do not look their oid up in the KV store */
+    size_t oid_cache_size = MOBJECT_OID_CACHE_SIZE_DEFAULT;
+    if(getenv(MOBJECT_OID_CACHE_SIZE_ENV))
+        oid_cache_size = strtoul(getenv(MOBJECT_OID_CACHE_SIZE_ENV), NULL, 0);
+    core_oid_cache_init(srv_ctx, oid_cache_size);
+
+    /* writes to an object wait while it is removed after its migration */
+    core_migration_init(srv_ctx);
+
+    /* rate limits and fair-share admission of client operations */
+    core_qos_init(srv_ctx);
+
+    /* per-xstream counters of actions and backend calls */
+    core_metrics_init(srv_ctx);
+
+    /* segment entries of concurrent writes are committed together */
+    srv_ctx->commit_window = 0;
+    if(getenv(MOBJECT_COMMIT_WINDOW_ENV))
+        srv_ctx->commit_window = atof(getenv(MOBJECT_COMMIT_WINDOW_ENV));
+    srv_ctx->commit_max = MOBJECT_COMMIT_MAX_DEFAULT;
+    if(getenv(MOBJECT_COMMIT_MAX_ENV))
+        srv_ctx->commit_max = strtoul(getenv(MOBJECT_COMMIT_MAX_ENV), NULL, 0);
+    if(srv_ctx->commit_max == 0)
+        srv_ctx->commit_max = 1;
+    core_commit_init(srv_ctx);
+
+    /* writes acknowledged before being persisted */
+    srv_ctx->persist_interval = MOBJECT_PERSIST_INTERVAL_DEFAULT;
+    if(getenv(MOBJECT_PERSIST_INTERVAL_ENV))
+        srv_ctx->persist_interval = atof(getenv(MOBJECT_PERSIST_INTERVAL_ENV));
+    ret = core_persist_init(srv_ctx);
+    if(ret != 0)
+        fprintf(stderr, "Warning: unable to start the persist ULT, deferred writes are persisted at shutdown\n");
+
+    /* reads are forwarded to previous owners until rebalancing settles */
+    srv_ctx->rebalance_settle = MOBJECT_REBALANCE_SETTLE_DEFAULT;
+    if(getenv(MOBJECT_REBALANCE_SETTLE_ENV))
+        srv_ctx->rebalance_settle = atof(getenv(MOBJECT_REBALANCE_SETTLE_ENV));
+
     hg_id_t rpc_id;
 
     /* read/write op RPCs */
@@ -146,11 +253,32 @@ int mobject_provider_register(
             provider_id, pool);
     margo_register_data(mid, rpc_id, srv_ctx, NULL);
 
+    rpc_id = MARGO_REGISTER_PROVIDER(mid, "mobject_write_op_batch",
+            write_op_batch_in_t, write_op_batch_out_t, mobject_write_op_batch_ult,
+            provider_id, pool);
+    margo_register_data(mid, rpc_id, srv_ctx, NULL);
+
     rpc_id = MARGO_REGISTER_PROVIDER(mid, "mobject_read_op",
             read_op_in_t, read_op_out_t, mobject_read_op_ult,
             provider_id, pool);
     margo_register_data(mid, rpc_id, srv_ctx, NULL);
 
+    rpc_id = MARGO_REGISTER_PROVIDER(mid, "mobject_read_op_batch",
+            read_op_batch_in_t, read_op_batch_out_t, mobject_read_op_batch_ult,
+            provider_id, pool);
+    margo_register_data(mid, rpc_id, srv_ctx, NULL);
+
+    rpc_id = MARGO_REGISTER_PROVIDER(mid, "mobject_replica_write_op",
+            write_op_in_t, write_op_out_t, mobject_replica_write_op_ult,
+            provider_id, pool);
+    margo_register_data(mid, rpc_id, srv_ctx, NULL);
+    srv_ctx->replica_write_op_rpc_id = rpc_id;
+
+    rpc_id = MARGO_REGISTER_PROVIDER(mid, "mobject_write_safe",
+            write_safe_in_t, write_safe_out_t, mobject_write_safe_ult,
+            provider_id, pool);
+    margo_register_data(mid, rpc_id, srv_ctx, NULL);
+
     /* server ctl RPCs */
     rpc_id = MARGO_REGISTER_PROVIDER(mid, "mobject_server_clean",
             void, void, mobject_server_clean_ult,
@@ -162,6 +290,25 @@ int mobject_provider_register(
             provider_id, pool);
     margo_register_data(mid, rpc_id, srv_ctx, NULL);
 
+    /* object migration RPCs */
+    rpc_id = MARGO_REGISTER_PROVIDER(mid, "mobject_migrate",
+            migrate_in_t, migrate_out_t, mobject_migrate_ult,
+            provider_id, pool);
+    margo_register_data(mid, rpc_id, srv_ctx, NULL);
+    srv_ctx->migrate_rpc_id = rpc_id;
+
+    rpc_id = MARGO_REGISTER_PROVIDER(mid, "mobject_forwarded_read_op",
+            read_op_in_t, forward_read_op_out_t, mobject_forwarded_read_op_ult,
+            provider_id, pool);
+    margo_register_data(mid, rpc_id, srv_ctx, NULL);
+    srv_ctx->forward_read_op_rpc_id = rpc_id;
+
+    /* rebalance objects when servers join or leave the group */
+    ret = ssg_group_add_membership_update_callback(gid,
+            mobject_server_membership_update_cb, (void*)srv_ctx);
+    if(ret != SSG_SUCCESS)
+        fprintf(stderr, "Warning: unable to track group membership, objects will not be rebalanced\n");
+
     margo_push_finalize_callback(mid, mobject_finalize_cb, (void*)srv_ctx);
 
     *provider = srv_ctx;
@@ -169,12 +316,135 @@ int mobject_provider_register(
     return 0;
 }
 
-static hg_return_t mobject_write_op_ult(hg_handle_t h)
+/* bytes of data moved by the actions of a write_op */
+static size_t write_op_data_size(mobject_store_write_op_t write_op)
+{
+    size_t size = 0;
+    wr_action_base_t a;
+    for(a = write_op->actions; a != NULL; a = a->next) {
+        switch(a->type) {
+            case WRITE_OPCODE_WRITE:
+                size += ((wr_action_write_t)a)->len; break;
+            case WRITE_OPCODE_WRITE_FULL:
+                size += ((wr_action_write_full_t)a)->len; break;
+            case WRITE_OPCODE_WRITE_SAME:
+                size += ((wr_action_write_same_t)a)->write_len; break;
+            case WRITE_OPCODE_APPEND:
+                size += ((wr_action_append_t)a)->len; break;
+            default:
+                break;
+        }
+    }
+    return size;
+}
+
+/* bytes of data moved by the actions of a read_op */
+static size_t read_op_data_size(mobject_store_read_op_t read_op)
+{
+    size_t size = 0;
+    rd_action_base_t a;
+    for(a = read_op->actions; a != NULL; a = a->next)
+        if(a->type == READ_OPCODE_READ)
+            size += ((rd_action_read_t)a)->len;
+    return size;
+}
+
+/* arguments of the operations that may be run in the bulk pool */
+typedef struct {
+    mobject_store_write_op_t* write_ops;
+    mobject_store_read_op_t*  read_ops;
+    const char* const*        object_names;
+    const uint64_t*           bulk_offsets;
+    size_t                    count;
+    server_visitor_args*      vargs;
+} server_op_args;
+
+static void mobject_server_write_op(void* arg)
+{
+    server_op_args* args = (server_op_args*)arg;
+#ifdef FAKE_CPP_SERVER
+    fake_write_op(args->write_ops[0], args->vargs);
+#else
+    core_write_op(args->write_ops[0], args->vargs);
+#endif
+}
+
+static void mobject_server_write_op_batch(void* arg)
+{
+    server_op_args* args = (server_op_args*)arg;
+#ifdef FAKE_CPP_SERVER
+    size_t i;
+    for(i = 0; i < args->count; i++) {
+        args->vargs->object_name = args->object_names[i];
+        args->vargs->oid         = 0;
+        args->vargs->bulk_offset = args->bulk_offsets[i];
+        fake_write_op(args->write_ops[i], args->vargs);
+    }
+#else
+    core_write_op_batch(args->write_ops, args->object_names,
+            args->bulk_offsets, args->count, args->vargs);
+#endif
+}
+
+static void mobject_server_read_op(void* arg)
+{
+    server_op_args* args = (server_op_args*)arg;
+#ifdef FAKE_CPP_SERVER
+    fake_read_op(args->read_ops[0], args->vargs);
+#else
+    core_read_op(args->read_ops[0], args->vargs);
+#endif
+}
+
+static void mobject_server_read_op_batch(void* arg)
+{
+    server_op_args* args = (server_op_args*)arg;
+#ifdef FAKE_CPP_SERVER
+    size_t i;
+    for(i = 0; i < args->count; i++) {
+        args->vargs->object_name = args->object_names[i];
+        args->vargs->oid         = 0;
+        fake_read_op(args->read_ops[i], args->vargs);
+    }
+#else
+    core_read_op_batch(args->read_ops, args->object_names, args->count, args->vargs);
+#endif
+}
+
+/* runs fn(arg) in a ULT of the bulk pool if the operation moves at
+   least bulk_threshold bytes, in the calling ULT otherwise; the calling
+   ULT is blocked in the meantime, without holding its xstream. Operations
+   of clients (vargs not NULL) go through admission first, num_ops being
+   the number of operations of a batch */
+static void mobject_server_run_op(mobject_provider_t srv_ctx, server_visitor_args* vargs,
+        size_t num_ops, size_t data_size, void (*fn)(void*), void* arg)
+{
+    ABT_thread ult;
+    if(vargs)
+        core_qos_admit(srv_ctx, vargs->client_addr_str, vargs->pool_name, num_ops, data_size);
+    if(srv_ctx->bulk_pool == ABT_POOL_NULL || data_size < srv_ctx->bulk_threshold
+    || ABT_thread_create(srv_ctx->bulk_pool, fn, arg, ABT_THREAD_ATTR_NULL, &ult) != ABT_SUCCESS) {
+        fn(arg);
+    } else {
+        ABT_thread_join(ult);
+        ABT_thread_free(&ult);
+    }
+    if(vargs)
+        core_qos_release(srv_ctx);
+}
+
+static hg_return_t mobject_process_write_op(hg_handle_t h, int replica)
 {
     hg_return_t ret;
 
     write_op_in_t in;
     write_op_out_t out;
+    ssg_member_id_t replicas[MOBJECT_MAX_REPLICAS];
+    hg_handle_t replica_handles[MOBJECT_MAX_REPLICAS];
+    margo_request replica_reqs[MOBJECT_MAX_REPLICAS];
+    unsigned num_replicas = 0;
+    ABT_mutex write_lock = ABT_MUTEX_NULL;
+    unsigned i;
 
     /* Deserialize the input from the received handle. */
     ret = margo_get_input(h, &in);
@@ -192,18 +462,102 @@ static hg_return_t mobject_write_op_ult(hg_handle_t h)
     vargs.client_addr_str = in.client_addr;
     vargs.client_addr = info->addr;
     vargs.bulk_handle = in.write_op->bulk_handle;
+    vargs.bulk_offset = 0;
+    vargs.local_data  = NULL;
+    vargs.seg_batch   = NULL;
+    vargs.defer_persist = 0;
+    vargs.safe_seq    = 0;
+
+    // set the return value of the RPC
+    out.ret = 0;
+    out.safe_seq = 0;
+
+    if(!replica) {
+        /* admission comes first, so that a throttled client does not
+           hold a write lock that other clients' writes may need */
+        core_qos_admit(vargs.srv_ctx, in.client_addr, in.pool_name,
+                1, write_op_data_size(in.write_op));
+        /* the primary forwards the operation to the other replicas,
+           which pull the data from the client in parallel with it */
+        ssg_member_id_t self_id = ssg_get_self_id(mid);
+        unsigned n = mobject_server_replicas(vargs.srv_ctx, in.pool_name, in.object_name, replicas);
+        /* each replica stamps the segments itself, so concurrent writes
+           to the object must reach all of them in the same order: the
+           next one is only forwarded once this one is applied everywhere */
+        if(n > 0) {
+            write_lock = vargs.srv_ctx->replica_write_locks[
+                mobject_hash_name(in.object_name) % MOBJECT_REPLICA_WRITE_LOCKS];
+            ABT_mutex_lock(write_lock);
+        }
+        for(i = 0; i < n; i++) {
+            if(replicas[i] == self_id) continue;
+            hg_addr_t addr = ssg_get_group_member_addr(vargs.srv_ctx->gid, replicas[i]);
+            if(addr == HG_ADDR_NULL
+            || margo_create(mid, addr, vargs.srv_ctx->replica_write_op_rpc_id,
+                    &replica_handles[num_replicas]) != HG_SUCCESS) {
+                out.ret = -1;
+                continue;
+            }
+            ret = margo_provider_iforward(vargs.srv_ctx->provider_id,
+                    replica_handles[num_replicas], &in, &replica_reqs[num_replicas]);
+            if(ret != HG_SUCCESS) {
+                margo_destroy(replica_handles[num_replicas]);
+                out.ret = -1;
+                continue;
+            }
+            num_replicas += 1;
+        }
+    } else {
+        /* bulk transfers must target the client, not the primary,
+           which waits for the response while holding the write lock */
+        ret = margo_addr_lookup(mid, in.client_addr, &vargs.client_addr);
+        if(ret != HG_SUCCESS) {
+            fprintf(stderr, "Error: unable to look up client %s (ret = %d)\n",
+                    in.client_addr, ret);
+            out.ret = -1;
+            ret = margo_respond(h, &out);
+            assert(ret == HG_SUCCESS);
+            margo_free_input(h, &in);
+            return margo_destroy(h);
+        }
+    }
+
+    /* without replicas, the write may be acknowledged before being
+       persisted; replicated writes are persisted before replying */
+    if(!replica && num_replicas == 0 && out.ret == 0
+    && (in.flags & LIBMOBJECT_OPERATION_DEFER_PERSIST))
+        vargs.defer_persist = 1;
 
     /* Execute the operation chain */
     //print_write_op(in.write_op, in.object_name);
-#ifdef FAKE_CPP_SERVER
-    fake_write_op(in.write_op, &vargs);
-#else
-    core_write_op(in.write_op, &vargs);
-#endif
+    /* the primary was admitted above, and replicas by the primary */
+    server_op_args args = { &in.write_op, NULL, NULL, NULL, 1, &vargs };
+    mobject_server_run_op(vargs.srv_ctx, NULL, 1,
+            write_op_data_size(in.write_op), mobject_server_write_op, &args);
+    if(!replica)
+        core_qos_release(vargs.srv_ctx);
 
-    // set the return value of the RPC
-    out.ret = 0;
+    /* the operation completes once all the replicas have applied it */
+    for(i = 0; i < num_replicas; i++) {
+        write_op_out_t replica_out;
+        ret = margo_wait(replica_reqs[i]);
+        if(ret == HG_SUCCESS)
+            ret = margo_get_output(replica_handles[i], &replica_out);
+        if(ret != HG_SUCCESS) {
+            out.ret = -1;
+        } else {
+            if(replica_out.ret != 0) out.ret = replica_out.ret;
+            margo_free_output(replica_handles[i], &replica_out);
+        }
+        margo_destroy(replica_handles[i]);
+    }
+    if(write_lock != ABT_MUTEX_NULL)
+        ABT_mutex_unlock(write_lock);
+
+    if(replica)
+        margo_addr_free(mid, vargs.client_addr);
 
+    out.safe_seq = vargs.safe_seq;
     ret = margo_respond(h, &out);
     assert(ret == HG_SUCCESS);
 
@@ -216,10 +570,192 @@ static hg_return_t mobject_write_op_ult(hg_handle_t h)
  
     return ret;
 }
+
+static hg_return_t mobject_write_op_ult(hg_handle_t h)
+{
+    return mobject_process_write_op(h, 0);
+}
 DEFINE_MARGO_RPC_HANDLER(mobject_write_op_ult)
 
+static hg_return_t mobject_replica_write_op_ult(hg_handle_t h)
+{
+    return mobject_process_write_op(h, 1);
+}
+DEFINE_MARGO_RPC_HANDLER(mobject_replica_write_op_ult)
+
+/* Replies once the deferred write that got the ticket in.seq is safe */
+static hg_return_t mobject_write_safe_ult(hg_handle_t h)
+{
+    hg_return_t ret;
+
+    write_safe_in_t in;
+    write_safe_out_t out;
+
+    ret = margo_get_input(h, &in);
+    assert(ret == HG_SUCCESS);
+
+    const struct hg_info* info = margo_get_info(h);
+    margo_instance_id mid = margo_hg_handle_get_instance(h);
+    mobject_provider_t srv_ctx = margo_registered_data(mid, info->id);
+    if(srv_ctx == NULL) return HG_OTHER_ERROR;
+
+    out.ret = core_wait_safe(srv_ctx, in.seq);
+
+    ret = margo_respond(h, &out);
+    assert(ret == HG_SUCCESS);
+
+    ret = margo_free_input(h, &in);
+    assert(ret == HG_SUCCESS);
+
+    ret = margo_destroy(h);
+
+    return ret;
+}
+DEFINE_MARGO_RPC_HANDLER(mobject_write_safe_ult)
+
+static hg_return_t mobject_write_op_batch_ult(hg_handle_t h)
+{
+    hg_return_t ret;
+
+    write_op_batch_in_t in;
+    write_op_batch_out_t out;
+    char* local_data = NULL;
+    hg_bulk_t local_bulk = HG_BULK_NULL;
+
+    /* Deserialize the input from the received handle. */
+    ret = margo_get_input(h, &in);
+    assert(ret == HG_SUCCESS);
+
+    const struct hg_info* info = margo_get_info(h);
+    margo_instance_id mid = margo_hg_handle_get_instance(h);
+
+    server_visitor_args vargs;
+    vargs.object_name = NULL;
+    vargs.oid         = 0;
+    vargs.pool_name   = in.pool_name;
+    vargs.srv_ctx     = margo_registered_data(mid, info->id);
+    if(vargs.srv_ctx == NULL) return HG_OTHER_ERROR;
+    vargs.client_addr_str = in.client_addr;
+    vargs.client_addr = info->addr;
+    vargs.bulk_handle = in.bulk_handle;
+    vargs.bulk_offset = 0;
+    vargs.local_data  = NULL;
+    vargs.seg_batch   = NULL;
+    vargs.defer_persist = 0;
+    vargs.safe_seq    = 0;
+
+    // set the return value of the RPC
+    out.ret = 0;
+
+    /* the data of a batch of small objects is pulled in a single
+       transfer, otherwise each region is transferred on its own */
+    if(in.bulk_size > 0 && in.bulk_size <= MOBJECT_BATCH_PULL_MAX) {
+        local_data = (char*)malloc(in.bulk_size);
+        void* buf_ptrs[1] = {(void*)local_data};
+        hg_size_t buf_sizes[1] = {in.bulk_size};
+        ret = margo_bulk_create(mid, 1, buf_ptrs, buf_sizes, HG_BULK_WRITE_ONLY, &local_bulk);
+        if(ret == HG_SUCCESS)
+            ret = margo_bulk_transfer(mid, HG_BULK_PULL, info->addr, in.bulk_handle, 0,
+                    local_bulk, 0, in.bulk_size);
+        if(ret == HG_SUCCESS)
+            vargs.local_data = local_data;
+        else
+            fprintf(stderr, "Warning: could not pull the data of a batch at once (ret = %d)\n", ret);
+    }
+
+    /* Execute the operation chains */
+    server_op_args args = { in.write_ops, NULL, in.object_names, in.bulk_offsets, in.count, &vargs };
+    mobject_server_run_op(vargs.srv_ctx, &vargs, in.count, in.bulk_size,
+            mobject_server_write_op_batch, &args);
+
+    if(local_bulk != HG_BULK_NULL)
+        margo_bulk_free(local_bulk);
+    free(local_data);
+
+    ret = margo_respond(h, &out);
+    assert(ret == HG_SUCCESS);
+
+    /* Free the input data. */
+    ret = margo_free_input(h, &in);
+    assert(ret == HG_SUCCESS);
+
+    /* We are not going to use the handle anymore, so we should destroy it. */
+    ret = margo_destroy(h);
+
+    return ret;
+}
+DEFINE_MARGO_RPC_HANDLER(mobject_write_op_batch_ult)
+
+/* Sets the return value of every action of a read_op to -1, once its
+   responses are built by build_matching_read_responses. */
+static void mobject_server_fail_read_op(mobject_store_read_op_t read_op)
+{
+    rd_action_base_t a;
+
+    DL_FOREACH(read_op->actions, a) {
+        switch(a->type) {
+            case READ_OPCODE_STAT:
+                *(((rd_action_stat_t)a)->prval) = -1;
+                break;
+            case READ_OPCODE_READ:
+                *(((rd_action_read_t)a)->prval) = -1;
+                break;
+            case READ_OPCODE_OMAP_GET_KEYS:
+                *(((rd_action_omap_get_keys_t)a)->prval) = -1;
+                break;
+            case READ_OPCODE_OMAP_GET_VALS:
+                *(((rd_action_omap_get_vals_t)a)->prval) = -1;
+                break;
+            case READ_OPCODE_OMAP_GET_VALS_BY_KEYS:
+                *(((rd_action_omap_get_vals_by_keys_t)a)->prval) = -1;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/* Forwards a read_op to the provider that owned the object before the last
+   membership change, for objects that have not been migrated here yet.
+   If that provider does not have the object, *found is set to 0 and h is
+   left for the caller to respond to. */
+static hg_return_t mobject_forward_read_op(
+        mobject_provider_t srv_ctx, hg_handle_t h,
+        hg_addr_t owner_addr, read_op_in_t* in, int* found)
+{
+    hg_return_t ret;
+    hg_handle_t fh;
+    forward_read_op_out_t fout;
+    read_op_out_t out;
+
+    ret = margo_create(srv_ctx->mid, owner_addr, srv_ctx->forward_read_op_rpc_id, &fh);
+    if(ret != HG_SUCCESS) return ret;
+
+    ret = margo_provider_forward(srv_ctx->provider_id, fh, in);
+    if(ret != HG_SUCCESS) {
+        margo_destroy(fh);
+        return ret;
+    }
+    ret = margo_get_output(fh, &fout);
+    if(ret != HG_SUCCESS) {
+        margo_destroy(fh);
+        return ret;
+    }
+
+    *found = fout.found;
+    if(fout.found) {
+        out.responses = fout.responses;
+        ret = margo_respond(h, &out);
+        assert(ret == HG_SUCCESS);
+    }
+
+    margo_free_output(fh, &fout);
+    margo_destroy(fh);
+    return ret;
+}
+
 /* Implementation of the RPC. */
-static hg_return_t mobject_read_op_ult(hg_handle_t h)
+static hg_return_t mobject_process_read_op(hg_handle_t h, int forwarded)
 {
     hg_return_t ret;
 
@@ -230,9 +766,6 @@ static hg_return_t mobject_read_op_ult(hg_handle_t h)
     ret = margo_get_input(h, &in);
     assert(ret == HG_SUCCESS);
 
-    /* Create a response list matching the input actions */
-    read_response_t resp = build_matching_read_responses(in.read_op);
-
     const struct hg_info* info = margo_get_info(h);
     margo_instance_id mid = margo_hg_handle_get_instance(h);
 
@@ -245,21 +778,253 @@ static hg_return_t mobject_read_op_ult(hg_handle_t h)
     vargs.client_addr_str = in.client_addr;
     vargs.client_addr = info->addr;
     vargs.bulk_handle = in.read_op->bulk_handle;
+    vargs.bulk_offset = 0;
+    vargs.local_data  = NULL;
+    vargs.seg_batch   = NULL;
+    vargs.defer_persist = 0;
+    vargs.safe_seq    = 0;
+
+    if(!forwarded) {
+        /* the object may still be on its previous owner */
+        hg_addr_t owner_addr = mobject_server_previous_owner(vargs.srv_ctx, in.object_name);
+        if(owner_addr != HG_ADDR_NULL) {
+            int found = 0;
+            ret = mobject_forward_read_op(vargs.srv_ctx, h, owner_addr, &in, &found);
+            if(ret == HG_SUCCESS && found) {
+                margo_free_input(h, &in);
+                return margo_destroy(h);
+            }
+            if(ret != HG_SUCCESS)
+                fprintf(stderr, "Warning: unable to forward read_op on %s (ret = %d)\n",
+                        in.object_name, ret);
+        }
+    } else {
+        /* without the object, the forwarding server has the only copy */
+        hg_size_t vsize;
+        ret = sdskv_length(vargs.srv_ctx->sdskv_ph, vargs.srv_ctx->name_db_id,
+                (const void*)in.object_name, strlen(in.object_name)+1, &vsize);
+        if(ret != SDSKV_SUCCESS) {
+            forward_read_op_out_t fout;
+            fout.found     = 0;
+            fout.responses = build_matching_read_responses(in.read_op);
+            ret = margo_respond(h, &fout);
+            assert(ret == HG_SUCCESS);
+            free_read_responses(fout.responses);
+            margo_free_input(h, &in);
+            return margo_destroy(h);
+        }
+        /* bulk transfers must target the client, not the forwarding server,
+           which waits for the response */
+        ret = margo_addr_lookup(mid, in.client_addr, &vargs.client_addr);
+        if(ret != HG_SUCCESS) {
+            forward_read_op_out_t fout;
+            fprintf(stderr, "Error: unable to look up client %s (ret = %d)\n",
+                    in.client_addr, ret);
+            fout.found     = 1;
+            fout.responses = build_matching_read_responses(in.read_op);
+            mobject_server_fail_read_op(in.read_op);
+            ret = margo_respond(h, &fout);
+            assert(ret == HG_SUCCESS);
+            free_read_responses(fout.responses);
+            margo_free_input(h, &in);
+            return margo_destroy(h);
+        }
+    }
+
+    /* Create a response list matching the input actions */
+    read_response_t resp = build_matching_read_responses(in.read_op);
 
     /* Compute the result. */
     //print_read_op(in.read_op, in.object_name);
-#ifdef FAKE_CPP_SERVER
-    fake_read_op(in.read_op, &vargs);
-#else
-    core_read_op(in.read_op, &vargs);
+    /* reads are admitted by the provider executing them, which is the
+       previous owner for forwarded ones: in.client_addr still names the
+       client, so they count against its limits and its queue */
+    server_op_args args = { NULL, &in.read_op, NULL, NULL, 1, &vargs };
+    mobject_server_run_op(vargs.srv_ctx, &vargs, 1,
+            read_op_data_size(in.read_op), mobject_server_read_op, &args);
+
+    if(forwarded) {
+        forward_read_op_out_t fout;
+        fout.found     = 1;
+        fout.responses = resp;
+        ret = margo_respond(h, &fout);
+    } else {
+        out.responses = resp;
+        ret = margo_respond(h, &out);
+    }
+    assert(ret == HG_SUCCESS);
+
+    free_read_responses(resp);
+
+    if(forwarded)
+        margo_addr_free(mid, vargs.client_addr);
+
+    /* Free the input data. */
+    ret = margo_free_input(h, &in);
+    assert(ret == HG_SUCCESS);
+
+    /* We are not going to use the handle anymore, so we should destroy it. */
+    ret = margo_destroy(h);
+    assert(ret == HG_SUCCESS);
+
+    return ret;
+}
+
+static hg_return_t mobject_read_op_ult(hg_handle_t h)
+{
+    return mobject_process_read_op(h, 0);
+}
+DEFINE_MARGO_RPC_HANDLER(mobject_read_op_ult)
+
+static hg_return_t mobject_forwarded_read_op_ult(hg_handle_t h)
+{
+    return mobject_process_read_op(h, 1);
+}
+DEFINE_MARGO_RPC_HANDLER(mobject_forwarded_read_op_ult)
+
+/* Forwards the i-th read_op of a batch to the previous owner of its object.
+   The previous owner pushes the data to the batch's bulk handle itself.
+   On success, *fh must be freed along with *fout once responded, unless
+   fout->found is 0 (the previous owner does not have the object). */
+static hg_return_t mobject_forward_batched_read_op(
+        mobject_provider_t srv_ctx, hg_addr_t owner_addr,
+        read_op_batch_in_t* batch, uint32_t i,
+        hg_handle_t* fh, forward_read_op_out_t* fout)
+{
+    hg_return_t ret;
+    read_op_in_t in;
+
+    in.client_addr = batch->client_addr;
+    in.pool_name   = batch->pool_name;
+    in.object_name = batch->object_names[i];
+    in.read_op     = batch->read_ops[i];
+
+    ret = margo_create(srv_ctx->mid, owner_addr, srv_ctx->forward_read_op_rpc_id, fh);
+    if(ret != HG_SUCCESS) return ret;
+
+    /* the offsets of the read_ops of a batch are positions in its bulk handle */
+    in.read_op->bulk_handle = batch->bulk_handle;
+    ret = margo_provider_forward(srv_ctx->provider_id, *fh, &in);
+    in.read_op->bulk_handle = HG_BULK_NULL;
+    if(ret == HG_SUCCESS)
+        ret = margo_get_output(*fh, fout);
+    if(ret == HG_SUCCESS && !fout->found)
+        margo_free_output(*fh, fout);
+    if(ret != HG_SUCCESS || !fout->found) {
+        margo_destroy(*fh);
+        *fh = HG_HANDLE_NULL;
+    }
+    return ret;
+}
+
+static hg_return_t mobject_read_op_batch_ult(hg_handle_t h)
+{
+    hg_return_t ret;
+    uint32_t i, num_local = 0, num_forwarded = 0;
+
+    read_op_batch_in_t in;
+    read_op_batch_out_t out;
+    char* local_data = NULL;
+    hg_bulk_t local_bulk = HG_BULK_NULL;
+
+    /* Deserialize the input from the received handle. */
+    ret = margo_get_input(h, &in);
+    assert(ret == HG_SUCCESS);
+
+    const struct hg_info* info = margo_get_info(h);
+    margo_instance_id mid = margo_hg_handle_get_instance(h);
+
+    server_visitor_args vargs;
+    vargs.object_name = NULL;
+    vargs.oid         = 0;
+    vargs.pool_name   = in.pool_name;
+    vargs.srv_ctx     = margo_registered_data(mid, info->id);
+    if(vargs.srv_ctx == NULL) return HG_OTHER_ERROR;
+    vargs.client_addr_str = in.client_addr;
+    vargs.client_addr = info->addr;
+    vargs.bulk_handle = in.bulk_handle;
+    vargs.bulk_offset = 0;
+    vargs.local_data  = NULL;
+    vargs.seg_batch   = NULL;
+    vargs.defer_persist = 0;
+    vargs.safe_seq    = 0;
+
+    out.count     = in.count;
+    out.responses = (read_response_t*)calloc(in.count, sizeof(read_response_t));
+
+    hg_handle_t* fwd_handles = (hg_handle_t*)calloc(in.count, sizeof(hg_handle_t));
+    forward_read_op_out_t* fwd_outs = (forward_read_op_out_t*)calloc(in.count, sizeof(forward_read_op_out_t));
+    mobject_store_read_op_t* local_ops = (mobject_store_read_op_t*)calloc(in.count, sizeof(mobject_store_read_op_t));
+    const char** local_names = (const char**)calloc(in.count, sizeof(const char*));
+
+    /* objects that have not been migrated here yet are read from their
+       previous owner, the others are read here; response lists matching
+       the input actions are created for the latter */
+    for(i = 0; i < in.count; i++) {
+        fwd_handles[i] = HG_HANDLE_NULL;
+        hg_addr_t owner_addr = mobject_server_previous_owner(vargs.srv_ctx, in.object_names[i]);
+        if(owner_addr != HG_ADDR_NULL) {
+            ret = mobject_forward_batched_read_op(vargs.srv_ctx, owner_addr, &in, i,
+                    &fwd_handles[i], &fwd_outs[i]);
+            if(ret == HG_SUCCESS && fwd_outs[i].found) {
+                out.responses[i] = fwd_outs[i].responses;
+                num_forwarded += 1;
+                continue;
+            }
+            if(ret != HG_SUCCESS)
+                fprintf(stderr, "Warning: unable to forward read_op on %s (ret = %d)\n",
+                        in.object_names[i], ret);
+        }
+        out.responses[i] = build_matching_read_responses(in.read_ops[i]);
+        local_ops[num_local]   = in.read_ops[i];
+        local_names[num_local] = in.object_names[i];
+        num_local += 1;
+    }
+
+    /* the data of a batch of small reads is gathered locally and pushed
+       in a single transfer, unless part of it was pushed by other servers */
+#ifndef FAKE_CPP_SERVER
+    if(num_forwarded == 0 && in.bulk_size > 0 && in.bulk_size <= MOBJECT_BATCH_PULL_MAX) {
+        local_data = (char*)calloc(1, in.bulk_size);
+        void* buf_ptrs[1] = {(void*)local_data};
+        hg_size_t buf_sizes[1] = {in.bulk_size};
+        ret = margo_bulk_create(mid, 1, buf_ptrs, buf_sizes, HG_BULK_READ_ONLY, &local_bulk);
+        if(ret == HG_SUCCESS)
+            vargs.local_data = local_data;
+    }
 #endif
 
-    out.responses = resp;
+    /* Compute the result. */
+    server_op_args args = { NULL, local_ops, local_names, NULL, num_local, &vargs };
+    mobject_server_run_op(vargs.srv_ctx, &vargs, num_local, in.bulk_size,
+            mobject_server_read_op_batch, &args);
+
+    if(vargs.local_data) {
+        ret = margo_bulk_transfer(mid, HG_BULK_PUSH, info->addr, in.bulk_handle, 0,
+                local_bulk, 0, in.bulk_size);
+        if(ret != HG_SUCCESS)
+            fprintf(stderr, "Error: could not push the data of a batch (ret = %d)\n", ret);
+    }
 
     ret = margo_respond(h, &out);
     assert(ret == HG_SUCCESS);
 
-    free_read_responses(resp);
+    for(i = 0; i < in.count; i++) {
+        if(fwd_handles[i] != HG_HANDLE_NULL) {
+            margo_free_output(fwd_handles[i], &fwd_outs[i]);
+            margo_destroy(fwd_handles[i]);
+        } else {
+            free_read_responses(out.responses[i]);
+        }
+    }
+    free(out.responses);
+    free(fwd_handles);
+    free(fwd_outs);
+    free(local_ops);
+    free(local_names);
+    if(local_bulk != HG_BULK_NULL)
+        margo_bulk_free(local_bulk);
+    free(local_data);
 
     /* Free the input data. */
     ret = margo_free_input(h, &in);
@@ -271,7 +1036,60 @@ static hg_return_t mobject_read_op_ult(hg_handle_t h)
 
     return ret;
 }
-DEFINE_MARGO_RPC_HANDLER(mobject_read_op_ult)
+DEFINE_MARGO_RPC_HANDLER(mobject_read_op_batch_ult)
+
+typedef struct {
+    mobject_provider_t srv_ctx;
+    migrate_in_t*      in;
+    hg_addr_t          sender;
+    int                ret;
+} receive_object_args;
+
+static void mobject_server_receive_object(void* arg)
+{
+    receive_object_args* args = (receive_object_args*)arg;
+    args->ret = core_receive_object(args->srv_ctx, args->in->object_name,
+            args->in->sender_addr, args->sender, args->in->bulk_handle, args->in->meta_size);
+}
+
+/* migrations always count as bulk operations */
+static hg_return_t mobject_migrate_ult(hg_handle_t h)
+{
+    hg_return_t ret;
+
+    migrate_in_t in;
+    migrate_out_t out;
+
+    ret = margo_get_input(h, &in);
+    assert(ret == HG_SUCCESS);
+
+    const struct hg_info* info = margo_get_info(h);
+    margo_instance_id mid = margo_hg_handle_get_instance(h);
+
+    mobject_provider_t srv_ctx = margo_registered_data(mid, info->id);
+    if(srv_ctx == NULL) return HG_OTHER_ERROR;
+
+    receive_object_args args = { srv_ctx, &in, info->addr, 0 };
+    mobject_server_run_op(srv_ctx, NULL, 1, srv_ctx->bulk_threshold,
+            mobject_server_receive_object, &args);
+    out.ret = args.ret;
+
+    ABT_mutex_lock(srv_ctx->mutex);
+    srv_ctx->last_migration = ABT_get_wtime();
+    ABT_mutex_unlock(srv_ctx->mutex);
+
+    ret = margo_respond(h, &out);
+    assert(ret == HG_SUCCESS);
+
+    ret = margo_free_input(h, &in);
+    assert(ret == HG_SUCCESS);
+
+    ret = margo_destroy(h);
+    assert(ret == HG_SUCCESS);
+
+    return ret;
+}
+DEFINE_MARGO_RPC_HANDLER(mobject_migrate_ult)
 
 static hg_return_t mobject_server_clean_ult(hg_handle_t h)
 {
@@ -314,6 +1132,8 @@ static hg_return_t mobject_server_stat_ult(hg_handle_t h)
         srv_ctx->total_seg_size, srv_ctx->total_seg_wr_duration,
         (srv_ctx->total_seg_size / (1024.0 * 1024.0 ) / srv_ctx->total_seg_wr_duration));
     ABT_mutex_unlock(srv_ctx->stats_mutex);
+    core_qos_print_stats(srv_ctx, stderr);
+    core_metrics_print(srv_ctx, stderr);
 
     ret = margo_respond(h, NULL);
     assert(ret == HG_SUCCESS);
@@ -325,14 +1145,230 @@ static hg_return_t mobject_server_stat_ult(hg_handle_t h)
 }
 DEFINE_MARGO_RPC_HANDLER(mobject_server_stat_ult)
 
+int mobject_provider_set_rebalancing(
+        mobject_provider_t provider,
+        size_t max_bandwidth,
+        size_t batch_size)
+{
+    ABT_mutex_lock(provider->mutex);
+    provider->rebalance_bandwidth  = max_bandwidth;
+    provider->rebalance_batch_size = batch_size;
+    ABT_mutex_unlock(provider->mutex);
+    return 0;
+}
+
+int mobject_provider_set_bulk_pool(
+        mobject_provider_t provider,
+        ABT_pool bulk_pool,
+        size_t threshold)
+{
+    ABT_mutex_lock(provider->mutex);
+    provider->bulk_pool      = bulk_pool;
+    provider->bulk_threshold = threshold ? threshold : MOBJECT_BULK_THRESHOLD_DEFAULT;
+    ABT_mutex_unlock(provider->mutex);
+    return 0;
+}
+
+int mobject_provider_set_symbiomon(
+        mobject_provider_t provider,
+        struct symbiomon_provider* metric_provider)
+{
+    return core_metrics_publish(provider, metric_provider);
+}
+
+static int mobject_server_refresh_placement(mobject_provider_t srv_ctx)
+{
+    mobject_placement_t placement;
+    ssg_member_id_t* members;
+    int gsize, i;
+
+    gsize = ssg_get_group_size(srv_ctx->gid);
+    if(gsize <= 0) return -1;
+
+    members = (ssg_member_id_t*)calloc(gsize, sizeof(*members));
+    if(!members) return -1;
+    for(i = 0; i < gsize; i++)
+        members[i] = ssg_get_group_member_id_from_rank(srv_ctx->gid, i);
+
+    if(mobject_placement_create_from_env(gsize, members, &placement) != 0) {
+        free(members);
+        return -1;
+    }
+
+    ABT_mutex_lock(srv_ctx->mutex);
+    mobject_placement_free(srv_ctx->prev_placement);
+    free(srv_ctx->prev_members);
+    srv_ctx->prev_placement = srv_ctx->placement;
+    srv_ctx->prev_members   = srv_ctx->members;
+    srv_ctx->placement      = placement;
+    srv_ctx->members        = members;
+    core_migration_clear(srv_ctx);
+    srv_ctx->rebalance_start = ABT_get_wtime();
+    ABT_mutex_unlock(srv_ctx->mutex);
+
+    return 0;
+}
+
+static hg_addr_t mobject_server_previous_owner(
+        mobject_provider_t srv_ctx, const char* object_name)
+{
+    ssg_member_id_t owner = SSG_MEMBER_ID_INVALID;
+
+    /* forward only objects that have not reached this provider whole: the
+       name of an object exists here from its first migration message on,
+       or from the first write received since the membership change */
+    ABT_mutex_lock(srv_ctx->mutex);
+    if(srv_ctx->prev_placement && !core_migration_complete(srv_ctx, object_name)) {
+        /* the primary, or the server of the chunk's position */
+        long rank = mobject_placement_locate_position(srv_ctx->prev_placement, object_name, 0);
+        if(rank >= 0) owner = srv_ctx->prev_members[rank];
+    }
+    ABT_mutex_unlock(srv_ctx->mutex);
+
+    if(owner == SSG_MEMBER_ID_INVALID || owner == ssg_get_self_id(srv_ctx->mid))
+        return HG_ADDR_NULL;
+
+    /* HG_ADDR_NULL if the previous owner has left the group */
+    return ssg_get_group_member_addr(srv_ctx->gid, owner);
+}
+
+static unsigned mobject_server_replicas(
+        mobject_provider_t srv_ctx, const char* pool_name,
+        const char* object_name, ssg_member_id_t* replicas)
+{
+    unsigned long ranks[MOBJECT_MAX_REPLICAS];
+    unsigned n, i, k, m;
+
+    /* chunks of erasure-coded objects are written by the clients */
+    if(mobject_erasure_profile(srv_ctx->erasure_spec, pool_name, &k, &m))
+        return 0;
+
+    n = mobject_replication_factor(srv_ctx->replication_spec, pool_name);
+    if(n <= 1) return 0;
+
+    ABT_mutex_lock(srv_ctx->mutex);
+    n = mobject_placement_locate_replicas(srv_ctx->placement, object_name, n, ranks);
+    for(i = 0; i < n; i++)
+        replicas[i] = srv_ctx->members[ranks[i]];
+    ABT_mutex_unlock(srv_ctx->mutex);
+
+    return n;
+}
+
+static void mobject_server_membership_update_cb(void* data,
+        ssg_member_id_t member_id, ssg_member_update_type_t update_type)
+{
+    mobject_provider_t srv_ctx = (mobject_provider_t)data;
+    (void)member_id;
+    (void)update_type;
+
+    /* a running rebalancing restarts with the new membership,
+       otherwise a new rebalancing ULT is started */
+    ABT_mutex_lock(srv_ctx->mutex);
+    srv_ctx->rebalance_pending = 1;
+    if(!srv_ctx->rebalance_running && !srv_ctx->finalizing) {
+        if(srv_ctx->rebalance_thread != ABT_THREAD_NULL)
+            ABT_thread_free(&srv_ctx->rebalance_thread);
+        srv_ctx->rebalance_running = 1;
+        ABT_thread_create(srv_ctx->bulk_pool != ABT_POOL_NULL ? srv_ctx->bulk_pool : srv_ctx->pool,
+                mobject_server_rebalance_ult,
+                (void*)srv_ctx, ABT_THREAD_ATTR_NULL, &srv_ctx->rebalance_thread);
+    }
+    ABT_mutex_unlock(srv_ctx->mutex);
+}
+
+static void mobject_server_rebalance_ult(void* data)
+{
+    mobject_provider_t srv_ctx = (mobject_provider_t)data;
+
+    while(1) {
+        ABT_mutex_lock(srv_ctx->mutex);
+        if(!srv_ctx->rebalance_pending || srv_ctx->finalizing) {
+            srv_ctx->rebalance_running = 0;
+            ABT_mutex_unlock(srv_ctx->mutex);
+            break;
+        }
+        srv_ctx->rebalance_pending = 0;
+        ABT_mutex_unlock(srv_ctx->mutex);
+
+        if(mobject_server_refresh_placement(srv_ctx) != 0) {
+            fprintf(stderr, "Error: unable to update object placement\n");
+            continue;
+        }
+        if(core_rebalance(srv_ctx) == 0)
+            mobject_server_drop_previous_placement(srv_ctx);
+    }
+}
+
+/* once the other servers seem done sending their objects to this one,
+   non-local objects do not exist and reads are no longer forwarded */
+static void mobject_server_drop_previous_placement(mobject_provider_t srv_ctx)
+{
+    double idle, last;
+
+    while(1) {
+        ABT_mutex_lock(srv_ctx->mutex);
+        if(srv_ctx->rebalance_pending || srv_ctx->finalizing) {
+            ABT_mutex_unlock(srv_ctx->mutex);
+            return;
+        }
+        /* the other servers may not have started sending anything yet */
+        last = srv_ctx->last_migration > srv_ctx->rebalance_start ?
+            srv_ctx->last_migration : srv_ctx->rebalance_start;
+        idle = (ABT_get_wtime() - last)*1000.0;
+        if(idle >= srv_ctx->rebalance_settle) {
+            mobject_placement_free(srv_ctx->prev_placement);
+            free(srv_ctx->prev_members);
+            srv_ctx->prev_placement = NULL;
+            srv_ctx->prev_members   = NULL;
+            core_migration_clear(srv_ctx);
+            ABT_mutex_unlock(srv_ctx->mutex);
+            return;
+        }
+        ABT_mutex_unlock(srv_ctx->mutex);
+        margo_thread_sleep(srv_ctx->mid, srv_ctx->rebalance_settle - idle);
+    }
+}
+
 static void mobject_finalize_cb(void* data)
 {
     mobject_provider_t srv_ctx = (mobject_provider_t)data;
+    ABT_thread rebalance_thread;
+    int i;
+
+    ssg_group_remove_membership_update_callback(srv_ctx->gid,
+            mobject_server_membership_update_cb, (void*)srv_ctx);
+    ABT_mutex_lock(srv_ctx->mutex);
+    srv_ctx->finalizing = 1;
+    rebalance_thread = srv_ctx->rebalance_thread;
+    ABT_mutex_unlock(srv_ctx->mutex);
+    if(rebalance_thread != ABT_THREAD_NULL) {
+        ABT_thread_join(rebalance_thread);
+        ABT_thread_free(&rebalance_thread);
+    }
+
+    core_persist_finalize(srv_ctx);
+    core_commit_finalize(srv_ctx);
+    core_oid_cache_finalize(srv_ctx);
+    core_migration_finalize(srv_ctx);
+    core_qos_finalize(srv_ctx);
+    core_metrics_finalize(srv_ctx);
 
+    mobject_placement_free(srv_ctx->placement);
+    mobject_placement_free(srv_ctx->prev_placement);
+    free(srv_ctx->members);
+    free(srv_ctx->prev_members);
+    core_migration_clear(srv_ctx);
+    free(srv_ctx->self_addr_str);
+    free(srv_ctx->replication_spec);
+    free(srv_ctx->erasure_spec);
     sdskv_provider_handle_release(srv_ctx->sdskv_ph);
     bake_provider_handle_release(srv_ctx->bake_ph);
+    free(srv_ctx->bake_tids);
     ABT_mutex_free(&srv_ctx->mutex);
     ABT_mutex_free(&srv_ctx->stats_mutex);
+    for(i = 0; i < MOBJECT_REPLICA_WRITE_LOCKS; i++)
+        ABT_mutex_free(&srv_ctx->replica_write_locks[i]);
 
     free(srv_ctx);
 }
@@ -15,6 +15,8 @@
 extern "C" {
 #endif
 
+struct segment_batch;
+
 typedef struct {
 	const char*                    object_name;
     oid_t                          oid;
@@ -23,6 +25,13 @@ typedef struct {
     const char*                    client_addr_str;
     hg_addr_t                      client_addr;
 	hg_bulk_t                      bulk_handle;
+    uint64_t                       bulk_offset;  // offset of the operation's data in bulk_handle
+    char*                          local_data;   // local copy of bulk_handle's content, pulled
+                                                 // before writes or pushed after reads
+    struct segment_batch*          seg_batch;    // if not NULL, segment entries are put in it
+                                                 // and written to the KV store together
+    int                            defer_persist; // regions and segments go to the persist log
+    uint64_t                       safe_seq;      // ticket of a deferred write, set by core_write_op
 } server_visitor_args;
 
 typedef server_visitor_args* server_visitor_args_t;
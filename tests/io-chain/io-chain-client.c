@@ -63,8 +63,9 @@ int main(int argc, char** argv)
 		write_op_in_t in;
                 in.object_name = "test-object";
 		in.write_op = write_op;
+		in.flags = LIBMOBJECT_OPERATION_NOFLAG;
 
-		prepare_write_op(mid, write_op);
+		prepare_write_op(mid, NULL, write_op);
 
 		hg_handle_t h;
 		margo_create(mid, svr_addr, write_op_rpc_id, &h);
@@ -117,7 +118,7 @@ int main(int argc, char** argv)
 		in.object_name = "test-object";
 		in.read_op = read_op;
 
-		prepare_read_op(mid, read_op);
+		prepare_read_op(mid, NULL, read_op);
 
 		hg_handle_t h;
 		margo_create(mid, svr_addr, read_op_rpc_id, &h);
@@ -101,6 +101,7 @@ hg_return_t mobject_write_op_rpc(hg_handle_t h)
 
 	// set the return value of the RPC
 	out.ret = 0;
+	out.safe_seq = 0;
 
 	ret = margo_respond(h, &out);
 	assert(ret == HG_SUCCESS);
@@ -0,0 +1,129 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libmobject-store.h>
+
+/* Measures AIO throughput: writes then reads back num_objects objects
+ * of object_size bytes each, keeping up to window requests in flight.
+ * Objects are spread over the servers by the placement, so running it
+ * against 1..N servers shows how throughput scales with the cluster.
+ *
+ * usage: mobject-aio-bench [num_objects] [object_size] [window]
+ */
+
+static double wtime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static void object_name(char* buf, size_t len, int i)
+{
+    snprintf(buf, len, "aio-bench-object-%d", i);
+}
+
+int main(int argc, char** argv)
+{
+    int num_objects    = argc > 1 ? atoi(argv[1]) : 1024;
+    size_t object_size = argc > 2 ? strtoul(argv[2], NULL, 0) : 65536;
+    int window         = argc > 3 ? atoi(argv[3]) : 64;
+    int i, j, ret;
+    double t1, t2;
+    char name[64];
+
+    if(num_objects <= 0 || object_size == 0 || window <= 0) {
+        fprintf(stderr, "usage: %s [num_objects] [object_size] [window]\n", argv[0]);
+        return -1;
+    }
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    ret = mobject_store_connect(cluster);
+    if(ret != 0) {
+        fprintf(stderr, "Error: unable to connect to the mobject cluster\n");
+        return -1;
+    }
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "my-object-pool", &ioctx);
+
+    char* wr_buf = malloc(object_size*window);
+    char* rd_buf = malloc(object_size*window);
+    memset(wr_buf, 'A', object_size*window);
+    size_t* bytes_read = calloc(window, sizeof(*bytes_read));
+    int* prvals = calloc(window, sizeof(*prvals));
+    mobject_store_completion_t* completions = calloc(window, sizeof(*completions));
+    mobject_store_write_op_t* write_ops = calloc(window, sizeof(*write_ops));
+    mobject_store_read_op_t* read_ops = calloc(window, sizeof(*read_ops));
+
+    /* write phase */
+    t1 = wtime();
+    for(i = 0; i < num_objects; i += window) {
+        int n = num_objects - i < window ? num_objects - i : window;
+        for(j = 0; j < n; j++) {
+            object_name(name, sizeof(name), i+j);
+            write_ops[j] = mobject_store_create_write_op();
+            mobject_store_write_op_write_full(write_ops[j], wr_buf + j*object_size, object_size);
+            mobject_store_aio_create_completion(NULL, NULL, NULL, &completions[j]);
+            mobject_store_aio_write_op_operate(write_ops[j], ioctx, completions[j],
+                    name, NULL, LIBMOBJECT_OPERATION_NOFLAG);
+        }
+        for(j = 0; j < n; j++) {
+            mobject_store_aio_wait_for_complete(completions[j]);
+            mobject_store_aio_release(completions[j]);
+            mobject_store_release_write_op(write_ops[j]);
+        }
+    }
+    t2 = wtime();
+    printf("write: %d objects of %zu bytes, window %d: %.3f sec, %.1f ops/s, %.2f MiB/s\n",
+            num_objects, object_size, window, t2-t1,
+            num_objects/(t2-t1), num_objects*(double)object_size/(1024.0*1024.0*(t2-t1)));
+
+    /* read phase */
+    t1 = wtime();
+    for(i = 0; i < num_objects; i += window) {
+        int n = num_objects - i < window ? num_objects - i : window;
+        for(j = 0; j < n; j++) {
+            object_name(name, sizeof(name), i+j);
+            read_ops[j] = mobject_store_create_read_op();
+            mobject_store_read_op_read(read_ops[j], 0, object_size,
+                    rd_buf + j*object_size, &bytes_read[j], &prvals[j]);
+            mobject_store_aio_create_completion(NULL, NULL, NULL, &completions[j]);
+            mobject_store_aio_read_op_operate(read_ops[j], ioctx, completions[j],
+                    name, LIBMOBJECT_OPERATION_NOFLAG);
+        }
+        for(j = 0; j < n; j++) {
+            mobject_store_aio_wait_for_complete(completions[j]);
+            mobject_store_aio_release(completions[j]);
+            mobject_store_release_read_op(read_ops[j]);
+            if(bytes_read[j] != object_size) {
+                fprintf(stderr, "Warning: read %zu bytes from object %d, expected %zu\n",
+                        bytes_read[j], i+j, object_size);
+            }
+        }
+    }
+    t2 = wtime();
+    printf("read: %d objects of %zu bytes, window %d: %.3f sec, %.1f ops/s, %.2f MiB/s\n",
+            num_objects, object_size, window, t2-t1,
+            num_objects/(t2-t1), num_objects*(double)object_size/(1024.0*1024.0*(t2-t1)));
+
+    free(read_ops);
+    free(write_ops);
+    free(completions);
+    free(prvals);
+    free(bytes_read);
+    free(rd_buf);
+    free(wr_buf);
+
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return 0;
+}
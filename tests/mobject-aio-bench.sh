@@ -0,0 +1,36 @@
+#!/bin/bash -x
+#
+# Runs the AIO throughput benchmark against 1 to MAX_SERVERS servers.
+# usage: mobject-aio-bench.sh [max_servers] [num_objects] [object_size] [window]
+
+if [ -z $srcdir ]; then
+    srcdir=.
+fi
+if [ -z "$MKTEMP" ] ; then
+    MKTEMP=mktemp
+fi
+if [ -z "$TIMEOUT" ] ; then
+    TIMEOUT=timeout
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+MAX_SERVERS=${1:-4}
+shift
+
+for nservers in `seq 1 $MAX_SERVERS`; do
+    TEST_DIR=`$MKTEMP -d /tmp/mobject-aio-bench-XXXXXX`
+    MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+    mobject_test_start_servers $nservers 2 300 $MOBJECT_CLUSTER_FILE
+
+    export MOBJECT_CLUSTER_FILE
+    export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+    echo "### $nservers server(s)"
+    run_to 240 tests/mobject-aio-bench "$@"
+
+    wait
+    rm -rf $TEST_DIR
+done
+
+exit 0
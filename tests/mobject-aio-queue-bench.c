@@ -0,0 +1,138 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libmobject-store.h>
+
+/* Measures how many AIOs a single thread can keep in flight: issues
+ * num_ops writes (then reads) of object_size bytes over num_objects
+ * objects, keeping in_flight operations outstanding and reaping the
+ * finished ones from a completion queue to replace them right away.
+ *
+ * usage: mobject-aio-queue-bench [num_ops] [object_size] [in_flight] [num_objects]
+ */
+
+typedef struct slot {
+    mobject_store_write_op_t write_op;
+    mobject_store_read_op_t  read_op;
+    char*                    buf;
+    size_t                   bytes_read;
+    int                      prval;
+} slot_t;
+
+static double wtime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static int issue(mobject_store_ioctx_t ioctx, mobject_store_completion_queue_t q,
+        slot_t* slot, int i, int num_objects, size_t object_size, int is_write)
+{
+    char name[64];
+    mobject_store_completion_t c;
+    snprintf(name, sizeof(name), "aio-queue-bench-object-%d", i % num_objects);
+    mobject_store_aio_create_queued_completion(q, slot, NULL, NULL, &c);
+    if(is_write) {
+        slot->write_op = mobject_store_create_write_op();
+        mobject_store_write_op_write_full(slot->write_op, slot->buf, object_size);
+        return mobject_store_aio_write_op_operate(slot->write_op, ioctx, c,
+                name, NULL, LIBMOBJECT_OPERATION_NOFLAG);
+    } else {
+        slot->read_op = mobject_store_create_read_op();
+        mobject_store_read_op_read(slot->read_op, 0, object_size, slot->buf,
+                &slot->bytes_read, &slot->prval);
+        return mobject_store_aio_read_op_operate(slot->read_op, ioctx, c,
+                name, LIBMOBJECT_OPERATION_NOFLAG);
+    }
+}
+
+static void run(mobject_store_ioctx_t ioctx, slot_t* slots, int num_ops, int num_objects,
+        size_t object_size, int in_flight, int is_write)
+{
+    mobject_store_completion_queue_t q;
+    mobject_store_completion_t* done = calloc(in_flight, sizeof(*done));
+    int issued = 0, completed = 0, errors = 0, max_in_flight = 0, i, n;
+    double t1, t2;
+
+    mobject_store_completion_queue_create(&q);
+    t1 = wtime();
+    for(i = 0; i < in_flight && issued < num_ops; i++, issued++) {
+        if(issue(ioctx, q, &slots[i], issued, num_objects, object_size, is_write) != 0)
+            errors += 1;
+    }
+    while(completed < issued) {
+        if(issued - completed > max_in_flight) max_in_flight = issued - completed;
+        n = mobject_store_completion_queue_reap(q, done, in_flight, 1);
+        for(i = 0; i < n; i++) {
+            slot_t* slot = (slot_t*)mobject_store_aio_get_arg(done[i]);
+            if(mobject_store_aio_get_return_value(done[i]) != 0) errors += 1;
+            mobject_store_aio_release(done[i]);
+            if(is_write) mobject_store_release_write_op(slot->write_op);
+            else mobject_store_release_read_op(slot->read_op);
+            completed += 1;
+            /* reuse the slot for the next operation */
+            if(issued < num_ops) {
+                if(issue(ioctx, q, slot, issued, num_objects, object_size, is_write) != 0)
+                    errors += 1;
+                issued += 1;
+            }
+        }
+    }
+    t2 = wtime();
+    mobject_store_completion_queue_destroy(q);
+    free(done);
+
+    printf("%s: %d ops of %zu bytes, up to %d in flight: %.3f sec, %.1f ops/s, %d errors\n",
+            is_write ? "write" : "read", num_ops, object_size, max_in_flight,
+            t2-t1, num_ops/(t2-t1), errors);
+}
+
+int main(int argc, char** argv)
+{
+    int num_ops        = argc > 1 ? atoi(argv[1]) : 65536;
+    size_t object_size = argc > 2 ? strtoul(argv[2], NULL, 0) : 4096;
+    int in_flight      = argc > 3 ? atoi(argv[3]) : 4096;
+    int num_objects    = argc > 4 ? atoi(argv[4]) : 1024;
+    int i, ret;
+
+    if(num_ops <= 0 || object_size == 0 || in_flight <= 0 || num_objects <= 0) {
+        fprintf(stderr, "usage: %s [num_ops] [object_size] [in_flight] [num_objects]\n", argv[0]);
+        return -1;
+    }
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    ret = mobject_store_connect(cluster);
+    if(ret != 0) {
+        fprintf(stderr, "Error: unable to connect to the mobject cluster\n");
+        return -1;
+    }
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "my-object-pool", &ioctx);
+
+    slot_t* slots = calloc(in_flight, sizeof(*slots));
+    for(i = 0; i < in_flight; i++) {
+        slots[i].buf = malloc(object_size);
+        memset(slots[i].buf, 'A', object_size);
+    }
+
+    run(ioctx, slots, num_ops, num_objects, object_size, in_flight, 1);
+    run(ioctx, slots, num_ops, num_objects, object_size, in_flight, 0);
+
+    for(i = 0; i < in_flight; i++)
+        free(slots[i].buf);
+    free(slots);
+
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#!/bin/bash -x
+#
+# Runs the completion queue benchmark against a single server,
+# with thousands of AIOs in flight from a single client thread.
+# usage: mobject-aio-queue-bench.sh [num_ops] [object_size] [in_flight] [num_objects]
+
+if [ -z $srcdir ]; then
+    srcdir=.
+fi
+if [ -z "$MKTEMP" ] ; then
+    MKTEMP=mktemp
+fi
+if [ -z "$TIMEOUT" ] ; then
+    TIMEOUT=timeout
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+TEST_DIR=`$MKTEMP -d /tmp/mobject-aio-queue-bench-XXXXXX`
+MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+mobject_test_start_servers 1 2 300 $MOBJECT_CLUSTER_FILE
+
+export MOBJECT_CLUSTER_FILE
+export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+run_to 240 tests/mobject-aio-queue-bench "$@"
+
+wait
+rm -rf $TEST_DIR
+
+exit 0
@@ -0,0 +1,101 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <margo.h>
+#include <libmobject-store.h>
+
+#define NUM_OBJECTS 64
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int i;
+
+    char names[NUM_OBJECTS][32];
+    char contents[NUM_OBJECTS][32];
+    const char* oids[NUM_OBJECTS];
+    mobject_store_write_op_t write_ops[NUM_OBJECTS];
+    int rvals[NUM_OBJECTS];
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "batch-pool", &ioctx);
+
+    // the objects of the batch are spread over the servers,
+    // each server receives a single RPC for its objects
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        sprintf(names[i], "batch-object-%d", i);
+        sprintf(contents[i], "content of object %d", i);
+        oids[i] = names[i];
+        rvals[i] = -1;
+        write_ops[i] = mobject_store_create_write_op();
+        mobject_store_write_op_write_full(write_ops[i], contents[i], strlen(contents[i]));
+    }
+
+    ret = mobject_store_write_op_operate_batch(write_ops, ioctx, oids, NUM_OBJECTS,
+            rvals, LIBMOBJECT_OPERATION_NOFLAG);
+    for(i = 0; i < NUM_OBJECTS; i++)
+        mobject_store_release_write_op(write_ops[i]);
+    if(ret != 0) {
+        fprintf(stderr, "Error: batched write failed (ret = %d)\n", ret);
+        goto finish;
+    }
+
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        if(rvals[i] != 0) {
+            fprintf(stderr, "Error: write of object %d returned %d\n", i, rvals[i]);
+            ret = -1;
+            goto finish;
+        }
+    }
+
+    { // READ and STAT of all the objects in a single batch
+
+        mobject_store_read_op_t read_ops[NUM_OBJECTS];
+        char read_bufs[NUM_OBJECTS][64];
+        size_t bytes_read[NUM_OBJECTS];
+        int read_prvals[NUM_OBJECTS];
+        uint64_t sizes[NUM_OBJECTS];
+        time_t mtimes[NUM_OBJECTS];
+        int stat_prvals[NUM_OBJECTS];
+
+        memset(read_bufs, 0, sizeof(read_bufs));
+        for(i = 0; i < NUM_OBJECTS; i++) {
+            rvals[i] = -1;
+            read_ops[i] = mobject_store_create_read_op();
+            mobject_store_read_op_stat(read_ops[i], &sizes[i], &mtimes[i], &stat_prvals[i]);
+            mobject_store_read_op_read(read_ops[i], 0, 64, read_bufs[i], &bytes_read[i], &read_prvals[i]);
+        }
+
+        ret = mobject_store_read_op_operate_batch(read_ops, ioctx, oids, NUM_OBJECTS,
+                rvals, LIBMOBJECT_OPERATION_NOFLAG);
+        for(i = 0; i < NUM_OBJECTS; i++)
+            mobject_store_release_read_op(read_ops[i]);
+        if(ret != 0) {
+            fprintf(stderr, "Error: batched read failed (ret = %d)\n", ret);
+            goto finish;
+        }
+
+        for(i = 0; i < NUM_OBJECTS; i++) {
+            size_t len = strlen(contents[i]);
+            if(rvals[i] != 0 || read_prvals[i] != 0 || stat_prvals[i] != 0
+            || sizes[i] != len || bytes_read[i] != len
+            || memcmp(read_bufs[i], contents[i], len) != 0) {
+                fprintf(stderr, "Error: read of object %d returned rval = %d, prval = %d, "
+                        "size = %lu, bytes_read = %ld\n",
+                        i, rvals[i], read_prvals[i], sizes[i], bytes_read[i]);
+                ret = -1;
+                goto finish;
+            }
+        }
+    }
+
+finish:
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+if [ -z "$MKTEMP" ] ; then
+    echo expected MKTEMP variable defined to its respective command
+    exit 1
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+TEST_DIR=`$MKTEMP -d /tmp/mobject-batch-test-XXXXXX`
+MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+##############
+
+# start 3 servers with 2 second wait, 30s timeout
+mobject_test_start_servers 3 2 30 $MOBJECT_CLUSTER_FILE
+
+##############
+
+# export some mobject client env variables
+export MOBJECT_CLUSTER_FILE
+export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+# run a batched write test client
+run_to 20 tests/mobject-batch-test
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+##############
+
+wait
+
+# cleanup
+rm -rf $TEST_DIR
+
+exit 0
@@ -0,0 +1,79 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <margo.h>
+#include <libmobject-store.h>
+
+#define NUM_OBJECTS 8
+#define BUF_SIZE    (256*1024)
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int i;
+
+    char name[32];
+    size_t bytes_read = 0;
+    int prval = -1;
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "buffer-pool", &ioctx);
+
+    // the buffers come from registered memory
+    char* write_buf = mobject_store_alloc_buffer(cluster, BUF_SIZE);
+    char* read_buf  = mobject_store_alloc_buffer(cluster, BUF_SIZE);
+    if(!write_buf || !read_buf) {
+        fprintf(stderr, "Error: could not allocate buffers\n");
+        ret = -1;
+        goto finish;
+    }
+
+    for(i = 0; i < NUM_OBJECTS; i++)
+    {
+        sprintf(name, "buffer-object-%d", i);
+        memset(write_buf, 'A'+i, BUF_SIZE);
+
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_write(write_op, write_buf, BUF_SIZE, 0);
+        ret = mobject_store_write_op_operate(write_op, ioctx, name, NULL, LIBMOBJECT_OPERATION_NOFLAG);
+        mobject_store_release_write_op(write_op);
+        if(ret != 0) {
+            fprintf(stderr, "Error: write of %s failed (ret = %d)\n", name, ret);
+            goto finish;
+        }
+    }
+
+    for(i = 0; i < NUM_OBJECTS; i++)
+    {
+        sprintf(name, "buffer-object-%d", i);
+        memset(read_buf, 0, BUF_SIZE);
+        bytes_read = 0;
+        prval = -1;
+
+        mobject_store_read_op_t read_op = mobject_store_create_read_op();
+        mobject_store_read_op_read(read_op, 0, BUF_SIZE, read_buf, &bytes_read, &prval);
+        ret = mobject_store_read_op_operate(read_op, ioctx, name, LIBMOBJECT_OPERATION_NOFLAG);
+        mobject_store_release_read_op(read_op);
+
+        // the region outlives the operations, the data must still be there
+        if(ret != 0 || prval != 0 || bytes_read != BUF_SIZE
+        || read_buf[0] != 'A'+i || read_buf[BUF_SIZE-1] != 'A'+i) {
+            fprintf(stderr, "Error: read of %s returned ret = %d, prval = %d, bytes_read = %ld\n",
+                    name, ret, prval, bytes_read);
+            ret = -1;
+            goto finish;
+        }
+    }
+
+finish:
+    mobject_store_free_buffer(cluster, write_buf);
+    mobject_store_free_buffer(cluster, read_buf);
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return ret == 0 ? 0 : 1;
+}
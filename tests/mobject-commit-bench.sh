@@ -0,0 +1,47 @@
+#!/bin/bash -x
+#
+# Measures small-write IOPS against a single server with persistent KV
+# backends, with and without group commit of the segment entries
+# (MOBJECT_COMMIT_MAX=1 commits each entry on its own), for 1 to 256
+# writes in flight at once.
+# usage: mobject-commit-bench.sh [num_ops] [object_size]
+
+if [ -z $srcdir ]; then
+    srcdir=.
+fi
+if [ -z "$MKTEMP" ] ; then
+    MKTEMP=mktemp
+fi
+if [ -z "$TIMEOUT" ] ; then
+    TIMEOUT=timeout
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+NUM_OPS=${1:-16384}
+OBJECT_SIZE=${2:-64}
+
+TEST_DIR=`$MKTEMP -d /tmp/mobject-commit-bench-XXXXXX`
+MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+export MOBJECT_CLUSTER_FILE
+export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+for backend in leveldb berkeleydb; do
+    for commit_max in 1 256; do
+        for in_flight in 1 4 16 64 256; do
+            echo "### backend=$backend commit_max=$commit_max in_flight=$in_flight"
+            KV_DIR=$TEST_DIR/kv-$backend-$commit_max-$in_flight
+            mkdir -p $KV_DIR
+            export MOBJECT_COMMIT_MAX=$commit_max
+            mobject_test_start_servers 1 2 300 $MOBJECT_CLUSTER_FILE /dev/shm/mobject.dat \
+                --kv-backend $backend --kv-path $KV_DIR
+            run_to 240 tests/mobject-aio-queue-bench $NUM_OPS $OBJECT_SIZE $in_flight $in_flight
+            wait
+            rm -rf $KV_DIR
+        done
+    done
+done
+
+rm -rf $TEST_DIR
+
+exit 0
@@ -0,0 +1,105 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <margo.h>
+#include <libmobject-store.h>
+
+#define NUM_OBJECTS 64
+#define BUF_SIZE    128
+
+static volatile int num_complete = 0;
+static volatile int num_safe     = 0;
+
+static void on_complete(mobject_store_completion_t c, void* arg)
+{
+    if(mobject_store_aio_get_return_value(c) == 0)
+        __sync_fetch_and_add(&num_complete, 1);
+}
+
+static void on_safe(mobject_store_completion_t c, void* arg)
+{
+    __sync_fetch_and_add(&num_safe, 1);
+}
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int i, n;
+
+    char name[32];
+    char write_buf[NUM_OBJECTS][BUF_SIZE];
+    char read_buf[NUM_OBJECTS][BUF_SIZE];
+    size_t bytes_read[NUM_OBJECTS];
+    int prval[NUM_OBJECTS];
+    mobject_store_write_op_t write_ops[NUM_OBJECTS];
+    mobject_store_read_op_t read_ops[NUM_OBJECTS];
+    mobject_store_completion_t completions[NUM_OBJECTS];
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "completion-pool", &ioctx);
+
+    // the callbacks fire without anyone waiting on the completions
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        sprintf(name, "completion-object-%d", i);
+        memset(write_buf[i], 'A'+(i%26), BUF_SIZE);
+        write_ops[i] = mobject_store_create_write_op();
+        mobject_store_write_op_write_full(write_ops[i], write_buf[i], BUF_SIZE);
+        mobject_store_aio_create_completion(NULL, on_complete, on_safe, &completions[i]);
+        mobject_store_aio_write_op_operate(write_ops[i], ioctx, completions[i],
+                name, NULL, LIBMOBJECT_OPERATION_NOFLAG);
+    }
+    for(i = 0; i < 20000 && num_complete < NUM_OBJECTS; i++)
+        usleep(1000);
+    if(num_complete != NUM_OBJECTS || num_safe != NUM_OBJECTS) {
+        fprintf(stderr, "Error: %d complete and %d safe callbacks called, expected %d\n",
+                num_complete, num_safe, NUM_OBJECTS);
+        ret = -1;
+    }
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        mobject_store_aio_wait_for_complete(completions[i]);
+        mobject_store_aio_release(completions[i]);
+        mobject_store_release_write_op(write_ops[i]);
+    }
+    if(ret != 0) goto finish;
+
+    // read everything back, reaping the completions from a queue
+    mobject_store_completion_queue_t queue;
+    mobject_store_completion_queue_create(&queue);
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        sprintf(name, "completion-object-%d", i);
+        read_ops[i] = mobject_store_create_read_op();
+        mobject_store_read_op_read(read_ops[i], 0, BUF_SIZE, read_buf[i], &bytes_read[i], &prval[i]);
+        mobject_store_aio_create_queued_completion(queue, NULL, NULL, NULL, &completions[i]);
+        mobject_store_aio_read_op_operate(read_ops[i], ioctx, completions[i],
+                name, LIBMOBJECT_OPERATION_NOFLAG);
+    }
+    for(n = 0; n < NUM_OBJECTS; ) {
+        mobject_store_completion_t done[NUM_OBJECTS];
+        int k, r = mobject_store_completion_queue_reap(queue, done, NUM_OBJECTS, 1);
+        for(k = 0; k < r; k++) {
+            if(mobject_store_aio_get_return_value(done[k]) != 0) ret = -1;
+            mobject_store_aio_release(done[k]);
+        }
+        n += r;
+    }
+    mobject_store_completion_queue_destroy(queue);
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        if(bytes_read[i] != BUF_SIZE || prval[i] != 0
+        || memcmp(read_buf[i], write_buf[i], BUF_SIZE) != 0) {
+            fprintf(stderr, "Error: unexpected content for object %d\n", i);
+            ret = -1;
+        }
+        mobject_store_release_read_op(read_ops[i]);
+    }
+
+finish:
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <margo.h>
+#include <libmobject-store.h>
+
+#define OBJECT_SIZE (100*1024+17)
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    size_t i;
+    char* content  = (char*)malloc(OBJECT_SIZE + 8);
+    char* read_buf = (char*)calloc(1, OBJECT_SIZE + 64);
+
+    for(i = 0; i < OBJECT_SIZE; i++) content[i] = 'A' + (i % 26);
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "ec-pool", &ioctx);
+
+    { // WRITE OP, encoded into data and parity chunks
+
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_write_full(write_op, content, OBJECT_SIZE);
+        ret = mobject_store_write_op_operate(write_op, ioctx, "ec-object", NULL, LIBMOBJECT_OPERATION_NOFLAG);
+        mobject_store_release_write_op(write_op);
+        if(ret != 0) {
+            fprintf(stderr, "Error: erasure-coded write failed (ret = %d)\n", ret);
+            goto finish;
+        }
+    }
+
+    { // PARTIAL UPDATE, requiring the object to be read and re-encoded
+
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_write(write_op, "0123456789", 10, 5000);
+        mobject_store_write_op_append(write_op, "ZZZZZZZZ", 8);
+        ret = mobject_store_write_op_operate(write_op, ioctx, "ec-object", NULL, LIBMOBJECT_OPERATION_NOFLAG);
+        mobject_store_release_write_op(write_op);
+        if(ret != 0) {
+            fprintf(stderr, "Error: erasure-coded partial write failed (ret = %d)\n", ret);
+            goto finish;
+        }
+        memcpy(content + 5000, "0123456789", 10);
+        memcpy(content + OBJECT_SIZE, "ZZZZZZZZ", 8);
+    }
+
+    { // READ OP, across stripes
+
+        mobject_store_read_op_t read_op = mobject_store_create_read_op();
+        uint64_t psize = 0;
+        time_t pmtime;
+        int prval1 = -1, prval2 = -1;
+        size_t bytes_read = 0;
+        mobject_store_read_op_stat(read_op, &psize, &pmtime, &prval1);
+        mobject_store_read_op_read(read_op, 3, OBJECT_SIZE + 64, read_buf, &bytes_read, &prval2);
+        ret = mobject_store_read_op_operate(read_op, ioctx, "ec-object", LIBMOBJECT_OPERATION_NOFLAG);
+        mobject_store_release_read_op(read_op);
+
+        if(ret != 0 || prval1 != 0 || prval2 != 0 || psize != OBJECT_SIZE + 8
+        || bytes_read != OBJECT_SIZE + 5 || memcmp(read_buf, content + 3, bytes_read) != 0) {
+            fprintf(stderr, "Error: read returned ret = %d, prval = %d/%d, size = %lu, bytes_read = %ld\n",
+                    ret, prval1, prval2, psize, bytes_read);
+            ret = -1;
+            goto finish;
+        }
+    }
+
+finish:
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+    free(content);
+    free(read_buf);
+
+    return ret == 0 ? 0 : 1;
+}
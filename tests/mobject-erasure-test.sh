@@ -0,0 +1,45 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+if [ -z "$MKTEMP" ] ; then
+    echo expected MKTEMP variable defined to its respective command
+    exit 1
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+TEST_DIR=`$MKTEMP -d /tmp/mobject-erasure-test-XXXXXX`
+MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+##############
+
+# objects of ec-pool are cut in 2 data chunks and 1 parity chunk;
+# servers and clients must agree on the erasure-coding profiles
+export MOBJECT_POOL_ERASURE="ec-pool:2+1"
+
+# start 3 servers with 2 second wait, 30s timeout
+mobject_test_start_servers 3 2 30 $MOBJECT_CLUSTER_FILE
+
+##############
+
+# export some mobject client env variables
+export MOBJECT_CLUSTER_FILE
+export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+# run an erasure-coding test client
+run_to 20 tests/mobject-erasure-test
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+##############
+
+wait
+
+# cleanup
+rm -rf $TEST_DIR
+
+exit 0
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <string.h>
+#include <libmobject-store.h>
+
+const char* content = "AAAABBBBCCCCDDDDEEEEFFFF";
+
+/* reads are hedged after the 1st percentile of their latencies, so
+   that most of them are sent to two replicas once enough completed */
+#define HEDGE_PERCENTILE 1.0
+#define NUM_READS        200
+#define NUM_AIOS         64
+
+static int check_read(int i, int ret, int prval, size_t bytes_read, const char* buf)
+{
+    if(ret != 0 || prval != 0 || bytes_read != 24 || memcmp(buf, content, 24) != 0) {
+        fprintf(stderr, "Error: read %d returned ret = %d, prval = %d, bytes_read = %ld\n",
+                i, ret, prval, bytes_read);
+        return -1;
+    }
+    return 0;
+}
+
+static int sync_read(mobject_store_ioctx_t ioctx, int i)
+{
+    char read_buf[64];
+    size_t bytes_read = 0;
+    int prval = -1;
+
+    mobject_store_read_op_t read_op = mobject_store_create_read_op();
+    mobject_store_read_op_read(read_op, 0, 64, read_buf, &bytes_read, &prval);
+    int ret = mobject_store_read_op_operate(read_op, ioctx, "hedged-object", LIBMOBJECT_OPERATION_NOFLAG);
+    mobject_store_release_read_op(read_op);
+    return check_read(i, ret, prval, bytes_read, read_buf);
+}
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int i;
+
+    char read_buf[NUM_AIOS][64];
+    size_t bytes_read[NUM_AIOS];
+    int prval[NUM_AIOS];
+    mobject_store_read_op_t read_ops[NUM_AIOS];
+    mobject_store_completion_t completions[NUM_AIOS];
+    mobject_client_stats_t stats, before;
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "replicated-pool", &ioctx);
+
+    { // WRITE OP, replicated by the primary server
+
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_write_full(write_op, content, 24);
+        ret = mobject_store_write_op_operate(write_op, ioctx, "hedged-object", NULL, LIBMOBJECT_OPERATION_NOFLAG);
+        mobject_store_release_write_op(write_op);
+        if(ret != 0) {
+            fprintf(stderr, "Error: replicated write failed (ret = %d)\n", ret);
+            goto finish;
+        }
+    }
+
+    // whichever replica answers, hedged reads must return the full content
+    mobject_store_set_hedging(cluster, HEDGE_PERCENTILE, 0);
+    for(i = 0; i < NUM_READS; i++) {
+        ret = sync_read(ioctx, i);
+        if(ret != 0) goto finish;
+    }
+
+    for(i = 0; i < NUM_AIOS; i++) {
+        read_ops[i] = mobject_store_create_read_op();
+        prval[i] = -1;
+        mobject_store_read_op_read(read_ops[i], 0, 64, read_buf[i], &bytes_read[i], &prval[i]);
+        mobject_store_aio_create_completion(NULL, NULL, NULL, &completions[i]);
+        ret = mobject_store_aio_read_op_operate(read_ops[i], ioctx, completions[i],
+                "hedged-object", LIBMOBJECT_OPERATION_NOFLAG);
+        if(ret != 0) {
+            fprintf(stderr, "Error: could not issue AIO read %d\n", i);
+            goto finish;
+        }
+    }
+    for(i = 0; i < NUM_AIOS; i++) {
+        mobject_store_aio_wait_for_complete(completions[i]);
+        int r = mobject_store_aio_get_return_value(completions[i]);
+        mobject_store_aio_release(completions[i]);
+        mobject_store_release_read_op(read_ops[i]);
+        if(ret == 0) ret = check_read(NUM_READS + i, r, prval[i], bytes_read[i], read_buf[i]);
+    }
+    if(ret != 0) goto finish;
+
+    mobject_store_get_client_stats(cluster, &stats);
+    fprintf(stderr, "hedges = %lu, hedge_wins = %lu, cancelled = %lu\n",
+            (unsigned long)stats.hedges, (unsigned long)stats.hedge_wins,
+            (unsigned long)stats.cancelled);
+    if(stats.hedges == 0 || stats.hedge_wins > stats.hedges || stats.cancelled > stats.hedges) {
+        fprintf(stderr, "Error: unexpected hedging counters\n");
+        ret = -1;
+        goto finish;
+    }
+    mobject_store_set_hedging(cluster, 0, 0);
+
+    // a read that times out is sent again max_retries times before failing
+    mobject_store_get_client_stats(cluster, &before);
+    mobject_store_set_timeout(cluster, 0.0001, 2, 0, 0);
+    if(sync_read(ioctx, -1) != 0) {
+        mobject_store_get_client_stats(cluster, &stats);
+        if(stats.timeouts - before.timeouts != 3 || stats.retries - before.retries != 2) {
+            fprintf(stderr, "Error: failed read counted %lu timeouts and %lu retries\n",
+                    (unsigned long)(stats.timeouts - before.timeouts),
+                    (unsigned long)(stats.retries - before.retries));
+            ret = -1;
+            goto finish;
+        }
+    }
+    mobject_store_set_timeout(cluster, 0, 0, 0, 0);
+    ret = sync_read(ioctx, -2);
+
+finish:
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return ret == 0 ? 0 : 1;
+}
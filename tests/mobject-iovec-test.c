@@ -0,0 +1,85 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <margo.h>
+#include <libmobject-store.h>
+
+#define NUM_SEGMENTS 4
+#define SEG_SIZE     1000
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int i;
+
+    char segments[NUM_SEGMENTS][SEG_SIZE];
+    char contiguous[NUM_SEGMENTS*SEG_SIZE];
+    struct iovec iov[NUM_SEGMENTS];
+    size_t bytes_read = 0;
+    int prval = -1;
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "iovec-pool", &ioctx);
+
+    // gather the segments into a single range of the object
+    for(i = 0; i < NUM_SEGMENTS; i++) {
+        memset(segments[i], 'A'+i, SEG_SIZE);
+        iov[i].iov_base = segments[i];
+        iov[i].iov_len  = SEG_SIZE;
+    }
+    mobject_store_write_op_t write_op = mobject_store_create_write_op();
+    mobject_store_write_op_writev(write_op, iov, NUM_SEGMENTS, 0);
+    ret = mobject_store_write_op_operate(write_op, ioctx, "iovec-object", NULL, LIBMOBJECT_OPERATION_NOFLAG);
+    mobject_store_release_write_op(write_op);
+    if(ret != 0) {
+        fprintf(stderr, "Error: writev failed (ret = %d)\n", ret);
+        goto finish;
+    }
+
+    // the object reads back as the concatenation of the segments
+    mobject_store_read_op_t read_op = mobject_store_create_read_op();
+    mobject_store_read_op_read(read_op, 0, sizeof(contiguous), contiguous, &bytes_read, &prval);
+    ret = mobject_store_read_op_operate(read_op, ioctx, "iovec-object", LIBMOBJECT_OPERATION_NOFLAG);
+    mobject_store_release_read_op(read_op);
+    for(i = 0; ret == 0 && i < NUM_SEGMENTS*SEG_SIZE; i++) {
+        if(contiguous[i] != 'A' + i/SEG_SIZE) ret = -1;
+    }
+    if(ret != 0 || prval != 0 || bytes_read != sizeof(contiguous)) {
+        fprintf(stderr, "Error: read returned ret = %d, prval = %d, bytes_read = %ld\n",
+                ret, prval, bytes_read);
+        ret = -1;
+        goto finish;
+    }
+
+    // scatter a range straddling two segments of the object, in reverse order
+    for(i = 0; i < NUM_SEGMENTS; i++) {
+        iov[i].iov_base = segments[NUM_SEGMENTS-1-i];
+        iov[i].iov_len  = SEG_SIZE/2;
+    }
+    prval = -1;
+    read_op = mobject_store_create_read_op();
+    mobject_store_read_op_readv(read_op, SEG_SIZE/2, iov, NUM_SEGMENTS, &bytes_read, &prval);
+    ret = mobject_store_read_op_operate(read_op, ioctx, "iovec-object", LIBMOBJECT_OPERATION_NOFLAG);
+    mobject_store_release_read_op(read_op);
+    for(i = 0; ret == 0 && i < NUM_SEGMENTS; i++) {
+        char expected = 'A' + (SEG_SIZE/2 + i*SEG_SIZE/2)/SEG_SIZE;
+        if(segments[NUM_SEGMENTS-1-i][0] != expected
+        || segments[NUM_SEGMENTS-1-i][SEG_SIZE/2-1] != expected) ret = -1;
+    }
+    if(ret != 0 || prval != 0 || bytes_read != NUM_SEGMENTS*SEG_SIZE/2) {
+        fprintf(stderr, "Error: readv returned ret = %d, prval = %d, bytes_read = %ld\n",
+                ret, prval, bytes_read);
+        ret = -1;
+        goto finish;
+    }
+
+finish:
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return ret == 0 ? 0 : 1;
+}
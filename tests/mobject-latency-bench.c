@@ -0,0 +1,162 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libmobject-store.h>
+
+/* Measures the mean latency of each kind of operation, issued one at a
+ * time: small writes (stored inline in the segment), large writes (one
+ * bake region each), appends, reads, stats and removals, each on
+ * num_objects objects. Comparing runs with MOBJECT_OID_CACHE_SIZE=0 and
+ * with the default cache on the servers shows the cost of the name
+ * lookups the cache saves.
+ *
+ * usage: mobject-latency-bench [num_objects] [large_size]
+ */
+
+static double wtime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static void object_name(char* buf, size_t len, int i)
+{
+    snprintf(buf, len, "latency-bench-object-%d", i);
+}
+
+static void report(const char* op, int count, double t)
+{
+    printf("%-12s %d ops: %.3f sec, mean latency %.1f usec\n",
+            op, count, t, t*1e6/count);
+}
+
+int main(int argc, char** argv)
+{
+    int num_objects   = argc > 1 ? atoi(argv[1]) : 1024;
+    size_t large_size = argc > 2 ? strtoul(argv[2], NULL, 0) : 65536;
+    size_t small_size = 8;
+    int i, ret, errors = 0;
+    double t1, t2;
+    char name[64];
+
+    if(num_objects <= 0 || large_size <= small_size) {
+        fprintf(stderr, "usage: %s [num_objects] [large_size]\n", argv[0]);
+        return -1;
+    }
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    ret = mobject_store_connect(cluster);
+    if(ret != 0) {
+        fprintf(stderr, "Error: unable to connect to the mobject cluster\n");
+        return -1;
+    }
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "my-object-pool", &ioctx);
+
+    char* wr_buf = malloc(large_size);
+    char* rd_buf = malloc(large_size + small_size);
+    memset(wr_buf, 'A', large_size);
+
+    /* small writes, creating the objects */
+    t1 = wtime();
+    for(i = 0; i < num_objects; i++) {
+        object_name(name, sizeof(name), i);
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_write(write_op, wr_buf, small_size, 0);
+        if(mobject_store_write_op_operate(write_op, ioctx, name, NULL,
+                    LIBMOBJECT_OPERATION_NOFLAG) != 0) errors += 1;
+        mobject_store_release_write_op(write_op);
+    }
+    t2 = wtime();
+    report("small write", num_objects, t2-t1);
+
+    /* large writes, overwriting the objects */
+    t1 = wtime();
+    for(i = 0; i < num_objects; i++) {
+        object_name(name, sizeof(name), i);
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_write_full(write_op, wr_buf, large_size);
+        if(mobject_store_write_op_operate(write_op, ioctx, name, NULL,
+                    LIBMOBJECT_OPERATION_NOFLAG) != 0) errors += 1;
+        mobject_store_release_write_op(write_op);
+    }
+    t2 = wtime();
+    report("large write", num_objects, t2-t1);
+
+    t1 = wtime();
+    for(i = 0; i < num_objects; i++) {
+        object_name(name, sizeof(name), i);
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_append(write_op, wr_buf, small_size);
+        if(mobject_store_write_op_operate(write_op, ioctx, name, NULL,
+                    LIBMOBJECT_OPERATION_NOFLAG) != 0) errors += 1;
+        mobject_store_release_write_op(write_op);
+    }
+    t2 = wtime();
+    report("append", num_objects, t2-t1);
+
+    t1 = wtime();
+    for(i = 0; i < num_objects; i++) {
+        size_t bytes_read = 0;
+        int prval = 0;
+        object_name(name, sizeof(name), i);
+        mobject_store_read_op_t read_op = mobject_store_create_read_op();
+        mobject_store_read_op_read(read_op, 0, large_size + small_size,
+                rd_buf, &bytes_read, &prval);
+        if(mobject_store_read_op_operate(read_op, ioctx, name,
+                    LIBMOBJECT_OPERATION_NOFLAG) != 0) errors += 1;
+        mobject_store_release_read_op(read_op);
+        if(bytes_read != large_size + small_size) errors += 1;
+    }
+    t2 = wtime();
+    report("read", num_objects, t2-t1);
+
+    t1 = wtime();
+    for(i = 0; i < num_objects; i++) {
+        uint64_t psize = 0;
+        time_t pmtime;
+        int prval = 0;
+        object_name(name, sizeof(name), i);
+        mobject_store_read_op_t read_op = mobject_store_create_read_op();
+        mobject_store_read_op_stat(read_op, &psize, &pmtime, &prval);
+        if(mobject_store_read_op_operate(read_op, ioctx, name,
+                    LIBMOBJECT_OPERATION_NOFLAG) != 0) errors += 1;
+        mobject_store_release_read_op(read_op);
+        if(psize != large_size + small_size) errors += 1;
+    }
+    t2 = wtime();
+    report("stat", num_objects, t2-t1);
+
+    t1 = wtime();
+    for(i = 0; i < num_objects; i++) {
+        object_name(name, sizeof(name), i);
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_remove(write_op);
+        if(mobject_store_write_op_operate(write_op, ioctx, name, NULL,
+                    LIBMOBJECT_OPERATION_NOFLAG) != 0) errors += 1;
+        mobject_store_release_write_op(write_op);
+    }
+    t2 = wtime();
+    report("remove", num_objects, t2-t1);
+
+    if(errors) {
+        fprintf(stderr, "Warning: %d operations failed or returned unexpected sizes\n", errors);
+    }
+
+    free(rd_buf);
+    free(wr_buf);
+
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+#!/bin/bash -x
+#
+# Runs the per-operation latency benchmark against a single server,
+# with and without the server's name-to-oid cache.
+# usage: mobject-latency-bench.sh [num_objects] [large_size]
+
+if [ -z $srcdir ]; then
+    srcdir=.
+fi
+if [ -z "$MKTEMP" ] ; then
+    MKTEMP=mktemp
+fi
+if [ -z "$TIMEOUT" ] ; then
+    TIMEOUT=timeout
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+for cache_size in 0 65536; do
+    TEST_DIR=`$MKTEMP -d /tmp/mobject-latency-bench-XXXXXX`
+    MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+    export MOBJECT_OID_CACHE_SIZE=$cache_size
+    mobject_test_start_servers 1 2 300 $MOBJECT_CLUSTER_FILE
+
+    export MOBJECT_CLUSTER_FILE
+    export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+    echo "### oid cache size $cache_size"
+    run_to 240 tests/mobject-latency-bench "$@"
+
+    wait
+    rm -rf $TEST_DIR
+done
+
+exit 0
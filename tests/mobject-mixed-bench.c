@@ -0,0 +1,193 @@
+/*
+ * (C) 2018 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libmobject-store.h>
+
+/* Measures the latency of small operations (stats and small reads,
+ * issued one at a time) first on an idle server, then while bulk_in_flight
+ * writes of bulk_size bytes are kept outstanding on other objects, and
+ * reports the median and tail latencies of both phases. Comparing servers
+ * started with and without --bulk-xstreams shows how much small
+ * operations are delayed by bulk transfers.
+ *
+ * usage: mobject-mixed-bench [num_small] [bulk_size] [bulk_in_flight]
+ */
+
+#define NUM_SMALL_OBJECTS 64
+#define SMALL_SIZE        64
+
+typedef struct bulk_slot {
+    mobject_store_write_op_t write_op;
+    char                     name[64];
+} bulk_slot_t;
+
+static double wtime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(const char* phase, double* lat, int count)
+{
+    qsort(lat, count, sizeof(double), cmp_double);
+    printf("%-10s %d small ops: p50 %.1f usec, p99 %.1f usec, max %.1f usec\n",
+            phase, count, lat[count/2]*1e6, lat[(count*99)/100]*1e6, lat[count-1]*1e6);
+}
+
+static int issue_bulk(mobject_store_ioctx_t ioctx, mobject_store_completion_queue_t q,
+        bulk_slot_t* slot, const char* buf, size_t bulk_size)
+{
+    mobject_store_completion_t c;
+    mobject_store_aio_create_queued_completion(q, slot, NULL, NULL, &c);
+    slot->write_op = mobject_store_create_write_op();
+    mobject_store_write_op_write_full(slot->write_op, buf, bulk_size);
+    return mobject_store_aio_write_op_operate(slot->write_op, ioctx, c,
+            slot->name, NULL, LIBMOBJECT_OPERATION_NOFLAG);
+}
+
+/* replaces the bulk writes that completed, returns how many did */
+static int refill_bulk(mobject_store_ioctx_t ioctx, mobject_store_completion_queue_t q,
+        mobject_store_completion_t* done, int in_flight, const char* buf,
+        size_t bulk_size, int* errors)
+{
+    int i, n = mobject_store_completion_queue_reap(q, done, in_flight, 0);
+    for(i = 0; i < n; i++) {
+        bulk_slot_t* slot = (bulk_slot_t*)mobject_store_aio_get_arg(done[i]);
+        if(mobject_store_aio_get_return_value(done[i]) != 0) *errors += 1;
+        mobject_store_aio_release(done[i]);
+        mobject_store_release_write_op(slot->write_op);
+        if(issue_bulk(ioctx, q, slot, buf, bulk_size) != 0) *errors += 1;
+    }
+    return n;
+}
+
+/* a stat or a small read of one of the small objects */
+static int small_op(mobject_store_ioctx_t ioctx, int i, char* buf)
+{
+    char name[64];
+    uint64_t psize = 0;
+    time_t pmtime;
+    size_t bytes_read = 0;
+    int prval = 0, ret;
+
+    snprintf(name, sizeof(name), "mixed-bench-small-%d", i % NUM_SMALL_OBJECTS);
+    mobject_store_read_op_t read_op = mobject_store_create_read_op();
+    if(i % 2)
+        mobject_store_read_op_stat(read_op, &psize, &pmtime, &prval);
+    else
+        mobject_store_read_op_read(read_op, 0, SMALL_SIZE, buf, &bytes_read, &prval);
+    ret = mobject_store_read_op_operate(read_op, ioctx, name, LIBMOBJECT_OPERATION_NOFLAG);
+    mobject_store_release_read_op(read_op);
+    return ret != 0 || prval != 0;
+}
+
+int main(int argc, char** argv)
+{
+    int num_small    = argc > 1 ? atoi(argv[1]) : 5000;
+    size_t bulk_size = argc > 2 ? strtoul(argv[2], NULL, 0) : 8*1024*1024;
+    int in_flight    = argc > 3 ? atoi(argv[3]) : 8;
+    int i, ret, errors = 0;
+    long bulk_done = 0;
+    double t1, t2;
+    char name[64];
+    char small_buf[SMALL_SIZE];
+
+    if(num_small <= 0 || bulk_size == 0 || in_flight <= 0) {
+        fprintf(stderr, "usage: %s [num_small] [bulk_size] [bulk_in_flight]\n", argv[0]);
+        return -1;
+    }
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    ret = mobject_store_connect(cluster);
+    if(ret != 0) {
+        fprintf(stderr, "Error: unable to connect to the mobject cluster\n");
+        return -1;
+    }
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "my-object-pool", &ioctx);
+
+    char* bulk_buf = malloc(bulk_size);
+    memset(bulk_buf, 'B', bulk_size);
+    memset(small_buf, 'S', SMALL_SIZE);
+    double* lat = calloc(num_small, sizeof(double));
+
+    for(i = 0; i < NUM_SMALL_OBJECTS; i++) {
+        snprintf(name, sizeof(name), "mixed-bench-small-%d", i);
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_write_full(write_op, small_buf, SMALL_SIZE);
+        if(mobject_store_write_op_operate(write_op, ioctx, name, NULL,
+                    LIBMOBJECT_OPERATION_NOFLAG) != 0) errors += 1;
+        mobject_store_release_write_op(write_op);
+    }
+
+    /* small operations alone */
+    for(i = 0; i < num_small; i++) {
+        t1 = wtime();
+        errors += small_op(ioctx, i, small_buf);
+        lat[i] = wtime() - t1;
+    }
+    report("idle", lat, num_small);
+
+    /* small operations under bulk load */
+    mobject_store_completion_queue_t q;
+    mobject_store_completion_t* done = calloc(in_flight, sizeof(*done));
+    bulk_slot_t* slots = calloc(in_flight, sizeof(*slots));
+    mobject_store_completion_queue_create(&q);
+    for(i = 0; i < in_flight; i++) {
+        snprintf(slots[i].name, sizeof(slots[i].name), "mixed-bench-bulk-%d", i);
+        if(issue_bulk(ioctx, q, &slots[i], bulk_buf, bulk_size) != 0) errors += 1;
+    }
+    t2 = wtime();
+    for(i = 0; i < num_small; i++) {
+        bulk_done += refill_bulk(ioctx, q, done, in_flight, bulk_buf, bulk_size, &errors);
+        t1 = wtime();
+        errors += small_op(ioctx, i, small_buf);
+        lat[i] = wtime() - t1;
+    }
+    t2 = wtime() - t2;
+    report("bulk load", lat, num_small);
+    printf("%-10s %ld writes of %zu bytes during the small ops: %.1f MiB/s\n",
+            "bulk", bulk_done, bulk_size, bulk_done*(double)bulk_size/t2/(1024*1024));
+
+    /* drain the bulk writes still in flight */
+    for(i = 0; i < in_flight; ) {
+        int n = mobject_store_completion_queue_reap(q, done, in_flight, 1);
+        int j;
+        for(j = 0; j < n; j++) {
+            bulk_slot_t* slot = (bulk_slot_t*)mobject_store_aio_get_arg(done[j]);
+            mobject_store_aio_release(done[j]);
+            mobject_store_release_write_op(slot->write_op);
+        }
+        i += n;
+    }
+    mobject_store_completion_queue_destroy(q);
+
+    if(errors) {
+        fprintf(stderr, "Warning: %d operations failed\n", errors);
+    }
+
+    free(slots);
+    free(done);
+    free(lat);
+    free(bulk_buf);
+
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#!/bin/bash -x
+#
+# Runs the mixed-workload benchmark against a single server, first with
+# bulk operations run by the same xstreams as the others, then with
+# dedicated bulk xstreams, and finally with handler xstreams also running
+# bulk operations when they have nothing else to do.
+# usage: mobject-mixed-bench.sh [num_small] [bulk_size] [bulk_in_flight]
+
+if [ -z $srcdir ]; then
+    srcdir=.
+fi
+if [ -z "$MKTEMP" ] ; then
+    MKTEMP=mktemp
+fi
+if [ -z "$TIMEOUT" ] ; then
+    TIMEOUT=timeout
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+for config in "--handler-xstreams 4" \
+              "--handler-xstreams 2 --bulk-xstreams 2" \
+              "--handler-xstreams 2 --bulk-xstreams 2 --bulk-shared"; do
+    TEST_DIR=`$MKTEMP -d /tmp/mobject-mixed-bench-XXXXXX`
+    MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+    mobject_test_start_servers 1 2 300 $MOBJECT_CLUSTER_FILE /dev/shm/mobject.dat \
+        $config --pool-size 4294967296 --pool-file /dev/shm/mobject-mixed-bench.dat
+
+    export MOBJECT_CLUSTER_FILE
+    export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+    echo "### $config"
+    run_to 240 tests/mobject-mixed-bench "$@"
+
+    wait
+    rm -f /dev/shm/mobject-mixed-bench.dat
+    rm -rf $TEST_DIR
+done
+
+exit 0
@@ -0,0 +1,47 @@
+#!/bin/bash -x
+#
+# Runs the AIO queue benchmark against a single server split into
+# 1 to MAX_PROVIDERS providers, each with its own databases, bake
+# target and xstreams, to measure how throughput scales with cores.
+# usage: mobject-providers-bench.sh [max_providers] [num_ops] [object_size] [in_flight]
+
+if [ -z $srcdir ]; then
+    srcdir=.
+fi
+if [ -z "$MKTEMP" ] ; then
+    MKTEMP=mktemp
+fi
+if [ -z "$TIMEOUT" ] ; then
+    TIMEOUT=timeout
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+MAX_PROVIDERS=${1:-8}
+NUM_OPS=${2:-65536}
+OBJECT_SIZE=${3:-4096}
+IN_FLIGHT=${4:-256}
+
+for nproviders in 1 2 4 8 16 32 64; do
+    if [ $nproviders -gt $MAX_PROVIDERS ]; then
+        break
+    fi
+    TEST_DIR=`$MKTEMP -d /tmp/mobject-providers-bench-XXXXXX`
+    MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+    export MOBJECT_PROVIDERS_PER_SERVER=$nproviders
+    mobject_test_start_servers 1 2 300 $MOBJECT_CLUSTER_FILE /dev/shm/mobject.dat \
+        --providers $nproviders --handler-xstreams $nproviders \
+        --pool-file /dev/shm/mobject-providers-bench.dat --kv-path $TEST_DIR
+
+    export MOBJECT_CLUSTER_FILE
+    export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+    echo "### $nproviders provider(s)"
+    run_to 240 tests/mobject-aio-queue-bench $NUM_OPS $OBJECT_SIZE $IN_FLIGHT $IN_FLIGHT
+
+    wait
+    rm -f /dev/shm/mobject-providers-bench.dat*
+    rm -rf $TEST_DIR
+done
+
+exit 0
@@ -0,0 +1,53 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+if [ -z "$MKTEMP" ] ; then
+    echo expected MKTEMP variable defined to its respective command
+    exit 1
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+TEST_DIR=`$MKTEMP -d /tmp/mobject-providers-test-XXXXXX`
+MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+##############
+
+# clients and servers must agree on the number of providers per server
+export MOBJECT_PROVIDERS_PER_SERVER=4
+
+# start 1 server of 4 providers with 2 second wait, 40s timeout
+mobject_test_start_servers 1 2 40 $MOBJECT_CLUSTER_FILE /dev/shm/mobject.dat \
+    --providers 4 --pool-file $TEST_DIR/mobject.dat --kv-path $TEST_DIR
+
+##############
+
+# export some mobject client env variables
+export MOBJECT_CLUSTER_FILE
+export MOBJECT_SHUTDOWN_KILL_SERVERS=false
+
+# objects are spread over the providers of each server
+run_to 10 tests/mobject-client-test
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+# batches are split by (server, provider)
+export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+run_to 20 tests/mobject-batch-test
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+##############
+
+wait
+
+# cleanup
+rm -rf $TEST_DIR
+
+exit 0
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libmobject-store.h>
+
+/* the server is started with MOBJECT_QOS_CLIENT_LIMIT=<OPS_PER_SEC>
+   and MOBJECT_QOS_MAX_ACTIVE=2, see mobject-qos-test.sh */
+#define OPS_PER_SEC 100
+#define NUM_READS   100
+#define NUM_AIOS    64
+#define BUF_SIZE    4096
+
+static double wtime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int i;
+
+    char name[32];
+    char write_buf[BUF_SIZE];
+    char read_buf[NUM_AIOS][BUF_SIZE];
+    size_t bytes_read[NUM_AIOS];
+    int prval[NUM_AIOS];
+    mobject_store_read_op_t read_ops[NUM_AIOS];
+    mobject_store_completion_t completions[NUM_AIOS];
+    double t1, t2, min_time;
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "qos-pool", &ioctx);
+
+    memset(write_buf, 'Q', BUF_SIZE);
+    strcpy(name, "qos-object");
+    mobject_store_write_op_t write_op = mobject_store_create_write_op();
+    mobject_store_write_op_write_full(write_op, write_buf, BUF_SIZE);
+    if(mobject_store_write_op_operate(write_op, ioctx, name, NULL, LIBMOBJECT_OPERATION_NOFLAG) != 0) {
+        fprintf(stderr, "Error: write failed\n");
+        ret = -1;
+    }
+    mobject_store_release_write_op(write_op);
+    if(ret != 0) goto finish;
+
+    // beyond the burst allowed by its bucket, the client gets OPS_PER_SEC
+    t1 = wtime();
+    for(i = 0; i < NUM_READS; i++) {
+        mobject_store_read_op_t read_op = mobject_store_create_read_op();
+        mobject_store_read_op_read(read_op, 0, BUF_SIZE, read_buf[0], &bytes_read[0], &prval[0]);
+        if(mobject_store_read_op_operate(read_op, ioctx, name, LIBMOBJECT_OPERATION_NOFLAG) != 0
+        || prval[0] != 0 || bytes_read[0] != BUF_SIZE) {
+            fprintf(stderr, "Error: read %d failed\n", i);
+            ret = -1;
+        }
+        mobject_store_release_read_op(read_op);
+    }
+    t2 = wtime();
+    min_time = 0.8*(NUM_READS - OPS_PER_SEC/10)/(double)OPS_PER_SEC;
+    if(t2 - t1 < min_time) {
+        fprintf(stderr, "Error: %d reads took %.3f sec, the rate limit allows no less than %.3f\n",
+                NUM_READS, t2 - t1, min_time);
+        ret = -1;
+    }
+    if(ret != 0) goto finish;
+
+    // operations queued beyond the active ones all complete, and correctly
+    for(i = 0; i < NUM_AIOS; i++) {
+        read_ops[i] = mobject_store_create_read_op();
+        mobject_store_read_op_read(read_ops[i], 0, BUF_SIZE, read_buf[i], &bytes_read[i], &prval[i]);
+        mobject_store_aio_create_completion(NULL, NULL, NULL, &completions[i]);
+        mobject_store_aio_read_op_operate(read_ops[i], ioctx, completions[i],
+                name, LIBMOBJECT_OPERATION_NOFLAG);
+    }
+    for(i = 0; i < NUM_AIOS; i++) {
+        mobject_store_aio_wait_for_complete(completions[i]);
+        if(mobject_store_aio_get_return_value(completions[i]) != 0 || prval[i] != 0
+        || bytes_read[i] != BUF_SIZE || memcmp(read_buf[i], write_buf, BUF_SIZE) != 0) {
+            fprintf(stderr, "Error: queued read %d failed\n", i);
+            ret = -1;
+        }
+        mobject_store_aio_release(completions[i]);
+        mobject_store_release_read_op(read_ops[i]);
+    }
+
+finish:
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <margo.h>
+#include <libmobject-store.h>
+
+const char* content = "AAAABBBBCCCCDDDDEEEEFFFF";
+
+#define NUM_READS 12
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int i;
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "replicated-pool", &ioctx);
+
+    { // WRITE OP, replicated by the primary server
+
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_write_full(write_op, content, 24);
+        ret = mobject_store_write_op_operate(write_op, ioctx, "replicated-object", NULL, LIBMOBJECT_OPERATION_NOFLAG);
+        mobject_store_release_write_op(write_op);
+        if(ret != 0) {
+            fprintf(stderr, "Error: replicated write failed (ret = %d)\n", ret);
+            goto finish;
+        }
+    }
+
+    // balanced reads go round-robin over the replicas,
+    // so each of them must return the full content
+    for(i = 0; i < NUM_READS; i++)
+    {
+        mobject_store_read_op_t read_op = mobject_store_create_read_op();
+
+        char read_buf[64];
+        size_t bytes_read = 0;
+        int prval = -1;
+        memset(read_buf, 0, sizeof(read_buf));
+        mobject_store_read_op_read(read_op, 0, 64, read_buf, &bytes_read, &prval);
+
+        int flags = (i % 2) ? LIBMOBJECT_OPERATION_BALANCE_READS : LIBMOBJECT_OPERATION_LOCALIZE_READS;
+        ret = mobject_store_read_op_operate(read_op, ioctx, "replicated-object", flags);
+        mobject_store_release_read_op(read_op);
+
+        if(ret != 0 || prval != 0 || bytes_read != 24 || memcmp(read_buf, content, 24) != 0) {
+            fprintf(stderr, "Error: read %d returned ret = %d, prval = %d, bytes_read = %ld\n",
+                    i, ret, prval, bytes_read);
+            ret = -1;
+            goto finish;
+        }
+    }
+
+finish:
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return ret == 0 ? 0 : 1;
+}
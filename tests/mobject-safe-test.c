@@ -0,0 +1,114 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <margo.h>
+#include <libmobject-store.h>
+
+#define NUM_OBJECTS 32
+#define BUF_SIZE    4096
+
+static volatile int state[NUM_OBJECTS]; // 1 once complete, 2 once safe
+static volatile int out_of_order = 0;
+
+static void on_complete(mobject_store_completion_t c, void* arg)
+{
+    int i = (int)(intptr_t)arg;
+    if(mobject_store_aio_get_return_value(c) == 0)
+        state[i] = 1;
+}
+
+static void on_safe(mobject_store_completion_t c, void* arg)
+{
+    int i = (int)(intptr_t)arg;
+    if(state[i] != 1) out_of_order = 1;
+    state[i] = 2;
+}
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int i;
+
+    char name[32];
+    char write_buf[NUM_OBJECTS][BUF_SIZE];
+    char read_buf[BUF_SIZE];
+    size_t bytes_read;
+    int prval;
+    mobject_store_write_op_t write_ops[NUM_OBJECTS];
+    mobject_store_completion_t completions[NUM_OBJECTS];
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "safe-pool", &ioctx);
+
+    // deferred writes are complete first, then safe
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        sprintf(name, "safe-object-%d", i);
+        memset(write_buf[i], 'A'+(i%26), BUF_SIZE);
+        write_ops[i] = mobject_store_create_write_op();
+        mobject_store_write_op_write_full(write_ops[i], write_buf[i], BUF_SIZE);
+        mobject_store_aio_create_completion((void*)(intptr_t)i, on_complete, on_safe, &completions[i]);
+        mobject_store_aio_write_op_operate(write_ops[i], ioctx, completions[i],
+                name, NULL, LIBMOBJECT_OPERATION_DEFER_PERSIST);
+    }
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        mobject_store_aio_wait_for_safe(completions[i]);
+        if(!mobject_store_aio_is_complete(completions[i])
+        || !mobject_store_aio_is_safe(completions[i]) || state[i] != 2) {
+            fprintf(stderr, "Error: write %d is not complete and safe\n", i);
+            ret = -1;
+        }
+        mobject_store_aio_release(completions[i]);
+        mobject_store_release_write_op(write_ops[i]);
+    }
+    if(out_of_order) {
+        fprintf(stderr, "Error: safe callback called before the complete callback\n");
+        ret = -1;
+    }
+    if(ret != 0) goto finish;
+
+    // a complete write is visible to reads before being safe
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        sprintf(name, "safe-object-%d", i);
+        memset(write_buf[i], 'a'+(i%26), BUF_SIZE);
+        write_ops[i] = mobject_store_create_write_op();
+        mobject_store_write_op_write(write_ops[i], write_buf[i], BUF_SIZE/2, 0);
+        mobject_store_aio_create_completion(NULL, NULL, NULL, &completions[i]);
+        mobject_store_aio_write_op_operate(write_ops[i], ioctx, completions[i],
+                name, NULL, LIBMOBJECT_OPERATION_DEFER_PERSIST);
+        mobject_store_aio_wait_for_complete(completions[i]);
+        if(mobject_store_aio_get_return_value(completions[i]) != 0) {
+            fprintf(stderr, "Error: deferred write %d failed\n", i);
+            ret = -1;
+        }
+
+        mobject_store_read_op_t read_op = mobject_store_create_read_op();
+        mobject_store_read_op_read(read_op, 0, BUF_SIZE, read_buf, &bytes_read, &prval);
+        mobject_store_read_op_operate(read_op, ioctx, name, LIBMOBJECT_OPERATION_NOFLAG);
+        mobject_store_release_read_op(read_op);
+        if(bytes_read != BUF_SIZE || prval != 0
+        || memcmp(read_buf, write_buf[i], BUF_SIZE/2) != 0
+        || read_buf[BUF_SIZE-1] != 'A'+(i%26)) {
+            fprintf(stderr, "Error: unexpected content for object %d\n", i);
+            ret = -1;
+        }
+    }
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        if(mobject_store_aio_wait_for_safe(completions[i]) != 0
+        || !mobject_store_aio_is_safe(completions[i])) {
+            fprintf(stderr, "Error: write %d did not become safe\n", i);
+            ret = -1;
+        }
+        mobject_store_aio_release(completions[i]);
+        mobject_store_release_write_op(write_ops[i]);
+    }
+
+finish:
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return ret == 0 ? 0 : 1;
+}
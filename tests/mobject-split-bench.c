@@ -0,0 +1,106 @@
+/*
+ * (C) 2018 The University of Chicago
+ * 
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libmobject-store.h>
+
+/* Measures the throughput of large reads and writes of a single object
+ * when they are split into 1 to max_requests concurrent sub-requests
+ * (see mobject_store_set_split), doubling the number of sub-requests
+ * at each step. Each step writes then reads back the object iterations
+ * times.
+ *
+ * usage: mobject-split-bench [object_size] [chunk_size] [max_requests] [iterations]
+ */
+
+static double wtime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char** argv)
+{
+    size_t object_size = argc > 1 ? strtoul(argv[1], NULL, 0) : 64*1024*1024;
+    size_t chunk_size  = argc > 2 ? strtoul(argv[2], NULL, 0) : 1024*1024;
+    int max_requests   = argc > 3 ? atoi(argv[3]) : 16;
+    int iterations     = argc > 4 ? atoi(argv[4]) : 4;
+    int k, i, ret;
+    size_t j;
+    double t1, t2;
+
+    if(object_size == 0 || chunk_size == 0 || max_requests <= 0 || iterations <= 0) {
+        fprintf(stderr, "usage: %s [object_size] [chunk_size] [max_requests] [iterations]\n", argv[0]);
+        return -1;
+    }
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    ret = mobject_store_connect(cluster);
+    if(ret != 0) {
+        fprintf(stderr, "Error: unable to connect to the mobject cluster\n");
+        return -1;
+    }
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "my-object-pool", &ioctx);
+
+    char* wr_buf = malloc(object_size);
+    char* rd_buf = malloc(object_size);
+    for(j = 0; j < object_size; j++) wr_buf[j] = 'A' + (j % 26);
+
+    for(k = 1; k <= max_requests; k *= 2) {
+        mobject_store_set_split(cluster, chunk_size, k);
+
+        /* write phase */
+        t1 = wtime();
+        for(i = 0; i < iterations; i++) {
+            mobject_store_write_op_t write_op = mobject_store_create_write_op();
+            mobject_store_write_op_write(write_op, wr_buf, object_size, 0);
+            ret = mobject_store_write_op_operate(write_op, ioctx, "split-bench-object",
+                    NULL, LIBMOBJECT_OPERATION_NOFLAG);
+            mobject_store_release_write_op(write_op);
+            if(ret != 0) fprintf(stderr, "Warning: write returned %d\n", ret);
+        }
+        t2 = wtime();
+        printf("write: %d sub-request(s), %zu bytes, chunk %zu: %.3f sec, %.2f MiB/s\n",
+                k, object_size, chunk_size, (t2-t1)/iterations,
+                iterations*(double)object_size/(1024.0*1024.0*(t2-t1)));
+
+        /* read phase */
+        t1 = wtime();
+        for(i = 0; i < iterations; i++) {
+            size_t bytes_read = 0;
+            int prval = -1;
+            memset(rd_buf, 0, object_size);
+            mobject_store_read_op_t read_op = mobject_store_create_read_op();
+            mobject_store_read_op_read(read_op, 0, object_size, rd_buf, &bytes_read, &prval);
+            ret = mobject_store_read_op_operate(read_op, ioctx, "split-bench-object",
+                    LIBMOBJECT_OPERATION_NOFLAG);
+            mobject_store_release_read_op(read_op);
+            if(ret != 0 || prval != 0 || bytes_read != object_size
+            || memcmp(rd_buf, wr_buf, object_size) != 0) {
+                fprintf(stderr, "Warning: read returned %d (prval = %d), %zu bytes\n",
+                        ret, prval, bytes_read);
+            }
+        }
+        t2 = wtime();
+        printf("read: %d sub-request(s), %zu bytes, chunk %zu: %.3f sec, %.2f MiB/s\n",
+                k, object_size, chunk_size, (t2-t1)/iterations,
+                iterations*(double)object_size/(1024.0*1024.0*(t2-t1)));
+    }
+
+    free(rd_buf);
+    free(wr_buf);
+
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#!/bin/bash -x
+#
+# Runs the range-split benchmark against a single server, the
+# sub-requests of an operation all going to the same server.
+# usage: mobject-split-bench.sh [object_size] [chunk_size] [max_requests] [iterations]
+
+if [ -z $srcdir ]; then
+    srcdir=.
+fi
+if [ -z "$MKTEMP" ] ; then
+    MKTEMP=mktemp
+fi
+if [ -z "$TIMEOUT" ] ; then
+    TIMEOUT=timeout
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+TEST_DIR=`$MKTEMP -d /tmp/mobject-split-bench-XXXXXX`
+MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+mobject_test_start_servers 1 2 300 $MOBJECT_CLUSTER_FILE
+
+export MOBJECT_CLUSTER_FILE
+export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+run_to 240 tests/mobject-split-bench "$@"
+
+wait
+rm -rf $TEST_DIR
+
+exit 0
@@ -0,0 +1,116 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <margo.h>
+#include <libmobject-store.h>
+#include <libmobject-striper.h>
+
+/* small layout, so that the object spans several object sets */
+#define STRIPE_UNIT  4096
+#define STRIPE_COUNT 3
+#define OBJECT_SIZE  8192
+#define DATA_SIZE    (100*1024+17)
+#define DATA_OFFSET  1000
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    size_t i;
+    uint64_t size = 0;
+    char* content  = (char*)calloc(1, DATA_OFFSET + DATA_SIZE + 8);
+    char* read_buf = (char*)calloc(1, DATA_OFFSET + DATA_SIZE + 64);
+
+    for(i = 0; i < DATA_SIZE; i++) content[DATA_OFFSET + i] = 'A' + (i % 26);
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "striped-pool", &ioctx);
+    mobject_striper_t striper;
+    mobject_striper_create(ioctx, &striper);
+
+    if(mobject_striper_set_object_layout_stripe_unit(striper, STRIPE_UNIT) != 0
+    || mobject_striper_set_object_layout_object_size(striper, OBJECT_SIZE) != 0
+    || mobject_striper_set_object_layout_stripe_count(striper, STRIPE_COUNT) != 0) {
+        fprintf(stderr, "Error: could not set the striper layout\n");
+        ret = -1;
+        goto finish;
+    }
+
+    { // WRITE at an offset, leaving a hole at the beginning
+        ret = mobject_striper_write(striper, "striped-object",
+                content + DATA_OFFSET, DATA_SIZE, DATA_OFFSET);
+        if(ret != 0) {
+            fprintf(stderr, "Error: striped write failed (ret = %d)\n", ret);
+            goto finish;
+        }
+    }
+
+    { // APPEND
+        ret = mobject_striper_append(striper, "striped-object", "ZZZZZZZZ", 8);
+        if(ret != 0) {
+            fprintf(stderr, "Error: striped append failed (ret = %d)\n", ret);
+            goto finish;
+        }
+        memcpy(content + DATA_OFFSET + DATA_SIZE, "ZZZZZZZZ", 8);
+    }
+
+    { // STAT and READ the whole object back
+        ret = mobject_striper_stat(striper, "striped-object", &size, NULL);
+        if(ret != 0 || size != DATA_OFFSET + DATA_SIZE + 8) {
+            fprintf(stderr, "Error: stat returned ret = %d, size = %lu\n", ret, size);
+            ret = -1;
+            goto finish;
+        }
+        int r = mobject_striper_read(striper, "striped-object",
+                read_buf, DATA_OFFSET + DATA_SIZE + 64, 0);
+        if(r != DATA_OFFSET + DATA_SIZE + 8
+        || memcmp(read_buf, content, DATA_OFFSET + DATA_SIZE + 8) != 0) {
+            fprintf(stderr, "Error: striped read returned %d\n", r);
+            ret = -1;
+            goto finish;
+        }
+    }
+
+    { // TRUNCATE in the middle of an object set
+        ret = mobject_striper_trunc(striper, "striped-object", 30000);
+        if(ret == 0) ret = mobject_striper_stat(striper, "striped-object", &size, NULL);
+        if(ret != 0 || size != 30000) {
+            fprintf(stderr, "Error: truncate returned ret = %d, size = %lu\n", ret, size);
+            ret = -1;
+            goto finish;
+        }
+        memset(read_buf, 0, DATA_OFFSET + DATA_SIZE + 64);
+        int r = mobject_striper_read(striper, "striped-object", read_buf, 40000, 20000);
+        if(r != 10000 || memcmp(read_buf, content + 20000, 10000) != 0) {
+            fprintf(stderr, "Error: read after truncate returned %d\n", r);
+            ret = -1;
+            goto finish;
+        }
+    }
+
+    { // REMOVE
+        ret = mobject_striper_remove(striper, "striped-object");
+        if(ret != 0) {
+            fprintf(stderr, "Error: striped remove failed (ret = %d)\n", ret);
+            goto finish;
+        }
+        if(mobject_striper_stat(striper, "striped-object", &size, NULL) == 0) {
+            fprintf(stderr, "Error: striped object still exists after remove\n");
+            ret = -1;
+            goto finish;
+        }
+    }
+
+finish:
+    mobject_striper_destroy(striper);
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+    free(content);
+    free(read_buf);
+
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#!/bin/bash -x
+#
+# Runs the AIO throughput benchmark against a single server using
+# 1 to MAX_TARGETS bake targets. The targets are created in
+# TARGET_DIR (/dev/shm by default); point it to a directory per
+# device, or set TARGET_FILES to a list of pool files, to measure
+# how write bandwidth scales with the number of devices.
+# usage: mobject-targets-bench.sh [max_targets] [num_objects] [object_size] [window]
+
+if [ -z $srcdir ]; then
+    srcdir=.
+fi
+if [ -z "$MKTEMP" ] ; then
+    MKTEMP=mktemp
+fi
+if [ -z "$TIMEOUT" ] ; then
+    TIMEOUT=timeout
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+MAX_TARGETS=${1:-4}
+shift
+TARGET_DIR=${TARGET_DIR:-/dev/shm}
+if [ -z "$TARGET_FILES" ]; then
+    for t in `seq 1 $MAX_TARGETS`; do
+        TARGET_FILES="$TARGET_FILES $TARGET_DIR/mobject-target-$t.dat"
+    done
+fi
+
+for ntargets in `seq 1 $MAX_TARGETS`; do
+    TEST_DIR=`$MKTEMP -d /tmp/mobject-targets-bench-XXXXXX`
+    MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+    POOL_ARGS=""
+    for f in `echo $TARGET_FILES | cut -d' ' -f1-$ntargets`; do
+        rm -f $f
+        POOL_ARGS="$POOL_ARGS --pool-file $f"
+    done
+
+    mobject_test_start_servers 1 2 300 $MOBJECT_CLUSTER_FILE /dev/shm/mobject.dat $POOL_ARGS
+
+    export MOBJECT_CLUSTER_FILE
+    export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+    echo "### $ntargets target(s)"
+    run_to 240 tests/mobject-aio-bench "$@"
+
+    wait
+    rm -rf $TEST_DIR
+done
+
+for f in $TARGET_FILES; do
+    rm -f $f
+done
+
+exit 0
@@ -0,0 +1,99 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <margo.h>
+#include <libmobject-store.h>
+
+#define NUM_OBJECTS 16
+#define BUF_SIZE    4096
+
+/* The server of this test has two bake targets, over which the
+   regions of the writes below are spread. */
+
+static int check_content(mobject_store_ioctx_t ioctx, const char* name, int i)
+{
+    char read_buf[BUF_SIZE];
+    size_t bytes_read = 0;
+    int prval = -1;
+    int j;
+
+    mobject_store_read_op_t read_op = mobject_store_create_read_op();
+    mobject_store_read_op_read(read_op, 0, BUF_SIZE, read_buf, &bytes_read, &prval);
+    mobject_store_read_op_operate(read_op, ioctx, name, LIBMOBJECT_OPERATION_NOFLAG);
+    mobject_store_release_read_op(read_op);
+    if(bytes_read != BUF_SIZE || prval != 0) return -1;
+    for(j = 0; j < BUF_SIZE; j++) {
+        char expected = j < BUF_SIZE/2 ? 'a'+(i%26) : 'A'+(i%26);
+        if(read_buf[j] != expected) return -1;
+    }
+    return 0;
+}
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int i;
+
+    char name[32];
+    char write_buf[BUF_SIZE];
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "targets-pool", &ioctx);
+
+    // each object gets two regions, usually on different targets
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        sprintf(name, "targets-object-%d", i);
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        memset(write_buf, 'A'+(i%26), BUF_SIZE);
+        mobject_store_write_op_write_full(write_op, write_buf, BUF_SIZE);
+        if(mobject_store_write_op_operate(write_op, ioctx, name, NULL,
+                    LIBMOBJECT_OPERATION_NOFLAG) != 0) {
+            fprintf(stderr, "Error: write_full of object %d failed\n", i);
+            ret = -1;
+        }
+        mobject_store_release_write_op(write_op);
+
+        write_op = mobject_store_create_write_op();
+        memset(write_buf, 'a'+(i%26), BUF_SIZE/2);
+        mobject_store_write_op_write(write_op, write_buf, BUF_SIZE/2, 0);
+        if(mobject_store_write_op_operate(write_op, ioctx, name, NULL,
+                    LIBMOBJECT_OPERATION_NOFLAG) != 0) {
+            fprintf(stderr, "Error: write of object %d failed\n", i);
+            ret = -1;
+        }
+        mobject_store_release_write_op(write_op);
+    }
+    if(ret != 0) goto finish;
+
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        sprintf(name, "targets-object-%d", i);
+        if(check_content(ioctx, name, i) != 0) {
+            fprintf(stderr, "Error: unexpected content for object %d\n", i);
+            ret = -1;
+        }
+    }
+    if(ret != 0) goto finish;
+
+    // regions are removed from the target they were created on
+    for(i = 0; i < NUM_OBJECTS; i++) {
+        sprintf(name, "targets-object-%d", i);
+        mobject_store_write_op_t write_op = mobject_store_create_write_op();
+        mobject_store_write_op_remove(write_op);
+        if(mobject_store_write_op_operate(write_op, ioctx, name, NULL,
+                    LIBMOBJECT_OPERATION_NOFLAG) != 0) {
+            fprintf(stderr, "Error: removal of object %d failed\n", i);
+            ret = -1;
+        }
+        mobject_store_release_write_op(write_op);
+    }
+
+finish:
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+if [ -z "$MKTEMP" ] ; then
+    echo expected MKTEMP variable defined to its respective command
+    exit 1
+fi
+source $srcdir/tests/mobject-test-util.sh
+
+TEST_DIR=`$MKTEMP -d /tmp/mobject-targets-test-XXXXXX`
+MOBJECT_CLUSTER_FILE=$TEST_DIR/cluster.gid
+
+##############
+
+# start 1 server with 2 bake targets, 2 second wait, 30s timeout
+mobject_test_start_servers 1 2 30 $MOBJECT_CLUSTER_FILE /dev/shm/mobject.dat \
+    --pool-size 52428800 --pool-file $TEST_DIR/target0.dat --pool-file $TEST_DIR/target1.dat
+
+##############
+
+# export some mobject client env variables
+export MOBJECT_CLUSTER_FILE
+export MOBJECT_SHUTDOWN_KILL_SERVERS=true
+
+# run a multiple targets test client
+run_to 20 tests/mobject-targets-test
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+##############
+
+wait
+
+# cleanup
+rm -rf $TEST_DIR
+
+exit 0
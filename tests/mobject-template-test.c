@@ -0,0 +1,91 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <margo.h>
+#include <libmobject-store.h>
+
+#define NUM_OBJECTS 16
+#define BUF_SIZE    64
+
+/* Main function. */
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int i;
+
+    char name[32];
+    char write_buf[BUF_SIZE];
+    char read_buf[BUF_SIZE];
+    size_t bytes_read = 0;
+    int prval = -1;
+
+    mobject_store_t cluster;
+    mobject_store_create(&cluster, "admin");
+    mobject_store_connect(cluster);
+    mobject_store_ioctx_t ioctx;
+    mobject_store_ioctx_create(cluster, "template-pool", &ioctx);
+
+    // both operations are registered once and sent for every object
+    mobject_store_write_op_t write_op = mobject_store_create_write_op();
+    mobject_store_write_op_write(write_op, write_buf, BUF_SIZE, 0);
+    mobject_store_read_op_t read_op = mobject_store_create_read_op();
+    mobject_store_read_op_read(read_op, 0, BUF_SIZE, read_buf, &bytes_read, &prval);
+
+    if(mobject_store_write_op_prepare(write_op, ioctx) != 0
+    || mobject_store_read_op_prepare(read_op, ioctx) != 0) {
+        fprintf(stderr, "Error: could not prepare the operations\n");
+        ret = -1;
+        goto finish;
+    }
+
+    for(i = 0; i < NUM_OBJECTS; i++)
+    {
+        // object i receives i+1 bytes at offset i
+        size_t len = i+1;
+        sprintf(name, "template-object-%d", i);
+        memset(write_buf, 'A'+i, BUF_SIZE);
+
+        mobject_store_write_op_update(write_op, 0, i, len);
+        ret = mobject_store_write_op_operate(write_op, ioctx, name, NULL, LIBMOBJECT_OPERATION_NOFLAG);
+        if(ret != 0) {
+            fprintf(stderr, "Error: write of %s failed (ret = %d)\n", name, ret);
+            goto finish;
+        }
+    }
+
+    // updating an action beyond its registered length must fail
+    if(mobject_store_write_op_update(write_op, 0, 0, BUF_SIZE+1) == 0) {
+        fprintf(stderr, "Error: update beyond the prepared buffer succeeded\n");
+        ret = -1;
+        goto finish;
+    }
+
+    for(i = 0; i < NUM_OBJECTS; i++)
+    {
+        size_t len = i+1;
+        sprintf(name, "template-object-%d", i);
+        memset(read_buf, 0, BUF_SIZE);
+        bytes_read = 0;
+        prval = -1;
+
+        mobject_store_read_op_update(read_op, 0, i, len);
+        ret = mobject_store_read_op_operate(read_op, ioctx, name, LIBMOBJECT_OPERATION_NOFLAG);
+
+        char expected[BUF_SIZE];
+        memset(expected, 'A'+i, len);
+        if(ret != 0 || prval != 0 || bytes_read != len || memcmp(read_buf, expected, len) != 0) {
+            fprintf(stderr, "Error: read of %s returned ret = %d, prval = %d, bytes_read = %ld\n",
+                    name, ret, prval, bytes_read);
+            ret = -1;
+            goto finish;
+        }
+    }
+
+finish:
+    mobject_store_release_write_op(write_op);
+    mobject_store_release_read_op(read_op);
+    mobject_store_ioctx_destroy(ioctx);
+    mobject_store_shutdown(cluster);
+
+    return ret == 0 ? 0 : 1;
+}
@@ -21,11 +21,13 @@ function mobject_test_start_servers()
     maxtime=${3:-120}
     cfile=${4:-/tmp/mobject-connect-cluster.gid}
     storage=${5:-/dev/shm/mobject.dat}
+    # remaining arguments are passed to the daemon (e.g. --kv-backend)
+    daemon_args="${@:6}"
 
     rm -rf ${storage}
     bake-mkpool -s 50M /dev/shm/mobject.dat
 
-    run_to $maxtime mpirun -np $nservers src/server/mobject-server-daemon tcp:// $cfile &
+    run_to $maxtime mpirun -np $nservers src/server/mobject-server-daemon $daemon_args tcp:// $cfile &
     if [ $? -ne 0 ]; then
         # TODO: this doesn't actually work; can't check return code of
         # something executing in background.  We have to rely on the